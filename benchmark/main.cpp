@@ -0,0 +1,222 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <easy/profiler.h>
+
+// Measures per-call cost of instrumentation hot paths (in nanoseconds per operation)
+// for 1..N threads and writes results as JSON.
+//
+// Usage: profiler_benchmark [output.json] [max threads] [iterations per thread]
+
+uint32_t ITERATIONS = 200000;
+
+const char* const TEMP_FILENAME = "profiler_benchmark.prof";
+
+//////////////////////////////////////////////////////////////////////////
+
+void blockEnabled(uint32_t _iterations)
+{
+    EASY_BLOCK("Benchmark");
+    for (uint32_t i = 0; i < _iterations; ++i)
+    {
+        EASY_BLOCK("Block");
+    }
+}
+
+void blockWithoutChildren(uint32_t _iterations)
+{
+    EASY_BLOCK("Benchmark", profiler::ON_WITHOUT_CHILDREN);
+    for (uint32_t i = 0; i < _iterations; ++i)
+    {
+        EASY_BLOCK("Block");
+    }
+}
+
+void event(uint32_t _iterations)
+{
+    EASY_BLOCK("Benchmark");
+    for (uint32_t i = 0; i < _iterations; ++i)
+    {
+        EASY_EVENT("Event");
+    }
+}
+
+void nonscopedBlock(uint32_t _iterations)
+{
+    EASY_BLOCK("Benchmark");
+    for (uint32_t i = 0; i < _iterations; ++i)
+    {
+        EASY_NONSCOPED_BLOCK("Nonscoped");
+        EASY_END_BLOCK;
+    }
+}
+
+void runtimeName(uint32_t _iterations)
+{
+    const char* name = "Runtime name of the block";
+
+    EASY_BLOCK("Benchmark");
+    for (uint32_t i = 0; i < _iterations; ++i)
+    {
+        EASY_BLOCK(name);
+    }
+}
+
+void storageExpansion(uint32_t _iterations)
+{
+    // Long runtime names fill storage chunks quickly, so a new chunk is allocated every few blocks
+    const std::string name(256, 'x');
+    const char* runtime = name.c_str();
+
+    EASY_BLOCK("Benchmark");
+    for (uint32_t i = 0; i < _iterations; ++i)
+    {
+        EASY_BLOCK(runtime);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+struct Benchmark
+{
+    const char*              name;
+    void               (*func)(uint32_t);
+    bool                  enabled;
+};
+
+struct Result
+{
+    const char* name;
+    uint32_t threads;
+    double nsPerOp;
+};
+
+double run(const Benchmark& _benchmark, uint32_t _threadsNumber)
+{
+    std::atomic<uint32_t> ready(0);
+    std::atomic<bool> start(false);
+    std::vector<double> durations(_threadsNumber, 0.0);
+    std::vector<std::thread> threads;
+
+    for (uint32_t t = 0; t < _threadsNumber; ++t)
+    {
+        threads.emplace_back([&, t]()
+        {
+            // Warm up: register thread and block descriptors
+            _benchmark.func(16);
+
+            ready.fetch_add(1, std::memory_order_acq_rel);
+            while (!start.load(std::memory_order_acquire))
+                std::this_thread::yield();
+
+            const auto begin = std::chrono::steady_clock::now();
+            _benchmark.func(ITERATIONS);
+            const auto end = std::chrono::steady_clock::now();
+
+            durations[t] = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+        });
+    }
+
+    while (ready.load(std::memory_order_acquire) != _threadsNumber)
+        std::this_thread::yield();
+    start.store(true, std::memory_order_release);
+
+    for (auto& thread : threads)
+        thread.join();
+
+    double total = 0;
+    for (auto duration : durations)
+        total += duration;
+
+    return total / _threadsNumber / ITERATIONS;
+}
+
+void writeJson(std::ostream& _output, const std::vector<Result>& _results)
+{
+    _output << "{\n  \"version\": \"" << (int)profiler::versionMajor() << "." << (int)profiler::versionMinor() << "." << profiler::versionPatch()
+            << "\",\n  \"iterations\": " << ITERATIONS << ",\n  \"results\": [";
+
+    for (size_t i = 0; i < _results.size(); ++i)
+    {
+        const auto& result = _results[i];
+        _output << (i == 0 ? "\n" : ",\n") << "    {\"name\": \"" << result.name << "\", \"threads\": " << result.threads
+                << ", \"ns_per_op\": " << result.nsPerOp << "}";
+    }
+
+    _output << "\n  ]\n}\n";
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char* argv[])
+{
+    const char* outputFilename = nullptr;
+    uint32_t maxThreads = std::max(std::thread::hardware_concurrency(), 1U);
+
+    if (argc > 1 && argv[1]){
+        outputFilename = argv[1];
+    }
+    if (argc > 2 && argv[2]){
+        maxThreads = static_cast<uint32_t>(std::max(std::atoi(argv[2]), 1));
+    }
+    if (argc > 3 && argv[3]){
+        ITERATIONS = static_cast<uint32_t>(std::max(std::atoi(argv[3]), 1));
+    }
+
+    const Benchmark benchmarks[] = {
+        {"block_enabled",          blockEnabled,         true},
+        {"block_disabled",         blockEnabled,         false},
+        {"block_without_children", blockWithoutChildren, true},
+        {"event",                  event,                true},
+        {"nonscoped_block",        nonscopedBlock,       true},
+        {"runtime_name",           runtimeName,          true},
+        {"storage_expansion",      storageExpansion,     true},
+    };
+
+    std::vector<Result> results;
+    for (const auto& benchmark : benchmarks)
+    {
+        for (uint32_t threadsNumber = 1; threadsNumber <= maxThreads; threadsNumber = threadsNumber < maxThreads ? std::min(threadsNumber * 2, maxThreads) : maxThreads + 1)
+        {
+            if (benchmark.enabled)
+                profiler::setEnabled(true);
+
+            const Result result = {benchmark.name, threadsNumber, run(benchmark, threadsNumber)};
+            results.push_back(result);
+
+            // Dumping frees memory used by stored blocks, so every run starts with empty storage
+            profiler::dumpBlocksToFile(TEMP_FILENAME);
+            profiler::setEnabled(false);
+
+            std::cerr << benchmark.name << " threads=" << threadsNumber << ": " << result.nsPerOp << " ns/op" << std::endl;
+        }
+    }
+
+    std::remove(TEMP_FILENAME);
+
+    if (outputFilename != nullptr)
+    {
+        std::ofstream outputFile(outputFilename);
+        if (!outputFile.is_open())
+        {
+            std::cerr << "Can not open " << outputFilename << " for writing" << std::endl;
+            return 1;
+        }
+
+        writeJson(outputFile, results);
+    }
+    else
+    {
+        writeJson(std::cout, results);
+    }
+
+    return 0;
+}
@@ -54,23 +54,11 @@
 namespace profiler {
 
 #ifndef EASY_PROFILER_API_DISABLED
-Event::Event(timestamp_t _begin_time) : m_begin(_begin_time), m_end(0)
-{
-
-}
-
 Event::Event(timestamp_t _begin_time, timestamp_t _end_time) : m_begin(_begin_time), m_end(_end_time)
 {
 
 }
 
-BaseBlockData::BaseBlockData(timestamp_t _begin_time, block_id_t _descriptor_id)
-    : Event(_begin_time)
-    , m_id(_descriptor_id)
-{
-
-}
-
 BaseBlockData::BaseBlockData(timestamp_t _begin_time, timestamp_t _end_time, block_id_t _descriptor_id)
     : Event(_begin_time, _end_time)
     , m_id(_descriptor_id)
@@ -83,6 +71,7 @@ Block::Block(Block&& that)
     , m_name(that.m_name)
     , m_status(that.m_status)
     , m_isScoped(that.m_isScoped)
+    , m_silentIndex(0)
 {
     m_end = that.m_end;
     that.m_end = that.m_begin;
@@ -93,6 +82,7 @@ Block::Block(timestamp_t _begin_time, block_id_t _descriptor_id, const char* _ru
     , m_name(_runtimeName)
     , m_status(::profiler::ON)
     , m_isScoped(true)
+    , m_silentIndex(0)
 {
 
 }
@@ -102,15 +92,7 @@ Block::Block(timestamp_t _begin_time, timestamp_t _end_time, block_id_t _descrip
     , m_name(_runtimeName)
     , m_status(::profiler::ON)
     , m_isScoped(true)
-{
-
-}
-
-Block::Block(const BaseBlockDescriptor* _descriptor, const char* _runtimeName, bool _scoped)
-    : BaseBlockData(1ULL, _descriptor->id())
-    , m_name(_runtimeName)
-    , m_status(_descriptor->status())
-    , m_isScoped(_scoped)
+    , m_silentIndex(0)
 {
 
 }
@@ -134,30 +116,12 @@ void Block::finish(timestamp_t _time)
 {
     m_end = _time;
 }
-
-Block::~Block()
-{
-    if (!finished())
-        ::profiler::endBlock();
-}
 #else
-Event::Event(timestamp_t) : m_begin(0), m_end(0)
-{
-
-}
-
 Event::Event(timestamp_t, timestamp_t) : m_begin(0), m_end(0)
 {
 
 }
 
-BaseBlockData::BaseBlockData(timestamp_t, block_id_t)
-    : Event(0, 0)
-    , m_id(~0U)
-{
-
-}
-
 BaseBlockData::BaseBlockData(timestamp_t, timestamp_t, block_id_t)
     : Event(0, 0)
     , m_id(~0U)
@@ -170,6 +134,7 @@ Block::Block(Block&& that)
     , m_name("")
     , m_status(::profiler::OFF)
     , m_isScoped(that.m_isScoped)
+    , m_silentIndex(0)
 {
 }
 
@@ -178,6 +143,7 @@ Block::Block(timestamp_t, block_id_t, const char*)
     , m_name("")
     , m_status(::profiler::OFF)
     , m_isScoped(true)
+    , m_silentIndex(0)
 {
 
 }
@@ -187,15 +153,7 @@ Block::Block(timestamp_t, timestamp_t, block_id_t, const char*)
     , m_name("")
     , m_status(::profiler::OFF)
     , m_isScoped(true)
-{
-
-}
-
-Block::Block(const BaseBlockDescriptor*, const char*, bool _scoped)
-    : BaseBlockData(0, ~0U)
-    , m_name("")
-    , m_status(::profiler::OFF)
-    , m_isScoped(_scoped)
+    , m_silentIndex(0)
 {
 
 }
@@ -215,10 +173,6 @@ void Block::finish()
 void Block::finish(timestamp_t)
 {
 }
-
-Block::~Block()
-{
-}
 #endif
 
 //////////////////////////////////////////////////////////////////////////
@@ -47,7 +47,8 @@ The Apache License, Version 2.0 (the "License");
 #include <cstring>
 #include <cstddef>
 #include <stdint.h>
-#include "outstream.h"
+#include <atomic>
+#include <utility>
 
 //////////////////////////////////////////////////////////////////////////
 
@@ -306,199 +307,365 @@ EASY_FORCE_INLINE T unaligned_load64(const void* ptr, T* val)
 template <uint16_t N>
 class chunk_allocator
 {
-    struct chunk { EASY_ALIGNED(char, data[N], EASY_ALIGNMENT_SIZE); chunk* prev = nullptr; };
-
-    struct chunk_list
+    struct chunk
     {
-        chunk* last;
+        EASY_ALIGNED(char, data[N], EASY_ALIGNMENT_SIZE);
+        std::atomic<chunk*>   next; ///< Next chunk. Set by producer when this chunk is filled.
+        std::atomic<uint16_t> size; ///< Number of bytes published by producer (only fully constructed elements are published).
 
-        chunk_list() : last(nullptr)
+        chunk()
         {
             static_assert(sizeof(char) == 1, "easy_profiler logic error: sizeof(char) != 1 for this platform! Please, contact easy_profiler authors to resolve your problem.");
-            emplace_back();
+            next.store(nullptr, std::memory_order_relaxed);
+            size.store(0, std::memory_order_relaxed);
         }
+    };
 
-        ~chunk_list()
-        {
-            do free_last(); while (last != nullptr);
-        }
+    static chunk* new_chunk()
+    {
+        return ::new (EASY_MALLOC(sizeof(chunk), EASY_ALIGNMENT_SIZE)) chunk();
+    }
 
-        void clear_all_except_last()
-        {
-            while (last->prev != nullptr)
-                free_last();
-            zero_last_chunk_size();
-        }
+    static void free_chunk(chunk* _chunk)
+    {
+        _chunk->~chunk();
+        EASY_FREE(_chunk);
+    }
+
+    // Chunks form a single-linked queue: producer (the owner thread) appends new chunks at the tail,
+    // consumer (dumping or flushing thread) writes published elements from the head and frees consumed chunks.
+    // There must be only one producer at a time: storages filled by several threads guard producer side by a lock.
+    // Each element consists of a payload size + a payload as follows:
+    // elementStart[0..1]: size as a uint16_t
+    // elementStart[2..size-1]: payload.
+
+    // Producer side (modified by the owner thread only)
+    chunk*                      m_last; ///< Current chunk.
+    chunk*                   m_visible; ///< The last chunk linked into the queue (visible for consumer).
+    chunk*                   m_pending; ///< Next chunk for m_visible: it is linked by publish() (nullptr if there are no new chunks).
+    uint16_t             m_pendingSize; ///< Final size of m_visible which is published together with m_pending.
+    std::atomic<uint64_t> m_producedSize; ///< Total payload size of all published elements.
+    uint16_t             m_chunkOffset; ///< Number of bytes used in the current chunk.
+
+    // Consumer side (modified by consumer only)
+    chunk*                     m_first; ///< First not consumed chunk.
+    uint64_t            m_consumedSize; ///< Total payload size of all consumed elements.
+    uint16_t              m_readOffset; ///< Number of bytes consumed in the first chunk.
 
-        void emplace_back()
+public:
+
+    /** Position in the chunks queue. Used to consume exactly the elements which have been counted by published().
+    */
+    class position
+    {
+        friend chunk_allocator;
+        chunk*    m_chunk = nullptr;
+        uint16_t m_offset = 0;
+    };
+
+    chunk_allocator()
+        : m_last(new_chunk())
+        , m_visible(m_last)
+        , m_pending(nullptr)
+        , m_pendingSize(0)
+        , m_chunkOffset(0)
+        , m_first(m_last)
+        , m_consumedSize(0)
+        , m_readOffset(0)
+    {
+        m_producedSize.store(0, std::memory_order_relaxed);
+    }
+
+    ~chunk_allocator()
+    {
+        if (m_pending != nullptr)
+            m_visible->next.store(m_pending, std::memory_order_relaxed);
+
+        while (m_first != nullptr)
         {
-            auto prev = last;
-            last = ::new (EASY_MALLOC(sizeof(chunk), EASY_ALIGNMENT_SIZE)) chunk();
-            last->prev = prev;
-            zero_last_chunk_size();
+            auto c = m_first;
+            m_first = c->next.load(std::memory_order_relaxed);
+            free_chunk(c);
         }
+    }
 
-        /** Invert current chunks list to enable to iterate over chunks list in direct order.
+    /** Allocate n bytes.
 
-        This method is used by serialize().
-        */
-        void invert()
-        {
-            chunk* next = nullptr;
+    Automatically checks if there is enough preserved memory to store additional n bytes
+    and allocates additional buffer if needed.
 
-            while (last->prev != nullptr) {
-                auto p = last->prev;
-                last->prev = next;
-                next = last;
-                last = p;
+    Allocated element is not visible for consumer until publish() is called,
+    so consumer could read the storage at any time without waiting for the owner thread.
+
+    \note Must be called by producer only.
+    */
+    void* allocate(uint16_t n)
+    {
+        if (need_expand(n))
+        {
+            // Consumer reads a chunk up to it's end once the next chunk is linked, so new chunks
+            // are linked into the queue by publish(): elements of the current chunk may be not constructed yet
+            auto c = new_chunk();
+            if (m_last == m_visible)
+            {
+                m_pending = c;
+                m_pendingSize = m_chunkOffset;
+            }
+            else
+            {
+                m_last->size.store(m_chunkOffset, std::memory_order_relaxed);
+                m_last->next.store(c, std::memory_order_relaxed);
             }
 
-            last->prev = next;
+            m_last = c;
+            m_chunkOffset = 0;
         }
 
-    private:
+        char* data = m_last->data + m_chunkOffset;
+        unaligned_store16(data, n);
 
-        chunk_list(const chunk_list&) = delete;
-        chunk_list(chunk_list&&) = delete;
+        m_chunkOffset += n + sizeof(uint16_t);
+        m_producedSize.store(m_producedSize.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
 
-        void free_last()
-        {
-            auto p = last;
-            last = last->prev;
-            EASY_FREE(p);
-        }
+        return data + sizeof(uint16_t);
+    }
 
-        void zero_last_chunk_size()
+    /** Make all allocated elements visible for consumer.
+
+    Must be called after element construction is finished.
+
+    \note Must be called by producer only.
+    */
+    void publish()
+    {
+        if (m_pending != nullptr)
         {
-            // Although there is no need for unaligned access stuff b/c a new chunk will
-            // usually be at least 8 byte aligned (and we only need 2 byte alignment),
-            // this is the only way I have been able to get rid of the GCC strict-aliasing warning
-            // without using std::memset. It's an extra line, but is just as fast as *(uint16_t*)last->data = 0;
-            char* const data = last->data;
-            *(uint16_t*)data = (uint16_t)0;
+            m_visible->size.store(m_pendingSize, std::memory_order_release);
+            m_visible->next.store(m_pending, std::memory_order_release);
+            m_visible = m_last;
+            m_pending = nullptr;
         }
-    };
 
-    // Used in serialize(): workaround for no constexpr support in MSVC 2013.
-    static const int_fast32_t MAX_CHUNK_OFFSET = N - sizeof(uint16_t);
-    static const uint16_t N_MINUS_ONE = N - 1;
+        m_last->size.store(m_chunkOffset, std::memory_order_release);
+    }
 
-    chunk_list      m_chunks; ///< List of chunks.
-    uint32_t          m_size; ///< Number of elements stored(# of times allocate() has been called.)
-    uint16_t   m_chunkOffset; ///< Number of bytes used in the current chunk.
+    /** Check if current storage is not enough to store additional n bytes.
+    */
+    bool need_expand(uint16_t n) const
+    {
+        return (m_chunkOffset + n + sizeof(uint16_t)) > N;
+    }
 
-public:
+    /** Total payload size of elements which have been published but not consumed yet.
 
-    chunk_allocator() : m_size(0), m_chunkOffset(0)
+    \note Must be called by consumer only.
+    */
+    uint64_t resident_size() const
     {
+        return m_producedSize.load(std::memory_order_relaxed) - m_consumedSize;
     }
 
-    /** Allocate n bytes.
+    /** Count elements published by producer up to this moment.
 
-    Automatically checks if there is enough preserved memory to store additional n bytes
-    and allocates additional buffer if needed.
+    \note Must be called by consumer only.
+
+    \param _end Position of the last published element would be stored here. Use it with consume().
+    \param _memorySize Total payload size of published elements would be added to this value.
+
+    \retval Number of published elements.
     */
-    void* allocate(uint16_t n)
+    uint32_t published(position& _end, uint64_t& _memorySize) const
     {
-        ++m_size;
+        uint32_t elementsNumber = 0;
+        const chunk* current = m_first;
+        uint16_t offset = m_readOffset;
 
-        if (!need_expand(n))
+        for (;;)
         {
-            // Temp to avoid extra load due to this* aliasing.
-            uint16_t chunkOffset = m_chunkOffset;
-            char* data = m_chunks.last->data + chunkOffset;
-            chunkOffset += n + sizeof(uint16_t);
-            m_chunkOffset = chunkOffset;
-
-            unaligned_store16(data, n);
-            data += sizeof(uint16_t);
+            auto size = current->size.load(std::memory_order_acquire);
+            elementsNumber += count(current, offset, size, _memorySize);
+
+            const auto next = current->next.load(std::memory_order_acquire);
+            if (next == nullptr)
+            {
+                _end.m_chunk = const_cast<chunk*>(current);
+                _end.m_offset = size;
+                break;
+            }
 
-            // If there is enough space for at least another payload size,
-            // set it to zero.
-            if (chunkOffset < N_MINUS_ONE)
-                unaligned_zero16(data + n);
+            // Producer never modifies the chunk after linking the next one:
+            // re-read its size to count elements published between two loads.
+            offset = size;
+            size = current->size.load(std::memory_order_acquire);
+            elementsNumber += count(current, offset, size, _memorySize);
 
-            return data;
+            current = next;
+            offset = 0;
         }
 
-        m_chunkOffset = n + sizeof(uint16_t);
-        m_chunks.emplace_back();
+        return elementsNumber;
+    }
 
-        char* data = m_chunks.last->data;
-        unaligned_store16(data, n);
-        data += sizeof(uint16_t);
-        
-        // We assume here that it takes more than one element to fill a chunk.
-        unaligned_zero16(data + n);
+    /** Pass elements up to the _end position to the _func and free consumed chunks.
 
-        return data;
-    }
+    Could be called concurrently with allocate() and publish().
 
-    /** Check if current storage is not enough to store additional n bytes.
+    \note Must be called by consumer only.
+
+    \param _end Position returned by published().
+    \param _func Functor called for each element with element payload and it's size: _func(const char*, uint16_t).
     */
-    bool need_expand(uint16_t n) const
+    template <class TFunc>
+    void consume(const position& _end, TFunc&& _func)
     {
-        return (m_chunkOffset + n + sizeof(uint16_t)) > N;
+        for (;;)
+        {
+            const bool last = m_first == _end.m_chunk;
+            const uint16_t size = last ? _end.m_offset : m_first->size.load(std::memory_order_acquire);
+
+            const char* data = m_first->data;
+            while (m_readOffset < size)
+            {
+                const auto payloadSize = unaligned_load16<uint16_t>(data + m_readOffset);
+                _func(data + m_readOffset + sizeof(uint16_t), payloadSize);
+                m_readOffset += sizeof(uint16_t) + payloadSize;
+                m_consumedSize += payloadSize;
+            }
+
+            if (last)
+                break;
+
+            auto c = m_first;
+            m_first = c->next.load(std::memory_order_acquire);
+            m_readOffset = 0;
+            free_chunk(c);
+        }
     }
 
-    uint32_t size() const
+    /** Pass elements up to the _end position to the _func without consuming them.
+
+    Elements stay in the storage and would be passed again by the next read() or consume().
+    Could be called concurrently with allocate() and publish().
+
+    \note Must be called by consumer only.
+
+    \param _end Position returned by published().
+    \param _func Functor called for each element with element payload and it's size: _func(const char*, uint16_t).
+    */
+    template <class TFunc>
+    void read(const position& _end, TFunc&& _func) const
     {
-        return m_size;
+        const chunk* current = m_first;
+        uint16_t offset = m_readOffset;
+
+        for (;;)
+        {
+            const bool last = current == _end.m_chunk;
+            const uint16_t size = last ? _end.m_offset : current->size.load(std::memory_order_acquire);
+
+            const char* data = current->data;
+            while (offset < size)
+            {
+                const auto payloadSize = unaligned_load16<uint16_t>(data + offset);
+                _func(data + offset + sizeof(uint16_t), payloadSize);
+                offset += sizeof(uint16_t) + payloadSize;
+            }
+
+            if (last)
+                break;
+
+            current = current->next.load(std::memory_order_acquire);
+            offset = 0;
+        }
     }
 
-    bool empty() const
+    /** Count elements up to the _end position which satisfy the _pred without consuming them.
+
+    \note Must be called by consumer only.
+
+    \param _end Position returned by published().
+    \param _memorySize Total payload size of counted elements would be added to this value.
+    \param _pred Predicate called for each element payload: _pred(const char*).
+
+    \retval Number of counted elements.
+    */
+    template <class TPred>
+    uint32_t count_if(const position& _end, uint64_t& _memorySize, TPred&& _pred) const
     {
-        return m_size == 0;
+        uint32_t elementsNumber = 0;
+        read(_end, [&](const char* _data, uint16_t _size) {
+            if (_pred(_data))
+            {
+                ++elementsNumber;
+                _memorySize += _size;
+            }
+        });
+        return elementsNumber;
     }
 
-    void clear()
+    /** Pass all published elements to the _func and free consumed chunks.
+
+    \note Must be called by consumer only.
+
+    \param _memorySize Total payload size of consumed elements would be added to this value.
+
+    \retval Number of consumed elements.
+    */
+    template <class TFunc>
+    uint32_t consume(uint64_t& _memorySize, TFunc&& _func)
     {
-        m_size = 0;
-        m_chunkOffset = 0;
-        m_chunks.clear_all_except_last(); // There is always at least one chunk
+        position end;
+        const auto elementsNumber = published(end, _memorySize);
+        if (elementsNumber != 0)
+            consume(end, std::forward<TFunc>(_func));
+        return elementsNumber;
     }
 
-    /** Serialize data to stream.
+    /** Free the oldest filled chunks (without consuming their elements) while resident size exceeds _maxSize.
 
-    \warning Data will be cleared after serialization.
+    The current chunk is never freed, so resident size may stay greater than _maxSize.
+    Could be called concurrently with allocate() and publish().
+
+    \note Must be called by consumer only.
+
+    \retval Number of dropped elements.
     */
-    void serialize(profiler::OStream& _outputStream)
+    uint32_t trim(uint64_t _maxSize)
     {
-        // Chunks are stored in reversed order (stack).
-        // To be able to iterate them in direct order we have to invert the chunks list.
-        m_chunks.invert();
-
-        // Each chunk is an array of N bytes that can hold between
-        // 1(if the list isn't empty) and however many elements can fit in a chunk,
-        // where an element consists of a payload size + a payload as follows:
-        // elementStart[0..1]: size as a uint16_t
-        // elementStart[2..size-1]: payload.
-        
-        // The maximum chunk offset is N-sizeof(uint16_t) b/c, if we hit that (or go past),
-        // there is either no space left, 1 byte left, or 2 bytes left, all of which are
-        // too small to cary more than a zero-sized element.
-
-        chunk* current = m_chunks.last;
-        do {
-            const char* data = current->data;
-            int_fast32_t chunkOffset = 0; // signed int so overflow is not checked.
-            uint16_t payloadSize = unaligned_load16<uint16_t>(data);
-            while (chunkOffset < MAX_CHUNK_OFFSET && payloadSize != 0) {
-                const uint16_t chunkSize = sizeof(uint16_t) + payloadSize;
-                _outputStream.write(data, chunkSize);
-                data += chunkSize;
-                chunkOffset += chunkSize;
-                unaligned_load16(data, &payloadSize);
-            }
+        uint32_t elementsNumber = 0;
+        while (resident_size() > _maxSize)
+        {
+            const auto next = m_first->next.load(std::memory_order_acquire);
+            if (next == nullptr)
+                break;
+
+            elementsNumber += count(m_first, m_readOffset, m_first->size.load(std::memory_order_acquire), m_consumedSize);
 
-            current = current->prev;
-        } while (current != nullptr);
+            free_chunk(m_first);
+            m_first = next;
+            m_readOffset = 0;
+        }
 
-        clear();
+        return elementsNumber;
     }
 
 private:
 
+    static uint32_t count(const chunk* _chunk, uint16_t _begin, uint16_t _end, uint64_t& _memorySize)
+    {
+        uint32_t elementsNumber = 0;
+        const char* data = _chunk->data;
+        while (_begin < _end)
+        {
+            const auto payloadSize = unaligned_load16<uint16_t>(data + _begin);
+            _begin += sizeof(uint16_t) + payloadSize;
+            _memorySize += payloadSize;
+            ++elementsNumber;
+        }
+
+        return elementsNumber;
+    }
+
     chunk_allocator(const chunk_allocator&) = delete;
     chunk_allocator(chunk_allocator&&) = delete;
 
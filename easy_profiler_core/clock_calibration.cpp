@@ -0,0 +1,355 @@
+/**
+Lightweight profiler library for c++
+Copyright(C) 2016-2017  Sergey Yagovtsev, Victor Zarubkin
+
+Licensed under either of
+    * MIT license (LICENSE.MIT or http://opensource.org/licenses/MIT)
+    * Apache License, Version 2.0, (LICENSE.APACHE or http://www.apache.org/licenses/LICENSE-2.0)
+at your option.
+
+The MIT License
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights 
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies 
+    of the Software, and to permit persons to whom the Software is furnished 
+    to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all 
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+    PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE 
+    LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE 
+    USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+The Apache License, Version 2.0 (the "License");
+    You may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+
+**/
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include "clock_calibration.h"
+#include "current_time.h"
+
+#ifdef EASY_SELECTABLE_CLOCK_SOURCE
+std::atomic<uint8_t> CLOCK_SOURCE = ATOMIC_VAR_INIT(profiler::CLOCK_SOURCE_DEFAULT);
+std::atomic<TimeFunction> TIME_FUNCTION = ATOMIC_VAR_INIT(nullptr);
+#endif
+
+#if !defined(_WIN32)
+
+#include <time.h>
+
+#if defined(__APPLE__)
+# include <mach/mach_time.h>
+#endif
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__i386__) || defined(__x86_64__) || defined(__amd64__))
+# include <cpuid.h>
+# define EASY_CPUID_AVAILABLE
+#endif
+
+//////////////////////////////////////////////////////////////////////////
+
+static uint64_t monotonic_nanoseconds()
+{
+#if defined(__APPLE__)
+    static const mach_timebase_info_data_t timebase = ([](){ mach_timebase_info_data_t info; mach_timebase_info(&info); return info; })();
+    return mach_absolute_time() * timebase.numer / timebase.denom;
+#else
+    struct timespec ts;
+# ifdef CLOCK_MONOTONIC_RAW
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts); // not affected by NTP frequency adjustments
+# else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+# endif
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+#endif
+}
+
+/** Read counter and monotonic clock as close to each other as possible.
+
+The shortest of several attempts is taken to reduce the error caused by preemption.
+*/
+static void read_clocks(profiler::timestamp_t& _ticks, uint64_t& _nanoseconds)
+{
+    profiler::timestamp_t shortest = ~0ULL;
+    for (int i = 0; i < 5; ++i)
+    {
+        const auto before = getCurrentTime();
+        const auto nanoseconds = monotonic_nanoseconds();
+        const auto after = getCurrentTime();
+
+        if (after - before < shortest)
+        {
+            shortest = after - before;
+            _ticks = before + shortest / 2;
+            _nanoseconds = nanoseconds;
+        }
+    }
+}
+
+/** Get counter frequency (in kHz) reported by the hardware or OS.
+
+\retval 0 if the frequency is not reported exactly and must be calibrated.
+*/
+static int64_t reported_frequency()
+{
+#if defined(EASY_CPUID_AVAILABLE)
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & (1U << 31)) != 0)
+    {
+        // Running under hypervisor: VMware and KVM report TSC frequency (in kHz) in timing information leaf
+        __cpuid(0x40000000, eax, ebx, ecx, edx);
+
+        char vendor[13] = {};
+        memcpy(vendor, &ebx, 4);
+        memcpy(vendor + 4, &ecx, 4);
+        memcpy(vendor + 8, &edx, 4);
+
+        if (eax >= 0x40000010 && (strcmp(vendor, "VMwareVMware") == 0 || strcmp(vendor, "KVMKVMKVM") == 0))
+        {
+            __cpuid(0x40000010, eax, ebx, ecx, edx);
+            if (eax != 0)
+                return static_cast<int64_t>(eax);
+        }
+    }
+
+    // Counter frequency is constant only if TSC is invariant
+    if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) || (edx & (1U << 8)) == 0)
+        return 0;
+
+    // TSC to core crystal clock ratio (ebx/eax) and crystal clock frequency in Hz (ecx)
+    if (__get_cpuid(0x15, &eax, &ebx, &ecx, &edx) && eax != 0 && ebx != 0 && ecx != 0)
+        return static_cast<int64_t>(static_cast<uint64_t>(ecx) * ebx / eax / 1000);
+
+# if defined(__linux__)
+    // Exported by some kernels when TSC frequency is known
+    std::ifstream file("/sys/devices/system/cpu/cpu0/tsc_freq_khz");
+    int64_t frequency = 0;
+    if (file >> frequency && frequency > 0)
+        return frequency;
+# endif
+#elif defined(__aarch64__) && !defined(EASY_CHRONO_CLOCK)
+    // getCurrentTime() reads virtual system timer which frequency is stored in CNTFRQ_EL0
+    uint64_t frequency = 0;
+    asm volatile("mrs %0, cntfrq_el0" : "=r"(frequency));
+    if (frequency >= 1000)
+        return static_cast<int64_t>(frequency / 1000);
+#endif
+
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+ClockCalibration::ClockCalibration() : m_baseTicks(0), m_baseNanoseconds(0)
+{
+    m_frequency = ATOMIC_VAR_INIT(0);
+}
+
+ClockCalibration::~ClockCalibration()
+{
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+void ClockCalibration::start()
+{
+    if (m_thread.joinable())
+        m_thread.join();
+
+    m_frequency.store(0, std::memory_order_release);
+    read_clocks(m_baseTicks, m_baseNanoseconds);
+
+#ifdef EASY_SELECTABLE_CLOCK_SOURCE
+    // clock_gettime() returns nanoseconds
+    const auto frequency = CLOCK_SOURCE.load(std::memory_order_acquire) == profiler::CLOCK_SOURCE_CLOCK_GETTIME ? 1000000LL : reported_frequency();
+#else
+    const auto frequency = reported_frequency();
+#endif
+    if (frequency != 0)
+        m_frequency.store(frequency, std::memory_order_release);
+    else
+        m_thread = std::thread(&ClockCalibration::calibrate, this);
+}
+
+int64_t ClockCalibration::frequency()
+{
+    auto frequency = m_frequency.load(std::memory_order_acquire);
+    while (frequency == 0)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        frequency = m_frequency.load(std::memory_order_acquire);
+    }
+
+    return frequency;
+}
+
+int64_t ClockCalibration::drift()
+{
+    const auto frequency = this->frequency();
+
+    profiler::timestamp_t ticks = 0;
+    uint64_t nanoseconds = 0;
+    read_clocks(ticks, nanoseconds);
+
+    const auto elapsed = nanoseconds - m_baseNanoseconds;
+    if (elapsed < 100000000ULL)
+        return 0;
+
+    const auto measured = static_cast<double>(ticks - m_baseTicks) * 1e6 / static_cast<double>(elapsed);
+    return static_cast<int64_t>((measured / static_cast<double>(frequency) - 1.0) * 1e9);
+}
+
+void ClockCalibration::calibrate()
+{
+    // Several short samples instead of one long busy loop: the median rejects samples disturbed by preemption
+    const int SamplesNumber = 5;
+    double samples[SamplesNumber];
+
+    for (int i = 0; i < SamplesNumber; ++i)
+    {
+        profiler::timestamp_t beginTicks = 0, endTicks = 0;
+        uint64_t beginNanoseconds = 0, endNanoseconds = 0;
+
+        read_clocks(beginTicks, beginNanoseconds);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        read_clocks(endTicks, endNanoseconds);
+
+        samples[i] = static_cast<double>(endTicks - beginTicks) * 1e6 / static_cast<double>(endNanoseconds - beginNanoseconds);
+    }
+
+    std::sort(samples, samples + SamplesNumber);
+    m_frequency.store(std::max(static_cast<int64_t>(samples[SamplesNumber / 2] + 0.5), int64_t(1)), std::memory_order_release);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+#endif // !defined(_WIN32)
+
+static profiler::timestamp_t read_clock(uint8_t _source)
+{
+#ifdef EASY_SELECTABLE_CLOCK_SOURCE
+    return getTime(_source);
+#else
+    (void)_source;
+    return getCurrentTime();
+#endif
+}
+
+bool is_clock_source_available(uint8_t _source)
+{
+    switch (_source)
+    {
+        case profiler::CLOCK_SOURCE_DEFAULT:
+            return true;
+
+#if defined(EASY_SELECTABLE_CLOCK_SOURCE) && (defined(__i386__) || defined(__x86_64__) || defined(__amd64__))
+        case profiler::CLOCK_SOURCE_RDTSCP:
+        {
+            unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+            return __get_cpuid(0x80000001, &eax, &ebx, &ecx, &edx) && (edx & (1U << 27)) != 0;
+        }
+
+        case profiler::CLOCK_SOURCE_LFENCE_RDTSC:
+        {
+            // lfence is a part of SSE2
+            unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+            return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (edx & (1U << 26)) != 0;
+        }
+#endif
+
+#ifdef EASY_SELECTABLE_CLOCK_SOURCE
+        case profiler::CLOCK_SOURCE_CLOCK_GETTIME:
+            return true;
+#endif
+
+        default:
+            return false;
+    }
+}
+
+bool test_clock_source(uint8_t _source, profiler::ClockTestResult& _result)
+{
+    if (!is_clock_source_available(_source))
+        return false;
+
+    // Cost and monotonicity on the same thread
+    const uint32_t ReadingsNumber = 200000;
+
+    _result.backwardSteps = 0;
+    auto previous = read_clock(_source);
+
+    const auto begin = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < ReadingsNumber; ++i)
+    {
+        const auto current = read_clock(_source);
+        if (current < previous)
+            ++_result.backwardSteps;
+        previous = current;
+    }
+    const auto end = std::chrono::steady_clock::now();
+
+    _result.callCost = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()) / ReadingsNumber;
+
+    // Monotonicity between two threads: each thread reads the clock after seeing the value read by another one.
+    // Threads are free to run on different cores (and sockets) so unsynchronized counters are detected.
+    const uint32_t ExchangesNumber = 1000;
+
+    std::atomic<uint32_t> sequence(0);
+    std::atomic<profiler::timestamp_t> mainTime(0), helperTime(0);
+    uint32_t helperBackwardSteps = 0;
+
+    std::thread helper([&]()
+    {
+        for (uint32_t i = 1; i <= ExchangesNumber; ++i)
+        {
+            while (sequence.load(std::memory_order_acquire) != 2 * i - 1)
+                std::this_thread::yield();
+
+            const auto current = read_clock(_source);
+            if (current < mainTime.load(std::memory_order_relaxed))
+                ++helperBackwardSteps;
+
+            helperTime.store(read_clock(_source), std::memory_order_relaxed);
+            sequence.store(2 * i, std::memory_order_release);
+        }
+    });
+
+    uint32_t mainBackwardSteps = 0;
+    for (uint32_t i = 1; i <= ExchangesNumber; ++i)
+    {
+        mainTime.store(read_clock(_source), std::memory_order_relaxed);
+        sequence.store(2 * i - 1, std::memory_order_release);
+
+        while (sequence.load(std::memory_order_acquire) != 2 * i)
+            std::this_thread::yield();
+
+        const auto current = read_clock(_source);
+        if (current < helperTime.load(std::memory_order_relaxed))
+            ++mainBackwardSteps;
+    }
+
+    helper.join();
+    _result.crossThreadBackwardSteps = mainBackwardSteps + helperBackwardSteps;
+
+    return true;
+}
@@ -0,0 +1,115 @@
+/**
+Lightweight profiler library for c++
+Copyright(C) 2016-2017  Sergey Yagovtsev, Victor Zarubkin
+
+Licensed under either of
+    * MIT license (LICENSE.MIT or http://opensource.org/licenses/MIT)
+    * Apache License, Version 2.0, (LICENSE.APACHE or http://www.apache.org/licenses/LICENSE-2.0)
+at your option.
+
+The MIT License
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights 
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies 
+    of the Software, and to permit persons to whom the Software is furnished 
+    to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all 
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+    PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE 
+    LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE 
+    USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+The Apache License, Version 2.0 (the "License");
+    You may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+
+**/
+
+#ifndef EASY_PROFILER_CLOCK_CALIBRATION_H
+#define EASY_PROFILER_CLOCK_CALIBRATION_H
+
+#include <easy/profiler.h>
+#include <atomic>
+#include <thread>
+
+//////////////////////////////////////////////////////////////////////////
+
+/** Frequency of the clock used by getCurrentTime() on Unix systems.
+
+The frequency is taken from the hardware or OS when it is reported exactly (invariant TSC frequency
+from CPUID or hypervisor CPUID leaf, tsc_freq_khz in sysfs, CNTFRQ_EL0 on ARMv8). Otherwise it is calibrated
+by a separate thread against CLOCK_MONOTONIC_RAW using several short sleeping samples, so the caller is never
+blocked unless it asks for the frequency before calibration is finished.
+
+The frequency is cached for the process lifetime. The counter and the monotonic clock readings taken
+at start() are kept to measure long-run drift of the cached frequency at any later moment.
+*/
+class ClockCalibration EASY_FINAL
+{
+    std::thread                   m_thread;
+    std::atomic<int64_t>       m_frequency; ///< Cached frequency in kHz. 0 means calibration is not finished yet.
+    profiler::timestamp_t      m_baseTicks; ///< getCurrentTime() at start()
+    uint64_t             m_baseNanoseconds; ///< Monotonic clock at start()
+
+public:
+
+    ClockCalibration();
+    ~ClockCalibration();
+
+    /** Take base clock readings and get frequency from the hardware or launch calibration thread.
+
+    \note Called again when clock source is changed.
+    */
+    void start();
+
+    /** Get cached frequency in kHz.
+
+    \note Waits for calibration thread if calibration is not finished yet.
+    */
+    int64_t frequency();
+
+    /** Get difference between the frequency measured since start() and cached frequency (in parts per billion).
+
+    \retval 0 if less than 100 ms elapsed since start().
+    */
+    int64_t drift();
+
+private:
+
+    void calibrate();
+
+    ClockCalibration(const ClockCalibration&) = delete;
+    ClockCalibration(ClockCalibration&&) = delete;
+
+}; // END of class ClockCalibration.
+
+//////////////////////////////////////////////////////////////////////////
+
+/** Check if clock source (see profiler::ClockSource) could be used on this machine.
+*/
+bool is_clock_source_available(uint8_t _source);
+
+/** Measure average cost of one clock reading and check it's monotonicity on one thread and between two threads.
+
+\retval false if clock source is not available.
+*/
+bool test_clock_source(uint8_t _source, profiler::ClockTestResult& _result);
+
+//////////////////////////////////////////////////////////////////////////
+
+#endif // EASY_PROFILER_CLOCK_CALIBRATION_H
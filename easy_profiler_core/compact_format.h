@@ -0,0 +1,603 @@
+/**
+Lightweight profiler library for c++
+Copyright(C) 2016-2017  Sergey Yagovtsev, Victor Zarubkin
+
+Licensed under either of
+    * MIT license (LICENSE.MIT or http://opensource.org/licenses/MIT)
+    * Apache License, Version 2.0, (LICENSE.APACHE or http://www.apache.org/licenses/LICENSE-2.0)
+at your option.
+
+The MIT License
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights 
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies 
+    of the Software, and to permit persons to whom the Software is furnished 
+    to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all 
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+    PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE 
+    LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE 
+    USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+The Apache License, Version 2.0 (the "License");
+    You may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+
+**/
+
+#ifndef EASY_PROFILER_COMPACT_FORMAT_H
+#define EASY_PROFILER_COMPACT_FORMAT_H
+
+#include <easy/profiler.h>
+#include <vector>
+#include <string.h>
+#include "outstream.h"
+
+//////////////////////////////////////////////////////////////////////////
+
+/*
+Compact representation of blocks and context switches used by .prof files since v1.4.0.
+
+List of records of one thread is written as a sequence of packets:
+
+    packet header: [uint32_t records number][uint32_t payload size][uint32_t decoded size]
+    payload:       records
+
+Block record:          varint(zigzag(begin - previous begin)), varint(zigzag(end - begin)),
+                       varint(id << 3 | has_sampling << 2 | has_counters << 1 | has_name) [, varint(name length), name without '\0']
+                       or varint(id << 3 | has_sampling << 2 | has_counters << 1 | 1), varint(0), varint(name id), varint(name length)
+                       for interned runtime name
+                       [, varint(sampling rate)]
+                       [, varint(counters mask), varint(counter value) for each set bit of mask]
+Context switch record: varint(zigzag(begin - previous begin)), varint(zigzag(end - begin)),
+                       varint(target thread id), varint(name length) [, name without '\0']
+
+Previous begin is 0 for the first record of each packet, so packets are independent
+and could be written by different routines (flushed into spill files or dumped directly).
+Decoded size is the size of decoded records (uint16_t size + payload),
+it lets reader allocate memory for all threads before decoding them in parallel.
+
+Plain block record stored with sampling rate greater than 1 has SAMPLING_FLAG set in it's id
+and stores the rate after the name: [uint16_t sampling rate].
+Plain block record with performance counters (see profiler::PerfCounter) has PERF_COUNTERS_FLAG set in it's id
+and stores counters after the name (and sampling rate): [uint64_t value for each set bit of mask][uint8_t mask].
+
+Decoded block record has no flags in it's id. Instead it stores extra data flags byte right after the name:
+
+    BaseBlockData, name, '\0', [uint8_t extra flags] [, data of each set flag in order of flags bits]
+
+    EXTRA_PERF_COUNTERS: [uint8_t mask][uint64_t value for each set bit of mask]
+    EXTRA_SAMPLING:      [uint16_t sampling rate]
+
+Interned runtime names (see runtime_names.h) are written per thread section after blocks
+as two tables (previous and current generation) of the following format:
+
+    [uint32_t generation][uint32_t names number] then [uint16_t name length][name without '\0'] for each name index
+
+Name id is (generation << NAME_GENERATION_SHIFT | name index). New table generation is started after each full dump,
+blocks with name id of none of both generations (which should never happen) get unknown name of the same length.
+*/
+
+namespace profiler { namespace compact {
+
+    const uint32_t PACKET_HEADER_SIZE = 3 * sizeof(uint32_t);
+    const uint32_t MAX_PACKET_PAYLOAD = 1U << 20; ///< Packet is closed when it's payload exceeds this size
+
+    /** Plain block record with interned runtime name stores empty name ('\0') followed by name id and name length.
+    */
+    const uint16_t INTERNED_NAME_SIZE = 1 + sizeof(uint32_t) + sizeof(uint16_t);
+
+    /** Interned runtime name read from thread section.
+    */
+    struct RuntimeName
+    {
+        const char* data;
+        uint16_t  length;
+    };
+
+    const uint32_t NO_NAME_ID = 0xffffffff; ///< Block name has not been interned
+    const uint32_t NAME_GENERATION_SHIFT = 16;
+    const uint32_t NAME_INDEX_MASK = (1U << NAME_GENERATION_SHIFT) - 1;
+    const uint32_t NAME_GENERATION_MASK = 0x7fff; ///< Keeps name id less than NO_NAME_ID
+    const uint32_t NAMES_TABLES_NUMBER = 2; ///< Previous and current generation
+
+    /** Names table of one generation in the list of interned runtime names of thread section.
+    */
+    struct NamesTable
+    {
+        uint32_t generation = 0;
+        uint32_t      begin = 0; ///< Index of the first name of the table in the list
+        uint32_t       size = 0;
+    };
+
+    const block_id_t PERF_COUNTERS_FLAG = 0x80000000; ///< Plain block record stores performance counters after the name
+    const block_id_t SAMPLING_FLAG = 0x40000000; ///< Plain block record stores sampling rate after the name
+
+    const uint8_t EXTRA_PERF_COUNTERS = 1; ///< Decoded block record stores performance counters after extra data flags
+    const uint8_t EXTRA_SAMPLING = 2; ///< Decoded block record stores sampling rate after extra data flags (and counters)
+
+    inline uint32_t counters_number(uint32_t _mask)
+    {
+        uint32_t number = 0;
+        for (; _mask != 0; _mask &= _mask - 1)
+            ++number;
+        return number;
+    }
+
+    /** Size of performance counters with their mask stored in plain or decoded block record. */
+    inline uint16_t counters_size(uint32_t _mask)
+    {
+        return static_cast<uint16_t>(counters_number(_mask) * sizeof(uint64_t) + sizeof(uint8_t));
+    }
+
+    inline uint64_t zigzag(int64_t _value)
+    {
+        return (static_cast<uint64_t>(_value) << 1) ^ static_cast<uint64_t>(_value >> 63);
+    }
+
+    inline int64_t unzigzag(uint64_t _value)
+    {
+        return static_cast<int64_t>(_value >> 1) ^ -static_cast<int64_t>(_value & 1);
+    }
+
+    inline void write_varint(std::vector<char>& _buffer, uint64_t _value)
+    {
+        while (_value >= 0x80)
+        {
+            _buffer.push_back(static_cast<char>((_value & 0x7f) | 0x80));
+            _value >>= 7;
+        }
+
+        _buffer.push_back(static_cast<char>(_value));
+    }
+
+    inline bool read_varint(const char*& _data, const char* _end, uint64_t& _value)
+    {
+        _value = 0;
+        for (unsigned shift = 0; _data < _end && shift < 64; shift += 7)
+        {
+            const auto byte = static_cast<uint8_t>(*_data++);
+            _value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0)
+                return true;
+        }
+
+        return false;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+
+    /** Encodes plain records (payloads of SerializedBlock or SerializedCSwitch) into packets.
+    */
+    class PacketWriter EASY_FINAL
+    {
+        std::vector<char>  m_payload;
+        OStream&            m_stream;
+        timestamp_t      m_prevBegin;
+        uint32_t     m_recordsNumber;
+        uint32_t       m_decodedSize;
+        const bool         m_cswitch;
+
+    public:
+
+        PacketWriter(OStream& _stream, bool _cswitch)
+            : m_stream(_stream)
+            , m_prevBegin(0)
+            , m_recordsNumber(0)
+            , m_decodedSize(0)
+            , m_cswitch(_cswitch)
+        {
+        }
+
+        ~PacketWriter()
+        {
+            flush();
+        }
+
+        /** Encode one record.
+
+        \param _data Plain record payload (BaseBlockData or CSwitchEvent followed by '\0'-terminated name and extra data).
+        \param _size Plain record payload size.
+        */
+        void add(const char* _data, uint16_t _size)
+        {
+            timestamp_t begin = 0, end = 0;
+            memcpy(&begin, _data, sizeof(timestamp_t));
+            memcpy(&end, _data + sizeof(timestamp_t), sizeof(timestamp_t));
+
+            write_varint(m_payload, zigzag(static_cast<int64_t>(begin - m_prevBegin)));
+            write_varint(m_payload, zigzag(static_cast<int64_t>(end - begin)));
+            m_prevBegin = begin;
+
+            if (m_cswitch)
+            {
+                thread_id_t tid = 0;
+                memcpy(&tid, _data + sizeof(Event), sizeof(thread_id_t));
+                const auto nameLength = static_cast<uint16_t>(_size - sizeof(CSwitchEvent) - 1);
+                write_varint(m_payload, tid);
+                write_varint(m_payload, nameLength);
+                m_payload.insert(m_payload.end(), _data + sizeof(CSwitchEvent), _data + sizeof(CSwitchEvent) + nameLength);
+            }
+            else
+            {
+                block_id_t id = 0;
+                memcpy(&id, _data + sizeof(Event), sizeof(block_id_t));
+
+                // Extra data is stored at the end of the record: [sampling][counters, mask]
+                const char* counters = nullptr;
+                uint16_t countersSize = 0;
+                uint64_t flags = 0;
+                if (id & PERF_COUNTERS_FLAG)
+                {
+                    flags |= 2;
+                    countersSize = counters_size(static_cast<uint8_t>(_data[_size - 1]));
+                    _size -= countersSize;
+                    counters = _data + _size;
+                }
+
+                uint16_t sampling = 0;
+                if (id & SAMPLING_FLAG)
+                {
+                    flags |= 4;
+                    _size -= sizeof(uint16_t);
+                    memcpy(&sampling, _data + _size, sizeof(uint16_t));
+                }
+
+                id &= ~(PERF_COUNTERS_FLAG | SAMPLING_FLAG);
+
+                // Decoded record stores extra data flags and extra data without counters mask
+                m_decodedSize += static_cast<uint32_t>(sizeof(uint8_t) + (sampling != 0 ? sizeof(uint16_t) : 0) + countersSize);
+
+                const char* name = _data + sizeof(BaseBlockData);
+                if (*name == 0 && _size == sizeof(BaseBlockData) + INTERNED_NAME_SIZE)
+                {
+                    uint32_t nameId = 0;
+                    uint16_t nameLength = 0;
+                    memcpy(&nameId, name + 1, sizeof(uint32_t));
+                    memcpy(&nameLength, name + 1 + sizeof(uint32_t), sizeof(uint16_t));
+                    write_varint(m_payload, (static_cast<uint64_t>(id) << 3) | flags | 1);
+                    write_varint(m_payload, 0);
+                    write_varint(m_payload, nameId);
+                    write_varint(m_payload, nameLength);
+
+                    // Decoded record would contain the name itself
+                    m_decodedSize += static_cast<uint32_t>(sizeof(uint16_t) + sizeof(BaseBlockData) + nameLength + 1);
+                }
+                else
+                {
+                    const auto nameLength = static_cast<uint16_t>(_size - sizeof(BaseBlockData) - 1);
+                    write_varint(m_payload, (static_cast<uint64_t>(id) << 3) | flags | (nameLength != 0 ? 1 : 0));
+                    if (nameLength != 0)
+                    {
+                        write_varint(m_payload, nameLength);
+                        m_payload.insert(m_payload.end(), name, name + nameLength);
+                    }
+
+                    m_decodedSize += sizeof(uint16_t) + _size;
+                }
+
+                if (sampling != 0)
+                    write_varint(m_payload, sampling);
+
+                if (counters != nullptr)
+                {
+                    const auto mask = static_cast<uint8_t>(counters[countersSize - 1]);
+                    write_varint(m_payload, mask);
+                    for (uint16_t offset = 0; offset + 1 < countersSize; offset += sizeof(uint64_t))
+                    {
+                        uint64_t value = 0;
+                        memcpy(&value, counters + offset, sizeof(uint64_t));
+                        write_varint(m_payload, value);
+                    }
+                }
+
+                ++m_recordsNumber;
+
+                if (m_payload.size() >= MAX_PACKET_PAYLOAD)
+                    flush();
+
+                return;
+            }
+
+            ++m_recordsNumber;
+            m_decodedSize += sizeof(uint16_t) + _size;
+
+            if (m_payload.size() >= MAX_PACKET_PAYLOAD)
+                flush();
+        }
+
+        /** Write current packet into the stream (if it is not empty) and start new one. */
+        void flush()
+        {
+            if (m_recordsNumber == 0)
+                return;
+
+            m_stream.write(m_recordsNumber);
+            m_stream.write(static_cast<uint32_t>(m_payload.size()));
+            m_stream.write(m_decodedSize);
+            m_stream.write(m_payload.data(), m_payload.size());
+
+            m_payload.clear();
+            m_prevBegin = 0;
+            m_recordsNumber = 0;
+            m_decodedSize = 0;
+        }
+
+    private:
+
+        PacketWriter(const PacketWriter&) = delete;
+        PacketWriter& operator = (const PacketWriter&) = delete;
+
+    }; // END of class PacketWriter.
+
+    //////////////////////////////////////////////////////////////////////////
+
+    /** Decode packet payload into decoded records (uint16_t size + payload).
+
+    Interned runtime names are copied into decoded records.
+
+    \param _output Buffer of the packet decoded size.
+    \param _names Interned runtime names of the thread section (nullptr for context switches).
+    \param _nameIds Index of name in _names (or NO_NAME_ID if the name was not interned or has unknown generation)
+    of each decoded block with runtime name would be appended to this list (could be nullptr).
+    \param _tables Tables of NAMES_TABLES_NUMBER generations in _names.
+
+    \retval false if the packet is corrupted.
+    */
+    inline bool decode(bool _cswitch, const char* _payload, uint32_t _payloadSize, uint32_t _recordsNumber,
+                       char* _output, uint32_t _decodedSize, const std::vector<RuntimeName>* _names = nullptr,
+                       std::vector<uint32_t>* _nameIds = nullptr, const NamesTable* _tables = nullptr)
+    {
+        const char* end = _payload + _payloadSize;
+        const char* output_end = _output + _decodedSize;
+        const size_t headerSize = _cswitch ? sizeof(CSwitchEvent) : sizeof(BaseBlockData);
+        timestamp_t prevBegin = 0;
+
+        for (uint32_t i = 0; i < _recordsNumber; ++i)
+        {
+            uint64_t delta = 0, duration = 0, value = 0, nameLength = 0;
+            if (!read_varint(_payload, end, delta) || !read_varint(_payload, end, duration) || !read_varint(_payload, end, value))
+                return false;
+
+            const char* name = _payload;
+            uint64_t nameId = NO_NAME_ID;
+            if (_cswitch || (value & 1) != 0)
+            {
+                if (!read_varint(_payload, end, nameLength) || nameLength > static_cast<uint64_t>(end - _payload))
+                    return false;
+
+                name = _payload;
+                if (!_cswitch && nameLength == 0)
+                {
+                    // Interned runtime name
+                    if (!read_varint(_payload, end, nameId) || !read_varint(_payload, end, nameLength)
+                        || nameLength == 0 || nameLength > 0xffff)
+                        return false;
+
+                    const auto generation = static_cast<uint32_t>(nameId >> NAME_GENERATION_SHIFT);
+                    const auto index = static_cast<uint32_t>(nameId & NAME_INDEX_MASK);
+                    name = nullptr;
+                    nameId = NO_NAME_ID;
+
+                    for (uint32_t k = 0; _names != nullptr && _tables != nullptr && k < NAMES_TABLES_NUMBER; ++k)
+                    {
+                        const auto& table = _tables[k];
+                        if (table.generation == generation && index < table.size
+                            && (*_names)[table.begin + index].length == nameLength)
+                        {
+                            name = (*_names)[table.begin + index].data;
+                            nameId = table.begin + index;
+                            break;
+                        }
+                    }
+                }
+                else
+                {
+                    _payload += nameLength;
+                }
+
+                if (!_cswitch && _nameIds != nullptr && nameLength != 0)
+                    _nameIds->push_back(static_cast<uint32_t>(nameId));
+            }
+
+            uint64_t sampling = 0;
+            if (!_cswitch && (value & 4) != 0)
+            {
+                if (!read_varint(_payload, end, sampling) || sampling < 2 || sampling > 0xffff)
+                    return false;
+            }
+
+            uint64_t mask = 0;
+            const char* counters = _payload;
+            if (!_cswitch && (value & 2) != 0)
+            {
+                if (!read_varint(_payload, end, mask) || mask == 0 || mask >= (1U << PERF_COUNTERS_NUMBER))
+                    return false;
+
+                counters = _payload;
+                for (uint32_t k = counters_number(static_cast<uint32_t>(mask)); k != 0; --k)
+                {
+                    uint64_t counter = 0;
+                    if (!read_varint(_payload, end, counter))
+                        return false;
+                }
+            }
+
+            const size_t countersSize = mask != 0 ? counters_size(static_cast<uint32_t>(mask)) : 0;
+            const size_t samplingSize = sampling != 0 ? sizeof(uint16_t) : 0;
+            const size_t extraSize = _cswitch ? 0 : sizeof(uint8_t) + countersSize + samplingSize;
+            const size_t size = headerSize + static_cast<size_t>(nameLength) + 1 + extraSize;
+            if (size > 0xffff || static_cast<size_t>(output_end - _output) < sizeof(uint16_t) + size)
+                return false;
+
+            const timestamp_t begin = prevBegin + static_cast<timestamp_t>(unzigzag(delta));
+            const timestamp_t finish = begin + static_cast<timestamp_t>(unzigzag(duration));
+            prevBegin = begin;
+
+            const auto recordSize = static_cast<uint16_t>(size);
+            memcpy(_output, &recordSize, sizeof(uint16_t));
+            _output += sizeof(uint16_t);
+
+            memcpy(_output, &begin, sizeof(timestamp_t));
+            memcpy(_output + sizeof(timestamp_t), &finish, sizeof(timestamp_t));
+
+            if (_cswitch)
+            {
+                const thread_id_t tid = value;
+                memcpy(_output + sizeof(Event), &tid, sizeof(thread_id_t));
+            }
+            else
+            {
+                const auto id = static_cast<block_id_t>(value >> 3);
+                memcpy(_output + sizeof(Event), &id, sizeof(block_id_t));
+            }
+
+            _output += headerSize;
+            if (name != nullptr)
+                memcpy(_output, name, static_cast<size_t>(nameLength));
+            else // Unknown interned name
+                memset(_output, '?', static_cast<size_t>(nameLength));
+            _output += nameLength;
+            *_output++ = 0;
+
+            if (_cswitch)
+                continue;
+
+            *_output++ = static_cast<char>((mask != 0 ? EXTRA_PERF_COUNTERS : 0) | (sampling != 0 ? EXTRA_SAMPLING : 0));
+
+            if (mask != 0)
+            {
+                *_output++ = static_cast<char>(mask);
+
+                // Counters have been validated above
+                for (uint32_t k = counters_number(static_cast<uint32_t>(mask)); k != 0; --k)
+                {
+                    uint64_t counter = 0;
+                    read_varint(counters, end, counter);
+                    memcpy(_output, &counter, sizeof(uint64_t));
+                    _output += sizeof(uint64_t);
+                }
+            }
+
+            if (sampling != 0)
+            {
+                const auto rate = static_cast<uint16_t>(sampling);
+                memcpy(_output, &rate, sizeof(uint16_t));
+                _output += sizeof(uint16_t);
+            }
+        }
+
+        return _payload == end && _output == output_end;
+    }
+
+    /** Copy packet records which would be kept by reader for specified capture begin time.
+
+    Reader drops blocks which end before capture begin time and context switches which end not later than it.
+    Records are copied as is except for begin time delta which is recalculated relative to the previous copied record.
+
+    \param _output Payload of copied records would be appended to this buffer.
+    \param _keptRecordsNumber Number of copied records would be written here.
+    \param _keptDecodedSize Decoded size of copied records would be written here.
+
+    \retval false if the packet is corrupted.
+    */
+    inline bool filter(bool _cswitch, const char* _payload, uint32_t _payloadSize, uint32_t _recordsNumber, timestamp_t _beginTime,
+                       std::vector<char>& _output, uint32_t& _keptRecordsNumber, uint32_t& _keptDecodedSize)
+    {
+        const char* end = _payload + _payloadSize;
+        const size_t headerSize = _cswitch ? sizeof(CSwitchEvent) : sizeof(BaseBlockData);
+        timestamp_t prevBegin = 0, prevKeptBegin = 0;
+        _keptRecordsNumber = 0;
+        _keptDecodedSize = 0;
+
+        for (uint32_t i = 0; i < _recordsNumber; ++i)
+        {
+            uint64_t delta = 0, duration = 0, value = 0, nameLength = 0;
+            if (!read_varint(_payload, end, delta) || !read_varint(_payload, end, duration))
+                return false;
+
+            const char* rest = _payload;
+            if (!read_varint(_payload, end, value))
+                return false;
+
+            if (_cswitch || (value & 1) != 0)
+            {
+                if (!read_varint(_payload, end, nameLength) || nameLength > static_cast<uint64_t>(end - _payload))
+                    return false;
+
+                if (!_cswitch && nameLength == 0)
+                {
+                    // Interned runtime name
+                    uint64_t nameId = 0;
+                    if (!read_varint(_payload, end, nameId) || !read_varint(_payload, end, nameLength))
+                        return false;
+                }
+                else
+                {
+                    _payload += nameLength;
+                }
+            }
+
+            size_t extraSize = 0;
+            if (!_cswitch)
+            {
+                uint64_t sampling = 0, mask = 0;
+                if ((value & 4) != 0 && !read_varint(_payload, end, sampling))
+                    return false;
+
+                if ((value & 2) != 0)
+                {
+                    if (!read_varint(_payload, end, mask) || mask >= (1U << PERF_COUNTERS_NUMBER))
+                        return false;
+
+                    for (uint32_t k = counters_number(static_cast<uint32_t>(mask)); k != 0; --k)
+                    {
+                        uint64_t counter = 0;
+                        if (!read_varint(_payload, end, counter))
+                            return false;
+                    }
+                }
+
+                extraSize = sizeof(uint8_t) + (mask != 0 ? counters_size(static_cast<uint32_t>(mask)) : 0) + (sampling != 0 ? sizeof(uint16_t) : 0);
+            }
+
+            const timestamp_t begin = prevBegin + static_cast<timestamp_t>(unzigzag(delta));
+            const timestamp_t finish = begin + static_cast<timestamp_t>(unzigzag(duration));
+            prevBegin = begin;
+
+            if (_cswitch ? finish <= _beginTime : finish < _beginTime)
+                continue;
+
+            write_varint(_output, zigzag(static_cast<int64_t>(begin - prevKeptBegin)));
+            write_varint(_output, duration);
+            _output.insert(_output.end(), rest, _payload);
+            prevKeptBegin = begin;
+
+            ++_keptRecordsNumber;
+            _keptDecodedSize += static_cast<uint32_t>(sizeof(uint16_t) + headerSize + nameLength + 1 + extraSize);
+        }
+
+        return _payload == end;
+    }
+
+} // END of namespace compact.
+} // END of namespace profiler.
+
+//////////////////////////////////////////////////////////////////////////
+
+#endif // EASY_PROFILER_COMPACT_FORMAT_H
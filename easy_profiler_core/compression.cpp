@@ -0,0 +1,361 @@
+/**
+Lightweight profiler library for c++
+Copyright(C) 2016-2017  Sergey Yagovtsev, Victor Zarubkin
+
+Licensed under either of
+    * MIT license (LICENSE.MIT or http://opensource.org/licenses/MIT)
+    * Apache License, Version 2.0, (LICENSE.APACHE or http://www.apache.org/licenses/LICENSE-2.0)
+at your option.
+
+The MIT License
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights 
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies 
+    of the Software, and to permit persons to whom the Software is furnished 
+    to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all 
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+    PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE 
+    LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE 
+    USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+The Apache License, Version 2.0 (the "License");
+    You may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+
+**/
+
+#include <string.h>
+#include <atomic>
+#include <vector>
+#include <easy/reader.h>
+#include "compression.h"
+#include "outstream.h"
+#include "parallel_for.h"
+
+//////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    const size_t MIN_MATCH = 4;
+    const size_t LAST_LITERALS = 5; ///< Last bytes of the chunk are always literals
+    const size_t MF_LIMIT = 12; ///< Match must start at least MF_LIMIT bytes before the end of the chunk
+    const size_t MAX_OFFSET = 65535;
+    const unsigned HASH_LOG = 16;
+
+    inline uint32_t read32(const uint8_t* _ptr)
+    {
+        uint32_t value;
+        memcpy(&value, _ptr, sizeof(uint32_t));
+        return value;
+    }
+
+    inline uint32_t hash32(uint32_t _value)
+    {
+        return (_value * 2654435761U) >> (32 - HASH_LOG);
+    }
+
+    inline uint8_t* writeLength(uint8_t* _op, size_t _length)
+    {
+        for (; _length >= 255; _length -= 255)
+            *_op++ = 255;
+        *_op++ = static_cast<uint8_t>(_length);
+        return _op;
+    }
+
+    inline bool readLength(const uint8_t*& _ip, const uint8_t* _iend, size_t& _length)
+    {
+        uint8_t byte;
+        do {
+            if (_ip == _iend)
+                return false;
+            byte = *_ip++;
+            _length += byte;
+        } while (byte == 255);
+        return true;
+    }
+
+    /** Write one sequence: literals followed by a match (match is omitted for the last sequence). */
+    inline bool writeSequence(uint8_t*& _op, const uint8_t* _oend, const uint8_t* _literals, size_t _literalsLength,
+                              size_t _offset, size_t _matchLength, bool _last)
+    {
+        // token + literals length + literals + offset + match length
+        const size_t maxSize = 1 + _literalsLength / 255 + 1 + _literalsLength + 2 + _matchLength / 255 + 1;
+        if (static_cast<size_t>(_oend - _op) < maxSize)
+            return false;
+
+        uint8_t* token = _op++;
+        *token = static_cast<uint8_t>((_literalsLength < 15 ? _literalsLength : 15) << 4);
+        if (_literalsLength >= 15)
+            _op = writeLength(_op, _literalsLength - 15);
+
+        memcpy(_op, _literals, _literalsLength);
+        _op += _literalsLength;
+
+        if (_last)
+            return true;
+
+        *_op++ = static_cast<uint8_t>(_offset & 0xff);
+        *_op++ = static_cast<uint8_t>(_offset >> 8);
+
+        *token |= static_cast<uint8_t>(_matchLength < 15 ? _matchLength : 15);
+        if (_matchLength >= 15)
+            _op = writeLength(_op, _matchLength - 15);
+
+        return true;
+    }
+
+} // END of namespace <noname>.
+
+//////////////////////////////////////////////////////////////////////////
+
+namespace profiler { namespace compression {
+
+    bool isCompressed(const char* _data, uint64_t _size)
+    {
+        uint32_t signature = 0;
+        if (_size < sizeof(uint32_t) * 2 + sizeof(uint64_t))
+            return false;
+        memcpy(&signature, _data, sizeof(uint32_t));
+        return signature == SIGNATURE;
+    }
+
+    size_t compressBlock(const char* _src, size_t _srcSize, char* _dst, size_t _dstCapacity)
+    {
+        const auto src = reinterpret_cast<const uint8_t*>(_src);
+        const auto iend = src + _srcSize;
+        auto op = reinterpret_cast<uint8_t*>(_dst);
+        const auto oend = op + _dstCapacity;
+
+        const uint8_t* ip = src;
+        const uint8_t* anchor = src;
+
+        if (_srcSize > MF_LIMIT)
+        {
+            const uint8_t* mflimit = iend - MF_LIMIT;
+            const uint8_t* matchlimit = iend - LAST_LITERALS;
+
+            ::std::vector<uint32_t> table(static_cast<size_t>(1) << HASH_LOG, 0);
+            size_t misses = 0;
+
+            while (ip < mflimit)
+            {
+                const auto sequence = read32(ip);
+                const auto h = hash32(sequence);
+                const uint8_t* candidate = src + table[h];
+                table[h] = static_cast<uint32_t>(ip - src);
+
+                if (candidate >= ip || static_cast<size_t>(ip - candidate) > MAX_OFFSET || read32(candidate) != sequence)
+                {
+                    // Skip faster through incompressible data
+                    ip += 1 + (misses++ >> 6);
+                    continue;
+                }
+
+                misses = 0;
+
+                while (ip > anchor && candidate > src && ip[-1] == candidate[-1])
+                {
+                    --ip;
+                    --candidate;
+                }
+
+                const uint8_t* matchEnd = ip + MIN_MATCH;
+                const uint8_t* ref = candidate + MIN_MATCH;
+                while (matchEnd < matchlimit && *matchEnd == *ref)
+                {
+                    ++matchEnd;
+                    ++ref;
+                }
+
+                if (!writeSequence(op, oend, anchor, static_cast<size_t>(ip - anchor), static_cast<size_t>(ip - candidate),
+                                   static_cast<size_t>(matchEnd - ip) - MIN_MATCH, false))
+                {
+                    return 0;
+                }
+
+                ip = matchEnd;
+                anchor = ip;
+
+                if (ip < mflimit)
+                    table[hash32(read32(ip - 2))] = static_cast<uint32_t>(ip - 2 - src);
+            }
+        }
+
+        if (!writeSequence(op, oend, anchor, static_cast<size_t>(iend - anchor), 0, 0, true))
+            return 0;
+
+        return static_cast<size_t>(op - reinterpret_cast<uint8_t*>(_dst));
+    }
+
+    bool decompressBlock(const char* _src, size_t _srcSize, char* _dst, size_t _dstSize)
+    {
+        auto ip = reinterpret_cast<const uint8_t*>(_src);
+        const auto iend = ip + _srcSize;
+        const auto dst = reinterpret_cast<uint8_t*>(_dst);
+        const auto oend = dst + _dstSize;
+        auto op = dst;
+
+        while (ip < iend)
+        {
+            const uint8_t token = *ip++;
+
+            size_t length = token >> 4;
+            if (length == 15 && !readLength(ip, iend, length))
+                return false;
+
+            if (length > static_cast<size_t>(iend - ip) || length > static_cast<size_t>(oend - op))
+                return false;
+
+            memcpy(op, ip, length);
+            op += length;
+            ip += length;
+
+            if (ip == iend)
+                break; // The last sequence contains literals only
+
+            if (iend - ip < 2)
+                return false;
+
+            const size_t offset = static_cast<size_t>(ip[0]) | (static_cast<size_t>(ip[1]) << 8);
+            ip += 2;
+            if (offset == 0 || offset > static_cast<size_t>(op - dst))
+                return false;
+
+            length = token & 15;
+            if (length == 15 && !readLength(ip, iend, length))
+                return false;
+            length += MIN_MATCH;
+
+            if (length > static_cast<size_t>(oend - op))
+                return false;
+
+            const uint8_t* ref = op - offset;
+            if (offset >= length)
+            {
+                memcpy(op, ref, length);
+                op += length;
+            }
+            else
+            {
+                // Overlapped match: repeat the pattern byte by byte
+                for (const auto end = op + length; op != end;)
+                    *op++ = *ref++;
+            }
+        }
+
+        return op == oend;
+    }
+
+    void compress(const OStream& _input, OStream& _output)
+    {
+        const size_t chunksNumber = _input.buffersNumber();
+
+        ::std::vector<::std::vector<char> > chunks(chunksNumber);
+        ::profiler::parallel_for(chunksNumber, [&](size_t _index)
+        {
+            const size_t size = _input.bufferSize(_index);
+            auto& chunk = chunks[_index];
+            chunk.resize(size);
+
+            // Store chunk as is if compressed data is not smaller than the original
+            const auto compressedSize = compressBlock(_input.bufferData(_index), size, chunk.data(), size);
+            if (compressedSize != 0 && compressedSize < size)
+                chunk.resize(compressedSize);
+            else
+                memcpy(chunk.data(), _input.bufferData(_index), size);
+        });
+
+        _output.write(SIGNATURE);
+        _output.write(static_cast<uint32_t>(chunksNumber));
+        _output.write(_input.size());
+
+        for (size_t i = 0; i < chunksNumber; ++i)
+        {
+            _output.write(static_cast<uint32_t>(chunks[i].size()));
+            _output.write(static_cast<uint32_t>(_input.bufferSize(i)));
+        }
+
+        for (const auto& chunk : chunks)
+            _output.write(chunk.data(), chunk.size());
+    }
+
+    bool decompress(const char* _data, uint64_t _size, SerializedData& _output)
+    {
+        if (!isCompressed(_data, _size))
+            return false;
+
+        uint32_t chunksNumber = 0;
+        uint64_t uncompressedSize = 0;
+        memcpy(&chunksNumber, _data + sizeof(uint32_t), sizeof(uint32_t));
+        memcpy(&uncompressedSize, _data + sizeof(uint32_t) * 2, sizeof(uint64_t));
+
+        const uint64_t headerSize = sizeof(uint32_t) * 2 + sizeof(uint64_t);
+        const uint64_t tableSize = static_cast<uint64_t>(chunksNumber) * sizeof(uint32_t) * 2;
+        if (tableSize > _size - headerSize)
+            return false;
+
+        struct Chunk { const char* data; uint64_t offset; uint32_t storedSize, originalSize; };
+        ::std::vector<Chunk> chunks(chunksNumber);
+
+        const char* table = _data + headerSize;
+        const char* data = table + tableSize;
+        const char* end = _data + _size;
+        uint64_t offset = 0;
+        for (auto& chunk : chunks)
+        {
+            memcpy(&chunk.storedSize, table, sizeof(uint32_t));
+            memcpy(&chunk.originalSize, table + sizeof(uint32_t), sizeof(uint32_t));
+            table += sizeof(uint32_t) * 2;
+
+            if (chunk.storedSize > static_cast<uint64_t>(end - data) || chunk.storedSize > chunk.originalSize)
+                return false;
+
+            chunk.data = data;
+            chunk.offset = offset;
+            data += chunk.storedSize;
+            offset += chunk.originalSize;
+        }
+
+        if (offset != uncompressedSize)
+            return false;
+
+        _output.set(uncompressedSize);
+
+        ::std::atomic<bool> corrupted(ATOMIC_VAR_INIT(false));
+        ::profiler::parallel_for(chunks.size(), [&](size_t _index)
+        {
+            const auto& chunk = chunks[_index];
+            char* output = _output[chunk.offset];
+            if (chunk.storedSize == chunk.originalSize)
+                memcpy(output, chunk.data, chunk.storedSize);
+            else if (!decompressBlock(chunk.data, chunk.storedSize, output, chunk.originalSize))
+                corrupted.store(true, ::std::memory_order_relaxed);
+        });
+
+        if (corrupted.load(::std::memory_order_relaxed))
+        {
+            _output.clear();
+            return false;
+        }
+
+        return true;
+    }
+
+} // END of namespace compression.
+} // END of namespace profiler.
@@ -0,0 +1,104 @@
+/**
+Lightweight profiler library for c++
+Copyright(C) 2016-2017  Sergey Yagovtsev, Victor Zarubkin
+
+Licensed under either of
+    * MIT license (LICENSE.MIT or http://opensource.org/licenses/MIT)
+    * Apache License, Version 2.0, (LICENSE.APACHE or http://www.apache.org/licenses/LICENSE-2.0)
+at your option.
+
+The MIT License
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights 
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies 
+    of the Software, and to permit persons to whom the Software is furnished 
+    to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all 
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+    PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE 
+    LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE 
+    USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+The Apache License, Version 2.0 (the "License");
+    You may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+
+**/
+
+#ifndef EASY_PROFILER_COMPRESSION_H
+#define EASY_PROFILER_COMPRESSION_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+//////////////////////////////////////////////////////////////////////////
+
+/*
+LZ4-style compression of profiler data (no external dependencies).
+
+Compressed data is a container of independently compressed chunks, so chunks could be compressed
+and decompressed in parallel:
+
+    [uint32_t signature "Easz"][uint32_t chunks number][uint64_t uncompressed size]
+    chunks table: [uint32_t stored size][uint32_t original size] for each chunk
+    chunks data
+
+Chunk is stored as is if it's stored size is equal to the original size (compression was not profitable).
+Otherwise it is a sequence of LZ4 block format sequences (token, literals, 16-bit offset, match length).
+*/
+
+namespace profiler {
+
+    class OStream;
+    class SerializedData;
+
+    namespace compression {
+
+        const uint32_t SIGNATURE = 0x7a736145; ///< "Easz"
+
+        /** Check if data starts with compressed container signature. */
+        bool isCompressed(const char* _data, uint64_t _size);
+
+        /** Compress all data of the stream (each stream buffer is an independent chunk) and write container into _output. */
+        void compress(const OStream& _input, OStream& _output);
+
+        /** Decompress the container into _output.
+
+        \retval false if data is corrupted (_output is cleared).
+        */
+        bool decompress(const char* _data, uint64_t _size, SerializedData& _output);
+
+        /** Compress one chunk.
+
+        \retval Compressed size or 0 if compressed data does not fit into _dstCapacity bytes.
+        */
+        size_t compressBlock(const char* _src, size_t _srcSize, char* _dst, size_t _dstCapacity);
+
+        /** Decompress one chunk of exactly _dstSize bytes.
+
+        \retval false if data is corrupted.
+        */
+        bool decompressBlock(const char* _src, size_t _srcSize, char* _dst, size_t _dstSize);
+
+    } // END of namespace compression.
+
+} // END of namespace profiler.
+
+//////////////////////////////////////////////////////////////////////////
+
+#endif // EASY_PROFILER_COMPRESSION_H
@@ -0,0 +1,224 @@
+/**
+Lightweight profiler library for c++
+Copyright(C) 2016-2017  Sergey Yagovtsev, Victor Zarubkin
+
+Licensed under either of
+    * MIT license (LICENSE.MIT or http://opensource.org/licenses/MIT)
+    * Apache License, Version 2.0, (LICENSE.APACHE or http://www.apache.org/licenses/LICENSE-2.0)
+at your option.
+
+The MIT License
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights 
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies 
+    of the Software, and to permit persons to whom the Software is furnished 
+    to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all 
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+    PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE 
+    LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE 
+    USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+The Apache License, Version 2.0 (the "License");
+    You may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+
+**/
+
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+#include <easy/reader.h>
+#include "context_switch_log.h"
+#include "parallel_for.h"
+
+namespace profiler { namespace cswitch_log {
+
+    const size_t CHUNK_RECORDS = 1 << 16; ///< Number of binary records parsed by one task
+    const size_t CHUNK_BYTES = CHUNK_RECORDS * 48; ///< Approximate size of text chunk parsed by one task
+
+    //////////////////////////////////////////////////////////////////////////
+
+    static void addEvent(threads_events_t& _output, uint64_t _timestamp, profiler::thread_id_t _from, profiler::thread_id_t _to,
+                         const char* _name, size_t _nameLength, uint64_t _process)
+    {
+        ThreadEvent out;
+        out.time = _timestamp;
+        out.target = _to;
+        out.process = 0;
+        out.out = true;
+
+        // Names are padded with spaces in binary format
+        while (_nameLength != 0 && (_name[_nameLength - 1] == ' ' || _name[_nameLength - 1] == 0))
+            --_nameLength;
+        _nameLength = std::min(_nameLength, NAME_SIZE - 1);
+        memcpy(out.name, _name, _nameLength);
+        out.name[_nameLength] = 0;
+
+        ThreadEvent in;
+        in.time = _timestamp;
+        in.target = 0;
+        in.process = _process;
+        in.out = false;
+        in.name[0] = 0;
+
+        _output[_from].push_back(out);
+        _output[_to].push_back(in);
+    }
+
+    static void parseBinary(const char* _data, size_t _count, threads_events_t& _output)
+    {
+        Record record;
+        for (size_t i = 0; i < _count; ++i, _data += sizeof(Record))
+        {
+            memcpy(&record, _data, sizeof(Record));
+            addEvent(_output, record.timestamp, record.thread_from, record.thread_to, record.next_task_name, NAME_SIZE, record.process_to);
+        }
+    }
+
+    static inline bool isSpace(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+    }
+
+    static bool parseNumber(const char*& _it, const char* _end, uint64_t& _value)
+    {
+        while (_it != _end && (*_it == ' ' || *_it == '\t'))
+            ++_it;
+
+        const bool negative = _it != _end && *_it == '-';
+        if (negative)
+            ++_it;
+
+        const char* begin = _it;
+        _value = 0;
+        for (; _it != _end && *_it >= '0' && *_it <= '9'; ++_it)
+            _value = _value * 10 + static_cast<uint64_t>(*_it - '0');
+
+        if (negative)
+            _value = static_cast<uint64_t>(-static_cast<int64_t>(_value));
+
+        return _it != begin && (_it == _end || isSpace(*_it));
+    }
+
+    /** Parse lines "timestamp thread_from thread_to next_task_name process_to" (malformed lines are skipped).
+    */
+    static void parseText(const char* _it, const char* _end, threads_events_t& _output)
+    {
+        while (_it != _end)
+        {
+            const char* eol = static_cast<const char*>(memchr(_it, '\n', static_cast<size_t>(_end - _it)));
+            if (eol == nullptr)
+                eol = _end;
+
+            uint64_t timestamp = 0, from = 0, to = 0, process = 0;
+            if (parseNumber(_it, eol, timestamp) && parseNumber(_it, eol, from) && parseNumber(_it, eol, to))
+            {
+                while (_it != eol && (*_it == ' ' || *_it == '\t'))
+                    ++_it;
+
+                const char* name = _it;
+                while (_it != eol && !isSpace(*_it))
+                    ++_it;
+                const auto nameLength = static_cast<size_t>(_it - name);
+
+                if (nameLength != 0 && parseNumber(_it, eol, process))
+                    addEvent(_output, timestamp, static_cast<profiler::thread_id_t>(from), static_cast<profiler::thread_id_t>(to), name, nameLength, process);
+            }
+
+            _it = eol == _end ? _end : eol + 1;
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+
+    bool read(const char* _filename, threads_events_t& _output, const std::atomic_bool* _stop)
+    {
+        profiler::SerializedData file;
+        if (!file.map(_filename))
+            return std::ifstream(_filename).is_open(); // Empty file can not be mapped
+
+        const char* data = file.data();
+        const size_t size = static_cast<size_t>(file.size());
+        const bool binary = size >= sizeof(MAGIC) && memcmp(data, MAGIC, sizeof(MAGIC)) == 0;
+
+        // Split file into chunks. Text chunks are aligned by lines.
+        std::vector<std::pair<const char*, const char*> > chunks;
+        if (binary)
+        {
+            const size_t count = (size - sizeof(MAGIC)) / sizeof(Record);
+            const char* records = data + sizeof(MAGIC);
+            for (size_t i = 0; i < count; i += CHUNK_RECORDS)
+            {
+                const auto n = std::min(CHUNK_RECORDS, count - i);
+                chunks.emplace_back(records + i * sizeof(Record), records + (i + n) * sizeof(Record));
+            }
+        }
+        else
+        {
+            const char* end = data + size;
+            for (const char* it = data; it != end;)
+            {
+                const char* next = static_cast<size_t>(end - it) > CHUNK_BYTES ? it + CHUNK_BYTES : end;
+                if (next != end)
+                {
+                    next = static_cast<const char*>(memchr(next, '\n', static_cast<size_t>(end - next)));
+                    next = next != nullptr ? next + 1 : end;
+                }
+
+                chunks.emplace_back(it, next);
+                it = next;
+            }
+        }
+
+        std::vector<threads_events_t> results(chunks.size());
+        parallel_for(chunks.size(), [&](size_t i)
+        {
+            if (_stop != nullptr && _stop->load(std::memory_order_acquire))
+                return;
+
+            const auto& chunk = chunks[i];
+            if (binary)
+                parseBinary(chunk.first, static_cast<size_t>(chunk.second - chunk.first) / sizeof(Record), results[i]);
+            else
+                parseText(chunk.first, chunk.second, results[i]);
+        });
+
+        if (_stop != nullptr && _stop->load(std::memory_order_acquire))
+            return true;
+
+        // Merge chunks in file order
+        for (auto& result : results)
+        {
+            for (auto& thread : result)
+            {
+                auto& events = _output[thread.first];
+                if (events.empty())
+                    events = std::move(thread.second);
+                else
+                    events.insert(events.end(), thread.second.begin(), thread.second.end());
+            }
+
+            threads_events_t().swap(result);
+        }
+
+        return true;
+    }
+
+} // END of namespace cswitch_log.
+} // END of namespace profiler.
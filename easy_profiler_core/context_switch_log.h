@@ -0,0 +1,106 @@
+/**
+Lightweight profiler library for c++
+Copyright(C) 2016-2017  Sergey Yagovtsev, Victor Zarubkin
+
+Licensed under either of
+    * MIT license (LICENSE.MIT or http://opensource.org/licenses/MIT)
+    * Apache License, Version 2.0, (LICENSE.APACHE or http://www.apache.org/licenses/LICENSE-2.0)
+at your option.
+
+The MIT License
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights 
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies 
+    of the Software, and to permit persons to whom the Software is furnished 
+    to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all 
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+    PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE 
+    LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE 
+    USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+The Apache License, Version 2.0 (the "License");
+    You may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+
+**/
+
+#ifndef EASY_PROFILER_CONTEXT_SWITCH_LOG_H
+#define EASY_PROFILER_CONTEXT_SWITCH_LOG_H
+
+#include <easy/profiler.h>
+#include <atomic>
+#include <vector>
+#include <unordered_map>
+
+//////////////////////////////////////////////////////////////////////////
+
+/** Context switch log-file of external tracer (see scripts/context_switch_logger.stp).
+
+Log-file is written in one of two formats:
+- text: one event per line "timestamp thread_from thread_to next_task_name process_to";
+- binary: MAGIC followed by fixed-size Record records.
+
+The file is mapped into memory and split into chunks (by records number for binary format) which are
+parsed in parallel. Events of each chunk are bucketed per thread, so ProfileManager applies
+all events of a thread at once and does not hold any locks while parsing.
+*/
+namespace profiler { namespace cswitch_log {
+
+    const char MAGIC[8] = {'E', 'A', 'S', 'Y', 'C', 'S', '0', '1'};
+    const size_t NAME_SIZE = 16;
+
+#pragma pack(push, 1)
+    struct Record
+    {
+        uint64_t           timestamp;
+        uint32_t         thread_from;
+        uint32_t           thread_to;
+        uint32_t          process_to;
+        char next_task_name[NAME_SIZE]; ///< Padded with spaces or zeros (not null-terminated)
+    };
+#pragma pack(pop)
+
+    /** Switch-out (begin of context switch) or switch-in (end of context switch) event of one thread.
+    */
+    struct ThreadEvent
+    {
+        profiler::timestamp_t   time;
+        profiler::thread_id_t target; ///< Thread which gets CPU (switch-out only)
+        uint64_t             process; ///< Process id of this thread (switch-in only)
+        bool                     out; ///< True for switch-out, false for switch-in
+        char         name[NAME_SIZE]; ///< Null-terminated name of the next task (switch-out only)
+    };
+
+    typedef std::vector<ThreadEvent> events_t;
+    typedef std::unordered_map<profiler::thread_id_t, events_t> threads_events_t;
+
+    /** Read log-file and bucket it's events per thread (keeping events order of the file).
+
+    \param _stop Reading is interrupted if this flag is set (could be nullptr).
+
+    \retval false if log-file could not be opened.
+    */
+    bool read(const char* _filename, threads_events_t& _output, const std::atomic_bool* _stop);
+
+} // END of namespace cswitch_log.
+} // END of namespace profiler.
+
+//////////////////////////////////////////////////////////////////////////
+
+#endif // EASY_PROFILER_CONTEXT_SWITCH_LOG_H
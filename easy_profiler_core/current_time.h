@@ -72,7 +72,15 @@ The Apache License, Version 2.0 (the "License");
 # endif//__ARM_ARCH
 #endif
 
-static inline profiler::timestamp_t getCurrentTime()
+#if !defined(_WIN32) && !EASY_CHRONO_HIGHRES_CLOCK && !EASY_CHRONO_STEADY_CLOCK && (defined(__GNUC__) || defined(__ICC))
+# include <atomic>
+# define EASY_SELECTABLE_CLOCK_SOURCE
+typedef profiler::timestamp_t (*TimeFunction)();
+extern std::atomic<uint8_t> CLOCK_SOURCE; ///< profiler::ClockSource used by getCurrentTime() (see ProfileManager::setClockSource())
+extern std::atomic<TimeFunction> TIME_FUNCTION; ///< Function reading CLOCK_SOURCE or nullptr for profiler::CLOCK_SOURCE_DEFAULT
+#endif
+
+static inline profiler::timestamp_t getDefaultTime()
 {
 #if EASY_CHRONO_HIGHRES_CLOCK || EASY_CHRONO_STEADY_CLOCK
     return (profiler::timestamp_t)EASY_CHRONO_CLOCK::now().time_since_epoch().count();
@@ -170,5 +178,70 @@ static inline profiler::timestamp_t getCurrentTime()
 #endif
 }
 
+#ifdef EASY_SELECTABLE_CLOCK_SOURCE
+#if defined(__i386__) || defined(__x86_64__) || defined(__amd64__)
+static inline profiler::timestamp_t getTimeAndCpu(uint32_t& _cpu)
+{
+    // rdtscp waits for all previous instructions and loads IA32_TSC_AUX (the processor id set up by OS) into ecx
+    uint32_t low, high;
+    __asm__ volatile("rdtscp" : "=a"(low), "=d"(high), "=c"(_cpu));
+    return (static_cast<profiler::timestamp_t>(high) << 32) | low;
+}
+
+static inline profiler::timestamp_t getTimeRdtscp()
+{
+    uint32_t cpu;
+    return getTimeAndCpu(cpu);
+}
+
+static inline profiler::timestamp_t getTimeLfenceRdtsc()
+{
+    uint32_t low, high;
+    __asm__ volatile("lfence\n\trdtsc" : "=a"(low), "=d"(high) : : "memory");
+    return (static_cast<profiler::timestamp_t>(high) << 32) | low;
+}
+#endif
+
+static inline profiler::timestamp_t getTimeClockGettime()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<profiler::timestamp_t>(ts.tv_sec) * 1000000000ULL + static_cast<profiler::timestamp_t>(ts.tv_nsec);
+}
+
+/** Get function reading specified clock source.
+
+\retval nullptr for profiler::CLOCK_SOURCE_DEFAULT (and for unknown sources): getDefaultTime() is inlined instead.
+*/
+static inline TimeFunction timeFunction(uint8_t _source)
+{
+    switch (_source)
+    {
+#if defined(__i386__) || defined(__x86_64__) || defined(__amd64__)
+        case profiler::CLOCK_SOURCE_RDTSCP: return getTimeRdtscp;
+        case profiler::CLOCK_SOURCE_LFENCE_RDTSC: return getTimeLfenceRdtsc;
+#endif
+        case profiler::CLOCK_SOURCE_CLOCK_GETTIME: return getTimeClockGettime;
+        default: return nullptr;
+    }
+}
+
+static inline profiler::timestamp_t getTime(uint8_t _source)
+{
+    const auto function = timeFunction(_source);
+    return function != nullptr ? function() : getDefaultTime();
+}
+#endif
+
+static inline profiler::timestamp_t getCurrentTime()
+{
+#ifdef EASY_SELECTABLE_CLOCK_SOURCE
+    // Function is chosen once by ProfileManager::setClockSource(): default clock source costs only one load and a branch
+    const auto function = TIME_FUNCTION.load(std::memory_order_relaxed);
+    if (function != nullptr)
+        return function();
+#endif
+    return getDefaultTime();
+}
 
 #endif // EASY_PROFILER_CURRENT_TIME_H
@@ -0,0 +1,234 @@
+/**
+Lightweight profiler library for c++
+Copyright(C) 2016-2017  Sergey Yagovtsev, Victor Zarubkin
+
+Licensed under either of
+    * MIT license (LICENSE.MIT or http://opensource.org/licenses/MIT)
+    * Apache License, Version 2.0, (LICENSE.APACHE or http://www.apache.org/licenses/LICENSE-2.0)
+at your option.
+
+The MIT License
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights 
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies 
+    of the Software, and to permit persons to whom the Software is furnished 
+    to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all 
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+    PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE 
+    LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE 
+    USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+The Apache License, Version 2.0 (the "License");
+    You may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+
+**/
+
+#ifndef EASY_PROFILER_DESCRIPTORS_REGISTRY_H
+#define EASY_PROFILER_DESCRIPTORS_REGISTRY_H
+
+#include <easy/profiler.h>
+#include <atomic>
+#include <unordered_map>
+#include "hashed_cstr.h"
+#include "spin_lock.h"
+
+//////////////////////////////////////////////////////////////////////////
+
+/** Concurrent registry of block descriptors.
+
+Descriptors are stored in an append-only array of fixed-size chunks: once a chunk is published
+it never moves, so reading a descriptor by id is lock-free. Lookup by unique key is split between
+SHARDS_NUMBER independent maps (each guarded by its own spin lock) so threads registering different
+descriptors almost never wait for each other.
+
+lock()/unlock() acquire/release all shards at once. This is used to get a consistent snapshot
+of all descriptors (for example, while writing them into the output stream).
+
+\note Descriptors are never removed from the registry. Owner is responsible for destroying descriptors.
+*/
+template <class TDescriptor>
+class DescriptorsRegistry EASY_FINAL
+{
+public:
+
+    enum : uint32_t
+    {
+        SHARDS_NUMBER = 32,
+        CHUNK_SIZE = 1024,
+        MAX_CHUNKS = 4096 ///< Up to 4M descriptors
+    };
+
+    struct Entry
+    {
+        TDescriptor* descriptor; ///< Found or registered descriptor
+        const char*         key; ///< Unique key stored in the registry (exists until registry destruction)
+    };
+
+private:
+
+#ifdef EASY_PROFILER_HASHED_CSTR_DEFINED
+    typedef profiler::hashed_cstr key_t;
+#else
+    typedef profiler::hashed_stdstring key_t;
+#endif
+
+    typedef std::atomic<TDescriptor*> slot_t;
+
+    struct Shard
+    {
+        std::unordered_map<key_t, TDescriptor*> map;
+        profiler::spin_lock                    lock;
+        char padding[64]; ///< Keep shards locks on different cache lines
+    };
+
+    Shard                 m_shards[SHARDS_NUMBER];
+    std::atomic<slot_t*>  m_chunks[MAX_CHUNKS];
+    std::atomic<uint32_t>                 m_size;
+
+public:
+
+    DescriptorsRegistry()
+    {
+        for (auto& chunk : m_chunks)
+            chunk = ATOMIC_VAR_INIT(nullptr);
+        m_size = ATOMIC_VAR_INIT(0U);
+    }
+
+    ~DescriptorsRegistry()
+    {
+        for (auto& chunk : m_chunks)
+            delete [] chunk.load(std::memory_order_acquire);
+    }
+
+    /** FNV-1a hash of a unique key.
+
+    It is used both to select a shard and as a precalculated hash for a key of the shard map.
+    */
+    static size_t hash(const char* _key)
+    {
+        uint64_t h = 14695981039346656037ULL;
+        for (; *_key != 0; ++_key)
+            h = (h ^ static_cast<unsigned char>(*_key)) * 1099511628211ULL;
+        return static_cast<size_t>(h);
+    }
+
+    /** Number of registered descriptors.
+
+    \note Descriptor with id less than size() may be not published yet if it is being registered right now.
+    Use lock() to wait until all registrations in progress are finished.
+    */
+    uint32_t size() const
+    {
+        return m_size.load(std::memory_order_acquire);
+    }
+
+    /** Get descriptor by id without locking.
+
+    \retval nullptr if there is no such descriptor (or it is not published yet).
+    */
+    TDescriptor* get(profiler::block_id_t _id) const
+    {
+        if (_id >= size())
+            return nullptr;
+
+        const slot_t* chunk = m_chunks[_id / CHUNK_SIZE].load(std::memory_order_acquire);
+        if (chunk == nullptr)
+            return nullptr;
+
+        return chunk[_id % CHUNK_SIZE].load(std::memory_order_acquire);
+    }
+
+    /** Find descriptor by unique key or register a new one.
+
+    \param _hash Hash of the key calculated by hash().
+    \param _create Function-like object with signature TDescriptor*(profiler::block_id_t id).
+    It is called under shard lock only if there is no descriptor with such key.
+
+    \retval Entry with nullptr descriptor if the registry is full.
+    */
+    template <class TFactory>
+    Entry findOrAdd(const char* _key, size_t _hash, TFactory&& _create)
+    {
+        auto& shard = m_shards[_hash % SHARDS_NUMBER];
+        profiler::guard_lock<profiler::spin_lock> lock(shard.lock);
+
+        key_t key(_key, _hash);
+        auto it = shard.map.find(key);
+        if (it != shard.map.end())
+            return Entry {it->second, it->first.c_str()};
+
+        // Reserve id (other shards are reserving ids concurrently)
+        auto newId = m_size.load(std::memory_order_relaxed);
+        do {
+            if (newId >= static_cast<uint32_t>(CHUNK_SIZE) * MAX_CHUNKS)
+                return Entry {nullptr, nullptr};
+        } while (!m_size.compare_exchange_weak(newId, newId + 1, std::memory_order_acq_rel));
+
+        slot_t* chunk = acquireChunk(newId / CHUNK_SIZE);
+        TDescriptor* descriptor = _create(static_cast<profiler::block_id_t>(newId));
+        chunk[newId % CHUNK_SIZE].store(descriptor, std::memory_order_release);
+
+        it = shard.map.emplace(std::move(key), descriptor).first;
+        return Entry {descriptor, it->first.c_str()};
+    }
+
+    /** Lock all shards.
+
+    After lock() returns, all descriptors with id less than size() are published
+    and no new descriptors can be registered until unlock().
+    */
+    void lock()
+    {
+        for (auto& shard : m_shards)
+            shard.lock.lock();
+    }
+
+    void unlock()
+    {
+        for (auto& shard : m_shards)
+            shard.lock.unlock();
+    }
+
+private:
+
+    slot_t* acquireChunk(uint32_t _index)
+    {
+        auto& chunkRef = m_chunks[_index];
+        slot_t* chunk = chunkRef.load(std::memory_order_acquire);
+        if (chunk != nullptr)
+            return chunk;
+
+        // Several shards can try to create the same chunk simultaneously: only one of them wins.
+        slot_t* newChunk = new slot_t[CHUNK_SIZE];
+        for (uint32_t i = 0; i < CHUNK_SIZE; ++i)
+            newChunk[i].store(nullptr, std::memory_order_relaxed);
+
+        if (chunkRef.compare_exchange_strong(chunk, newChunk, std::memory_order_acq_rel))
+            return newChunk;
+
+        delete [] newChunk;
+        return chunk;
+    }
+
+}; // END of class DescriptorsRegistry.
+
+//////////////////////////////////////////////////////////////////////////
+
+#endif // EASY_PROFILER_DESCRIPTORS_REGISTRY_H
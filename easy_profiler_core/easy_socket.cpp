@@ -43,6 +43,7 @@ limitations under the License.
 #include <string.h>
 #include <thread>
 #include <limits>
+#include <vector>
 
 #if defined(_WIN32)
 # pragma comment (lib, "Ws2_32.lib")
@@ -72,6 +73,12 @@ const int SOCK_ENOENT = ENOENT;
 
 const int SEND_BUFFER_SIZE = 64 * 1024 * 1024;
 
+#if !defined(_WIN32) && defined(IOV_MAX)
+const size_t MAX_SEND_BUFFERS = IOV_MAX;
+#else
+const size_t MAX_SEND_BUFFERS = 1024;
+#endif
+
 /////////////////////////////////////////////////////////////////
 
 static int closeSocket(EasySocket::socket_t s)
@@ -276,6 +283,85 @@ int EasySocket::send(const void* buffer, size_t nbytes)
     return res;
 }
 
+int64_t EasySocket::send(const void* const* buffers, const size_t* sizes, size_t count)
+{
+    if (!checkSocket(m_replySocket))
+        return -1;
+
+#if defined(_WIN32)
+    std::vector<WSABUF> chunks;
+#else
+    std::vector<struct iovec> chunks;
+#endif
+    chunks.reserve(std::min(count, MAX_SEND_BUFFERS));
+
+    int64_t total = 0;
+    size_t index = 0, offset = 0; // current buffer and number of bytes of it which have been sent already
+
+    while (index < count)
+    {
+        chunks.clear();
+        for (size_t i = index; i < count && chunks.size() < MAX_SEND_BUFFERS; ++i)
+        {
+            const size_t skip = i == index ? offset : 0;
+            if (sizes[i] == skip)
+                continue;
+
+            const auto data = static_cast<const char*>(buffers[i]) + skip;
+            const auto size = sizes[i] - skip;
+#if defined(_WIN32)
+            WSABUF chunk;
+            chunk.buf = const_cast<char*>(data);
+            chunk.len = static_cast<ULONG>(size);
+#else
+            struct iovec chunk;
+            chunk.iov_base = const_cast<char*>(data);
+            chunk.iov_len = size;
+#endif
+            chunks.push_back(chunk);
+        }
+
+        if (chunks.empty())
+            break;
+
+#if defined(_WIN32)
+        DWORD sent = 0;
+        int res = ::WSASend(m_replySocket, chunks.data(), static_cast<DWORD>(chunks.size()), &sent, 0, nullptr, nullptr);
+        if (res == 0)
+            res = static_cast<int>(sent);
+#else
+        struct msghdr message;
+        memset(&message, 0, sizeof(message));
+        message.msg_iov = chunks.data();
+        message.msg_iovlen = chunks.size();
+# if defined(__APPLE__)
+        const int res = (int)::sendmsg(m_replySocket, &message, 0);
+# else
+        const int res = (int)::sendmsg(m_replySocket, &message, MSG_NOSIGNAL);
+# endif
+#endif
+
+        checkResult(res);
+        if (res <= 0)
+            return -1;
+
+        total += res;
+
+        // Skip sent data (send could be partial)
+        auto sent = static_cast<size_t>(res);
+        while (index < count && sizes[index] - offset <= sent)
+        {
+            sent -= sizes[index] - offset;
+            offset = 0;
+            ++index;
+        }
+
+        offset += sent;
+    }
+
+    return total;
+}
+
 int EasySocket::receive(void* buffer, size_t nbytes)
 {
     if (!checkSocket(m_replySocket))
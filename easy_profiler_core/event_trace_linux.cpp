@@ -0,0 +1,752 @@
+/**
+Lightweight profiler library for c++
+Copyright(C) 2016-2017  Sergey Yagovtsev, Victor Zarubkin
+
+Licensed under either of
+    * MIT license (LICENSE.MIT or http://opensource.org/licenses/MIT)
+    * Apache License, Version 2.0, (LICENSE.APACHE or http://www.apache.org/licenses/LICENSE-2.0)
+at your option.
+
+The MIT License
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights 
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies 
+    of the Software, and to permit persons to whom the Software is furnished 
+    to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all 
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+    PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE 
+    LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE 
+    USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+The Apache License, Version 2.0 (the "License");
+    You may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+
+**/
+
+#ifdef __linux__
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
+#include <linux/perf_event.h>
+#include "profile_manager.h"
+#include "current_time.h"
+
+#include "event_trace_linux.h"
+
+#if EASY_OPTION_LOG_ENABLED != 0
+# include <iostream>
+
+# ifndef EASY_ERRORLOG
+#  define EASY_ERRORLOG ::std::cerr
+# endif
+
+# ifndef EASY_LOG
+#  define EASY_LOG ::std::cerr
+# endif
+
+# ifndef EASY_ERROR
+#  define EASY_ERROR(LOG_MSG) EASY_ERRORLOG << "EasyProfiler ERROR: " << LOG_MSG
+# endif
+
+# ifndef EASY_WARNING
+#  define EASY_WARNING(LOG_MSG) EASY_ERRORLOG << "EasyProfiler WARNING: " << LOG_MSG
+# endif
+
+# ifndef EASY_LOGMSG
+#  define EASY_LOGMSG(LOG_MSG) EASY_LOG << "EasyProfiler INFO: " << LOG_MSG
+# endif
+
+# ifndef EASY_LOG_ONLY
+#  define EASY_LOG_ONLY(CODE) CODE
+# endif
+
+#else
+
+# ifndef EASY_ERROR
+#  define EASY_ERROR(LOG_MSG) 
+# endif
+
+# ifndef EASY_WARNING
+#  define EASY_WARNING(LOG_MSG) 
+# endif
+
+# ifndef EASY_LOGMSG
+#  define EASY_LOGMSG(LOG_MSG) 
+# endif
+
+# ifndef EASY_LOG_ONLY
+#  define EASY_LOG_ONLY(CODE) 
+# endif
+
+#endif
+
+//////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////
+
+#define MANAGER ProfileManager::instance()
+
+namespace profiler {
+
+    const uint32_t DATA_PAGES = 64; ///< Number of data pages of each ring buffer (must be power of 2)
+    const int POLL_TIMEOUT_MS = 50;
+
+    // Records of different CPUs are drained at different moments, so the most recent events are kept
+    // in pending list for a while to be able to sort them by time before passing to ProfileManager.
+    const uint64_t FLUSH_DELAY_NS = 10000000ULL;
+
+    const char* const TRACEFS_PATHS[] = {"/sys/kernel/tracing", "/sys/kernel/debug/tracing"};
+    const char REPLAY_MAGIC[8] = {'E', 'A', 'S', 'Y', 'P', 'E', 'R', 'F'};
+
+    //////////////////////////////////////////////////////////////////////////
+
+    static uint64_t monotonicTime()
+    {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+    }
+
+    template <class T>
+    static inline T readValue(const char* _data)
+    {
+        T value;
+        memcpy(&value, _data, sizeof(T));
+        return value;
+    }
+
+    /** Read sched:sched_switch tracepoint id and offsets of it's fields from tracefs.
+
+    \retval false if tracefs is not available.
+    */
+    static bool readSchedSwitchFormat(uint64_t& _id, uint32_t& _prevPid, uint32_t& _nextPid, uint32_t& _nextComm)
+    {
+        for (auto path : TRACEFS_PATHS)
+        {
+            const std::string dir = std::string(path) + "/events/sched/sched_switch/";
+
+            std::ifstream idfile(dir + "id");
+            if (!(idfile >> _id))
+                continue;
+
+            std::ifstream format(dir + "format");
+            if (!format.is_open())
+                continue;
+
+            // Each field is described as "field:char next_comm[16];	offset:40;	size:16;	signed:1;"
+            uint32_t found = 0;
+            std::string line;
+            while (std::getline(format, line))
+            {
+                const auto field = line.find("field:");
+                const auto semicolon = line.find(';', field);
+                const auto offset = line.find("offset:", semicolon);
+                if (field == std::string::npos || semicolon == std::string::npos || offset == std::string::npos)
+                    continue;
+
+                auto end = line.find('[', field);
+                if (end == std::string::npos || end > semicolon)
+                    end = semicolon;
+                const auto begin = line.find_last_of(" \t", end) + 1;
+                const auto name = line.substr(begin, end - begin);
+                const auto value = static_cast<uint32_t>(strtoul(line.c_str() + offset + 7, nullptr, 10));
+
+                if (name == "prev_pid") { _prevPid = value; found |= 1; }
+                else if (name == "next_pid") { _nextPid = value; found |= 2; }
+                else if (name == "next_comm") { _nextComm = value; found |= 4; }
+            }
+
+            if (found == 7)
+                return true;
+        }
+
+        return false;
+    }
+
+    static int openPerfEvent(perf_event_attr& _attr, int _cpu)
+    {
+        return static_cast<int>(syscall(__NR_perf_event_open, &_attr, -1, _cpu, -1, PERF_FLAG_FD_CLOEXEC));
+    }
+
+    /** Read process id of the thread from /proc/<tid>/status.
+
+    \retval -1 if thread does not exist anymore.
+    */
+    static int32_t readProcessId(uint32_t _tid)
+    {
+        std::ifstream status("/proc/" + std::to_string(_tid) + "/status");
+        std::string line;
+        while (std::getline(status, line))
+        {
+            if (line.compare(0, 5, "Tgid:") == 0)
+                return static_cast<int32_t>(strtol(line.c_str() + 5, nullptr, 10));
+        }
+
+        return -1;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+
+#ifndef EASY_MAGIC_STATIC_CPP11
+    class EasyEventTracerInstance {
+        friend EasyEventTracer;
+        EasyEventTracer instance;
+    } EASY_EVENT_TRACER;
+#endif
+
+    EasyEventTracer& EasyEventTracer::instance()
+    {
+#ifndef EASY_MAGIC_STATIC_CPP11
+        return EASY_EVENT_TRACER.instance;
+#else
+        static EasyEventTracer tracer;
+        return tracer;
+#endif
+    }
+
+    EasyEventTracer::EasyEventTracer()
+    {
+        m_lowPriority = ATOMIC_VAR_INIT(EASY_OPTION_LOW_PRIORITY_EVENT_TRACING);
+        m_stopping = ATOMIC_VAR_INIT(false);
+        m_stopTime = ATOMIC_VAR_INIT(~0ULL);
+    }
+
+    EasyEventTracer::~EasyEventTracer()
+    {
+        disable();
+    }
+
+    bool EasyEventTracer::isLowPriority() const
+    {
+        return m_lowPriority.load(::std::memory_order_acquire);
+    }
+
+    void EasyEventTracer::setLowPriority(bool _value)
+    {
+        m_lowPriority.store(_value, ::std::memory_order_release);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+
+    ::profiler::EventTracingEnableStatus EasyEventTracer::openBuffers()
+    {
+        uint64_t tracepoint = 0;
+        const bool schedSwitch = readSchedSwitchFormat(tracepoint, m_prevPidOffset, m_nextPidOffset, m_nextCommOffset);
+
+        const auto pageSize = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+        const auto cpus = static_cast<int>(sysconf(_SC_NPROCESSORS_CONF));
+
+        int error = 0;
+        for (uint32_t mode = schedSwitch ? TRACE_SCHED_SWITCH : TRACE_SWITCH_RECORDS; mode <= TRACE_SWITCH_RECORDS; ++mode)
+        {
+            perf_event_attr attr;
+            memset(&attr, 0, sizeof(perf_event_attr));
+            attr.size = sizeof(perf_event_attr);
+            attr.disabled = 1;
+            attr.sample_id_all = 1;
+            attr.use_clockid = 1;
+            attr.clockid = CLOCK_MONOTONIC;
+            attr.watermark = 1;
+            attr.wakeup_watermark = static_cast<uint32_t>(DATA_PAGES * pageSize / 4);
+
+            if (mode == TRACE_SCHED_SWITCH)
+            {
+                // Reading raw tracepoint data requires CAP_PERFMON or kernel.perf_event_paranoid == -1
+                attr.type = PERF_TYPE_TRACEPOINT;
+                attr.config = tracepoint;
+                attr.sample_period = 1;
+                attr.sample_type = PERF_SAMPLE_TID | PERF_SAMPLE_TIME | PERF_SAMPLE_CPU | PERF_SAMPLE_RAW;
+            }
+            else
+            {
+                attr.type = PERF_TYPE_SOFTWARE;
+                attr.config = PERF_COUNT_SW_DUMMY;
+                attr.context_switch = 1;
+                attr.sample_type = PERF_SAMPLE_TID | PERF_SAMPLE_TIME | PERF_SAMPLE_CPU;
+            }
+
+            error = 0;
+            for (int cpu = 0; cpu < cpus && error == 0; ++cpu)
+            {
+                RingBuffer buffer;
+                buffer.fd = openPerfEvent(attr, cpu);
+                if (buffer.fd < 0)
+                {
+                    if (errno != ENODEV) // ENODEV means that cpu is offline
+                        error = errno;
+                    continue;
+                }
+
+                buffer.size = DATA_PAGES * pageSize;
+                void* base = mmap(nullptr, buffer.size + pageSize, PROT_READ | PROT_WRITE, MAP_SHARED, buffer.fd, 0);
+                if (base == MAP_FAILED)
+                {
+                    error = errno;
+                    close(buffer.fd);
+                    continue;
+                }
+
+                buffer.base = static_cast<char*>(base);
+                m_buffers.push_back(buffer);
+            }
+
+            if (error == 0 && !m_buffers.empty())
+            {
+                m_mode = static_cast<TraceMode>(mode);
+                return EVENT_TRACING_LAUNCHED_SUCCESSFULLY;
+            }
+
+            closeBuffers();
+        }
+
+        switch (error)
+        {
+            case EACCES:
+            case EPERM:
+                EASY_WARNING("Event tracing not launched: perf_event_open() access denied. Set kernel.perf_event_paranoid to 0 (or -1) or grant CAP_PERFMON to use built-in tracer. Context switch log-file would be used instead.\n");
+                return EVENT_TRACING_NOT_ENOUGH_ACCESS_RIGHTS;
+
+            case EBUSY:
+                EASY_ERROR("Event tracing not launched: perf_event_open() returned EBUSY.\n");
+                return EVENT_TRACING_WAS_LAUNCHED_BY_SOMEBODY_ELSE;
+
+            case E2BIG:
+                EASY_ERROR("Event tracing not launched: perf_event_attr size is not supported by the kernel.\n");
+                return EVENT_TRACING_BAD_PROPERTIES_SIZE;
+
+            case ENOENT:
+            case EINVAL:
+            case ENOSYS:
+            case EOPNOTSUPP:
+                EASY_ERROR("Event tracing not launched: context switch events are not supported by the kernel (" << strerror(error) << ").\n");
+                return EVENT_TRACING_OPEN_TRACE_ERROR;
+        }
+
+        EASY_ERROR("Event tracing not launched: perf_event_open() failed (" << strerror(error) << ").\n");
+        return EVENT_TRACING_MISTERIOUS_ERROR;
+    }
+
+    ::profiler::EventTracingEnableStatus EasyEventTracer::openReplay(const char* _filename)
+    {
+        std::ifstream file(_filename, std::ios::binary);
+        if (!file.is_open())
+        {
+            EASY_ERROR("Event tracing not launched: can not open replay-file \"" << _filename << "\"\n");
+            return EVENT_TRACING_OPEN_TRACE_ERROR;
+        }
+
+        std::stringstream content;
+        content << file.rdbuf();
+        const auto data = content.str();
+
+        ReplayHeader header;
+        if (data.size() < sizeof(ReplayHeader) || (memcpy(&header, data.data(), sizeof(ReplayHeader)), memcmp(header.magic, REPLAY_MAGIC, sizeof(REPLAY_MAGIC)) != 0)
+            || header.mode > TRACE_SWITCH_RECORDS)
+        {
+            EASY_ERROR("Event tracing not launched: \"" << _filename << "\" is not a replay-file\n");
+            return EVENT_TRACING_OPEN_TRACE_ERROR;
+        }
+
+        m_mode = static_cast<TraceMode>(header.mode);
+        m_prevPidOffset = header.prevPidOffset;
+        m_nextPidOffset = header.nextPidOffset;
+        m_nextCommOffset = header.nextCommOffset;
+        m_replay.assign(data.begin() + sizeof(ReplayHeader), data.end());
+
+        EASY_LOGMSG("Event tracing replays \"" << _filename << "\"\n");
+        return EVENT_TRACING_LAUNCHED_SUCCESSFULLY;
+    }
+
+    void EasyEventTracer::openRecord(const char* _filename)
+    {
+        m_recordFile.open(_filename, std::ios::binary | std::ios::trunc);
+        if (!m_recordFile.is_open())
+        {
+            EASY_ERROR("Can not open replay-file \"" << _filename << "\" for recording\n");
+            return;
+        }
+
+        ReplayHeader header;
+        memcpy(header.magic, REPLAY_MAGIC, sizeof(REPLAY_MAGIC));
+        header.mode = m_mode;
+        header.prevPidOffset = m_prevPidOffset;
+        header.nextPidOffset = m_nextPidOffset;
+        header.nextCommOffset = m_nextCommOffset;
+        m_recordFile.write(reinterpret_cast<const char*>(&header), sizeof(ReplayHeader));
+
+        EASY_LOGMSG("Event tracing records into \"" << _filename << "\"\n");
+    }
+
+    void EasyEventTracer::closeBuffers()
+    {
+        const auto pageSize = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+        for (auto& buffer : m_buffers)
+        {
+            munmap(buffer.base, buffer.size + pageSize);
+            close(buffer.fd);
+        }
+
+        m_buffers.clear();
+        m_replay.clear();
+
+        if (m_recordFile.is_open())
+            m_recordFile.close();
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+
+    timestamp_t EasyEventTracer::toTicks(uint64_t _time) const
+    {
+        if (_time >= m_baseTime)
+            return m_baseTicks + static_cast<timestamp_t>(static_cast<double>(_time - m_baseTime) * m_ticksPerNs);
+
+        const auto ticks = static_cast<timestamp_t>(static_cast<double>(m_baseTime - _time) * m_ticksPerNs);
+        return ticks < m_baseTicks ? m_baseTicks - ticks : 0;
+    }
+
+    void EasyEventTracer::readRecord(const char* _record, uint16_t _size)
+    {
+        const auto header = reinterpret_cast<const perf_event_header*>(_record);
+        const char* data = _record + sizeof(perf_event_header);
+        const char* end = _record + _size;
+
+        SwitchEvent event;
+        switch (header->type)
+        {
+            case PERF_RECORD_SAMPLE:
+            {
+                // u32 pid, tid; u64 time; u32 cpu, res; u32 size; char raw[size];
+                if (m_mode != TRACE_SCHED_SWITCH || data + 28 > end)
+                    return;
+
+                const char* raw = data + 28;
+                const auto rawSize = readValue<uint32_t>(data + 24);
+                const auto rawEnd = std::min(raw + rawSize, end);
+                if (raw + std::max(std::max(m_prevPidOffset, m_nextPidOffset) + 4, m_nextCommOffset + 16) > rawEnd)
+                    return;
+
+                event.time = readValue<uint64_t>(data + 8);
+                event.prev_tid = readValue<uint32_t>(raw + m_prevPidOffset);
+                event.next_tid = readValue<uint32_t>(raw + m_nextPidOffset);
+                event.next_pid = -1;
+                memcpy(event.next_comm, raw + m_nextCommOffset, sizeof(event.next_comm));
+                event.next_comm[sizeof(event.next_comm) - 1] = 0;
+                break;
+            }
+
+            case PERF_RECORD_SWITCH_CPU_WIDE:
+            {
+                // u32 next_prev_pid, next_prev_tid; sample_id { u32 pid, tid; u64 time; u32 cpu, res; }
+                // Switch-out record describes the next task, switch-in record of the next task is redundant.
+                if (m_mode != TRACE_SWITCH_RECORDS || !(header->misc & PERF_RECORD_MISC_SWITCH_OUT) || data + 24 > end)
+                    return;
+
+                event.time = readValue<uint64_t>(data + 16);
+                event.prev_tid = readValue<uint32_t>(data + 12);
+                event.next_tid = readValue<uint32_t>(data + 4);
+                event.next_pid = readValue<int32_t>(data);
+                event.next_comm[0] = 0;
+                break;
+            }
+
+            case PERF_RECORD_LOST:
+            {
+                // u64 id, lost;
+                if (data + 16 <= end)
+                    m_lostEvents += readValue<uint64_t>(data + 8);
+                return;
+            }
+
+            default:
+                return;
+        }
+
+        m_pending.push_back(event);
+    }
+
+    void EasyEventTracer::drain()
+    {
+        const auto pageSize = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+        for (auto& buffer : m_buffers)
+        {
+            auto meta = reinterpret_cast<perf_event_mmap_page*>(buffer.base);
+            const char* data = buffer.base + pageSize;
+
+            const uint64_t head = __atomic_load_n(&meta->data_head, __ATOMIC_ACQUIRE);
+            uint64_t tail = meta->data_tail;
+
+            while (tail < head)
+            {
+                // Records are 8-byte aligned, so header is never wrapped around the end of buffer
+                const auto offset = tail & (buffer.size - 1);
+                const auto header = reinterpret_cast<const perf_event_header*>(data + offset);
+                const uint16_t size = header->size;
+                if (size < sizeof(perf_event_header))
+                {
+                    tail = head;
+                    break;
+                }
+
+                const char* record = data + offset;
+                if (offset + size > buffer.size)
+                {
+                    const auto first = buffer.size - offset;
+                    m_record.resize(size);
+                    memcpy(m_record.data(), data + offset, first);
+                    memcpy(m_record.data() + first, data, size - first);
+                    record = m_record.data();
+                }
+
+                if (m_recordFile.is_open())
+                    m_recordFile.write(record, size);
+
+                readRecord(record, size);
+
+                tail += size;
+            }
+
+            __atomic_store_n(&meta->data_tail, tail, __ATOMIC_RELEASE);
+        }
+    }
+
+    const char* EasyEventTracer::processName(const SwitchEvent& _event, processid_t& _pid)
+    {
+        auto it = m_threads.find(_event.next_tid);
+        if (it != m_threads.end())
+        {
+            _pid = it->second.pid;
+            return it->second.name;
+        }
+
+        ThreadInfo info;
+        info.pid = 0;
+        info.name = "";
+
+        const int32_t pid = _event.next_tid == 0 ? 0 : _event.next_pid >= 0 ? _event.next_pid : readProcessId(_event.next_tid);
+        if (pid >= 0)
+        {
+            auto& name = m_processes[static_cast<uint32_t>(pid)];
+            if (name == nullptr)
+            {
+                // Process name format is "pid name" as for Windows
+                std::string comm;
+                if (pid == 0)
+                    comm = "swapper";
+                else if (!std::getline(std::ifstream("/proc/" + std::to_string(pid) + "/comm"), comm))
+                    comm = pid == static_cast<int32_t>(_event.next_tid) ? _event.next_comm : "";
+
+                name = m_names.insert(comm.empty() ? std::to_string(pid) : std::to_string(pid) + " " + comm).first->c_str();
+            }
+
+            info.pid = static_cast<processid_t>(pid);
+            info.name = name;
+        }
+        else if (_event.next_comm[0] != 0)
+        {
+            // Thread has exited already
+            info.name = m_names.insert(_event.next_comm).first->c_str();
+        }
+
+        m_threads.emplace(_event.next_tid, info);
+
+        _pid = info.pid;
+        return info.name;
+    }
+
+    void EasyEventTracer::flush(uint64_t _until)
+    {
+        // Events are passed to ProfileManager concurrently with dumping: storages found by ProfileManager
+        // are referenced until the event is stored (so they are never removed meanwhile), full dumps stop
+        // the tracer before modifying storages and dumps of recent blocks do not modify them at all.
+        if (m_pending.empty())
+            return;
+
+        std::sort(m_pending.begin(), m_pending.end(), [](const SwitchEvent& _a, const SwitchEvent& _b) {
+            return _a.time < _b.time;
+        });
+
+        const auto stopTime = m_stopTime.load(std::memory_order_acquire);
+        auto it = m_pending.begin();
+        for (; it != m_pending.end() && it->time <= _until; ++it)
+        {
+            if (it->time > stopTime)
+                continue;
+
+            processid_t pid = 0;
+            const char* name = processName(*it, pid);
+            const auto time = toTicks(it->time);
+
+            MANAGER.beginContextSwitch(it->prev_tid, time, it->next_tid, name);
+            MANAGER.endContextSwitch(it->next_tid, pid, time);
+        }
+
+        m_pending.erase(m_pending.begin(), it);
+    }
+
+    void EasyEventTracer::process()
+    {
+        if (!m_replay.empty())
+        {
+            const char* data = m_replay.data();
+            const char* end = data + m_replay.size();
+            while (data + sizeof(perf_event_header) <= end)
+            {
+                const uint16_t size = reinterpret_cast<const perf_event_header*>(data)->size;
+                if (size < sizeof(perf_event_header) || data + size > end)
+                    break;
+                readRecord(data, size);
+                data += size;
+            }
+
+            if (!m_pending.empty())
+            {
+                // Events recorded by another launch would be dropped by the reader (they are older than capture begin),
+                // so they are shifted to start at the moment of enabling the tracer
+                const auto first = std::min_element(m_pending.begin(), m_pending.end(), [](const SwitchEvent& _a, const SwitchEvent& _b) {
+                    return _a.time < _b.time;
+                })->time;
+
+                if (first < m_baseTime)
+                {
+                    for (auto& event : m_pending)
+                        event.time += m_baseTime - first;
+                }
+            }
+
+            flush(~0ULL);
+            return;
+        }
+
+        std::vector<pollfd> fds(m_buffers.size());
+        for (size_t i = 0; i < fds.size(); ++i)
+        {
+            fds[i].fd = m_buffers[i].fd;
+            fds[i].events = POLLIN;
+            fds[i].revents = 0;
+        }
+
+        while (!m_stopping.load(std::memory_order_acquire))
+        {
+            poll(fds.data(), static_cast<nfds_t>(fds.size()), POLL_TIMEOUT_MS);
+
+            const auto now = monotonicTime();
+            drain();
+            flush(now - FLUSH_DELAY_NS);
+        }
+
+        drain();
+        flush(~0ULL);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+
+    ::profiler::EventTracingEnableStatus EasyEventTracer::enable(bool)
+    {
+        ::profiler::guard_lock<::profiler::spin_lock> lock(m_spin);
+        if (m_bEnabled)
+            return EVENT_TRACING_LAUNCHED_SUCCESSFULLY;
+
+        const char* replay = getenv("EASY_PROFILER_PERF_REPLAY");
+        const auto res = replay != nullptr && *replay != 0 ? openReplay(replay) : openBuffers();
+        if (res != EVENT_TRACING_LAUNCHED_SUCCESSFULLY)
+            return res;
+
+        // perf timestamps are CLOCK_MONOTONIC nanoseconds, take matching pair of times to convert them into ticks
+        const auto ticks = getCurrentTime();
+        m_baseTime = monotonicTime();
+        m_baseTicks = ticks + (getCurrentTime() - ticks) / 2;
+        m_ticksPerNs = MANAGER.ticksPerNanosecond();
+
+        m_lostEvents = 0;
+        m_stopping.store(false, ::std::memory_order_release);
+        m_stopTime.store(~0ULL, ::std::memory_order_release);
+
+        const char* record = getenv("EASY_PROFILER_PERF_RECORD");
+        if (record != nullptr && *record != 0 && !m_buffers.empty())
+            openRecord(record);
+
+        for (const auto& buffer : m_buffers)
+            ioctl(buffer.fd, PERF_EVENT_IOC_ENABLE, 0);
+
+        m_processThread = ::std::thread([this](bool _lowPriority)
+        {
+            if (_lowPriority) // Set low priority for event tracing thread
+                setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 19);
+            EASY_THREAD_SCOPE("EasyProfiler.Perf");
+            process();
+
+        }, m_lowPriority.load(::std::memory_order_acquire));
+
+        m_bEnabled = true;
+
+        EASY_LOGMSG("Event tracing launched (" << (m_mode == TRACE_SCHED_SWITCH ? "sched_switch" : "switch records") << ")\n");
+        return EVENT_TRACING_LAUNCHED_SUCCESSFULLY;
+    }
+
+    void EasyEventTracer::disable()
+    {
+        ::profiler::guard_lock<::profiler::spin_lock> lock(m_spin);
+        if (!m_bEnabled)
+            return;
+
+        EASY_LOGMSG("Event tracing is stopping...\n");
+
+        m_stopTime.store(monotonicTime(), ::std::memory_order_release);
+        m_stopping.store(true, ::std::memory_order_release);
+
+        // Wait for process() to finish to make sure no events will be passed to ProfileManager later.
+        if (m_processThread.joinable())
+            m_processThread.join();
+
+        for (const auto& buffer : m_buffers)
+            ioctl(buffer.fd, PERF_EVENT_IOC_DISABLE, 0);
+
+        closeBuffers();
+        m_pending.clear();
+
+        // Process ids may be reused by the next session, names are kept because opened context switch events refer to them
+        m_processes.clear();
+        m_threads.clear();
+
+        m_bEnabled = false;
+
+        EASY_LOG_ONLY(
+            if (m_lostEvents != 0)
+                EASY_WARNING(m_lostEvents << " context switch events were lost\n");
+        )
+
+        EASY_LOGMSG("Event tracing stopped\n");
+    }
+
+} // END of namespace profiler.
+
+//////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////
+
+#endif // __linux__
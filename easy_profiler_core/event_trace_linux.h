@@ -0,0 +1,193 @@
+/**
+Lightweight profiler library for c++
+Copyright(C) 2016-2017  Sergey Yagovtsev, Victor Zarubkin
+
+Licensed under either of
+    * MIT license (LICENSE.MIT or http://opensource.org/licenses/MIT)
+    * Apache License, Version 2.0, (LICENSE.APACHE or http://www.apache.org/licenses/LICENSE-2.0)
+at your option.
+
+The MIT License
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights 
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies 
+    of the Software, and to permit persons to whom the Software is furnished 
+    to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all 
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+    PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE 
+    LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE 
+    USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+The Apache License, Version 2.0 (the "License");
+    You may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+
+**/
+
+#ifndef EASY_PROFILER_EVENT_TRACE_LINUX_H
+#define EASY_PROFILER_EVENT_TRACE_LINUX_H
+#ifdef __linux__
+
+#include <easy/profiler.h>
+#include <thread>
+#include <atomic>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include "event_trace_status.h"
+#include "spin_lock.h"
+
+//////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////
+
+namespace profiler {
+
+    /** Linux counterpart of Windows EasyEventTracer.
+
+    Reads sched:sched_switch tracepoint events from per-CPU perf_event mmap ring buffers on a separate thread
+    and passes them to ProfileManager incrementally. If tracefs is not mounted then PERF_RECORD_SWITCH_CPU_WIDE
+    records are used instead (Linux 4.3+).
+
+    System-wide tracing requires CAP_PERFMON (or CAP_SYS_ADMIN) or kernel.perf_event_paranoid <= 0.
+    If tracer can not be launched then context switch events are read from the log-file
+    of external tracer while dumping (see profiler::setContextSwitchLogFilename()).
+
+    If environment variable EASY_PROFILER_PERF_REPLAY contains path to the replay-file
+    then events are read from this file instead of the kernel (used for testing without privileges).
+    Replay-file starts with ReplayHeader followed by raw perf records exactly as they are written into ring buffer
+    (sample_type is TID|TIME|CPU|RAW for tracepoint records and TID|TIME|CPU for sample_id of switch records,
+    time is CLOCK_MONOTONIC in nanoseconds). If recorded events are older than the moment of enabling the tracer
+    (e.g. the file has been recorded by another launch) then their times are shifted to start at this moment.
+
+    If environment variable EASY_PROFILER_PERF_RECORD contains path to the replay-file then all records read
+    from the kernel are also written into this file (see tests/perf_replay for an example of using it).
+    */
+    class EasyEventTracer EASY_FINAL
+    {
+#ifndef EASY_MAGIC_STATIC_CPP11
+        friend class EasyEventTracerInstance;
+#endif
+
+    public:
+
+        enum TraceMode : uint32_t
+        {
+            TRACE_SCHED_SWITCH = 0, ///< sched:sched_switch tracepoint samples
+            TRACE_SWITCH_RECORDS,   ///< PERF_RECORD_SWITCH_CPU_WIDE records of dummy software event
+        };
+
+#pragma pack(push, 1)
+        struct ReplayHeader
+        {
+            char           magic[8]; ///< "EASYPERF"
+            uint32_t           mode; ///< TraceMode
+            uint32_t  prevPidOffset; ///< Offset of prev_pid field in raw tracepoint data (TRACE_SCHED_SWITCH only)
+            uint32_t  nextPidOffset; ///< Offset of next_pid field in raw tracepoint data (TRACE_SCHED_SWITCH only)
+            uint32_t nextCommOffset; ///< Offset of next_comm field in raw tracepoint data (TRACE_SCHED_SWITCH only)
+        };
+#pragma pack(pop)
+
+    private:
+
+        struct RingBuffer
+        {
+            char*       base = nullptr; ///< Mapped metadata page followed by data pages
+            uint64_t    size = 0; ///< Size of data pages
+            int           fd = -1;
+        };
+
+        struct SwitchEvent
+        {
+            uint64_t          time; ///< CLOCK_MONOTONIC time in nanoseconds
+            uint32_t      prev_tid;
+            uint32_t      next_tid;
+            int32_t       next_pid; ///< Process id of next thread (-1 if unknown)
+            char     next_comm[16];
+        };
+
+        struct ThreadInfo
+        {
+            const char*  name; ///< "pid name" as for Windows (points into m_names)
+            processid_t   pid;
+        };
+
+        typedef std::unordered_map<uint32_t, const char*> process_info_map;
+        typedef std::unordered_map<uint32_t, ThreadInfo> thread_info_map;
+
+        ::std::thread            m_processThread;
+        ::std::vector<RingBuffer>        m_buffers;
+        ::std::vector<SwitchEvent>       m_pending; ///< Events drained from ring buffers but not passed to ProfileManager yet (sorted by time before processing)
+        ::std::vector<char>               m_record; ///< Temporary storage for records wrapped around the end of ring buffer
+        ::std::vector<char>               m_replay; ///< Contents of replay-file
+        ::std::ofstream               m_recordFile; ///< Replay-file being recorded (see EASY_PROFILER_PERF_RECORD)
+        ::std::unordered_set<::std::string> m_names; ///< Process names (never cleared because opened context switch events refer to them)
+        process_info_map             m_processes;
+        thread_info_map                m_threads;
+        ::profiler::spin_lock               m_spin;
+        ::std::atomic_bool           m_lowPriority;
+        ::std::atomic_bool              m_stopping;
+        ::std::atomic<uint64_t>         m_stopTime; ///< CLOCK_MONOTONIC time of disable(), events after it are dropped
+        uint64_t                      m_lostEvents = 0;
+        uint64_t                        m_baseTime = 0; ///< CLOCK_MONOTONIC time corresponding to m_baseTicks
+        timestamp_t                    m_baseTicks = 0;
+        double                        m_ticksPerNs = 1;
+        TraceMode                           m_mode = TRACE_SCHED_SWITCH;
+        uint32_t                   m_prevPidOffset = 0;
+        uint32_t                   m_nextPidOffset = 0;
+        uint32_t                  m_nextCommOffset = 0;
+        bool                            m_bEnabled = false;
+
+    public:
+
+        static EasyEventTracer& instance();
+        ~EasyEventTracer();
+
+        bool isLowPriority() const;
+
+        ::profiler::EventTracingEnableStatus enable(bool _force = false);
+        void disable();
+        void setLowPriority(bool _value);
+
+    private:
+
+        EasyEventTracer();
+
+        ::profiler::EventTracingEnableStatus openBuffers();
+        ::profiler::EventTracingEnableStatus openReplay(const char* _filename);
+        void openRecord(const char* _filename);
+        void closeBuffers();
+
+        void process();
+        void drain();
+        void flush(uint64_t _until);
+        void readRecord(const char* _record, uint16_t _size);
+        const char* processName(const SwitchEvent& _event, processid_t& _pid);
+        timestamp_t toTicks(uint64_t _time) const;
+
+    }; // END of class EasyEventTracer.
+
+} // END of namespace profiler.
+
+//////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////
+
+#endif // __linux__
+#endif // EASY_PROFILER_EVENT_TRACE_LINUX_H
@@ -80,6 +80,9 @@
                                             __declspec(thread) static VarType VarName = 0;\
                                             if (!VarName)\
                                                 VarName = VarInitializer
+
+// There is no support for C++11 constexpr keyword prior to Visual Studio 2015.
+#  define EASY_CONSTEXPR 
 # endif
 
 #define EASY_FORCE_INLINE __forceinline
@@ -153,6 +156,11 @@
 # define EASY_FINAL final
 #endif
 
+#ifndef EASY_CONSTEXPR
+# define EASY_CONSTEXPR constexpr
+# define EASY_CONSTEXPR_CPP11
+#endif
+
 #ifndef EASY_FORCE_INLINE
 # define EASY_FORCE_INLINE inline
 #endif
@@ -77,6 +77,12 @@ enum MessageType : uint8_t
 
     MESSAGE_TYPE_REQUEST_MAIN_FRAME_TIME_MAX_AVG_US,
     MESSAGE_TYPE_REPLY_MAIN_FRAME_TIME_MAX_AVG_US,
+
+    MESSAGE_TYPE_COMPRESSION_STATUS, ///< BoolMessage: request compressed MESSAGE_TYPE_REPLY_BLOCKS payload (ignored by older applications which always send uncompressed blocks)
+
+    MESSAGE_TYPE_EDIT_BLOCK_SAMPLING, ///< BlockSamplingMessage: change sampling rate of a block descriptor
+
+    MESSAGE_TYPE_REQUEST_RECENT_BLOCKS, ///< RecentBlocksMessage: send blocks of the last window milliseconds without stopping capture (replied with MESSAGE_TYPE_REPLY_BLOCKS)
 };
 
 struct Message
@@ -108,6 +114,21 @@ private:
     BlockStatusMessage() = delete;
 };
 
+struct BlockSamplingMessage : public Message {
+    uint32_t       id;
+    uint16_t sampling;
+    BlockSamplingMessage(uint32_t _id, uint16_t _sampling) : Message(MESSAGE_TYPE_EDIT_BLOCK_SAMPLING), id(_id), sampling(_sampling) { }
+private:
+    BlockSamplingMessage() = delete;
+};
+
+struct RecentBlocksMessage : public Message {
+    uint32_t window; ///< Window size in milliseconds
+    RecentBlocksMessage(uint32_t _window) : Message(MESSAGE_TYPE_REQUEST_RECENT_BLOCKS), window(_window) { }
+private:
+    RecentBlocksMessage() = delete;
+};
+
 struct EasyProfilerStatus : public Message
 {
     bool         isProfilerEnabled;
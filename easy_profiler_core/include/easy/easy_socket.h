@@ -52,6 +52,7 @@ The Apache License, Version 2.0 (the "License");
 #include <unistd.h>
 #include <fcntl.h>
 #include <netinet/in.h> //for android-build
+#include <sys/uio.h>
 #else
 
 #define WIN32_LEAN_AND_MEAN
@@ -101,6 +102,13 @@ public:
     void setReceiveTimeout(int milliseconds);
 
     int send(const void* buf, size_t nbyte);
+
+    /** Send several buffers as one contiguous message without copying them (scatter/gather send).
+
+    \retval Total number of bytes sent or -1 if an error occured.
+    */
+    int64_t send(const void* const* buffers, const size_t* sizes, size_t count);
+
     int receive(void* buf, size_t nbyte);
     int listen(int count = 5);
     int accept();
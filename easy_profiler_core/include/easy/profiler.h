@@ -44,6 +44,7 @@ The Apache License, Version 2.0 (the "License");
 #define EASY_PROFILER_H
 
 #include <easy/profiler_public_types.h>
+#include <atomic>
 
 #if defined ( __clang__ )
 # pragma clang diagnostic push
@@ -59,6 +60,12 @@ The Apache License, Version 2.0 (the "License");
 //                       to disable profiler for certain source-file or project.
 //
 
+//
+// EASY_STATIC_DESCRIPTORS may be defined manually in source-file before #include <easy/profiler.h>
+//                         to register all block descriptors of certain source-file or project at program startup
+//                         instead of registering each descriptor when it's block is executed for the first time.
+//
+
 #if defined(BUILD_WITH_EASY_PROFILER) && !defined(DISABLE_EASY_PROFILER)
 
 /**
@@ -72,6 +79,33 @@ The Apache License, Version 2.0 (the "License");
 */
 #define USING_EASY_PROFILER
 
+// EASY_BLOCK_DESCRIPTOR declares local pointer VarName to the descriptor of a block at the place of use.
+//
+// By default the descriptor is registered when the block is executed for the first time
+// (guarded local static variable, registration searches descriptor by unique id).
+//
+// If EASY_STATIC_DESCRIPTORS is defined then the block generates a unique local class which is used as a key
+// of profiler::StaticDescriptor. Descriptor is registered during dynamic initialization of the program
+// (or shared library) and the block only reads already registered pointer.
+// Block name, color, status and sampling must be compile-time constants in this case.
+# if defined(EASY_STATIC_DESCRIPTORS) && defined(EASY_CONSTEXPR_CPP11)
+#  define EASY_BLOCK_DESCRIPTOR(VarName, compiletimeName, blockType, copyName, ...)\
+    static EASY_CONSTEXPR const char* EASY_UNIQUE_DESC_NAME(__LINE__) = compiletimeName;\
+    struct EASY_UNIQUE_DESC_TAG(__LINE__) EASY_FINAL {\
+        static const ::profiler::BaseBlockDescriptor* registerDescription() {\
+            return ::profiler::registerDescription(::profiler::extract_enable_flag(__VA_ARGS__), EASY_UNIQUE_LINE_ID,\
+                EASY_UNIQUE_DESC_NAME(__LINE__), __FILE__, __LINE__, blockType, ::profiler::extract_color(__VA_ARGS__),\
+                copyName, ::profiler::extract_sampling(__VA_ARGS__));\
+        }\
+    };\
+    const ::profiler::BaseBlockDescriptor* const VarName = ::profiler::StaticDescriptor<EASY_UNIQUE_DESC_TAG(__LINE__)>::descriptor
+# else
+#  define EASY_BLOCK_DESCRIPTOR(VarName, compiletimeName, blockType, copyName, ...)\
+    EASY_LOCAL_STATIC_PTR(const ::profiler::BaseBlockDescriptor*, VarName, ::profiler::registerDescription(::profiler::extract_enable_flag(__VA_ARGS__),\
+        EASY_UNIQUE_LINE_ID, compiletimeName, __FILE__, __LINE__, blockType, ::profiler::extract_color(__VA_ARGS__), copyName,\
+        ::profiler::extract_sampling(__VA_ARGS__)))
+# endif
+
 
 // EasyProfiler core API:
 
@@ -101,6 +135,11 @@ The Apache License, Version 2.0 (the "License");
         for (int i = 0; i < 10; ++i)
             sum += i;
         EASY_END_BLOCK; // End of "Calculate sum" block
+
+        for (int i = 0; i < 1000000; ++i) {
+            EASY_BLOCK("Hot block", profiler::Sampling(100)); // Only 1 of 100 such blocks will be stored
+            hot();
+        }
     }
 \endcode
 
@@ -109,11 +148,10 @@ Block will be automatically completed by destructor.
 \ingroup profiler
 */
 # define EASY_BLOCK(name, ...)\
-    EASY_LOCAL_STATIC_PTR(const ::profiler::BaseBlockDescriptor*, EASY_UNIQUE_DESC(__LINE__), ::profiler::registerDescription(::profiler::extract_enable_flag(__VA_ARGS__),\
-        EASY_UNIQUE_LINE_ID, EASY_COMPILETIME_NAME(name), __FILE__, __LINE__, ::profiler::BLOCK_TYPE_BLOCK, ::profiler::extract_color(__VA_ARGS__),\
-        ::std::is_base_of<::profiler::ForceConstStr, decltype(name)>::value));\
+    EASY_BLOCK_DESCRIPTOR(EASY_UNIQUE_DESC(__LINE__), EASY_COMPILETIME_NAME(name), ::profiler::BLOCK_TYPE_BLOCK,\
+        (::std::is_base_of<::profiler::ForceConstStr, decltype(name)>::value), __VA_ARGS__);\
     ::profiler::Block EASY_UNIQUE_BLOCK(__LINE__)(EASY_UNIQUE_DESC(__LINE__), EASY_RUNTIME_NAME(name));\
-    ::profiler::beginBlock(EASY_UNIQUE_BLOCK(__LINE__));
+    ::profiler::beginBlockFast(EASY_UNIQUE_BLOCK(__LINE__));
 
 /** Macro for beginning of a non-scoped block with custom name and color.
 
@@ -147,10 +185,9 @@ Block will be automatically completed by destructor.
 \ingroup profiler
 */
 #define EASY_NONSCOPED_BLOCK(name, ...)\
-    EASY_LOCAL_STATIC_PTR(const ::profiler::BaseBlockDescriptor*, EASY_UNIQUE_DESC(__LINE__), ::profiler::registerDescription(::profiler::extract_enable_flag(__VA_ARGS__),\
-        EASY_UNIQUE_LINE_ID, EASY_COMPILETIME_NAME(name), __FILE__, __LINE__, ::profiler::BLOCK_TYPE_BLOCK, ::profiler::extract_color(__VA_ARGS__),\
-        ::std::is_base_of<::profiler::ForceConstStr, decltype(name)>::value));\
-    ::profiler::beginNonScopedBlock(EASY_UNIQUE_DESC(__LINE__), EASY_RUNTIME_NAME(name));
+    EASY_BLOCK_DESCRIPTOR(EASY_UNIQUE_DESC(__LINE__), EASY_COMPILETIME_NAME(name), ::profiler::BLOCK_TYPE_BLOCK,\
+        (::std::is_base_of<::profiler::ForceConstStr, decltype(name)>::value), __VA_ARGS__);\
+    ::profiler::beginNonScopedBlockFast(EASY_UNIQUE_DESC(__LINE__), EASY_RUNTIME_NAME(name));
 
 /** Macro for beginning of a block with function name and custom color.
 
@@ -177,10 +214,9 @@ Name of the block automatically created with function name.
 \ingroup profiler
 */
 # define EASY_FUNCTION(...)\
-    EASY_LOCAL_STATIC_PTR(const ::profiler::BaseBlockDescriptor*, EASY_UNIQUE_DESC(__LINE__), ::profiler::registerDescription(::profiler::extract_enable_flag(__VA_ARGS__),\
-        EASY_UNIQUE_LINE_ID, __func__, __FILE__, __LINE__, ::profiler::BLOCK_TYPE_BLOCK, ::profiler::extract_color(__VA_ARGS__), false));\
+    EASY_BLOCK_DESCRIPTOR(EASY_UNIQUE_DESC(__LINE__), __func__, ::profiler::BLOCK_TYPE_BLOCK, false, __VA_ARGS__);\
     ::profiler::Block EASY_UNIQUE_BLOCK(__LINE__)(EASY_UNIQUE_DESC(__LINE__), "");\
-    ::profiler::beginBlock(EASY_UNIQUE_BLOCK(__LINE__)); // this is to avoid compiler warning about unused variable
+    ::profiler::beginBlockFast(EASY_UNIQUE_BLOCK(__LINE__)); // this is to avoid compiler warning about unused variable
 
 /** Macro for completion of last opened block explicitly.
 
@@ -205,7 +241,7 @@ int foo()
 
 \ingroup profiler
 */
-# define EASY_END_BLOCK ::profiler::endBlock();
+# define EASY_END_BLOCK ::profiler::endBlockFast();
 
 /** Macro for creating event marker with custom name and color.
 
@@ -217,11 +253,9 @@ will end previously opened EASY_BLOCK or EASY_FUNCTION.
 \ingroup profiler
 */
 # define EASY_EVENT(name, ...)\
-    EASY_LOCAL_STATIC_PTR(const ::profiler::BaseBlockDescriptor*, EASY_UNIQUE_DESC(__LINE__), ::profiler::registerDescription(\
-        ::profiler::extract_enable_flag(__VA_ARGS__), EASY_UNIQUE_LINE_ID, EASY_COMPILETIME_NAME(name),\
-            __FILE__, __LINE__, ::profiler::BLOCK_TYPE_EVENT, ::profiler::extract_color(__VA_ARGS__),\
-            ::std::is_base_of<::profiler::ForceConstStr, decltype(name)>::value));\
-    ::profiler::storeEvent(EASY_UNIQUE_DESC(__LINE__), EASY_RUNTIME_NAME(name));
+    EASY_BLOCK_DESCRIPTOR(EASY_UNIQUE_DESC(__LINE__), EASY_COMPILETIME_NAME(name), ::profiler::BLOCK_TYPE_EVENT,\
+        (::std::is_base_of<::profiler::ForceConstStr, decltype(name)>::value), __VA_ARGS__);\
+    ::profiler::storeEventFast(EASY_UNIQUE_DESC(__LINE__), EASY_RUNTIME_NAME(name));
 
 /** Macro for enabling profiler.
 
@@ -303,6 +337,8 @@ breakdown, but if you care about that then you change set event tracing priority
 
 \note Default value is "/tmp/cs_profiling_info.log".
 
+\note On Linux the log-file is read only if built-in perf_event tracer could not be launched (not enough access rights).
+
 \ingroup profiler
 */
 # define EASY_EVENT_TRACING_SET_LOG(filename) ::profiler::setContextSwitchLogFilename(filename);
@@ -351,7 +387,7 @@ turned on/off with next calls of profiler::setEnabled().
 #  define EASY_OPTION_EVENT_TRACING_ENABLED true
 # endif
 
-/** If true then EasyProfiler.ETW thread (Event tracing for Windows) will have low priority by default.
+/** If true then EasyProfiler.ETW thread (Event tracing for Windows) or EasyProfiler.Perf thread (Linux) will have low priority by default.
 
 \sa EASY_SET_LOW_PRIORITY_EVENT_TRACING
 
@@ -457,6 +493,17 @@ namespace profiler {
 
     const uint16_t DEFAULT_PORT = EASY_DEFAULT_PORT;
 
+    /** Returns pointer to the fast path state of current thread cached in thread-local variable of this module.
+
+    It is nullptr until the first block of current thread is begun (see registerThreadFastState()).
+
+    \ingroup profiler
+    */
+    inline ThreadFastState*& thisThreadFastState() {
+        EASY_THREAD_LOCAL static ThreadFastState* state = nullptr;
+        return state;
+    }
+
     //////////////////////////////////////////////////////////////////////
     // Core API
     // Note: It is better to use macros defined above than a direct calls to API.
@@ -494,7 +541,11 @@ namespace profiler {
         /** Registers static description of a block.
 
         It is general information which is common for all such blocks.
-        Includes color, block type (see BlockType), file-name, line-number, compile-time name of a block and enable-flag.
+        Includes color, block type (see BlockType), file-name, line-number, compile-time name of a block, enable-flag
+        and sampling rate.
+
+        \param _sampling Only 1 of _sampling blocks (or events) with this description would be stored by each thread.
+        Use it for very hot blocks to reduce profiling overhead: statistics are scaled back by the reader.
 
         \note This API function is used by EASY_EVENT, EASY_BLOCK, EASY_FUNCTION macros.
         There is no need to invoke this function explicitly.
@@ -503,7 +554,7 @@ namespace profiler {
 
         \ingroup profiler
         */
-        PROFILER_API const BaseBlockDescriptor* registerDescription(EasyBlockStatus _status, const char* _autogenUniqueId, const char* _compiletimeName, const char* _filename, int _line, block_type_t _block_type, color_t _color, bool _copyName = false);
+        PROFILER_API const BaseBlockDescriptor* registerDescription(EasyBlockStatus _status, const char* _autogenUniqueId, const char* _compiletimeName, const char* _filename, int _line, block_type_t _block_type, color_t _color, bool _copyName = false, uint16_t _sampling = 1);
 
         /** Stores event in the blocks list.
 
@@ -567,6 +618,14 @@ namespace profiler {
         */
         PROFILER_API void endBlock();
 
+        /** Returns fast path state of current thread and registers _cache which would be reset to nullptr when thread is unregistered.
+
+        \note There is no need to invoke this function explicitly - it is called by inlined fast path of EASY_BLOCK, EASY_FUNCTION etc.
+
+        \ingroup profiler
+        */
+        PROFILER_API ThreadFastState* registerThreadFastState(ThreadFastState** _cache);
+
         /** Enable or disable profiler.
 
         AKA start or stop profiling (capturing blocks).
@@ -640,6 +699,8 @@ namespace profiler {
 
         \note Default value is "/tmp/cs_profiling_info.log".
 
+        \note On Linux the log-file is read only if built-in perf_event tracer could not be launched (not enough access rights).
+
         \ingroup profiler
         */
         PROFILER_API void setContextSwitchLogFilename(const char* _name);
@@ -675,6 +736,218 @@ namespace profiler {
         */
         PROFILER_API bool isListening();
 
+        /** Start streaming mode.
+
+        Launches a separate thread which continuously flushes filled blocks storage chunks of all threads
+        into a ring of spill files while capturing is enabled. This keeps resident memory used by closed blocks
+        bounded by _memoryBudget without stopping capture. Flushed blocks are written back into the output stream
+        by the next dump (dumpBlocksToFile() or network command 'stop'), so the result is the same as without streaming.
+
+        Spill files are named "<_filenamePrefix>.<index>.spill". When the current file exceeds _segmentSize
+        the next file is used overwriting the oldest one, so the oldest blocks are lost if the ring overflows.
+
+        \param _filenamePrefix Path prefix for spill files.
+        \param _memoryBudget Approximate limit for memory used by closed blocks (in bytes).
+        \param _segmentsNumber Number of spill files in the ring (at least 2).
+        \param _segmentSize Size limit for one spill file (in bytes).
+
+        \retval false if spill file can not be created or if spill files of the previous streaming session
+        (opened with different parameters) still contain blocks which have not been dumped yet.
+
+        \ingroup profiler
+        */
+        PROFILER_API bool startStreaming(const char* _filenamePrefix, uint64_t _memoryBudget, uint32_t _segmentsNumber = 8, uint64_t _segmentSize = 64ULL << 20);
+
+        /** Stops flushing thread.
+
+        \note Already flushed blocks are kept in spill files until the next dump.
+
+        \ingroup profiler
+        */
+        PROFILER_API void stopStreaming();
+
+        /** Check if streaming mode is enabled.
+
+        \ingroup profiler
+        */
+        PROFILER_API bool isStreaming();
+
+        /** Enable or disable compression of captured data written by dumpBlocksToFile().
+
+        Data is compressed in independent chunks by all hardware threads using built-in LZ4-style compressor.
+        Compressed files are recognized by the reader automatically.
+
+        \note Compression of data sent via network is requested by the receiving side (GUI) and does not depend on this setting.
+
+        \ingroup profiler
+        */
+        PROFILER_API void setCompressionEnabled(bool _isEnable);
+        PROFILER_API bool isCompressionEnabled();
+
+        /** Set global minimum duration of stored blocks.
+
+        Blocks which are shorter than _nanoseconds are not stored. Instead, their number and total duration
+        are aggregated per thread and per block descriptor and written into the dump as one summary record
+        per descriptor, so statistics totals stay correct while capture memory and dump size are reduced.
+
+        \note 0 (default) disables filtering. Events are never filtered.
+
+        \sa setBlockMinDuration
+
+        \ingroup profiler
+        */
+        PROFILER_API void setMinBlockDuration(timestamp_t _nanoseconds);
+
+        /** Set minimum duration of stored blocks for the block descriptor with id _id.
+
+        Overrides global minimum duration set by setMinBlockDuration(). Pass 0 to use global value again.
+
+        \ingroup profiler
+        */
+        PROFILER_API void setBlockMinDuration(block_id_t _id, timestamp_t _nanoseconds);
+
+        /** Select performance counters stored with blocks which have counters enabled by setBlockPerfCounters().
+
+        _mask is a combination of (1 << PerfCounter) bits. All counters are selected by default.
+        Counters are opened for each thread on the first block with counters enabled and are read at the beginning
+        and at the end of the block, the difference is stored with the block and summed up by reader
+        in BlockStatistics. Only user-space events are counted.
+
+        \retval Mask of counters which are available in the calling thread (hardware counters require PMU
+        and kernel.perf_event_paranoid <= 2). Only available counters are used.
+
+        \note Linux only. Counters are ignored in statistics-only mode and for filtered blocks (see setMinBlockDuration()).
+
+        \ingroup profiler
+        */
+        PROFILER_API uint32_t setPerfCounters(uint32_t _mask);
+
+        /** Enable or disable storing of performance counters with blocks of the block descriptor with id _id.
+
+        \sa setPerfCounters
+
+        \ingroup profiler
+        */
+        PROFILER_API void setBlockPerfCounters(block_id_t _id, bool _isEnable);
+
+        /** Enable or disable statistics-only mode.
+
+        In statistics-only mode closed blocks and events are not stored. Instead, each thread updates it's own
+        fixed-size accumulator for the block descriptor: calls number, total, min and max duration and
+        a log-linear histogram of durations. Memory used by accumulators depends only on the number of threads
+        and block descriptors, so the mode is suitable for always-on profiling of long running processes.
+
+        \note Profiler must be enabled (see setEnabled()) to collect statistics.
+
+        \sa dumpStatisticsToFile
+
+        \ingroup profiler
+        */
+        PROFILER_API void setStatisticsOnly(bool _isEnable);
+        PROFILER_API bool isStatisticsOnly();
+
+        /** Merge statistics of all threads collected in statistics-only mode and write them into JSON file.
+
+        Statistics are accumulated since the first block of every descriptor, so the file contains totals
+        for the whole process run. Profiling is not interrupted.
+
+        \retval Number of block descriptors written.
+
+        \sa setStatisticsOnly
+
+        \ingroup profiler
+        */
+        PROFILER_API uint32_t dumpStatisticsToFile(const char* _filename);
+
+        /** Start flight recorder mode.
+
+        Launches a separate thread which periodically drops the oldest filled chunks of closed blocks of each thread
+        when they take more than _threadMemoryBudget bytes, so the memory stays bounded while capturing is enabled
+        permanently. Use dumpRecentToFile() (or network message MESSAGE_TYPE_REQUEST_RECENT_BLOCKS) to get
+        the most recent blocks when something interesting happens.
+
+        \note Flight recorder and streaming mode (see startStreaming()) are exclusive: starting one stops the other.
+
+        \ingroup profiler
+        */
+        PROFILER_API void startFlightRecording(uint64_t _threadMemoryBudget = 4ULL << 20);
+        PROFILER_API void stopFlightRecording();
+        PROFILER_API bool isFlightRecording();
+
+        /** Dump blocks of the last _windowMs milliseconds into file without stopping capture.
+
+        All retained blocks are written but the capture begin time is set to the window start,
+        so the reader loads only blocks which end inside the window. Blocks are copied: they stay in the storage
+        and would be written again by the next dump (until they are dropped by flight recorder).
+
+        \retval Number of written blocks (including blocks outside of the window).
+
+        \sa startFlightRecording
+
+        \ingroup profiler
+        */
+        PROFILER_API uint32_t dumpRecentToFile(const char* _filename, uint32_t _windowMs);
+
+        /** Set main thread frame duration which fires capture trigger.
+
+        When main thread frame is longer than _nanoseconds, a separate thread writes captured blocks around this frame
+        into file "<prefix>.<date>-<time>.prof" without stopping capture (see setTriggerOutput()). Blocks are copied the same way
+        as by dumpRecentToFile(), so triggers do not take blocks away from other dumps. Combine with startFlightRecording()
+        to keep memory and size of written files bounded.
+
+        \note 0 (default) disables the trigger. Trigger fires only while capturing is enabled.
+
+        \ingroup profiler
+        */
+        PROFILER_API void setFrameTrigger(timestamp_t _nanoseconds);
+
+        /** Set duration of blocks of the block descriptor with id _id which fires capture trigger.
+
+        Works the same way as setFrameTrigger() but for any block of given descriptor. Pass 0 to disable.
+
+        \ingroup profiler
+        */
+        PROFILER_API void setBlockTrigger(block_id_t _id, timestamp_t _nanoseconds);
+
+        /** Set prefix of files written by capture triggers and duration captured before the slow frame (or block).
+
+        Default prefix is "easy_trigger", default margin is 1000 ms.
+
+        \ingroup profiler
+        */
+        PROFILER_API void setTriggerOutput(const char* _filenamePrefix, uint32_t _marginMs = 1000);
+
+        /** Select clock used for blocks timestamps.
+
+        Clock frequency is recalibrated after switching (see ClockSource for the list of clocks).
+        Use testClockSource() or findBestClockSource() to choose the cheapest correct clock for current machine.
+
+        \note Clock can be changed only while capturing is disabled. Blocks captured with previous clock
+        and not dumped yet would have incorrect timestamps.
+
+        \retval false if clock source is not available or capturing is enabled.
+
+        \ingroup profiler
+        */
+        PROFILER_API bool setClockSource(ClockSource _source);
+        PROFILER_API ClockSource clockSource();
+
+        /** Measure average cost of one clock reading and check if clock is monotonic on the same thread and between threads.
+
+        \note Takes from several milliseconds up to hundreds of milliseconds depending on the clock cost.
+
+        \retval false if clock source is not available on this machine.
+
+        \ingroup profiler
+        */
+        PROFILER_API bool testClockSource(ClockSource _source, ClockTestResult& _result);
+
+        /** Test all available clocks and return the cheapest one which never goes backward.
+
+        \ingroup profiler
+        */
+        PROFILER_API ClockSource findBestClockSource();
+
         /** Returns current major version.
         
         \ingroup profiler
@@ -774,11 +1047,104 @@ namespace profiler {
         PROFILER_API timestamp_t main_thread_frameTimeLocalAvg(Duration _durationCast = ::profiler::MICROSECONDS);
 
     }
+
+    /** Descriptor of a block registered at program startup.
+
+    TDescription is a unique local class generated by EASY_BLOCK, EASY_FUNCTION, EASY_NONSCOPED_BLOCK or EASY_EVENT
+    when EASY_STATIC_DESCRIPTORS is defined. The descriptor is registered during dynamic initialization
+    of the program (or shared library), so the block itself has neither guard check nor descriptor lookup.
+
+    \warning Blocks executed during dynamic initialization of other static objects
+    may see descriptor which is not registered yet. Do not use EASY_STATIC_DESCRIPTORS for such code.
+
+    \ingroup profiler
+    */
+    template <class TDescription>
+    struct StaticDescriptor EASY_FINAL {
+        static const BaseBlockDescriptor* const descriptor;
+    };
+
+    template <class TDescription>
+    const BaseBlockDescriptor* const StaticDescriptor<TDescription>::descriptor = TDescription::registerDescription();
+
+    /** Current profiler status: 0 if profiler is disabled.
+
+    Exported to let inlined fast path of profiler blocks check it without calling into profiler library.
+
+    \ingroup profiler
+    */
+    extern PROFILER_API ::std::atomic<char> profilerStatus;
+
+    /** Returns true if new block should be skipped by the fast path.
+
+    Profiler turns off all blocks nested into the block which was opened while profiler was disabled
+    (and all blocks opened while profiler is disabled do not store anything), so such blocks
+    are skipped without calling into profiler library. Top-level blocks are always passed to the library
+    because they are used to measure frame time.
+    */
+    inline bool isSilentBlock(const ThreadFastState* _state) {
+        return _state != nullptr && (_state->silentBlocks != 0 ||
+            (_state->frameOpened && profilerStatus.load(::std::memory_order_relaxed) == 0));
+    }
+
+    /** Inlined fast path of beginBlock().
+
+    \ingroup profiler
+    */
+    inline void beginBlockFast(Block& _block) {
+        auto& state = thisThreadFastState();
+        if (isSilentBlock(state)) {
+            _block.m_status = ::profiler::OFF;
+            _block.m_silentIndex = ++state->silentBlocks;
+            return;
+        }
+
+        ::profiler::beginBlock(_block);
+        if (state == nullptr)
+            state = ::profiler::registerThreadFastState(&state);
+    }
+
+    /** Inlined fast path of beginNonScopedBlock().
+
+    \ingroup profiler
+    */
+    inline void beginNonScopedBlockFast(const BaseBlockDescriptor* _desc, const char* _runtimeName = "") {
+        auto state = thisThreadFastState();
+        if (isSilentBlock(state)) {
+            ++state->silentBlocks;
+            return;
+        }
+
+        ::profiler::beginNonScopedBlock(_desc, _runtimeName);
+    }
+
+    /** Inlined fast path of endBlock().
+
+    \ingroup profiler
+    */
+    inline void endBlockFast() {
+        auto state = thisThreadFastState();
+        if (state != nullptr && state->silentBlocks != 0) {
+            --state->silentBlocks;
+            return;
+        }
+
+        ::profiler::endBlock();
+    }
+
+    /** Inlined fast path of storeEvent().
+
+    \ingroup profiler
+    */
+    inline void storeEventFast(const BaseBlockDescriptor* _desc, const char* _runtimeName = "") {
+        if (profilerStatus.load(::std::memory_order_relaxed) != 0)
+            ::profiler::storeEvent(_desc, _runtimeName);
+    }
 #else
     inline timestamp_t currentTime() { return 0; }
     inline timestamp_t toNanoseconds(timestamp_t) { return 0; }
     inline timestamp_t toMicroseconds(timestamp_t) { return 0; }
-    inline const BaseBlockDescriptor* registerDescription(EasyBlockStatus, const char*, const char*, const char*, int, block_type_t, color_t, bool = false)
+    inline const BaseBlockDescriptor* registerDescription(EasyBlockStatus, const char*, const char*, const char*, int, block_type_t, color_t, bool = false, uint16_t = 1)
     { return reinterpret_cast<const BaseBlockDescriptor*>(0xbad); }
     inline void endBlock() { }
     inline void setEnabled(bool) { }
@@ -787,6 +1153,7 @@ namespace profiler {
     inline void storeBlock(const BaseBlockDescriptor*, const char*, timestamp_t, timestamp_t) { }
     inline void beginBlock(Block&) { }
     inline void beginNonScopedBlock(const BaseBlockDescriptor*, const char* = "") { }
+    inline ThreadFastState* registerThreadFastState(ThreadFastState**) { return nullptr; }
     inline uint32_t dumpBlocksToFile(const char*) { return 0; }
     inline const char* registerThreadScoped(const char*, ThreadGuard&) { return ""; }
     inline const char* registerThread(const char*) { return ""; }
@@ -799,6 +1166,29 @@ namespace profiler {
     inline void startListen(uint16_t = ::profiler::DEFAULT_PORT) { }
     inline void stopListen() { }
     inline bool isListening() { return false; }
+    inline bool startStreaming(const char*, uint64_t, uint32_t = 8, uint64_t = 64ULL << 20) { return false; }
+    inline void stopStreaming() { }
+    inline bool isStreaming() { return false; }
+    inline void setCompressionEnabled(bool) { }
+    inline bool isCompressionEnabled() { return false; }
+    inline void setMinBlockDuration(timestamp_t) { }
+    inline void setBlockMinDuration(block_id_t, timestamp_t) { }
+    inline uint32_t setPerfCounters(uint32_t) { return 0; }
+    inline void setBlockPerfCounters(block_id_t, bool) { }
+    inline void setStatisticsOnly(bool) { }
+    inline bool isStatisticsOnly() { return false; }
+    inline uint32_t dumpStatisticsToFile(const char*) { return 0; }
+    inline void startFlightRecording(uint64_t = 4ULL << 20) { }
+    inline void stopFlightRecording() { }
+    inline bool isFlightRecording() { return false; }
+    inline uint32_t dumpRecentToFile(const char*, uint32_t) { return 0; }
+    inline void setFrameTrigger(timestamp_t) { }
+    inline void setBlockTrigger(block_id_t, timestamp_t) { }
+    inline void setTriggerOutput(const char*, uint32_t = 1000) { }
+    inline bool setClockSource(ClockSource) { return false; }
+    inline ClockSource clockSource() { return CLOCK_SOURCE_DEFAULT; }
+    inline bool testClockSource(ClockSource, ClockTestResult&) { return false; }
+    inline ClockSource findBestClockSource() { return CLOCK_SOURCE_DEFAULT; }
     inline uint8_t versionMajor() { return 0; }
     inline uint8_t versionMinor() { return 0; }
     inline uint16_t versionPatch() { return 0; }
@@ -905,6 +1295,21 @@ namespace profiler {
 
     //////////////////////////////////////////////////////////////////////
 
+    inline Block::~Block() {
+        if (m_silentIndex != 0) {
+            // Block was skipped by the fast path. All skipped blocks opened after this one are already ended
+            // and this one could be already ended explicitly by EASY_END_BLOCK, so just restore the counter.
+            auto state = thisThreadFastState();
+            if (state != nullptr)
+                state->silentBlocks = m_silentIndex - 1;
+        }
+        else if (!finished()) {
+            ::profiler::endBlock();
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////
+
 } // END of namespace profiler.
 
 #if defined ( __clang__ )
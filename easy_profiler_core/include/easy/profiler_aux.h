@@ -73,6 +73,17 @@ namespace profiler {
         FORCE_ON_WITHOUT_CHILDREN = FORCE_ON | OFF_RECURSIVE, ///< The block is ALWAYS ON but all of it's children are OFF.
     };
 
+    /** Sampling rate of a block: only 1 of rate blocks would be stored by each thread.
+
+    Pass it as the last argument of EASY_BLOCK, EASY_FUNCTION, EASY_NONSCOPED_BLOCK or EASY_EVENT.
+
+    \ingroup profiler
+    */
+    struct Sampling EASY_FINAL {
+        uint16_t rate;
+        explicit Sampling(uint16_t _rate) : rate(_rate) {}
+    };
+
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -87,6 +98,8 @@ namespace profiler {
 # define EASY_UNIQUE_BLOCK(x) EASY_TOKEN_CONCATENATE(unique_profiler_mark_name_, x)
 # define EASY_UNIQUE_FRAME_COUNTER(x) EASY_TOKEN_CONCATENATE(unique_profiler_frame_mark_name_, x)
 # define EASY_UNIQUE_DESC(x) EASY_TOKEN_CONCATENATE(unique_profiler_descriptor_, x)
+# define EASY_UNIQUE_DESC_NAME(x) EASY_TOKEN_CONCATENATE(unique_profiler_descriptor_name_, x)
+# define EASY_UNIQUE_DESC_TAG(x) EASY_TOKEN_CONCATENATE(unique_profiler_descriptor_tag_, x)
 
 #ifdef BUILD_WITH_EASY_PROFILER
 
@@ -108,7 +121,7 @@ namespace profiler {
 
     public:
 
-        ForceConstStr(const char* _str) : c_str(_str) {}
+        EASY_CONSTEXPR ForceConstStr(const char* _str) : c_str(_str) {}
         ForceConstStr(const ::std::string& _str) : c_str(_str.c_str()) {}
     };
 
@@ -118,9 +131,8 @@ namespace profiler {
         static const char* runtime_name(const ForceConstStr&) { return ""; }
 
         template <class T>
-        static const char* compiletime_name(const T&, const char* autoGeneratedName) { return autoGeneratedName; }
-        static const char* compiletime_name(const char*, const char* autoGeneratedName) { return autoGeneratedName; }
-        static const char* compiletime_name(const ForceConstStr& name, const char*) { return name.c_str; }
+        static EASY_CONSTEXPR const char* compiletime_name(const T&, const char* autoGeneratedName) { return autoGeneratedName; }
+        static EASY_CONSTEXPR const char* compiletime_name(const ForceConstStr& name, const char*) { return name.c_str; }
     };
 
     template <> struct NameSwitch<true> EASY_FINAL {
@@ -129,9 +141,9 @@ namespace profiler {
         static const char* runtime_name(const ForceConstStr&) { return ""; }
 
         template <class T>
-        static const char* compiletime_name(const T&, const char* autoGeneratedName) { return autoGeneratedName; }
-        static const char* compiletime_name(const char* name, const char*) { return name; }
-        static const char* compiletime_name(const ForceConstStr& name, const char*) { return name.c_str; }
+        static EASY_CONSTEXPR const char* compiletime_name(const T&, const char* autoGeneratedName) { return autoGeneratedName; }
+        static EASY_CONSTEXPR const char* compiletime_name(const char* name, const char*) { return name; }
+        static EASY_CONSTEXPR const char* compiletime_name(const ForceConstStr& name, const char*) { return name.c_str; }
     };
 
     //***********************************************
@@ -185,6 +197,31 @@ namespace profiler {
 
     //***********************************************
 
+    inline EasyBlockStatus extract_enable_flag(::profiler::EasyBlockStatus _flag, Sampling) {
+        return _flag;
+    }
+
+    template <class T>
+    inline EasyBlockStatus extract_enable_flag(T, Sampling) {
+        return ::profiler::ON;
+    }
+
+    inline uint16_t extract_sampling() {
+        return 1;
+    }
+
+    template <class ... TArgs>
+    inline uint16_t extract_sampling(Sampling _sampling, TArgs...) {
+        return _sampling.rate;
+    }
+
+    template <class T, class ... TArgs>
+    inline uint16_t extract_sampling(T, TArgs... _args) {
+        return extract_sampling(_args...);
+    }
+
+    //***********************************************
+
 } // END of namespace profiler.
 
 # define EASY_UNIQUE_LINE_ID __FILE__ ":" EASY_STRINGIFICATION(__LINE__)
@@ -70,6 +70,39 @@ namespace profiler {
         MICROSECONDS ///< Microseconds
     };
 
+    enum ClockSource : uint8_t
+    {
+        CLOCK_SOURCE_DEFAULT = 0, ///< Compile-time selected clock: rdtsc on x86, system timer on ARMv8, QueryPerformanceCounter on Windows or std::chrono clock
+        CLOCK_SOURCE_RDTSCP, ///< x86 only: rdtscp waits until all previous instructions are executed (processor id returned by rdtscp is not used)
+        CLOCK_SOURCE_LFENCE_RDTSC, ///< x86 only: lfence + rdtsc, rdtsc is not executed until all previous instructions are completed
+        CLOCK_SOURCE_CLOCK_GETTIME, ///< Unix only: clock_gettime(CLOCK_MONOTONIC) which is served by vDSO without system call on Linux
+
+        CLOCK_SOURCES_NUMBER
+    };
+
+    /** Performance counters which could be stored with blocks (see ::profiler::setBlockPerfCounters()).
+
+    Counters are read using Linux perf_event subsystem. Hardware counters require PMU (usually not available on VMs),
+    software counters are available everywhere.
+    */
+    enum PerfCounter : uint8_t
+    {
+        PERF_COUNTER_CYCLES = 0,   ///< Hardware: CPU cycles
+        PERF_COUNTER_INSTRUCTIONS, ///< Hardware: retired instructions
+        PERF_COUNTER_CACHE_MISSES, ///< Hardware: last level cache misses
+        PERF_COUNTER_TASK_CLOCK,   ///< Software: thread CPU time in nanoseconds
+        PERF_COUNTER_PAGE_FAULTS,  ///< Software: page faults
+
+        PERF_COUNTERS_NUMBER
+    };
+
+    struct ClockTestResult
+    {
+        double                         callCost; ///< Average duration of one clock reading (in nanoseconds)
+        uint32_t                  backwardSteps; ///< Number of times clock value decreased between consecutive readings on the same thread
+        uint32_t       crossThreadBackwardSteps; ///< Number of times clock value read on one thread was less than the value read earlier on another thread
+    };
+
     //***********************************************
 
 #pragma pack(push,1)
@@ -85,8 +118,9 @@ namespace profiler {
         color_t          m_color; ///< Color of the block packed into 1-byte structure
         block_type_t      m_type; ///< Type of the block (See BlockType)
         EasyBlockStatus m_status; ///< If false then blocks with such id() will not be stored by profiler during profile session
+        uint16_t        m_sampling; ///< Only 1 of m_sampling blocks with such id() is stored by profiler (per thread). 0 and 1 mean that all blocks are stored. Each stored block keeps the rate it was sampled with.
 
-        BaseBlockDescriptor(block_id_t _id, EasyBlockStatus _status, int _line, block_type_t _block_type, color_t _color);
+        BaseBlockDescriptor(block_id_t _id, EasyBlockStatus _status, int _line, block_type_t _block_type, color_t _color, uint16_t _sampling = 1);
 
     public:
 
@@ -95,6 +129,7 @@ namespace profiler {
         inline color_t color() const { return m_color; }
         inline block_type_t type() const { return m_type; }
         inline EasyBlockStatus status() const { return m_status; }
+        inline uint16_t sampling() const { return m_sampling > 1 ? m_sampling : static_cast<uint16_t>(1); }
 
     }; // END of class BaseBlockDescriptor.
 
@@ -112,7 +147,7 @@ namespace profiler {
     public:
 
         Event(const Event&) = default;
-        Event(timestamp_t _begin_time);
+        Event(timestamp_t _begin_time) : m_begin(_begin_time), m_end(0) {}
         Event(timestamp_t _begin_time, timestamp_t _end_time);
 
         inline timestamp_t begin() const { return m_begin; }
@@ -136,7 +171,7 @@ namespace profiler {
     public:
 
         BaseBlockData(const BaseBlockData&) = default;
-        BaseBlockData(timestamp_t _begin_time, block_id_t _id);
+        BaseBlockData(timestamp_t _begin_time, block_id_t _id) : Event(_begin_time), m_id(_id) {}
         BaseBlockData(timestamp_t _begin_time, timestamp_t _end_time, block_id_t _id);
 
         inline block_id_t id() const { return m_id; }
@@ -165,15 +200,33 @@ namespace profiler {
 
     //***********************************************
 
+    /** Per-thread state which is checked by inlined fast path of profiler blocks.
+
+    It is owned by profiler library and each module caches pointer to it in thread-local variable
+    (see registerThreadFastState()).
+
+    \ingroup profiler
+    */
+    struct ThreadFastState EASY_FINAL
+    {
+        uint32_t silentBlocks; ///< Number of opened blocks which were skipped by the fast path (they would be turned off by profiler anyway)
+        bool      frameOpened; ///< Is new frame opened, i.e. thread has opened top-level block (this does not depend on profiling status)
+    };
+
+    class Block;
+    inline void beginBlockFast(Block& _block);
+
     class PROFILER_API Block : public BaseBlockData
     {
         friend ::ProfileManager;
         friend ::ThreadStorage;
         friend ::NonscopedBlock;
+        friend void beginBlockFast(Block& _block);
 
-        const char*       m_name;
-        EasyBlockStatus m_status;
-        bool          m_isScoped;
+        const char*        m_name;
+        EasyBlockStatus  m_status;
+        bool           m_isScoped;
+        uint32_t    m_silentIndex; ///< Non-zero for blocks skipped by the fast path (number of such blocks opened when this one was begun)
 
     private:
 
@@ -188,7 +241,15 @@ namespace profiler {
     public:
 
         Block(Block&& that);
-        Block(const BaseBlockDescriptor* _desc, const char* _runtimeName, bool _scoped = true);
+        Block(const BaseBlockDescriptor* _desc, const char* _runtimeName, bool _scoped = true)
+            : BaseBlockData(1ULL, _desc->id())
+            , m_name(_runtimeName)
+            , m_status(_desc->status())
+            , m_isScoped(_scoped)
+            , m_silentIndex(0)
+        {
+        }
+
         Block(timestamp_t _begin_time, block_id_t _id, const char* _runtimeName);
         Block(timestamp_t _begin_time, timestamp_t _end_time, block_id_t _id, const char* _runtimeName);
         ~Block();
@@ -91,15 +91,23 @@ namespace profiler {
         ::profiler::block_index_t    min_duration_block; ///< Will be used in GUI to jump to the block with min duration
         ::profiler::block_index_t    max_duration_block; ///< Will be used in GUI to jump to the block with max duration
         ::profiler::block_index_t          parent_block; ///< Index of block which is "parent" for "per_parent_stats" or "frame" for "per_frame_stats" or thread-id for "per_thread_stats"
-        ::profiler::calls_number_t         calls_number; ///< Block calls number
-
-        explicit BlockStatistics(::profiler::timestamp_t _duration, ::profiler::block_index_t _block_index, ::profiler::block_index_t _parent_index)
-            : total_duration(_duration)
+        ::profiler::calls_number_t         calls_number; ///< Block calls number (scaled by sampling rate of each block)
+        uint32_t                             references; ///< Number of blocks which refer to this statistics (see release_stats())
+        uint64_t total_perf_counters[::profiler::PERF_COUNTERS_NUMBER]; ///< Total performance counters deltas of block calls which have counters (indexed by ::profiler::PerfCounter, scaled by sampling rate)
+        ::profiler::calls_number_t  perf_counters_calls; ///< Number of block calls which have performance counters (scaled by sampling rate)
+        uint8_t                      perf_counters_mask; ///< Performance counters stored with at least one block call (bit (1 << ::profiler::PerfCounter) for each one)
+
+        explicit BlockStatistics(::profiler::timestamp_t _duration, ::profiler::block_index_t _block_index, ::profiler::block_index_t _parent_index, uint16_t _sampling = 1)
+            : total_duration(_duration * _sampling)
             , total_children_duration(0)
             , min_duration_block(_block_index)
             , max_duration_block(_block_index)
             , parent_block(_parent_index)
-            , calls_number(1)
+            , calls_number(_sampling)
+            , references(1)
+            , total_perf_counters()
+            , perf_counters_calls(0)
+            , perf_counters_mask(0)
         {
         }
 
@@ -115,6 +123,42 @@ namespace profiler {
 
     extern "C" PROFILER_API void release_stats(BlockStatistics*& _stats);
 
+    /** Read performance counters stored with the block (see ::profiler::setBlockPerfCounters()).
+
+    \param _values Array of ::profiler::PERF_COUNTERS_NUMBER counters deltas indexed by ::profiler::PerfCounter
+    (counters which have not been stored are set to 0).
+
+    \retval Mask of stored counters (bit (1 << ::profiler::PerfCounter) for each one), 0 if there are no counters.
+    */
+    extern "C" PROFILER_API uint32_t readPerfCounters(const SerializedBlock* _block, uint64_t* _values);
+
+    /** Read sampling rate the block has been stored with (see ::profiler::Sampling).
+
+    \retval Number of block calls the stored block stands for (1 if the block has not been sampled).
+    */
+    extern "C" PROFILER_API uint16_t readSampling(const SerializedBlock* _block);
+
+    /** Aggregated blocks of one descriptor which have been filtered out by minimum duration during capture.
+
+    \sa ::profiler::setMinBlockDuration
+    */
+    struct BlockSummary EASY_FINAL
+    {
+        ::profiler::timestamp_t  total_duration; ///< Total duration of all filtered blocks (ns)
+        ::profiler::block_id_t               id; ///< Block descriptor id
+        ::profiler::calls_number_t calls_number; ///< Number of filtered blocks (scaled by sampling rate)
+
+        BlockSummary(::profiler::block_id_t _id, ::profiler::calls_number_t _calls_number, ::profiler::timestamp_t _total_duration)
+            : total_duration(_total_duration)
+            , id(_id)
+            , calls_number(_calls_number)
+        {
+        }
+
+    }; // END of struct BlockSummary.
+
+    typedef ::std::vector<::profiler::BlockSummary> summaries_t;
+
     //////////////////////////////////////////////////////////////////////////
 
     class BlocksTree EASY_FINAL
@@ -230,6 +274,7 @@ namespace profiler {
         BlocksTree::children_t         children; ///< List of children indexes
         BlocksTree::children_t             sync; ///< List of context-switch events
         BlocksTree::children_t           events; ///< List of events indexes
+        summaries_t                   summaries; ///< Blocks filtered out by minimum duration (not included into statistics)
         std::string                 thread_name; ///< Name of this thread
         ::profiler::timestamp_t   profiled_time; ///< Profiled time of this thread (sum of all children duration)
         ::profiler::timestamp_t       wait_time; ///< Wait time of this thread (sum of all context switches)
@@ -246,6 +291,7 @@ namespace profiler {
             : children(::std::move(that.children))
             , sync(::std::move(that.sync))
             , events(::std::move(that.events))
+            , summaries(::std::move(that.summaries))
             , thread_name(::std::move(that.thread_name))
             , profiled_time(that.profiled_time)
             , wait_time(that.wait_time)
@@ -261,6 +307,7 @@ namespace profiler {
             children = ::std::move(that.children);
             sync = ::std::move(that.sync);
             events = ::std::move(that.events);
+            summaries = ::std::move(that.summaries);
             thread_name = ::std::move(that.thread_name);
             profiled_time = that.profiled_time;
             wait_time = that.wait_time;
@@ -299,21 +346,170 @@ namespace profiler {
 
     //////////////////////////////////////////////////////////////////////////
 
+    const ::profiler::block_index_t NO_BLOCK_INDEX = ~0U; ///< Used by BlocksColumns for absent parent, child or sibling
+
+    /** Thread part of columnar blocks storage.
+
+    Top-level blocks of the thread form a list: first_frame -> next_sibling -> ...
+    */
+    class BlocksColumnsThread EASY_FINAL
+    {
+        typedef BlocksColumnsThread This;
+
+    public:
+
+        typedef ::std::unordered_map<::profiler::block_id_t, ::profiler::BlockStatistics, ::profiler::passthrough_hash<::profiler::block_id_t> > stats_map_t;
+
+        ::std::vector<::profiler::SerializedCSwitch*> sync; ///< Context-switch events of this thread
+        ::std::vector<::profiler::block_index_t>    events; ///< Indexes of top-level events (BLOCK_TYPE_EVENT)
+        stats_map_t                         statistics; ///< Statistics per block id within the bounds of all frames of this thread
+        summaries_t                          summaries; ///< Blocks filtered out by minimum duration (not included into statistics)
+        std::string                        thread_name; ///< Name of this thread
+        ::profiler::timestamp_t          profiled_time; ///< Profiled time of this thread (sum of all top-level blocks duration)
+        ::profiler::timestamp_t              wait_time; ///< Wait time of this thread (sum of all context switches)
+        ::profiler::thread_id_t              thread_id; ///< System Id of this thread
+        ::profiler::block_index_t          first_frame; ///< Index of the first top-level block (or NO_BLOCK_INDEX)
+        ::profiler::block_index_t        frames_number; ///< Total frames number (top-level blocks of BLOCK_TYPE_BLOCK type)
+        ::profiler::block_index_t        blocks_number; ///< Total blocks number including their children
+        uint8_t                                  depth; ///< Maximum stack depth (number of levels)
+
+        BlocksColumnsThread() : profiled_time(0), wait_time(0), thread_id(0), first_frame(NO_BLOCK_INDEX), frames_number(0), blocks_number(0), depth(0)
+        {
+        }
+
+        BlocksColumnsThread(This&&) = default;
+        This& operator = (This&&) = default;
+
+        inline bool got_name() const
+        {
+            return !thread_name.empty();
+        }
+
+        inline const char* name() const
+        {
+            return thread_name.c_str();
+        }
+
+    private:
+
+        BlocksColumnsThread(const This&) = delete;
+        This& operator = (const This&) = delete;
+
+    }; // END of class BlocksColumnsThread.
+
+    /** Columnar (struct-of-arrays) storage of loaded blocks.
+
+    This is a compact alternative to blocks_t + thread_blocks_tree_t: every block takes 35 bytes
+    in contiguous arrays instead of BlocksTree with it's own children vector and pointer to serialized data.
+    Scanning one attribute of many blocks (begin, end, id) touches only that attribute's memory.
+
+    Blocks of one thread are stored contiguously in the order of their completion (children before parent).
+    Used by profiler_reader to print statistics ("profiler_reader file.prof --stats").
+    */
+    class BlocksColumns EASY_FINAL
+    {
+        typedef BlocksColumns This;
+
+    public:
+
+        ::std::vector<::profiler::timestamp_t>  begin; ///< Block begin time (ns)
+        ::std::vector<::profiler::timestamp_t>    end; ///< Block end time (ns)
+        ::std::vector<::profiler::block_id_t>      id; ///< Block descriptor id (id of blocks with runtime names is generated)
+        ::std::vector<::profiler::block_index_t> parent; ///< Index of parent block (or NO_BLOCK_INDEX for top-level blocks)
+        ::std::vector<::profiler::block_index_t> first_child; ///< Index of the first child block (or NO_BLOCK_INDEX)
+        ::std::vector<::profiler::block_index_t> next_sibling; ///< Index of the next block with the same parent (or NO_BLOCK_INDEX)
+        ::std::vector<uint8_t>                  depth; ///< Maximum number of sublevels (maximum children depth)
+        ::std::vector<uint16_t>              sampling; ///< Sampling rate the block has been stored with (see ::profiler::readSampling())
+        ::std::vector<const char*>      runtime_names; ///< Runtime names of blocks with generated ids: runtime_names[id - first_runtime_id]
+        ::std::vector<BlocksColumnsThread>    threads; ///< Threads in order of appearance in the file
+        ::profiler::block_id_t       first_runtime_id; ///< First generated id (equals to the number of descriptors in the file)
+
+        BlocksColumns() : first_runtime_id(0)
+        {
+        }
+
+        BlocksColumns(This&&) = default;
+        This& operator = (This&&) = default;
+
+        inline size_t size() const
+        {
+            return begin.size();
+        }
+
+        inline bool empty() const
+        {
+            return begin.empty();
+        }
+
+        inline ::profiler::timestamp_t duration(::profiler::block_index_t i) const
+        {
+            return end[i] - begin[i];
+        }
+
+        /** Returns runtime name of the block or nullptr if block has no runtime name (use descriptor name instead). */
+        inline const char* runtime_name(::profiler::block_index_t i) const
+        {
+            return id[i] < first_runtime_id ? nullptr : runtime_names[id[i] - first_runtime_id];
+        }
+
+        void resize(size_t _size)
+        {
+            begin.resize(_size);
+            end.resize(_size);
+            id.resize(_size);
+            parent.resize(_size, NO_BLOCK_INDEX);
+            first_child.resize(_size, NO_BLOCK_INDEX);
+            next_sibling.resize(_size, NO_BLOCK_INDEX);
+            depth.resize(_size, 0);
+            sampling.resize(_size, 1);
+        }
+
+        void clear()
+        {
+            This().swap(*this);
+        }
+
+        void swap(This& other)
+        {
+            begin.swap(other.begin);
+            end.swap(other.end);
+            id.swap(other.id);
+            parent.swap(other.parent);
+            first_child.swap(other.first_child);
+            next_sibling.swap(other.next_sibling);
+            depth.swap(other.depth);
+            sampling.swap(other.sampling);
+            runtime_names.swap(other.runtime_names);
+            threads.swap(other.threads);
+            ::std::swap(first_runtime_id, other.first_runtime_id);
+        }
+
+    private:
+
+        BlocksColumns(const This&) = delete;
+        This& operator = (const This&) = delete;
+
+    }; // END of class BlocksColumns.
+
+    //////////////////////////////////////////////////////////////////////////
+
     class PROFILER_API SerializedData EASY_FINAL
     {
         char*  m_data;
         size_t m_size;
+        bool m_mapped; ///< True if m_data is a memory-mapped file
 
     public:
 
-        SerializedData() : m_data(nullptr), m_size(0)
+        SerializedData() : m_data(nullptr), m_size(0), m_mapped(false)
         {
         }
 
-        SerializedData(SerializedData&& that) : m_data(that.m_data), m_size(that.m_size)
+        SerializedData(SerializedData&& that) : m_data(that.m_data), m_size(that.m_size), m_mapped(that.m_mapped)
         {
             that.m_data = nullptr;
             that.m_size = 0;
+            that.m_mapped = false;
         }
 
         ~SerializedData()
@@ -324,11 +520,21 @@ namespace profiler {
         void set(uint64_t _size);
         void extend(uint64_t _size);
 
+        /** Map the whole file into memory instead of reading it.
+
+        Mapping is read-only: the data must not be modified.
+
+        \retval false if the file can not be opened or mapped (the data remains empty).
+        */
+        bool map(const char* _filename);
+
         SerializedData& operator = (SerializedData&& that)
         {
             set(that.m_data, that.m_size);
+            m_mapped = that.m_mapped;
             that.m_data = nullptr;
             that.m_size = 0;
+            that.m_mapped = false;
             return *this;
         }
 
@@ -371,12 +577,15 @@ namespace profiler {
         {
             char* d = other.m_data;
             uint64_t sz = other.m_size;
+            bool mapped = other.m_mapped;
 
             other.m_data = m_data;
             other.m_size = m_size;
+            other.m_mapped = m_mapped;
 
             m_data = d;
             m_size = (size_t)sz;
+            m_mapped = mapped;
         }
 
     private:
@@ -418,6 +627,30 @@ extern "C" {
                                                                bool gather_statistics,
                                                                ::std::stringstream& _log);
 
+    /** Load blocks into columnar storage instead of blocks_t + thread_blocks_tree_t.
+
+    serialized_blocks must be kept alive while columns are used: context switches and runtime names point into it.
+    */
+    PROFILER_API ::profiler::block_index_t fillColumnsFromFile(::std::atomic<int>& progress, const char* filename,
+                                                               ::profiler::SerializedData& serialized_blocks,
+                                                               ::profiler::SerializedData& serialized_descriptors,
+                                                               ::profiler::descriptors_list_t& descriptors,
+                                                               ::profiler::BlocksColumns& columns,
+                                                               uint32_t& total_descriptors_number,
+                                                               uint32_t& version,
+                                                               bool gather_statistics,
+                                                               ::std::stringstream& _log);
+
+    PROFILER_API ::profiler::block_index_t fillColumnsFromStream(::std::atomic<int>& progress, ::std::stringstream& str,
+                                                                 ::profiler::SerializedData& serialized_blocks,
+                                                                 ::profiler::SerializedData& serialized_descriptors,
+                                                                 ::profiler::descriptors_list_t& descriptors,
+                                                                 ::profiler::BlocksColumns& columns,
+                                                                 uint32_t& total_descriptors_number,
+                                                                 uint32_t& version,
+                                                                 bool gather_statistics,
+                                                                 ::std::stringstream& _log);
+
     PROFILER_API bool readDescriptionsFromStream(::std::atomic<int>& progress, ::std::stringstream& str,
                                                  ::profiler::SerializedData& serialized_descriptors,
                                                  ::profiler::descriptors_list_t& descriptors,
@@ -437,6 +670,19 @@ inline ::profiler::block_index_t fillTreesFromFile(const char* filename, ::profi
     return fillTreesFromFile(progress, filename, serialized_blocks, serialized_descriptors, descriptors, _blocks, threaded_trees, total_descriptors_number, version, gather_statistics, _log);
 }
 
+inline ::profiler::block_index_t fillColumnsFromFile(const char* filename, ::profiler::SerializedData& serialized_blocks,
+                                                     ::profiler::SerializedData& serialized_descriptors,
+                                                     ::profiler::descriptors_list_t& descriptors,
+                                                     ::profiler::BlocksColumns& columns,
+                                                     uint32_t& total_descriptors_number,
+                                                     uint32_t& version,
+                                                     bool gather_statistics,
+                                                     ::std::stringstream& _log)
+{
+    ::std::atomic<int> progress = ATOMIC_VAR_INIT(0);
+    return fillColumnsFromFile(progress, filename, serialized_blocks, serialized_descriptors, descriptors, columns, total_descriptors_number, version, gather_statistics, _log);
+}
+
 inline bool readDescriptionsFromStream(::std::stringstream& str,
                                        ::profiler::SerializedData& serialized_descriptors,
                                        ::profiler::descriptors_list_t& descriptors,
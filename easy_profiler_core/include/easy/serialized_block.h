@@ -125,6 +125,10 @@ namespace profiler {
             m_status = _status;
         }
 
+        inline void setSampling(uint16_t _sampling) {
+            m_sampling = _sampling;
+        }
+
     private:
 
         SerializedBlockDescriptor(const SerializedBlockDescriptor&) = delete;
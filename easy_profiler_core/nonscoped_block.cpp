@@ -41,11 +41,11 @@ The Apache License, Version 2.0 (the "License");
 **/
 
 #include "nonscoped_block.h"
+#include "stack_buffer.h"
 #include <cstring>
-#include <cstdlib>
 
 NonscopedBlock::NonscopedBlock(const profiler::BaseBlockDescriptor* _desc, const char* _runtimeName, bool)
-    : profiler::Block(_desc, _runtimeName, false), m_runtimeName(nullptr)
+    : profiler::Block(_desc, _runtimeName, false)
 {
 
 }
@@ -55,12 +55,11 @@ NonscopedBlock::~NonscopedBlock()
     // Actually destructor should not be invoked because StackBuffer do manual memory management
 
     m_end = m_begin; // to restrict profiler::Block to invoke profiler::endBlock() on destructor.
-    free(m_runtimeName);
 }
 
-void NonscopedBlock::copyname()
+void NonscopedBlock::copyname(StackBuffer<NonscopedBlock>& _storage)
 {
-    // Here we need to copy m_name to m_runtimeName to ensure that
+    // Here we need to copy m_name to the arena of _storage to ensure that
     // it would be alive to the moment we will serialize the block
 
     if ((m_status & profiler::ON) == 0)
@@ -69,14 +68,14 @@ void NonscopedBlock::copyname()
     if (*m_name != 0)
     {
         auto len = strlen(m_name);
-        m_runtimeName = static_cast<char*>(malloc(len + 1));
+        auto runtimeName = static_cast<char*>(_storage.allocate(static_cast<uint32_t>(len + 1)));
 
         // memcpy should be faster than strncpy because we know
         // actual bytes number and both strings have the same size
-        memcpy(m_runtimeName, m_name, len);
+        memcpy(runtimeName, m_name, len);
 
-        m_runtimeName[len] = 0;
-        m_name = m_runtimeName;
+        runtimeName[len] = 0;
+        m_name = runtimeName;
     }
     else
     {
@@ -86,7 +85,6 @@ void NonscopedBlock::copyname()
 
 void NonscopedBlock::destroy()
 {
-    // free memory used by m_runtimeName
-    free(m_runtimeName);
+    // memory used by name copy is owned by StackBuffer arena
     m_name = "";
 }
@@ -45,10 +45,11 @@ The Apache License, Version 2.0 (the "License");
 
 #include <easy/profiler.h>
 
+template <class T>
+class StackBuffer;
+
 class NonscopedBlock : public profiler::Block
 {
-    char* m_runtimeName; ///< A copy of _runtimeName to make it safe to begin block in one function and end it in another
-
     NonscopedBlock() = delete;
     NonscopedBlock(const NonscopedBlock&) = delete;
     NonscopedBlock(NonscopedBlock&&) = delete;
@@ -60,11 +61,12 @@ public:
     NonscopedBlock(const profiler::BaseBlockDescriptor* _desc, const char* _runtimeName, bool = false);
     ~NonscopedBlock();
 
-    /** Copy string from m_name to m_runtimeName to make it safe to end block in another function.
+    /** Copy string m_name into _storage to make it safe to end block in another function.
 
     Performs any work if block is ON and m_name != ""
+    \note The copy is released together with this block when it is popped from _storage.
     */
-    void copyname();
+    void copyname(StackBuffer<NonscopedBlock>& _storage);
 
     void destroy();
 
@@ -55,7 +55,9 @@
 #ifndef EASY_PROFILER__OUTPUT_STREAM__H_
 #define EASY_PROFILER__OUTPUT_STREAM__H_
 
-#include <sstream>
+#include <ostream>
+#include <vector>
+#include <stdint.h>
 #include <string.h>
 
 //////////////////////////////////////////////////////////////////////////
@@ -63,48 +65,157 @@
 
 namespace profiler {
 
+    /** Binary output stream built from a list of fixed-size buffers.
+
+    Written data is never moved or copied again: when current buffer is filled a new one is allocated,
+    so the data could be sent to a socket directly from the buffers (see EasySocket::send(const void* const*, const size_t*, size_t)).
+
+    If an output sink (usually a file) is attached then only one buffer is used: it is written into the sink
+    each time it is filled and large data is written directly into the sink bypassing the buffer.
+    */
     class OStream
     {
-        ::std::stringstream m_stream;
+    public:
+
+        static const size_t BUFFER_SIZE = 1024 * 1024;
+
+    private:
+
+        std::vector<char*> m_buffers; ///< Filled buffers and the current one (the last)
+        ::std::ostream*       m_sink; ///< Output sink (if not null then buffered data is written into it)
+        uint64_t              m_size; ///< Total size of written data
+        size_t              m_offset; ///< Number of bytes used in the current buffer
 
     public:
 
-        explicit OStream() : m_stream(std::ios_base::out | std::ios_base::binary)
+        explicit OStream() : m_sink(nullptr), m_size(0), m_offset(BUFFER_SIZE)
+        {
+
+        }
+
+        explicit OStream(::std::ostream& _sink) : m_sink(&_sink), m_size(0), m_offset(BUFFER_SIZE)
         {
 
         }
 
+        ~OStream()
+        {
+            for (auto buffer : m_buffers)
+                delete [] buffer;
+        }
+
         template <typename T> void write(const char* _data, T _size)
         {
-            m_stream.write(_data, _size);
+            const auto size = static_cast<size_t>(_size);
+            m_size += size;
+
+            // Strict comparison here also guarantees that there is at least one buffer
+            if (size < BUFFER_SIZE - m_offset)
+            {
+                memcpy(m_buffers.back() + m_offset, _data, size);
+                m_offset += size;
+                return;
+            }
+
+            write_slow(_data, size);
         }
 
         template <class T> void write(const T& _data)
         {
-            m_stream.write((const char*)&_data, sizeof(T));
+            write((const char*)&_data, sizeof(T));
+        }
+
+        /** Write buffered data into the sink (does nothing if there is no sink).
+        */
+        void flush()
+        {
+            if (m_sink != nullptr && m_offset != 0 && !m_buffers.empty())
+            {
+                m_sink->write(m_buffers.back(), static_cast<::std::streamsize>(m_offset));
+                m_offset = 0;
+            }
         }
 
-        ::std::stringstream& stream()
+        /** Total size of written data (since construction or last clear()).
+        */
+        uint64_t size() const
         {
-            return m_stream;
+            return m_size;
         }
 
-        const ::std::stringstream& stream() const
+        /** Number of buffers holding written data (for stream without sink).
+        */
+        size_t buffersNumber() const
         {
-            return m_stream;
+            return m_offset == 0 && !m_buffers.empty() ? m_buffers.size() - 1 : m_buffers.size();
         }
 
+        const char* bufferData(size_t _index) const
+        {
+            return m_buffers[_index];
+        }
+
+        size_t bufferSize(size_t _index) const
+        {
+            return _index + 1 < m_buffers.size() ? BUFFER_SIZE : m_offset;
+        }
+
+        /** Drop all written (or buffered) data and free all buffers except one.
+        */
         void clear()
         {
-#if defined(__GNUC__) && __GNUC__ < 5
-            // gcc 4 has a known bug which has been solved in gcc 5:
-            // std::stringstream has no swap() method :(
-            m_stream.str(::std::string());
-#else
-            ::std::stringstream().swap(m_stream);
-#endif
+            for (size_t i = 1, n = m_buffers.size(); i < n; ++i)
+                delete [] m_buffers[i];
+
+            if (!m_buffers.empty())
+            {
+                m_buffers.resize(1);
+                m_offset = 0;
+            }
+
+            m_size = 0;
+        }
+
+    private:
+
+        void write_slow(const char* _data, size_t _size)
+        {
+            while (_size != 0)
+            {
+                if (m_offset == BUFFER_SIZE)
+                    next_buffer();
+
+                if (m_sink != nullptr && m_offset == 0 && _size >= BUFFER_SIZE)
+                {
+                    // Buffer is empty: there is no need to copy large data into it
+                    m_sink->write(_data, static_cast<::std::streamsize>(_size));
+                    return;
+                }
+
+                const auto n = _size < BUFFER_SIZE - m_offset ? _size : BUFFER_SIZE - m_offset;
+                memcpy(m_buffers.back() + m_offset, _data, n);
+                m_offset += n;
+                _data += n;
+                _size -= n;
+            }
         }
 
+        void next_buffer()
+        {
+            if (m_sink != nullptr && !m_buffers.empty())
+            {
+                // Reuse the only buffer
+                flush();
+                return;
+            }
+
+            m_buffers.push_back(new char[BUFFER_SIZE]);
+            m_offset = 0;
+        }
+
+        OStream(const OStream&) = delete;
+        OStream& operator = (const OStream&) = delete;
+
     }; // END of class OStream.
 
 } // END of namespace profiler.
@@ -0,0 +1,94 @@
+/**
+Lightweight profiler library for c++
+Copyright(C) 2016-2017  Sergey Yagovtsev, Victor Zarubkin
+
+Licensed under either of
+    * MIT license (LICENSE.MIT or http://opensource.org/licenses/MIT)
+    * Apache License, Version 2.0, (LICENSE.APACHE or http://www.apache.org/licenses/LICENSE-2.0)
+at your option.
+
+The MIT License
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights 
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies 
+    of the Software, and to permit persons to whom the Software is furnished 
+    to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all 
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+    PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE 
+    LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE 
+    USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+The Apache License, Version 2.0 (the "License");
+    You may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+
+**/
+
+#ifndef EASY_PROFILER_PARALLEL_FOR_H
+#define EASY_PROFILER_PARALLEL_FOR_H
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////////
+
+namespace profiler {
+
+    /** Call _func(i) for i in [0, _count) using all hardware threads.
+
+    Current thread is also used as a worker. If there is only one hardware thread (or one task)
+    then all tasks are executed sequentially in the current thread.
+    */
+    template <class TFunc>
+    void parallel_for(size_t _count, TFunc _func)
+    {
+        const size_t hardware_threads = ::std::max(::std::thread::hardware_concurrency(), 1U);
+        const size_t workers_number = ::std::min(hardware_threads, _count);
+        if (workers_number < 2)
+        {
+            for (size_t i = 0; i < _count; ++i)
+                _func(i);
+            return;
+        }
+
+        ::std::atomic<size_t> next(ATOMIC_VAR_INIT(0));
+        const auto worker = [&next, &_func, _count]
+        {
+            for (size_t i = next.fetch_add(1); i < _count; i = next.fetch_add(1))
+                _func(i);
+        };
+
+        ::std::vector<::std::thread> workers;
+        workers.reserve(workers_number - 1);
+        for (size_t i = 1; i < workers_number; ++i)
+            workers.emplace_back(worker);
+
+        worker();
+
+        for (auto& t : workers)
+            t.join();
+    }
+
+} // END of namespace profiler.
+
+//////////////////////////////////////////////////////////////////////////
+
+#endif // EASY_PROFILER_PARALLEL_FOR_H
@@ -0,0 +1,251 @@
+/**
+Lightweight profiler library for c++
+Copyright(C) 2016-2017  Sergey Yagovtsev, Victor Zarubkin
+
+Licensed under either of
+    * MIT license (LICENSE.MIT or http://opensource.org/licenses/MIT)
+    * Apache License, Version 2.0, (LICENSE.APACHE or http://www.apache.org/licenses/LICENSE-2.0)
+at your option.
+
+The MIT License
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights 
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies 
+    of the Software, and to permit persons to whom the Software is furnished 
+    to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all 
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+    PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE 
+    LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE 
+    USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+The Apache License, Version 2.0 (the "License");
+    You may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+
+**/
+
+#include "perf_counters.h"
+
+#ifdef __linux__
+#include <cstring>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#if defined(__i386__) || defined(__x86_64__) || defined(__amd64__)
+# define EASY_PERF_COUNTERS_RDPMC
+#endif
+
+namespace {
+
+    void counterAttributes(profiler::PerfCounter _counter, perf_event_attr& _attr)
+    {
+        switch (_counter)
+        {
+            case profiler::PERF_COUNTER_CYCLES:
+                _attr.type = PERF_TYPE_HARDWARE;
+                _attr.config = PERF_COUNT_HW_CPU_CYCLES;
+                break;
+
+            case profiler::PERF_COUNTER_INSTRUCTIONS:
+                _attr.type = PERF_TYPE_HARDWARE;
+                _attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+                break;
+
+            case profiler::PERF_COUNTER_CACHE_MISSES:
+                _attr.type = PERF_TYPE_HARDWARE;
+                _attr.config = PERF_COUNT_HW_CACHE_MISSES;
+                break;
+
+            case profiler::PERF_COUNTER_TASK_CLOCK:
+                _attr.type = PERF_TYPE_SOFTWARE;
+                _attr.config = PERF_COUNT_SW_TASK_CLOCK;
+                break;
+
+            default:
+                _attr.type = PERF_TYPE_SOFTWARE;
+                _attr.config = PERF_COUNT_SW_PAGE_FAULTS;
+                break;
+        }
+    }
+
+#ifdef EASY_PERF_COUNTERS_RDPMC
+    inline uint64_t rdpmc(uint32_t _counter)
+    {
+        uint32_t low, high;
+        __asm__ __volatile__("rdpmc" : "=a" (low), "=d" (high) : "c" (_counter));
+        return static_cast<uint64_t>(low) | (static_cast<uint64_t>(high) << 32);
+    }
+
+    /** Read counter value by rdpmc using self-monitoring protocol described in linux/perf_event.h.
+
+    \retval false if counter could not be read by rdpmc now (for example, it is not scheduled on the PMU).
+    */
+    bool readUserCounter(const void* _page, uint64_t& _value)
+    {
+        const auto page = static_cast<const volatile perf_event_mmap_page*>(_page);
+        uint32_t seq;
+        do
+        {
+            seq = page->lock;
+            __asm__ __volatile__("" ::: "memory");
+
+            const uint32_t index = page->index;
+            if (!page->cap_user_rdpmc || index == 0)
+                return false;
+
+            const uint16_t width = page->pmc_width;
+            int64_t count = static_cast<int64_t>(rdpmc(index - 1));
+            count <<= 64 - width;
+            count >>= 64 - width;
+            _value = static_cast<uint64_t>(page->offset + count);
+
+            __asm__ __volatile__("" ::: "memory");
+        } while (page->lock != seq);
+
+        return true;
+    }
+#endif
+
+} // END of anonymous namespace.
+#endif // __linux__
+
+//////////////////////////////////////////////////////////////////////////
+
+PerfCounters::PerfCounters() : m_number(0), m_mask(0), m_rdpmc(false)
+{
+    for (uint32_t i = 0; i < profiler::PERF_COUNTERS_NUMBER; ++i)
+    {
+        m_fds[i] = -1;
+        m_pages[i] = nullptr;
+    }
+}
+
+PerfCounters::~PerfCounters()
+{
+    close();
+}
+
+uint32_t PerfCounters::open(uint32_t _mask)
+{
+    close();
+
+#ifdef __linux__
+    const auto pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    bool rdpmc = true;
+
+    for (uint32_t counter = 0; counter < profiler::PERF_COUNTERS_NUMBER; ++counter)
+    {
+        if (!(_mask & (1U << counter)))
+            continue;
+
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(perf_event_attr));
+        attr.size = sizeof(perf_event_attr);
+        counterAttributes(static_cast<profiler::PerfCounter>(counter), attr);
+        attr.read_format = PERF_FORMAT_GROUP;
+        attr.exclude_kernel = 1; // Allowed for unprivileged users with default kernel.perf_event_paranoid
+        attr.exclude_hv = 1;
+
+        const int leader = m_number != 0 ? m_fds[0] : -1;
+        const int fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, leader, PERF_FLAG_FD_CLOEXEC));
+        if (fd < 0)
+            continue; // Hardware counters are not available without PMU
+
+        void* page = nullptr;
+        if (attr.type == PERF_TYPE_HARDWARE)
+        {
+            page = mmap(nullptr, pageSize, PROT_READ, MAP_SHARED, fd, 0);
+            if (page == MAP_FAILED)
+                page = nullptr;
+        }
+
+#ifdef EASY_PERF_COUNTERS_RDPMC
+        if (page == nullptr || !static_cast<const perf_event_mmap_page*>(page)->cap_user_rdpmc)
+            rdpmc = false;
+#else
+        rdpmc = false;
+#endif
+
+        m_fds[m_number] = fd;
+        m_pages[m_number] = page;
+        ++m_number;
+        m_mask |= 1U << counter;
+    }
+
+    m_rdpmc = rdpmc && m_number != 0;
+#else
+    (void)_mask;
+#endif
+
+    return m_mask;
+}
+
+void PerfCounters::close()
+{
+#ifdef __linux__
+    const auto pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+    // Group members are closed before the leader
+    for (uint32_t i = m_number; i-- > 0;)
+    {
+        if (m_pages[i] != nullptr)
+            munmap(m_pages[i], pageSize);
+        ::close(m_fds[i]);
+        m_fds[i] = -1;
+        m_pages[i] = nullptr;
+    }
+#endif
+
+    m_number = 0;
+    m_mask = 0;
+    m_rdpmc = false;
+}
+
+bool PerfCounters::read(uint64_t* _values) const
+{
+#ifdef __linux__
+    if (m_number == 0)
+        return false;
+
+#ifdef EASY_PERF_COUNTERS_RDPMC
+    if (m_rdpmc)
+    {
+        uint32_t i = 0;
+        for (; i < m_number && readUserCounter(m_pages[i], _values[i]); ++i);
+        if (i == m_number)
+            return true;
+    }
+#endif
+
+    // PERF_FORMAT_GROUP: u64 nr; u64 values[nr];
+    uint64_t data[profiler::PERF_COUNTERS_NUMBER + 1];
+    const auto size = static_cast<ssize_t>((m_number + 1) * sizeof(uint64_t));
+    if (::read(m_fds[0], data, static_cast<size_t>(size)) != size || data[0] != m_number)
+        return false;
+
+    memcpy(_values, data + 1, m_number * sizeof(uint64_t));
+    return true;
+#else
+    (void)_values;
+    return false;
+#endif
+}
@@ -0,0 +1,98 @@
+/**
+Lightweight profiler library for c++
+Copyright(C) 2016-2017  Sergey Yagovtsev, Victor Zarubkin
+
+Licensed under either of
+    * MIT license (LICENSE.MIT or http://opensource.org/licenses/MIT)
+    * Apache License, Version 2.0, (LICENSE.APACHE or http://www.apache.org/licenses/LICENSE-2.0)
+at your option.
+
+The MIT License
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights 
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies 
+    of the Software, and to permit persons to whom the Software is furnished 
+    to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all 
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+    PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE 
+    LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE 
+    USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+The Apache License, Version 2.0 (the "License");
+    You may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+
+**/
+
+#ifndef EASY_PROFILER_PERF_COUNTERS_H
+#define EASY_PROFILER_PERF_COUNTERS_H
+
+#include <easy/profiler.h>
+
+//////////////////////////////////////////////////////////////////////////
+
+/** Performance counters of one thread (see profiler::PerfCounter).
+
+Counters are opened by perf_event_open() for the calling thread only (user-space events only, so it works
+with default kernel.perf_event_paranoid). They are read by rdpmc instruction without system calls
+if all opened counters allow it (x86 hardware counters with /sys/bus/event_source/devices/cpu/rdpmc != 0),
+otherwise all counters are read at once by one read() of the counters group.
+
+\note Only Linux is supported, open() returns 0 on other platforms.
+*/
+class PerfCounters EASY_FINAL
+{
+    int          m_fds[profiler::PERF_COUNTERS_NUMBER]; ///< Opened counters in order of set bits of m_mask (the first one is group leader)
+    void*      m_pages[profiler::PERF_COUNTERS_NUMBER]; ///< Mapped metadata pages of counters (used by rdpmc)
+    uint32_t                                  m_number; ///< Number of opened counters
+    uint32_t                                    m_mask; ///< Opened counters (bit (1 << profiler::PerfCounter) for each one)
+    bool                                       m_rdpmc; ///< True if all opened counters could be read by rdpmc
+
+public:
+
+    PerfCounters();
+    ~PerfCounters();
+
+    /** Open counters for the calling thread (previously opened counters are closed).
+
+    \retval Mask of successfully opened counters.
+    */
+    uint32_t open(uint32_t _mask);
+
+    void close();
+
+    inline uint32_t mask() const { return m_mask; }
+    inline uint32_t number() const { return m_number; }
+
+    /** Read current values of opened counters in order of set bits of mask().
+
+    \retval false if counters could not be read.
+    */
+    bool read(uint64_t* _values) const;
+
+private:
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator = (const PerfCounters&) = delete;
+
+}; // END of class PerfCounters.
+
+//////////////////////////////////////////////////////////////////////////
+
+#endif // EASY_PROFILER_PERF_COUNTERS_H
@@ -49,6 +49,8 @@
 ************************************************************************/
 
 #include <algorithm>
+#include <cstdio>
+#include <ctime>
 #include <fstream>
 #include <future>
 #include "profile_manager.h"
@@ -58,8 +60,11 @@
 #include <easy/easy_socket.h>
 
 #include "event_trace_win.h"
+#include "event_trace_linux.h"
 #include "current_time.h"
 #include "current_thread.h"
+#include "compact_format.h"
+#include "compression.h"
 
 #ifdef __APPLE__
 #include <mach/clock.h>
@@ -159,6 +164,10 @@ extern const uint32_t EASY_CURRENT_VERSION = EASY_VERSION_INT(EASY_PROFILER_VERS
 # define EASY_PROF_ENABLED 1
 # define EASY_PROF_DUMP 2
 
+namespace profiler {
+    PROFILER_API std::atomic<char> profilerStatus(EASY_PROF_DISABLED);
+}
+
 //////////////////////////////////////////////////////////////////////////
 
 //auto& MANAGER = ProfileManager::instance();
@@ -173,53 +182,36 @@ const int64_t CPU_FREQUENCY = EASY_CHRONO_CLOCK::period::den / EASY_CHRONO_CLOCK
 const decltype(LARGE_INTEGER::QuadPart) CPU_FREQUENCY = ([](){ LARGE_INTEGER freq; QueryPerformanceFrequency(&freq); return freq.QuadPart; })();
 # define TICKS_TO_US(ticks) ticks * 1000000LL / CPU_FREQUENCY
 #else
-# ifndef __APPLE__
-#  include <time.h>
-# endif
-int64_t calculate_cpu_frequency()
-{
-    double g_TicksPerNanoSec;
-    uint64_t begin = 0, end = 0;
-#ifdef __APPLE__
-    clock_serv_t cclock;
-    mach_timespec_t begints, endts;
-    host_get_clock_service(mach_host_self(), SYSTEM_CLOCK, &cclock);
-    clock_get_time(cclock, &begints);
-#else
-    struct timespec begints, endts;
-    clock_gettime(CLOCK_MONOTONIC, &begints);
+// Counter frequency is in kHz here (see ClockCalibration)
+# define TICKS_TO_US(ticks) ticks * 1000 / MANAGER.cpuFrequency()
 #endif
-    begin = getCurrentTime();
-    volatile uint64_t i;
-    for (i = 0; i < 100000000; i++); /* must be CPU intensive */
-    end = getCurrentTime();
-#ifdef __APPLE__
-    clock_get_time(cclock, &endts);
-    mach_port_deallocate(mach_task_self(), cclock);
+
+static double ticks_per_nanosecond()
+{
+#if defined(EASY_CHRONO_CLOCK) || defined(_WIN32)
+    return static_cast<double>(CPU_FREQUENCY) * 1e-9;
 #else
-    clock_gettime(CLOCK_MONOTONIC, &endts);
+    return static_cast<double>(MANAGER.cpuFrequency()) * 1e-6;
 #endif
-    struct timespec tmpts;
-    const int NANO_SECONDS_IN_SEC = 1000000000;
-    tmpts.tv_sec = endts.tv_sec - begints.tv_sec;
-    tmpts.tv_nsec = endts.tv_nsec - begints.tv_nsec;
-    if (tmpts.tv_nsec < 0)
-    {
-        tmpts.tv_sec--;
-        tmpts.tv_nsec += NANO_SECONDS_IN_SEC;
-    }
-
-    uint64_t nsecElapsed = tmpts.tv_sec * 1000000000LL + tmpts.tv_nsec;
-    g_TicksPerNanoSec = (double)(end - begin) / (double)nsecElapsed;
+}
 
-    int64_t cpu_frequency = int(g_TicksPerNanoSec * 1000000);
+static profiler::timestamp_t nanoseconds_to_ticks(profiler::timestamp_t _nanoseconds)
+{
+    return static_cast<profiler::timestamp_t>(static_cast<double>(_nanoseconds) * ticks_per_nanosecond());
+}
 
-    return cpu_frequency;
+static profiler::timestamp_t ticks_to_nanoseconds(profiler::timestamp_t _ticks)
+{
+    return static_cast<profiler::timestamp_t>(static_cast<double>(_ticks) / ticks_per_nanosecond());
 }
 
-static std::atomic<int64_t> CPU_FREQUENCY = ATOMIC_VAR_INIT(1);
-# define TICKS_TO_US(ticks) ticks * 1000 / CPU_FREQUENCY.load(std::memory_order_acquire)
-#endif
+/** End time of the stored block or context switch (both records start with profiler::Event). */
+static profiler::timestamp_t record_end(const char* _data)
+{
+    profiler::timestamp_t end = 0;
+    memcpy(&end, _data + sizeof(profiler::timestamp_t), sizeof(profiler::timestamp_t));
+    return end;
+}
 
 extern const profiler::color_t EASY_COLOR_INTERNAL_EVENT = 0xffffffff; // profiler::colors::White
 const profiler::color_t EASY_COLOR_THREAD_END = 0xff212121; // profiler::colors::Dark
@@ -238,6 +230,16 @@ EASY_THREAD_LOCAL static uint32_t THIS_THREAD_N_FRAMES = 0;
 EASY_THREAD_LOCAL static bool THIS_THREAD_FRAME_T_RESET_MAX = false;
 EASY_THREAD_LOCAL static bool THIS_THREAD_FRAME_T_RESET_AVG = false;
 
+struct CachedDescriptor
+{
+    size_t                                     hash; ///< Hash of the key
+    const char*                                 key; ///< Points to the key stored in descriptors registry
+    const profiler::BaseBlockDescriptor* descriptor;
+};
+
+const uint32_t DESCRIPTORS_CACHE_SIZE = 64;
+EASY_THREAD_LOCAL static CachedDescriptor THIS_THREAD_DESCRIPTORS[DESCRIPTORS_CACHE_SIZE]; ///< Thread-local front cache of descriptors registry
+
 #ifdef EASY_THREAD_LOCAL_CPP11
 thread_local static profiler::ThreadGuard THIS_THREAD_GUARD; // thread guard for monitoring thread life time
 #endif
@@ -293,7 +295,7 @@ extern "C" {
 #if defined(EASY_CHRONO_CLOCK) || defined(_WIN32)
         return _ticks * 1000000000LL / CPU_FREQUENCY;
 #else
-        return _ticks / CPU_FREQUENCY.load(std::memory_order_acquire);
+        return _ticks / MANAGER.cpuFrequency();
 #endif
     }
 
@@ -302,9 +304,9 @@ extern "C" {
         return TICKS_TO_US(_ticks);
     }
 
-    PROFILER_API const BaseBlockDescriptor* registerDescription(EasyBlockStatus _status, const char* _autogenUniqueId, const char* _name, const char* _filename, int _line, block_type_t _block_type, color_t _color, bool _copyName)
+    PROFILER_API const BaseBlockDescriptor* registerDescription(EasyBlockStatus _status, const char* _autogenUniqueId, const char* _name, const char* _filename, int _line, block_type_t _block_type, color_t _color, bool _copyName, uint16_t _sampling)
     {
-        return MANAGER.addBlockDescriptor(_status, _autogenUniqueId, _name, _filename, _line, _block_type, _color, _copyName);
+        return MANAGER.addBlockDescriptor(_status, _autogenUniqueId, _name, _filename, _line, _block_type, _color, _copyName, _sampling);
     }
 
     PROFILER_API void endBlock()
@@ -312,6 +314,11 @@ extern "C" {
         MANAGER.endBlock();
     }
 
+    PROFILER_API ThreadFastState* registerThreadFastState(ThreadFastState** _cache)
+    {
+        return MANAGER.registerThreadFastState(_cache);
+    }
+
     PROFILER_API void setEnabled(bool isEnable)
     {
         MANAGER.setEnabled(isEnable);
@@ -367,7 +374,7 @@ extern "C" {
         return MANAGER.isEventTracingEnabled();
     }
 
-# ifdef _WIN32
+# if defined(_WIN32) || defined(__linux__)
     PROFILER_API void setLowPriorityEventTracing(bool _isLowPriority)
     {
         EasyEventTracer::instance().setLowPriority(_isLowPriority);
@@ -407,6 +414,137 @@ extern "C" {
         return MANAGER.isListening();
     }
 
+    PROFILER_API bool startStreaming(const char* _filenamePrefix, uint64_t _memoryBudget, uint32_t _segmentsNumber, uint64_t _segmentSize)
+    {
+        return MANAGER.startStreaming(_filenamePrefix, _memoryBudget, _segmentsNumber, _segmentSize);
+    }
+
+    PROFILER_API void stopStreaming()
+    {
+        MANAGER.stopStreaming();
+    }
+
+    PROFILER_API bool isStreaming()
+    {
+        return MANAGER.isStreaming();
+    }
+
+    PROFILER_API void setCompressionEnabled(bool _isEnable)
+    {
+        MANAGER.setCompressionEnabled(_isEnable);
+    }
+
+    PROFILER_API bool isCompressionEnabled()
+    {
+        return MANAGER.isCompressionEnabled();
+    }
+
+    PROFILER_API void setMinBlockDuration(timestamp_t _nanoseconds)
+    {
+        MANAGER.setMinBlockDuration(_nanoseconds);
+    }
+
+    PROFILER_API void setBlockMinDuration(block_id_t _id, timestamp_t _nanoseconds)
+    {
+        MANAGER.setBlockMinDuration(_id, _nanoseconds);
+    }
+
+    PROFILER_API uint32_t setPerfCounters(uint32_t _mask)
+    {
+        return MANAGER.setPerfCounters(_mask);
+    }
+
+    PROFILER_API void setBlockPerfCounters(block_id_t _id, bool _isEnable)
+    {
+        MANAGER.setBlockPerfCounters(_id, _isEnable);
+    }
+
+    PROFILER_API void setStatisticsOnly(bool _isEnable)
+    {
+        MANAGER.setStatisticsOnly(_isEnable);
+    }
+
+    PROFILER_API bool isStatisticsOnly()
+    {
+        return MANAGER.isStatisticsOnly();
+    }
+
+    PROFILER_API uint32_t dumpStatisticsToFile(const char* _filename)
+    {
+        return MANAGER.dumpStatisticsToFile(_filename);
+    }
+
+    PROFILER_API void startFlightRecording(uint64_t _threadMemoryBudget)
+    {
+        MANAGER.startFlightRecording(_threadMemoryBudget);
+    }
+
+    PROFILER_API void stopFlightRecording()
+    {
+        MANAGER.stopFlightRecording();
+    }
+
+    PROFILER_API bool isFlightRecording()
+    {
+        return MANAGER.isFlightRecording();
+    }
+
+    PROFILER_API uint32_t dumpRecentToFile(const char* _filename, uint32_t _windowMs)
+    {
+        return MANAGER.dumpRecentToFile(_filename, _windowMs);
+    }
+
+    PROFILER_API void setFrameTrigger(timestamp_t _nanoseconds)
+    {
+        MANAGER.setFrameTrigger(_nanoseconds);
+    }
+
+    PROFILER_API void setBlockTrigger(block_id_t _id, timestamp_t _nanoseconds)
+    {
+        MANAGER.setBlockTrigger(_id, _nanoseconds);
+    }
+
+    PROFILER_API void setTriggerOutput(const char* _filenamePrefix, uint32_t _marginMs)
+    {
+        MANAGER.setTriggerOutput(_filenamePrefix, _marginMs);
+    }
+
+    PROFILER_API bool setClockSource(ClockSource _source)
+    {
+        return MANAGER.setClockSource(_source);
+    }
+
+    PROFILER_API ClockSource clockSource()
+    {
+        return MANAGER.clockSource();
+    }
+
+    PROFILER_API bool testClockSource(ClockSource _source, ClockTestResult& _result)
+    {
+        return test_clock_source(_source, _result);
+    }
+
+    PROFILER_API ClockSource findBestClockSource()
+    {
+        auto best = profiler::CLOCK_SOURCE_DEFAULT;
+        double bestCost = 0;
+
+        for (uint8_t source = 0; source < profiler::CLOCK_SOURCES_NUMBER; ++source)
+        {
+            ClockTestResult result;
+            if (!test_clock_source(source, result) || result.backwardSteps != 0 || result.crossThreadBackwardSteps != 0)
+                continue;
+
+            if (source == profiler::CLOCK_SOURCE_DEFAULT || result.callCost < bestCost)
+            {
+                best = static_cast<ClockSource>(source);
+                bestCost = result.callCost;
+            }
+        }
+
+        return best;
+    }
+
     PROFILER_API bool isMainThread()
     {
         return THIS_THREAD_IS_MAIN;
@@ -479,8 +617,9 @@ extern "C" {
     PROFILER_API timestamp_t currentTime() { return 0; }
     PROFILER_API timestamp_t toNanoseconds(timestamp_t) { return 0; }
     PROFILER_API timestamp_t toMicroseconds(timestamp_t) { return 0; }
-    PROFILER_API const BaseBlockDescriptor* registerDescription(EasyBlockStatus, const char*, const char*, const char*, int, block_type_t, color_t, bool) { return reinterpret_cast<const BaseBlockDescriptor*>(0xbad); }
+    PROFILER_API const BaseBlockDescriptor* registerDescription(EasyBlockStatus, const char*, const char*, const char*, int, block_type_t, color_t, bool, uint16_t) { return reinterpret_cast<const BaseBlockDescriptor*>(0xbad); }
     PROFILER_API void endBlock() { }
+    PROFILER_API ThreadFastState* registerThreadFastState(ThreadFastState**) { return nullptr; }
     PROFILER_API void setEnabled(bool) { }
     PROFILER_API bool isEnabled() { return false; }
     PROFILER_API void storeEvent(const BaseBlockDescriptor*, const char*) { }
@@ -499,6 +638,29 @@ extern "C" {
     PROFILER_API void startListen(uint16_t) { }
     PROFILER_API void stopListen() { }
     PROFILER_API bool isListening() { return false; }
+    PROFILER_API bool startStreaming(const char*, uint64_t, uint32_t, uint64_t) { return false; }
+    PROFILER_API void stopStreaming() { }
+    PROFILER_API bool isStreaming() { return false; }
+    PROFILER_API void setCompressionEnabled(bool) { }
+    PROFILER_API bool isCompressionEnabled() { return false; }
+    PROFILER_API void setMinBlockDuration(timestamp_t) { }
+    PROFILER_API void setBlockMinDuration(block_id_t, timestamp_t) { }
+    PROFILER_API uint32_t setPerfCounters(uint32_t) { return 0; }
+    PROFILER_API void setBlockPerfCounters(block_id_t, bool) { }
+    PROFILER_API void setStatisticsOnly(bool) { }
+    PROFILER_API bool isStatisticsOnly() { return false; }
+    PROFILER_API uint32_t dumpStatisticsToFile(const char*) { return 0; }
+    PROFILER_API void startFlightRecording(uint64_t) { }
+    PROFILER_API void stopFlightRecording() { }
+    PROFILER_API bool isFlightRecording() { return false; }
+    PROFILER_API uint32_t dumpRecentToFile(const char*, uint32_t) { return 0; }
+    PROFILER_API void setFrameTrigger(timestamp_t) { }
+    PROFILER_API void setBlockTrigger(block_id_t, timestamp_t) { }
+    PROFILER_API void setTriggerOutput(const char*, uint32_t) { }
+    PROFILER_API bool setClockSource(ClockSource) { return false; }
+    PROFILER_API ClockSource clockSource() { return CLOCK_SOURCE_DEFAULT; }
+    PROFILER_API bool testClockSource(ClockSource, ClockTestResult&) { return false; }
+    PROFILER_API ClockSource findBestClockSource() { return CLOCK_SOURCE_DEFAULT; }
 
     PROFILER_API bool isMainThread() { return false; }
     PROFILER_API timestamp_t this_thread_frameTime(Duration) { return 0; }
@@ -563,12 +725,13 @@ SerializedCSwitch::SerializedCSwitch(const CSwitchBlock& block, uint16_t name_le
 
 //////////////////////////////////////////////////////////////////////////
 
-BaseBlockDescriptor::BaseBlockDescriptor(block_id_t _id, EasyBlockStatus _status, int _line, block_type_t _block_type, color_t _color)
+BaseBlockDescriptor::BaseBlockDescriptor(block_id_t _id, EasyBlockStatus _status, int _line, block_type_t _block_type, color_t _color, uint16_t _sampling)
     : m_id(_id)
     , m_line(_line)
     , m_type(_block_type)
     , m_color(_color)
     , m_status(_status)
+    , m_sampling(_sampling)
 {
 
 }
@@ -595,14 +758,27 @@ class BlockDescriptor : public BaseBlockDescriptor
 
     EASY_BLOCK_DESC_STRING m_filename; ///< Source file name where this block is declared
     EASY_BLOCK_DESC_STRING     m_name; ///< Static name of all blocks of the same type (blocks can have dynamic name) which is, in pair with descriptor id, a unique block identifier
+    std::atomic<timestamp_t> m_minDuration; ///< Blocks shorter than this (in ticks) are aggregated instead of being stored. 0 means global threshold is used.
+    std::atomic<timestamp_t>     m_trigger; ///< Blocks longer than this (in ticks) fire capture trigger. 0 means disabled.
+    std::atomic_bool        m_perfCounters; ///< True if performance counters are stored with blocks
+    std::atomic<uint16_t>   m_samplingRate; ///< Current sampling rate (BaseBlockDescriptor::m_sampling is the rate at registration). Could be changed at run-time by listening thread.
 
 public:
 
-    BlockDescriptor(block_id_t _id, EasyBlockStatus _status, const char* _name, const char* _filename, int _line, block_type_t _block_type, color_t _color)
-        : BaseBlockDescriptor(_id, _status, _line, _block_type, _color)
+    BlockDescriptor(block_id_t _id, EasyBlockStatus _status, const char* _name, const char* _filename, int _line, block_type_t _block_type, color_t _color, uint16_t _sampling)
+        : BaseBlockDescriptor(_id, _status, _line, _block_type, _color, _sampling)
         , m_filename(_filename)
         , m_name(_name)
     {
+        m_minDuration = ATOMIC_VAR_INIT(0);
+        m_trigger = ATOMIC_VAR_INIT(0);
+        m_perfCounters = ATOMIC_VAR_INIT(false);
+        m_samplingRate = ATOMIC_VAR_INIT(_sampling);
+    }
+
+    uint16_t samplingRate() const {
+        const auto sampling = m_samplingRate.load(std::memory_order_relaxed);
+        return sampling > 1 ? sampling : static_cast<uint16_t>(1);
     }
 
     const char* name() const {
@@ -632,8 +808,8 @@ ThreadGuard::~ThreadGuard()
     {
         bool isMarked = false;
         EASY_EVENT_RES(isMarked, "ThreadFinished", EASY_COLOR_THREAD_END, ::profiler::FORCE_ON);
-        THIS_THREAD->profiledFrameOpened.store(false, std::memory_order_release);
         THIS_THREAD->expired.store(isMarked ? 2 : 1, std::memory_order_release);
+        THIS_THREAD->resetFastStateCaches();
         THIS_THREAD = nullptr;
     }
 #endif
@@ -650,12 +826,36 @@ ProfileManager::ProfileManager() :
     , m_usedMemorySize(0)
     , m_beginTime(0)
     , m_endTime(0)
+    , m_profilerStatus(profiler::profilerStatus)
 {
+    // Id of overflow descriptor is out of m_descriptors range, so it's status, sampling and etc. can not be changed
+    m_overflowDescriptor = new BlockDescriptor(static_cast<profiler::block_id_t>(-1), profiler::OFF, "EasyProfiler.DescriptorsOverflow",
+                                               __FILE__, __LINE__, profiler::BLOCK_TYPE_BLOCK, profiler::colors::Default, 1);
+
     m_profilerStatus = ATOMIC_VAR_INIT(EASY_PROF_DISABLED);
     m_isEventTracingEnabled = ATOMIC_VAR_INIT(EASY_OPTION_EVENT_TRACING_ENABLED);
+    m_isEventTracerLaunched = ATOMIC_VAR_INIT(false);
+    m_isSamplingUsed = ATOMIC_VAR_INIT(false);
+    m_minBlockDuration = ATOMIC_VAR_INIT(0);
+    m_isFilteringUsed = ATOMIC_VAR_INIT(false);
+    m_isStatisticsOnly = ATOMIC_VAR_INIT(false);
+    m_isPerfCountersUsed = ATOMIC_VAR_INIT(false);
+    m_perfCountersMask = ATOMIC_VAR_INIT((1U << profiler::PERF_COUNTERS_NUMBER) - 1);
+    m_perfCountersGeneration = ATOMIC_VAR_INIT(1);
     m_isAlreadyListening = ATOMIC_VAR_INIT(false);
     m_stopDumping = ATOMIC_VAR_INIT(false);
+    m_isDescriptorsOverflow = ATOMIC_VAR_INIT(false);
     m_stopListen = ATOMIC_VAR_INIT(false);
+    m_memoryBudget = ATOMIC_VAR_INIT(0);
+    m_stopFlush = ATOMIC_VAR_INIT(false);
+    m_isStreaming = ATOMIC_VAR_INIT(false);
+    m_isFlightRecording = ATOMIC_VAR_INIT(false);
+    m_isCompressionEnabled = ATOMIC_VAR_INIT(false);
+    m_frameTrigger = ATOMIC_VAR_INIT(0);
+    m_triggerMargin = ATOMIC_VAR_INIT(1000);
+    m_triggerTime = ATOMIC_VAR_INIT(0);
+    m_isTriggersUsed = ATOMIC_VAR_INIT(false);
+    m_stopTriggers = ATOMIC_VAR_INIT(false);
 
     m_mainThreadId = ATOMIC_VAR_INIT(0);
     m_frameMax = ATOMIC_VAR_INIT(0);
@@ -669,8 +869,7 @@ ProfileManager::ProfileManager() :
 #endif
 
 #if !defined(EASY_PROFILER_API_DISABLED) && !defined(EASY_CHRONO_CLOCK) && !defined(_WIN32)
-    const int64_t cpu_frequency = calculate_cpu_frequency();
-    CPU_FREQUENCY.store(cpu_frequency, std::memory_order_release);
+    m_clock.start();
 #endif
 }
 
@@ -678,9 +877,16 @@ ProfileManager::~ProfileManager()
 {
 #ifndef EASY_PROFILER_API_DISABLED
     stopListen();
+    stopStreaming();
+    stopFlightRecording();
+
+    m_stopTriggers.store(true, std::memory_order_release);
+    if (m_triggerThread.joinable())
+        m_triggerThread.join();
 #endif
 
-    for (auto desc : m_descriptors) {
+    for (uint32_t i = 0, n = m_descriptors.size(); i < n; ++i) {
+        auto desc = m_descriptors.get(i);
 #if EASY_BLOCK_DESC_FULL_COPY == 0
         if (desc)
             desc->~BlockDescriptor();
@@ -689,6 +895,8 @@ ProfileManager::~ProfileManager()
         delete desc;
 #endif
     }
+
+    delete m_overflowDescriptor;
 }
 
 #ifndef EASY_MAGIC_STATIC_CPP11
@@ -714,19 +922,6 @@ ProfileManager& ProfileManager::instance()
 
 //////////////////////////////////////////////////////////////////////////
 
-ThreadStorage& ProfileManager::_threadStorage(profiler::thread_id_t _thread_id)
-{
-    return m_threads[_thread_id];
-}
-
-ThreadStorage* ProfileManager::_findThreadStorage(profiler::thread_id_t _thread_id)
-{
-    auto it = m_threads.find(_thread_id);
-    return it != m_threads.end() ? &it->second : nullptr;
-}
-
-//////////////////////////////////////////////////////////////////////////
-
 const BaseBlockDescriptor* ProfileManager::addBlockDescriptor(EasyBlockStatus _defaultStatus,
                                                         const char* _autogenUniqueId,
                                                         const char* _name,
@@ -734,42 +929,55 @@ const BaseBlockDescriptor* ProfileManager::addBlockDescriptor(EasyBlockStatus _d
                                                         int _line,
                                                         block_type_t _block_type,
                                                         color_t _color,
-                                                        bool _copyName)
+                                                        bool _copyName,
+                                                        uint16_t _sampling)
 {
-    guard_lock_t lock(m_storedSpin);
-
-    descriptors_map_t::key_type key(_autogenUniqueId);
-    auto it = m_descriptorsMap.find(key);
-    if (it != m_descriptorsMap.end())
-        return m_descriptors[it->second];
+    // Check thread-local cache first: this does not touch any shared state
+    const auto hash = block_descriptors_t::hash(_autogenUniqueId);
+    auto& cached = THIS_THREAD_DESCRIPTORS[hash % DESCRIPTORS_CACHE_SIZE];
+    if (cached.descriptor != nullptr && cached.hash == hash && !strcmp(cached.key, _autogenUniqueId))
+        return cached.descriptor;
 
-    const auto nameLen = strlen(_name);
-    m_usedMemorySize += sizeof(profiler::SerializedBlockDescriptor) + nameLen + strlen(_filename) + 2;
+    const auto entry = m_descriptors.findOrAdd(_autogenUniqueId, hash, [&](block_id_t _id) -> BlockDescriptor*
+    {
+        const auto nameLen = strlen(_name);
+        m_usedMemorySize.fetch_add(sizeof(profiler::SerializedBlockDescriptor) + nameLen + strlen(_filename) + 2, std::memory_order_relaxed);
 
 #if EASY_BLOCK_DESC_FULL_COPY == 0
-    BlockDescriptor* desc = nullptr;
+        if (_copyName)
+        {
+            void* data = malloc(sizeof(BlockDescriptor) + nameLen + 1);
+            char* name = reinterpret_cast<char*>(data) + sizeof(BlockDescriptor);
+            strncpy(name, _name, nameLen);
+            name[nameLen] = 0;
+            return ::new (data)BlockDescriptor(_id, _defaultStatus, name, _filename, _line, _block_type, _color, _sampling);
+        }
 
-    if (_copyName)
-    {
-        void* data = malloc(sizeof(BlockDescriptor) + nameLen + 1);
-        char* name = reinterpret_cast<char*>(data) + sizeof(BlockDescriptor);
-        strncpy(name, _name, nameLen);
-        desc = ::new (data)BlockDescriptor(static_cast<block_id_t>(m_descriptors.size()), _defaultStatus, name, _filename, _line, _block_type, _color);
-    }
-    else
-    {
         void* data = malloc(sizeof(BlockDescriptor));
-        desc = ::new (data)BlockDescriptor(static_cast<block_id_t>(m_descriptors.size()), _defaultStatus, _name, _filename, _line, _block_type, _color);
-    }
+        return ::new (data)BlockDescriptor(_id, _defaultStatus, _name, _filename, _line, _block_type, _color, _sampling);
 #else
-    auto desc = new BlockDescriptor(static_cast<block_id_t>(m_descriptors.size()), _defaultStatus, _name, _filename, _line, _block_type, _color);
-    (void)_copyName; // unused
+        (void)_copyName; // unused
+        return new BlockDescriptor(_id, _defaultStatus, _name, _filename, _line, _block_type, _color, _sampling);
 #endif
+    });
+
+    if (entry.descriptor == nullptr)
+    {
+        // Return disabled descriptor instead of nullptr: blocks and events dereference it without any check
+        if (!m_isDescriptorsOverflow.exchange(true, std::memory_order_relaxed))
+            EASY_ERROR("Can not register block descriptor \"" << _name << "\": too many descriptors. This and all following new blocks are disabled\n");
 
-    m_descriptors.emplace_back(desc);
-    m_descriptorsMap.emplace(key, desc->id());
+        return m_overflowDescriptor;
+    }
+
+    if (entry.descriptor->samplingRate() > 1)
+        m_isSamplingUsed.store(true, std::memory_order_release);
 
-    return desc;
+    cached.hash = hash;
+    cached.key = entry.key;
+    cached.descriptor = entry.descriptor;
+
+    return entry.descriptor;
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -795,11 +1003,21 @@ bool ProfileManager::storeBlock(const profiler::BaseBlockDescriptor* _desc, cons
         return false;
 #endif
 
+    const auto sampling = static_cast<const BlockDescriptor*>(_desc)->samplingRate();
+    if (sampling > 1 && !THIS_THREAD->sample(_desc->m_id, sampling))
+        return false;
+
+    if (m_isStatisticsOnly.load(std::memory_order_relaxed))
+    {
+        THIS_THREAD->statistics.add(_desc->m_id, 0, sampling);
+        return true;
+    }
+
     profiler::Block b(_desc, _runtimeName);
     b.start();
     b.m_end = b.m_begin;
 
-    THIS_THREAD->storeBlock(b);
+    THIS_THREAD->storeBlock(b, sampling);
 
     return true;
 }
@@ -825,8 +1043,18 @@ bool ProfileManager::storeBlock(const profiler::BaseBlockDescriptor* _desc, cons
         return false;
 #endif
 
+    const auto sampling = static_cast<const BlockDescriptor*>(_desc)->samplingRate();
+    if (sampling > 1 && !THIS_THREAD->sample(_desc->m_id, sampling))
+        return false;
+
+    if (m_isStatisticsOnly.load(std::memory_order_relaxed))
+    {
+        THIS_THREAD->statistics.add(_desc->m_id, _endTime - _beginTime, sampling);
+        return true;
+    }
+
     profiler::Block b(_beginTime, _endTime, _desc->id(), _runtimeName);
-    THIS_THREAD->storeBlock(b);
+    THIS_THREAD->storeBlock(b, sampling);
     b.m_end = b.m_begin;
 
     return true;
@@ -933,6 +1161,14 @@ void ProfileManager::beginBlock(Block& _block)
     THIS_THREAD->stackSize = 0;
     THIS_THREAD->halt = false;
 
+    if ((_block.m_status & profiler::ON) && m_isSamplingUsed.load(std::memory_order_relaxed))
+    {
+        const auto desc = m_descriptors.get(_block.m_id);
+        const auto sampling = desc != nullptr ? desc->samplingRate() : static_cast<uint16_t>(1);
+        if (sampling > 1 && !THIS_THREAD->sample(_block.m_id, sampling))
+            _block.m_status = static_cast<profiler::EasyBlockStatus>(_block.m_status & profiler::OFF_RECURSIVE); // Skipped block still turns off it's children if required
+    }
+
 #if EASY_ENABLE_BLOCK_STATUS != 0
     if (THIS_THREAD->allowChildren)
     {
@@ -954,12 +1190,48 @@ void ProfileManager::beginBlock(Block& _block)
 #endif
 
     if (empty)
-    {
         beginFrame();
-        THIS_THREAD->profiledFrameOpened.store(true, std::memory_order_release);
-    }
 
     THIS_THREAD->blocks.openedList.emplace_back(_block);
+
+    if ((_block.m_status & profiler::ON) && m_isPerfCountersUsed.load(std::memory_order_relaxed) && !m_isStatisticsOnly.load(std::memory_order_relaxed))
+    {
+        // Counters are read after the block start and before it's finish to exclude profiler overhead
+        const auto desc = m_descriptors.get(_block.m_id);
+        if (desc != nullptr && desc->m_perfCounters.load(std::memory_order_relaxed))
+            THIS_THREAD->beginPerfSample(m_perfCountersMask.load(std::memory_order_relaxed), m_perfCountersGeneration.load(std::memory_order_acquire));
+    }
+}
+
+void ProfileManager::accumulateBlock(const profiler::Block& _block)
+{
+    uint16_t weight = 1;
+    if (m_isSamplingUsed.load(std::memory_order_relaxed))
+    {
+        const auto desc = m_descriptors.get(_block.id());
+        if (desc != nullptr)
+            weight = desc->samplingRate();
+    }
+
+    THIS_THREAD->statistics.add(_block.id(), _block.duration(), weight);
+}
+
+bool ProfileManager::filterBlock(const profiler::Block& _block)
+{
+    const auto desc = m_descriptors.get(_block.id());
+    if (desc == nullptr)
+        return false;
+
+    auto minDuration = desc->m_minDuration.load(std::memory_order_relaxed);
+    if (minDuration == 0)
+        minDuration = m_minBlockDuration.load(std::memory_order_relaxed);
+
+    const auto duration = _block.duration();
+    if (duration >= minDuration)
+        return false;
+
+    THIS_THREAD->storeSummary(_block.id(), duration, desc->samplingRate());
+    return true;
 }
 
 void ProfileManager::beginNonScopedBlock(const profiler::BaseBlockDescriptor* _desc, const char* _runtimeName)
@@ -967,24 +1239,43 @@ void ProfileManager::beginNonScopedBlock(const profiler::BaseBlockDescriptor* _d
     if (THIS_THREAD == nullptr)
         registerThread();
 
-    NonscopedBlock& b = THIS_THREAD->nonscopedBlocks.push(_desc, _runtimeName, false);
+    auto& fastState = THIS_THREAD->fastState;
+    if (fastState.silentBlocks != 0 || (fastState.frameOpened && m_profilerStatus.load(std::memory_order_acquire) == EASY_PROF_DISABLED))
+    {
+        // The same as profiler::beginNonScopedBlockFast() does: this block would be turned off anyway
+        ++fastState.silentBlocks;
+        return;
+    }
+
+    auto& nonscopedBlocks = THIS_THREAD->nonscopedBlocks;
+    NonscopedBlock& b = nonscopedBlocks.push(_desc, _runtimeName, false);
     beginBlock(b);
-    b.copyname();
+    b.copyname(nonscopedBlocks);
 }
 
-void ProfileManager::beginContextSwitch(profiler::thread_id_t _thread_id, profiler::timestamp_t _time, profiler::thread_id_t _target_thread_id, const char* _target_process, bool _lockSpin)
+void ProfileManager::beginContextSwitch(profiler::thread_id_t _thread_id, profiler::timestamp_t _time, profiler::thread_id_t _target_thread_id, const char* _target_process)
 {
-    auto ts = _lockSpin ? findThreadStorage(_thread_id) : _findThreadStorage(_thread_id);
+    auto ts = m_threads.find(_thread_id);
     if (ts != nullptr)
+    {
         // Dirty hack: _target_thread_id will be written to the field "block_id_t m_id"
         // and will be available calling method id().
+        profiler::guard_lock<profiler::spin_lock> lock(ts->syncSpin);
         ts->sync.openedList.emplace_back(_time, _target_thread_id, _target_process);
+    }
 }
 
 //////////////////////////////////////////////////////////////////////////
 
 void ProfileManager::endBlock()
 {
+    if (THIS_THREAD->fastState.silentBlocks != 0)
+    {
+        // Last opened block was skipped by the fast path
+        --THIS_THREAD->fastState.silentBlocks;
+        return;
+    }
+
     if (--THIS_THREAD->stackSize > 0)
     {
         THIS_THREAD->popSilent();
@@ -1005,9 +1296,34 @@ void ProfileManager::endBlock()
     Block& top = THIS_THREAD->blocks.openedList.back();
     if (top.m_status & profiler::ON)
     {
+        uint64_t counters[profiler::PERF_COUNTERS_NUMBER];
+        const uint32_t countersMask = THIS_THREAD->perfSamples.empty() ? 0 : THIS_THREAD->endPerfSample(counters);
         if (!top.finished())
             top.finish();
-        THIS_THREAD->storeBlock(top);
+        if (m_isTriggersUsed.load(std::memory_order_relaxed))
+        {
+            const auto desc = m_descriptors.get(top.id());
+            const auto trigger = desc != nullptr ? desc->m_trigger.load(std::memory_order_relaxed) : 0;
+            if (trigger != 0 && top.duration() > trigger)
+                fireTrigger(top.begin());
+        }
+        if (m_isStatisticsOnly.load(std::memory_order_relaxed))
+        {
+            accumulateBlock(top);
+        }
+        else if (!m_isFilteringUsed.load(std::memory_order_relaxed) || !filterBlock(top))
+        {
+            // Block stands for the number of calls equal to the current sampling rate of it's descriptor
+            uint16_t sampling = 1;
+            if (m_isSamplingUsed.load(std::memory_order_relaxed))
+            {
+                const auto desc = m_descriptors.get(top.id());
+                if (desc != nullptr)
+                    sampling = desc->samplingRate();
+            }
+
+            THIS_THREAD->storeBlock(top, sampling, countersMask, counters);
+        }
     }
     else
     {
@@ -1021,7 +1337,6 @@ void ProfileManager::endBlock()
     const bool empty = THIS_THREAD->blocks.openedList.empty();
     if (empty)
     {
-        THIS_THREAD->profiledFrameOpened.store(false, std::memory_order_release);
         endFrame();
 #if EASY_ENABLE_BLOCK_STATUS != 0
         THIS_THREAD->allowChildren = true;
@@ -1035,15 +1350,70 @@ void ProfileManager::endBlock()
 #endif
 }
 
-void ProfileManager::endContextSwitch(profiler::thread_id_t _thread_id, processid_t _process_id, profiler::timestamp_t _endtime, bool _lockSpin)
+void ProfileManager::endContextSwitch(profiler::thread_id_t _thread_id, processid_t _process_id, profiler::timestamp_t _endtime)
+{
+    auto ts = contextSwitchTarget(_thread_id, _process_id);
+    if (ts == nullptr)
+        return;
+
+    profiler::guard_lock<profiler::spin_lock> lock(ts->syncSpin);
+    if (ts->sync.openedList.empty())
+        return;
+
+    CSwitchBlock& lastBlock = ts->sync.openedList.back();
+    lastBlock.m_end = _endtime;
+
+    ts->storeCSwitch(lastBlock);
+    ts->sync.openedList.pop_back();
+}
+
+void ProfileManager::storeContextSwitches(profiler::thread_id_t _thread_id, const std::vector<profiler::cswitch_log::ThreadEvent>& _events)
+{
+    // Same as calling beginContextSwitch() or endContextSwitch() for each event, but thread storage is found
+    // and it's sync list is locked only once
+    auto ts = m_threads.find(_thread_id);
+    if (ts != nullptr)
+        ts->syncSpin.lock();
+
+    for (const auto& event : _events)
+    {
+        if (event.out)
+        {
+            if (ts != nullptr)
+                ts->sync.openedList.emplace_back(event.time, event.target, event.name);
+            continue;
+        }
+
+        if (ts == nullptr && event.process == m_processId)
+        {
+            ts = contextSwitchTarget(_thread_id, event.process);
+            if (ts != nullptr)
+                ts->syncSpin.lock();
+        }
+
+        if (ts == nullptr || ts->sync.openedList.empty())
+            continue;
+
+        CSwitchBlock& lastBlock = ts->sync.openedList.back();
+        lastBlock.m_end = event.time;
+
+        ts->storeCSwitch(lastBlock);
+        ts->sync.openedList.pop_back();
+    }
+
+    if (ts != nullptr)
+        ts->syncSpin.unlock();
+}
+
+ThreadsRegistry::Reference ProfileManager::contextSwitchTarget(profiler::thread_id_t _thread_id, processid_t _process_id)
 {
-    ThreadStorage* ts = nullptr;
+    ThreadsRegistry::Reference ts;
     if (_process_id == m_processId)
     {
         // Implicit thread registration.
         // If thread owned by current process then create new ThreadStorage if there is no one
 #if EASY_OPTION_IMPLICIT_THREAD_REGISTRATION != 0
-        ts = _lockSpin ? &threadStorage(_thread_id) : &_threadStorage(_thread_id);
+        ts = m_threads.findOrAdd(_thread_id);
 # if !defined(_WIN32) && !defined(EASY_THREAD_LOCAL_CPP11)
 #  if EASY_OPTION_REMOVE_EMPTY_UNGUARDED_THREADS != 0
 #   pragma message "Warning: Implicit thread registration together with removing empty unguarded threads may cause application crash because there is no possibility to check thread state (dead or alive) for pthreads and removed ThreadStorage may be reused if thread is still alive."
@@ -1056,17 +1426,10 @@ void ProfileManager::endContextSwitch(profiler::thread_id_t _thread_id, processi
     else
     {
         // If thread owned by another process OR _process_id IS UNKNOWN then do not create ThreadStorage for this
-        ts = _lockSpin ? findThreadStorage(_thread_id) : _findThreadStorage(_thread_id);
+        ts = m_threads.find(_thread_id);
     }
 
-    if (ts == nullptr || ts->sync.openedList.empty())
-        return;
-
-    CSwitchBlock& lastBlock = ts->sync.openedList.back();
-    lastBlock.m_end = _endtime;
-
-    ts->storeCSwitch(lastBlock);
-    ts->sync.openedList.pop_back();
+    return ts;
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -1076,9 +1439,21 @@ void ProfileManager::beginFrame()
     THIS_THREAD->beginFrame();
 }
 
+profiler::ThreadFastState* ProfileManager::registerThreadFastState(profiler::ThreadFastState** _cache)
+{
+    if (THIS_THREAD == nullptr)
+        registerThread();
+
+    auto& caches = THIS_THREAD->fastStateCaches;
+    if (std::find(caches.begin(), caches.end(), _cache) == caches.end())
+        caches.push_back(_cache);
+
+    return &THIS_THREAD->fastState;
+}
+
 void ProfileManager::endFrame()
 {
-    if (!THIS_THREAD->frameOpened)
+    if (!THIS_THREAD->fastState.frameOpened)
         return;
 
     const profiler::timestamp_t duration = THIS_THREAD->endFrame();
@@ -1124,6 +1499,10 @@ void ProfileManager::endFrame()
             maxDuration = 0;
 
         m_frameCur.store(duration, std::memory_order_release);
+
+        const auto frameTrigger = m_frameTrigger.load(std::memory_order_relaxed);
+        if (frameTrigger != 0 && duration > frameTrigger)
+            fireTrigger(THIS_THREAD->frameStartTime);
     }
     else if (THIS_THREAD_FRAME_T_RESET_AVG)
     {
@@ -1161,19 +1540,27 @@ profiler::timestamp_t ProfileManager::curFrameDuration() const
 
 void ProfileManager::enableEventTracer()
 {
-#ifdef _WIN32
+#if defined(_WIN32) || defined(__linux__)
     if (m_isEventTracingEnabled.load(std::memory_order_acquire))
-        EasyEventTracer::instance().enable(true);
+    {
+        const auto status = EasyEventTracer::instance().enable(true);
+        m_isEventTracerLaunched.store(status == profiler::EVENT_TRACING_LAUNCHED_SUCCESSFULLY, std::memory_order_release);
+    }
 #endif
 }
 
 void ProfileManager::disableEventTracer()
 {
-#ifdef _WIN32
+#if defined(_WIN32) || defined(__linux__)
     EasyEventTracer::instance().disable();
 #endif
 }
 
+double ProfileManager::ticksPerNanosecond()
+{
+    return ticks_per_nanosecond();
+}
+
 void ProfileManager::setEnabled(bool isEnable)
 {
     guard_lock_t lock(m_dumpSpin);
@@ -1260,20 +1647,26 @@ char ProfileManager::checkThreadExpired(ThreadStorage& _registeredThread)
 
 //////////////////////////////////////////////////////////////////////////
 
-uint32_t ProfileManager::dumpBlocksToStream(profiler::OStream& _outputStream, bool _lockSpin, bool _async)
+uint32_t ProfileManager::dumpBlocksToStream(profiler::OStream& _outputStream, bool _lockSpin, bool _async, profiler::timestamp_t _recentWindow)
 {
-    EASY_LOGMSG("dumpBlocksToStream(_lockSpin = " << _lockSpin << ")...\n");
+    EASY_LOGMSG("dumpBlocksToStream(_lockSpin = " << _lockSpin << ", _recentWindow = " << _recentWindow << ")...\n");
 
     if (_lockSpin)
         m_dumpSpin.lock();
 
+    // Dumping of recent blocks does not stop capturing (see dumpRecentToFile()) and does not modify
+    // threads storages: blocks are copied (not consumed) and threads are never removed, because
+    // profiled threads and event tracer keep working with the storages
+    const bool recent = _recentWindow != 0;
     const auto state = m_profilerStatus.load(std::memory_order_acquire);
 
 #ifndef _WIN32
-    const bool eventTracingEnabled = m_isEventTracingEnabled.load(std::memory_order_acquire);
+    // Context switch log-file of external tracer is read only if built-in event tracer has not been launched
+    const bool eventTracingEnabled = !recent && m_isEventTracingEnabled.load(std::memory_order_acquire)
+        && !m_isEventTracerLaunched.load(std::memory_order_acquire);
 #endif
 
-    if (state == EASY_PROF_ENABLED) {
+    if (!recent && state == EASY_PROF_ENABLED) {
         m_profilerStatus.store(EASY_PROF_DUMP, std::memory_order_release);
         disableEventTracer();
         m_endTime = getCurrentTime();
@@ -1292,14 +1685,25 @@ uint32_t ProfileManager::dumpBlocksToStream(profiler::OStream& _outputStream, bo
         return 0;
     }
 
-    // Wait for some time to be sure that all operations which began before setEnabled(false) will be finished.
-    // This is much better than inserting spin-lock or atomic variable check into each store operation.
-    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    // There is no need to wait for threads to finish their opened frames or for store operations in progress:
+    // closed blocks lists are lock-free queues and only fully constructed blocks are visible for dumping thread.
+    // Blocks which would be stored after taking a snapshot would stay in the storage and would be dropped
+    // by the reader (their end time is less than next capture begin time).
+    if (!recent)
+    {
+        m_profilerStatus.store(EASY_PROF_DISABLED, std::memory_order_release);
+        EASY_LOGMSG("Disabled profiling\n");
+    }
 
-    // wait for all threads finish opened frames
-    EASY_LOG_ONLY(bool logged = false);
-    for (auto it = m_threads.begin(), end = m_threads.end(); it != end;)
+#ifndef _WIN32
+    // Context switch log-file is parsed before taking m_spin because it may take a while
+    // and threads storages are not needed for that.
+    profiler::cswitch_log::threads_events_t contextSwitches;
+    if (eventTracingEnabled)
     {
+        EASY_LOGMSG("Reading context switch events...\n");
+
+        const bool opened = profiler::cswitch_log::read(m_csInfoFilename.c_str(), contextSwitches, _async ? &m_stopDumping : nullptr);
         if (_async && m_stopDumping.load(std::memory_order_acquire))
         {
             if (_lockSpin)
@@ -1307,143 +1711,164 @@ uint32_t ProfileManager::dumpBlocksToStream(profiler::OStream& _outputStream, bo
             return 0;
         }
 
-        if (!it->second.profiledFrameOpened.load(std::memory_order_acquire))
-        {
-            ++it;
-            EASY_LOG_ONLY(logged = false);
-        }
-        else
-        {
-            EASY_LOG_ONLY(
-                if (!logged)
-                {
-                    logged = true;
-                    if (it->second.named)
-                        EASY_WARNING("Waiting for thread \"" << it->second.name << "\" finish opened frame (which is top EASY_BLOCK for this thread)...\n");
-                    else
-                        EASY_WARNING("Waiting for thread " << it->first << " finish opened frame (which is top EASY_BLOCK for this thread)...\n");
-                }
-            );
-
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
-        }
-    }
-
-    m_profilerStatus.store(EASY_PROF_DISABLED, std::memory_order_release);
-
-    EASY_LOGMSG("All threads have closed frames\n");
-    EASY_LOGMSG("Disabled profiling\n");
+        EASY_LOG_ONLY(
+            if (!opened) {
+                EASY_ERROR("Can not open context switch log-file \"" << m_csInfoFilename << "\"\n");
+            }
+        )
+        (void)opened;
+    }
+#endif
 
     m_spin.lock();
-    m_storedSpin.lock();
-    // TODO: think about better solution because this one is not 100% safe...
 
     const profiler::timestamp_t now = getCurrentTime();
-    const profiler::timestamp_t endtime = m_endTime == 0 ? now : std::min(now, m_endTime);
+    const profiler::timestamp_t endtime = recent || m_endTime == 0 ? now : std::min(now, m_endTime);
+
+    // Reader drops blocks which end before capture begin time, so only the requested window would be loaded
+    const profiler::timestamp_t begintime = recent ? std::max(m_beginTime, now > _recentWindow ? now - _recentWindow : 0) : m_beginTime;
 
 #ifndef _WIN32
-    if (eventTracingEnabled)
+    if (!contextSwitches.empty())
     {
-        // Read thread context switch events from temporary file
-
-        if (_async && m_stopDumping.load(std::memory_order_acquire))
-        {
-            m_spin.unlock();
-            m_storedSpin.unlock();
-            if (_lockSpin)
-                m_dumpSpin.unlock();
-            return 0;
-        }
-
         EASY_LOGMSG("Writing context switch events...\n");
 
-        uint64_t timestamp = 0;
-        profiler::thread_id_t thread_from = 0, thread_to = 0;
-
-        std::ifstream infile(m_csInfoFilename.c_str());
-        if(infile.is_open())
+        EASY_LOG_ONLY(uint32_t num = 0);
+        for (const auto& thread : contextSwitches)
         {
-            EASY_LOG_ONLY(uint32_t num = 0);
-            std::string next_task_name;
-            pid_t process_to = 0;
-            while (infile >> timestamp >> thread_from >> thread_to >> next_task_name >> process_to)
-            {
-                if (_async && m_stopDumping.load(std::memory_order_acquire))
-                {
-                    m_spin.unlock();
-                    m_storedSpin.unlock();
-                    if (_lockSpin)
-                        m_dumpSpin.unlock();
-                    return 0;
-                }
-
-                beginContextSwitch(thread_from, timestamp, thread_to, next_task_name.c_str(), false);
-                endContextSwitch(thread_to, (processid_t)process_to, timestamp, false);
-                EASY_LOG_ONLY(++num);
-            }
-
-            EASY_LOGMSG("Done, " << num << " context switch events wrote\n");
+            storeContextSwitches(thread.first, thread.second);
+            EASY_LOG_ONLY(num += static_cast<uint32_t>(thread.second.size()));
         }
-        EASY_LOG_ONLY(
-            else {
-                EASY_ERROR("Can not open context switch log-file \"" << m_csInfoFilename << "\"\n");
-            }
-        )
+
+        EASY_LOGMSG("Done, " << num / 2 << " context switch events wrote\n");
     }
 #endif
 
+    // Drop flushed blocks which can not be read back before counting blocks of each thread for the file header
+    const auto droppedBlocks = m_spillRing.validate();
+    if (droppedBlocks != 0)
+        EASY_WARNING(droppedBlocks << " flushed blocks have been lost because spill files can not be read\n");
+    (void)droppedBlocks;
+
     bool mainThreadExpired = false;
 
+    // Recent blocks dump skips blocks and context switches which the reader would drop
+    // (see fillTreesFromFile()), so threads headers match the records written
+    const auto blockInWindow = [begintime](const char* _data) { return record_end(_data) >= begintime; };
+    const auto cswitchInWindow = [begintime](const char* _data) { return record_end(_data) > begintime; };
+    const profiler::timestamp_t spilledBegin = recent ? begintime : 0;
+
+    struct ThreadSnapshot
+    {
+        decltype(ThreadStorage::blocks.closedList)::position blocksEnd;
+        decltype(ThreadStorage::sync.closedList)::position     syncEnd;
+        std::vector<std::pair<profiler::block_id_t, BlockSummary> > summaries;
+        ThreadStorage* thread = nullptr;
+        uint32_t index = 0;
+        uint32_t blocksNumber = 0;
+        uint32_t syncNumber = 0;
+    };
+
+    // Positions of the last published elements for each thread: only these elements would be written.
+    // Threads registered after taking snapshots would be written during the next dump.
+    std::vector<ThreadSnapshot> snapshots;
+    snapshots.reserve(m_threads.size());
+
     // Calculate used memory total size and total blocks number
     uint64_t usedMemorySize = 0;
     uint32_t blocks_number = 0;
-    for (auto it = m_threads.begin(), end = m_threads.end(); it != end;)
+    for (uint32_t index = 0, threadsNumber = m_threads.size(); index < threadsNumber; ++index)
     {
         if (_async && m_stopDumping.load(std::memory_order_acquire))
         {
             m_spin.unlock();
-            m_storedSpin.unlock();
             if (_lockSpin)
                 m_dumpSpin.unlock();
             return 0;
         }
 
-        auto& t = it->second;
-        uint32_t num = static_cast<uint32_t>(t.blocks.closedList.size()) + static_cast<uint32_t>(t.sync.closedList.size());
+        auto thread = m_threads.get(index);
+        if (thread == nullptr)
+            continue;
+
+        auto& t = *thread;
+
+        uint32_t spilledBlocksNumber = 0;
+        uint64_t spilledMemorySize = 0;
+        m_spillRing.threadInfo(&t, spilledBlocksNumber, spilledMemorySize, spilledBegin);
+
+        ThreadSnapshot snapshot;
+        snapshot.thread = thread;
+        snapshot.index = index;
+        uint64_t memorySize = spilledMemorySize;
+        if (recent)
+        {
+            uint64_t publishedSize = 0;
+            t.blocks.closedList.published(snapshot.blocksEnd, publishedSize);
+            t.sync.closedList.published(snapshot.syncEnd, publishedSize);
+            snapshot.blocksNumber = t.blocks.closedList.count_if(snapshot.blocksEnd, memorySize, blockInWindow);
+            snapshot.syncNumber = t.sync.closedList.count_if(snapshot.syncEnd, memorySize, cswitchInWindow);
+            t.copySummaries(snapshot.summaries);
+        }
+        else
+        {
+            snapshot.blocksNumber = t.blocks.closedList.published(snapshot.blocksEnd, memorySize);
+            snapshot.syncNumber = t.sync.closedList.published(snapshot.syncEnd, memorySize);
+            t.takeSummaries(snapshot.summaries);
+        }
+
+        uint32_t num = snapshot.blocksNumber + snapshot.syncNumber + spilledBlocksNumber;
+        const bool empty = num == 0 && snapshot.summaries.empty();
+        if (recent)
+        {
+            // Threads are removed and marked expired only by full dumps
+            snapshots.push_back(std::move(snapshot));
+            usedMemorySize += memorySize;
+            blocks_number += num;
+            continue;
+        }
+
         const char expired = ProfileManager::checkThreadExpired(t);
 
 #ifdef _WIN32
-        if (num == 0 && expired != 0)
+        if (empty && expired != 0)
 #elif defined(EASY_THREAD_LOCAL_CPP11)
         // Removing !guarded thread when thread_local feature is supported is safe.
-        if (num == 0 && (expired != 0 || !t.guarded))
+        if (empty && (expired != 0 || !t.guarded))
 #elif EASY_OPTION_REMOVE_EMPTY_UNGUARDED_THREADS != 0
 # pragma message "Warning: Removing !guarded thread without thread_local support may cause an application crash, but fixes potential memory leak when using pthreads."
         // Removing !guarded thread may cause an application crash if a thread would start to write blocks after ThreadStorage remove.
         // TODO: Find solution to check thread state for pthread or to nullify THIS_THREAD pointer for removed ThreadStorage
-        if (num == 0 && (expired != 0 || !t.guarded))
+        if (empty && (expired != 0 || !t.guarded))
 #else
 # pragma message "Warning: Can not check pthread state (dead or alive). This may cause memory leak because ThreadStorage-s would not be removed ever during an application launched."
-        if (num == 0 && expired != 0)
+        if (empty && expired != 0)
 #endif
         {
             // Remove thread if it contains no profiled information and has been finished (or is not guarded --deprecated).
-            profiler::thread_id_t id = it->first;
+            profiler::thread_id_t id = t.id;
             if (!mainThreadExpired && m_mainThreadId.compare_exchange_weak(id, 0, std::memory_order_release, std::memory_order_acquire))
                 mainThreadExpired = true;
-            m_threads.erase(it++);
+            m_threads.remove(index);
             continue;
         }
 
         if (expired == 1)
         {
+            // The thread is dead, so it is safe to store an event into its storage from this thread
+            // (blocks list is single-producer: it's owner would never store blocks anymore)
             EASY_FORCE_EVENT3(t, endtime, "ThreadExpired", EASY_COLOR_THREAD_END);
-            ++num;
+
+            // Take the snapshot again to include this event
+            memorySize = spilledMemorySize;
+            snapshot.blocksNumber = t.blocks.closedList.published(snapshot.blocksEnd, memorySize);
+            snapshot.syncNumber = t.sync.closedList.published(snapshot.syncEnd, memorySize);
+            num = snapshot.blocksNumber + snapshot.syncNumber + spilledBlocksNumber;
         }
 
-        usedMemorySize += t.blocks.usedMemorySize + t.sync.usedMemorySize;
+        snapshots.push_back(std::move(snapshot));
+        usedMemorySize += memorySize;
         blocks_number += num;
-        ++it;
     }
 
     // Write profiler signature and version
@@ -1452,88 +1877,154 @@ uint32_t ProfileManager::dumpBlocksToStream(profiler::OStream& _outputStream, bo
     _outputStream.write(m_processId);
 
     // Write CPU frequency to let GUI calculate real time value from CPU clocks
+    // and it's drift measured since profiler start (in parts per billion)
 #if defined(EASY_CHRONO_CLOCK) || defined(_WIN32)
-    _outputStream.write(CPU_FREQUENCY);
+    _outputStream.write(static_cast<int64_t>(CPU_FREQUENCY));
+    _outputStream.write(int64_t(0));
 #else
-    EASY_LOGMSG("Calculating CPU frequency\n");
-    const int64_t cpu_frequency = calculate_cpu_frequency();
-    _outputStream.write(cpu_frequency * 1000LL);
-    EASY_LOGMSG("Done calculating CPU frequency\n");
-
-    CPU_FREQUENCY.store(cpu_frequency, std::memory_order_release);
+    _outputStream.write(m_clock.frequency() * 1000LL);
+    _outputStream.write(m_clock.drift());
 #endif
 
     // Write begin and end time
-    _outputStream.write(m_beginTime);
-    _outputStream.write(m_endTime);
+    _outputStream.write(begintime);
+    _outputStream.write(recent ? endtime : m_endTime);
 
     // Write blocks number and used memory size
     _outputStream.write(blocks_number);
     _outputStream.write(usedMemorySize);
-    _outputStream.write(static_cast<uint32_t>(m_descriptors.size()));
-    _outputStream.write(m_usedMemorySize);
+
+    // Descriptors registration is blocked only while writing descriptors.
+    // All blocks from snapshots refer to descriptors registered before taking snapshots.
+    m_descriptors.lock();
+    const auto descriptorsNumber = m_descriptors.size();
+    _outputStream.write(descriptorsNumber);
+    _outputStream.write(m_usedMemorySize.load(std::memory_order_relaxed));
 
     // Write block descriptors
-    for (const auto descriptor : m_descriptors)
+    for (uint32_t i = 0; i < descriptorsNumber; ++i)
     {
+        const auto descriptor = m_descriptors.get(i);
         const auto name_size = descriptor->nameSize();
         const auto filename_size = descriptor->filenameSize();
         const auto size = static_cast<uint16_t>(sizeof(profiler::SerializedBlockDescriptor) + name_size + filename_size);
 
+        // Current sampling rate is written: stored blocks keep the rate they have been sampled with
+        profiler::BaseBlockDescriptor base(*descriptor);
+        base.m_sampling = descriptor->samplingRate();
+
         _outputStream.write(size);
-        _outputStream.write<profiler::BaseBlockDescriptor>(*descriptor);
+        _outputStream.write(base);
         _outputStream.write(name_size);
         _outputStream.write(descriptor->name(), name_size);
         _outputStream.write(descriptor->filename(), filename_size);
     }
+    m_descriptors.unlock();
 
     // Write blocks and context switch events for each thread
-    for (auto it = m_threads.begin(), end = m_threads.end(); it != end;)
+    uint32_t spilledBlocksWritten = 0;
+    for (const auto& snapshot : snapshots)
     {
         if (_async && m_stopDumping.load(std::memory_order_acquire))
         {
             m_spin.unlock();
-            m_storedSpin.unlock();
             if (_lockSpin)
                 m_dumpSpin.unlock();
             return 0;
         }
 
-        auto& t = it->second;
+        auto& t = *snapshot.thread;
 
-        _outputStream.write(it->first);
+        _outputStream.write(t.id);
 
         const auto name_size = static_cast<uint16_t>(t.name.size() + 1);
         _outputStream.write(name_size);
         _outputStream.write(name_size > 1 ? t.name.c_str() : "", name_size);
 
-        _outputStream.write(t.sync.closedList.size());
-        if (!t.sync.closedList.empty())
-            t.sync.closedList.serialize(_outputStream);
+        _outputStream.write(snapshot.syncNumber);
+        if (snapshot.syncNumber != 0)
+        {
+            profiler::compact::PacketWriter packets(_outputStream, true);
+            const auto add = [&packets](const char* _data, uint16_t _size) { packets.add(_data, _size); };
+            if (recent)
+                t.sync.closedList.read(snapshot.syncEnd, [&](const char* _data, uint16_t _size) { if (cswitchInWindow(_data)) add(_data, _size); });
+            else
+                t.sync.closedList.consume(snapshot.syncEnd, add);
+        }
 
-        _outputStream.write(t.blocks.closedList.size());
-        if (!t.blocks.closedList.empty())
-            t.blocks.closedList.serialize(_outputStream);
+        uint32_t spilledBlocksNumber = 0;
+        uint64_t spilledMemorySize = 0;
+        m_spillRing.threadInfo(&t, spilledBlocksNumber, spilledMemorySize, spilledBegin);
+
+        _outputStream.write(snapshot.blocksNumber + spilledBlocksNumber);
+        if (spilledBlocksNumber != 0 && !m_spillRing.writeThread(&t, _outputStream, spilledBegin))
+            EASY_ERROR("Can not read flushed blocks of thread " << t.id << " from spill files: output file is corrupted\n");
+        spilledBlocksWritten += spilledBlocksNumber;
+        if (snapshot.blocksNumber != 0)
+        {
+            profiler::compact::PacketWriter packets(_outputStream, false);
+            const auto add = [&packets](const char* _data, uint16_t _size) { packets.add(_data, _size); };
+            if (recent)
+                t.blocks.closedList.read(snapshot.blocksEnd, [&](const char* _data, uint16_t _size) { if (blockInWindow(_data)) add(_data, _size); });
+            else
+                t.blocks.closedList.consume(snapshot.blocksEnd, add);
+        }
+
+        // Write summaries of blocks filtered out by minimum duration: (block id, calls number, total duration)
+        _outputStream.write(static_cast<uint32_t>(snapshot.summaries.size()));
+        for (const auto& summary : snapshot.summaries)
+        {
+            _outputStream.write(summary.first);
+            _outputStream.write(summary.second.count);
+            _outputStream.write(summary.second.duration);
+        }
+
+        // Write interned runtime names referenced by blocks of this thread
+        t.runtimeNames.serialize(_outputStream);
+
+        if (recent)
+            continue;
+
+        // Owner thread will start new names table generation (only current and previous ones are kept)
+        t.runtimeNames.requestReset();
 
-        t.clearClosed();
         //t.blocks.openedList.clear();
+        t.syncSpin.lock();
         t.sync.openedList.clear();
+        t.syncSpin.unlock();
 
         if (t.expired.load(std::memory_order_acquire) != 0)
         {
             // Remove expired thread after writing all profiled information
-            profiler::thread_id_t id = it->first;
+            profiler::thread_id_t id = t.id;
             if (!mainThreadExpired && m_mainThreadId.compare_exchange_weak(id, 0, std::memory_order_release, std::memory_order_acquire))
                 mainThreadExpired = true;
-            m_threads.erase(it++);
+            m_threads.remove(snapshot.index);
+        }
+    }
+
+    if (!recent && m_spillRing.isOpen())
+    {
+        // Threads are not removed while they have flushed blocks, so every flushed block is expected to be written
+        const auto orphanedBlocks = m_spillRing.blocksNumber() - spilledBlocksWritten;
+        if (orphanedBlocks != 0)
+            EASY_WARNING(orphanedBlocks << " flushed blocks have been lost because their threads have been removed\n");
+        (void)orphanedBlocks;
+
+        // All flushed blocks have been written: spill files could be reused (or removed if streaming has been stopped)
+        if (m_isStreaming.load(std::memory_order_acquire))
+        {
+            const auto lostBlocks = m_spillRing.clear();
+            if (lostBlocks != 0)
+                EASY_WARNING(lostBlocks << " flushed blocks have been lost because spill files ring has been overflowed\n");
+            (void)lostBlocks;
         }
         else
         {
-            ++it;
+            m_spillRing.close();
         }
     }
 
-    m_storedSpin.unlock();
     m_spin.unlock();
 
     if (_lockSpin)
@@ -1555,27 +2046,169 @@ uint32_t ProfileManager::dumpBlocksToFile(const char* _filename)
         return 0;
     }
 
-    profiler::OStream outputStream;
+    uint32_t blocksNumber = 0;
+    if (m_isCompressionEnabled.load(std::memory_order_acquire))
+    {
+        // Compression requires the whole data in memory: chunks are compressed in parallel
+        profiler::OStream plainStream;
+        blocksNumber = dumpBlocksToStream(plainStream, true, false);
+
+        profiler::OStream outputStream(outputFile);
+        profiler::compression::compress(plainStream, outputStream);
+        outputStream.flush();
+    }
+    else
+    {
+        // Write data directly to file
+        profiler::OStream outputStream(outputFile);
+        blocksNumber = dumpBlocksToStream(outputStream, true, false);
+        outputStream.flush();
+    }
+
+    EASY_LOGMSG("Done dumpBlocksToFile()\n");
 
-    // Replace outputStream buffer to outputFile buffer to avoid redundant copying
-    typedef ::std::basic_iostream<std::stringstream::char_type, std::stringstream::traits_type> stringstream_parent;
-    stringstream_parent& s = outputStream.stream();
-    auto oldbuf = s.rdbuf(outputFile.rdbuf());
+    return blocksNumber;
+}
 
-    // Write data directly to file
-    const auto blocksNumber = dumpBlocksToStream(outputStream, true, false);
+void ProfileManager::setStatisticsOnly(bool _isEnable)
+{
+    m_isStatisticsOnly.store(_isEnable, std::memory_order_release);
+}
 
-    // Restore old outputStream buffer to avoid possible second memory free on stringstream destructor
-    s.rdbuf(oldbuf);
+bool ProfileManager::isStatisticsOnly() const
+{
+    return m_isStatisticsOnly.load(std::memory_order_acquire);
+}
 
-    EASY_LOGMSG("Done dumpBlocksToFile()\n");
+static void write_json_string(std::ostream& _output, const char* _str)
+{
+    _output << '"';
+    for (; *_str != 0; ++_str)
+    {
+        const char c = *_str;
+        if (c == '"' || c == '\\')
+            _output << '\\' << c;
+        else if (static_cast<unsigned char>(c) < 0x20)
+            _output << ' ';
+        else
+            _output << c;
+    }
+    _output << '"';
+}
+
+uint32_t ProfileManager::dumpStatisticsToFile(const char* _filename)
+{
+    EASY_LOGMSG("dumpStatisticsToFile(\"" << _filename << "\")...\n");
+
+    std::ofstream outputFile(_filename);
+    if (!outputFile.is_open())
+    {
+        EASY_ERROR("Can not open \"" << _filename << "\" for writing\n");
+        return 0;
+    }
+
+    // Merge accumulators of all threads. Owner threads continue to update their accumulators meanwhile.
+    std::unordered_map<profiler::block_id_t, MergedStatistics> merged;
+
+    m_spin.lock();
+
+    for (uint32_t index = 0, threadsNumber = m_threads.size(); index < threadsNumber; ++index)
+    {
+        auto thread = m_threads.get(index);
+        if (thread == nullptr)
+            continue;
+
+        auto& t = *thread;
+
+        decltype(t.blocks.closedList)::position blocksEnd;
+        decltype(t.sync.closedList)::position syncEnd;
+        uint64_t memorySize = 0;
+        uint32_t spilledBlocksNumber = 0;
+        m_spillRing.threadInfo(&t, spilledBlocksNumber, memorySize);
+        const bool empty = spilledBlocksNumber == 0 && t.blocks.closedList.published(blocksEnd, memorySize) == 0
+            && t.sync.closedList.published(syncEnd, memorySize) == 0;
+
+        if (empty && ProfileManager::checkThreadExpired(t) != 0)
+        {
+            // Thread is finished and has nothing to dump: keep it's statistics and remove the storage,
+            // so memory usage does not grow when threads are created and finished continuously.
+            t.statistics.forEach([this](profiler::block_id_t _id, const BlockAccumulator& _accumulator) {
+                m_retiredStatistics[_id].merge(_accumulator);
+            });
+
+            profiler::thread_id_t id = t.id;
+            m_mainThreadId.compare_exchange_strong(id, 0, std::memory_order_release, std::memory_order_acquire);
+            m_threads.remove(index);
+            continue;
+        }
+
+        t.statistics.forEach([&merged](profiler::block_id_t _id, const BlockAccumulator& _accumulator) {
+            merged[_id].merge(_accumulator);
+        });
+    }
+
+    for (const auto& retired : m_retiredStatistics)
+        merged[retired.first].merge(retired.second);
+
+    m_spin.unlock();
+
+    std::vector<profiler::block_id_t> ids;
+    ids.reserve(merged.size());
+    for (const auto& statistics : merged)
+        ids.push_back(statistics.first);
+    std::sort(ids.begin(), ids.end());
+
+    outputFile << "{\n  \"version\": \"" << EASY_PROFILER_PRODUCT_VERSION << "\",\n  \"pid\": " << m_processId << ",\n  \"blocks\": [";
+
+    uint32_t blocksNumber = 0;
+    for (auto id : ids)
+    {
+        const auto desc = m_descriptors.get(id);
+        if (desc == nullptr)
+            continue;
+
+        const auto& statistics = merged[id];
+        if (statistics.count == 0)
+            continue;
+
+        outputFile << (blocksNumber++ == 0 ? "\n    {" : ",\n    {");
+        outputFile << "\"id\": " << id << ", \"name\": ";
+        write_json_string(outputFile, desc->name());
+        outputFile << ", \"file\": ";
+        write_json_string(outputFile, desc->filename());
+        outputFile << ", \"line\": " << desc->line()
+                   << ", \"count\": " << statistics.count
+                   << ", \"total_ns\": " << ticks_to_nanoseconds(statistics.total)
+                   << ", \"min_ns\": " << ticks_to_nanoseconds(statistics.min)
+                   << ", \"max_ns\": " << ticks_to_nanoseconds(statistics.max)
+                   << ", \"histogram\": [";
+
+        // Non-empty buckets only: [lower bound (ns), count]
+        bool first = true;
+        for (uint16_t i = 0; i < HISTOGRAM_BUCKETS; ++i)
+        {
+            if (statistics.buckets[i] == 0)
+                continue;
+
+            outputFile << (first ? "[" : ", [") << ticks_to_nanoseconds(histogram_bucket_lower_bound(i)) << ", " << statistics.buckets[i] << "]";
+            first = false;
+        }
+
+        outputFile << "]}";
+    }
+
+    outputFile << "\n  ]\n}\n";
+
+    EASY_LOGMSG("Done dumpStatisticsToFile(). Dumped statistics of " << blocksNumber << " block descriptors\n");
 
     return blocksNumber;
 }
 
 void ProfileManager::registerThread()
 {
-    THIS_THREAD = &threadStorage(getCurrentThreadId());
+    // Own storage is removed only after it has expired (THIS_THREAD is reset at that moment),
+    // so it is safe to keep raw pointer without holding the reference.
+    THIS_THREAD = m_threads.findOrAdd(getCurrentThreadId()).get();
 
 #ifdef EASY_THREAD_LOCAL_CPP11
     THIS_THREAD->guarded = true;
@@ -1586,7 +2219,7 @@ void ProfileManager::registerThread()
 const char* ProfileManager::registerThread(const char* name, ThreadGuard& threadGuard)
 {
     if (THIS_THREAD == nullptr)
-        THIS_THREAD = &threadStorage(getCurrentThreadId());
+        THIS_THREAD = m_threads.findOrAdd(getCurrentThreadId()).get();
 
     THIS_THREAD->guarded = true;
     if (!THIS_THREAD->named)
@@ -1617,7 +2250,7 @@ const char* ProfileManager::registerThread(const char* name, ThreadGuard& thread
 const char* ProfileManager::registerThread(const char* name)
 {
     if (THIS_THREAD == nullptr)
-        THIS_THREAD = &threadStorage(getCurrentThreadId());
+        THIS_THREAD = m_threads.findOrAdd(getCurrentThreadId()).get();
 
     if (!THIS_THREAD->named)
     {
@@ -1644,12 +2277,67 @@ void ProfileManager::setBlockStatus(block_id_t _id, EasyBlockStatus _status)
     if (m_profilerStatus.load(std::memory_order_acquire) != EASY_PROF_DISABLED)
         return; // Changing blocks statuses is restricted while profile session is active
 
-    guard_lock_t lock(m_storedSpin);
-    if (_id < m_descriptors.size())
-    {
-        auto desc = m_descriptors[_id];
-        lock.unlock();
+    auto desc = m_descriptors.get(_id);
+    if (desc != nullptr)
         desc->m_status = _status;
+}
+
+void ProfileManager::setBlockSampling(block_id_t _id, uint16_t _sampling)
+{
+    // Rate could be changed during profile session: each stored block keeps the rate it was sampled with
+    auto desc = m_descriptors.get(_id);
+    if (desc != nullptr)
+    {
+        desc->m_samplingRate.store(_sampling, std::memory_order_relaxed);
+        if (_sampling > 1)
+            m_isSamplingUsed.store(true, std::memory_order_release);
+    }
+}
+
+uint32_t ProfileManager::setPerfCounters(uint32_t _mask)
+{
+    _mask &= (1U << profiler::PERF_COUNTERS_NUMBER) - 1;
+
+    // Check which counters are available (hardware counters are usually not available on VMs)
+    PerfCounters counters;
+    const auto available = _mask != 0 ? counters.open(_mask) : 0U;
+    if (available != _mask)
+        EASY_WARNING("Some of requested performance counters are not available: requested 0x" << std::hex << _mask << ", available 0x" << available << std::dec << "\n");
+
+    m_perfCountersMask.store(available, std::memory_order_relaxed);
+    m_perfCountersGeneration.fetch_add(1, std::memory_order_release);
+
+    return available;
+}
+
+void ProfileManager::setBlockPerfCounters(block_id_t _id, bool _isEnable)
+{
+    auto desc = m_descriptors.get(_id);
+    if (desc != nullptr)
+    {
+        desc->m_perfCounters.store(_isEnable, std::memory_order_relaxed);
+        if (_isEnable)
+            m_isPerfCountersUsed.store(true, std::memory_order_release);
+    }
+}
+
+void ProfileManager::setMinBlockDuration(profiler::timestamp_t _nanoseconds)
+{
+    const auto ticks = nanoseconds_to_ticks(_nanoseconds);
+    m_minBlockDuration.store(ticks, std::memory_order_release);
+    if (ticks != 0)
+        m_isFilteringUsed.store(true, std::memory_order_release);
+}
+
+void ProfileManager::setBlockMinDuration(block_id_t _id, profiler::timestamp_t _nanoseconds)
+{
+    auto desc = m_descriptors.get(_id);
+    if (desc != nullptr)
+    {
+        const auto ticks = nanoseconds_to_ticks(_nanoseconds);
+        desc->m_minDuration.store(ticks, std::memory_order_release);
+        if (ticks != 0)
+            m_isFilteringUsed.store(true, std::memory_order_release);
     }
 }
 
@@ -1679,6 +2367,374 @@ bool ProfileManager::isListening() const
 
 //////////////////////////////////////////////////////////////////////////
 
+bool ProfileManager::startStreaming(const char* _filenamePrefix, uint64_t _memoryBudget, uint32_t _segmentsNumber, uint64_t _segmentSize)
+{
+    stopStreaming();
+    stopFlightRecording();
+
+    {
+        guard_lock_t lock(m_spin);
+
+        // Blocks flushed during previous streaming session are kept until the next dump
+        if (m_spillRing.isOpen() && !m_spillRing.empty())
+        {
+            if (!m_spillRing.isOpenedWith(_filenamePrefix, _segmentsNumber, _segmentSize))
+            {
+                EASY_ERROR("Can not start streaming into \"" << _filenamePrefix << "\": spill files of the previous streaming session"
+                           " contain blocks which have not been dumped yet. Dump blocks first or use the same spill files parameters\n");
+                return false;
+            }
+        }
+        else
+        {
+            if (!m_spillRing.open(_filenamePrefix, _segmentsNumber, _segmentSize))
+            {
+                EASY_ERROR("Can not open spill file \"" << _filenamePrefix << ".0.spill\" for writing\n");
+                return false;
+            }
+        }
+    }
+
+    m_memoryBudget.store(_memoryBudget, std::memory_order_release);
+    m_stopFlush.store(false, std::memory_order_release);
+    m_isStreaming.store(true, std::memory_order_release);
+    m_flushThread = std::thread(&ProfileManager::flushLoop, this);
+
+    EASY_LOGMSG("Streaming started\n");
+
+    return true;
+}
+
+void ProfileManager::stopStreaming()
+{
+    if (!m_isStreaming.exchange(false, std::memory_order_acq_rel))
+        return;
+
+    m_stopFlush.store(true, std::memory_order_release);
+    if (m_flushThread.joinable())
+        m_flushThread.join();
+
+    EASY_LOGMSG("Streaming stopped\n");
+}
+
+bool ProfileManager::isStreaming() const
+{
+    return m_isStreaming.load(std::memory_order_acquire);
+}
+
+void ProfileManager::startFlightRecording(uint64_t _threadMemoryBudget)
+{
+    stopStreaming();
+    stopFlightRecording();
+
+    m_memoryBudget.store(_threadMemoryBudget, std::memory_order_release);
+    m_stopFlush.store(false, std::memory_order_release);
+    m_isFlightRecording.store(true, std::memory_order_release);
+    m_flushThread = std::thread(&ProfileManager::recordLoop, this);
+
+    EASY_LOGMSG("Flight recording started\n");
+}
+
+void ProfileManager::stopFlightRecording()
+{
+    if (!m_isFlightRecording.exchange(false, std::memory_order_acq_rel))
+        return;
+
+    m_stopFlush.store(true, std::memory_order_release);
+    if (m_flushThread.joinable())
+        m_flushThread.join();
+
+    EASY_LOGMSG("Flight recording stopped\n");
+}
+
+bool ProfileManager::isFlightRecording() const
+{
+    return m_isFlightRecording.load(std::memory_order_acquire);
+}
+
+uint32_t ProfileManager::dumpRecentToFile(const char* _filename, uint32_t _windowMs)
+{
+    EASY_LOGMSG("dumpRecentToFile(\"" << _filename << "\", " << _windowMs << ")...\n");
+    return dumpWindowToFile(_filename, nanoseconds_to_ticks(static_cast<profiler::timestamp_t>(_windowMs) * 1000000ULL));
+}
+
+uint32_t ProfileManager::dumpWindowToFile(const char* _filename, profiler::timestamp_t _window)
+{
+    std::ofstream outputFile(_filename, std::fstream::binary);
+    if (!outputFile.is_open())
+    {
+        EASY_ERROR("Can not open \"" << _filename << "\" for writing\n");
+        return 0;
+    }
+
+    const auto window = std::max(_window, profiler::timestamp_t(1));
+
+    uint32_t blocksNumber = 0;
+    if (m_isCompressionEnabled.load(std::memory_order_acquire))
+    {
+        profiler::OStream plainStream;
+        blocksNumber = dumpBlocksToStream(plainStream, true, false, window);
+
+        profiler::OStream outputStream(outputFile);
+        profiler::compression::compress(plainStream, outputStream);
+        outputStream.flush();
+    }
+    else
+    {
+        profiler::OStream outputStream(outputFile);
+        blocksNumber = dumpBlocksToStream(outputStream, true, false, window);
+        outputStream.flush();
+    }
+
+    EASY_LOGMSG("Done dumpWindowToFile()\n");
+
+    return blocksNumber;
+}
+
+void ProfileManager::setFrameTrigger(profiler::timestamp_t _nanoseconds)
+{
+    const auto ticks = nanoseconds_to_ticks(_nanoseconds);
+    m_frameTrigger.store(ticks, std::memory_order_release);
+    if (ticks != 0)
+        startTriggers();
+}
+
+void ProfileManager::setBlockTrigger(block_id_t _id, profiler::timestamp_t _nanoseconds)
+{
+    auto desc = m_descriptors.get(_id);
+    if (desc != nullptr)
+    {
+        const auto ticks = nanoseconds_to_ticks(_nanoseconds);
+        desc->m_trigger.store(ticks, std::memory_order_release);
+        if (ticks != 0)
+            startTriggers();
+    }
+}
+
+void ProfileManager::setTriggerOutput(const char* _filenamePrefix, uint32_t _marginMs)
+{
+    guard_lock_t lock(m_triggerSpin);
+    m_triggerFilenamePrefix = _filenamePrefix;
+    m_triggerMargin.store(_marginMs, std::memory_order_release);
+}
+
+void ProfileManager::startTriggers()
+{
+    // Thread is started once and lives until profiler destruction: zero thresholds just stop firing
+    if (!m_isTriggersUsed.exchange(true, std::memory_order_acq_rel))
+    {
+        m_stopTriggers.store(false, std::memory_order_release);
+        m_triggerThread = std::thread(&ProfileManager::triggerLoop, this);
+    }
+}
+
+void ProfileManager::fireTrigger(profiler::timestamp_t _beginTime)
+{
+    if (m_profilerStatus.load(std::memory_order_acquire) != EASY_PROF_ENABLED)
+        return;
+
+    // Only the first slow frame is remembered until the triggers thread takes it:
+    // following ones would be written into the same file anyway.
+    profiler::timestamp_t pending = 0;
+    m_triggerTime.compare_exchange_strong(pending, std::max(_beginTime, profiler::timestamp_t(1)), std::memory_order_acq_rel, std::memory_order_relaxed);
+}
+
+bool ProfileManager::setClockSource(profiler::ClockSource _source)
+{
+#if defined(EASY_SELECTABLE_CLOCK_SOURCE) && !defined(EASY_CHRONO_CLOCK)
+    if (!is_clock_source_available(_source))
+    {
+        EASY_WARNING("Clock source " << (int)_source << " is not available\n");
+        return false;
+    }
+
+    // Timestamps of different sources are not comparable: only blocks of the same source must be captured together
+    guard_lock_t lock(m_dumpSpin);
+    if (m_profilerStatus.load(std::memory_order_acquire) != EASY_PROF_DISABLED)
+    {
+        EASY_WARNING("Can not change clock source while capturing\n");
+        return false;
+    }
+
+    if (CLOCK_SOURCE.exchange(_source, std::memory_order_acq_rel) != _source)
+    {
+        TIME_FUNCTION.store(timeFunction(_source), std::memory_order_release);
+        m_clock.start();
+    }
+
+    return true;
+#else
+    return _source == profiler::CLOCK_SOURCE_DEFAULT;
+#endif
+}
+
+profiler::ClockSource ProfileManager::clockSource() const
+{
+#if defined(EASY_SELECTABLE_CLOCK_SOURCE) && !defined(EASY_CHRONO_CLOCK)
+    return static_cast<profiler::ClockSource>(CLOCK_SOURCE.load(std::memory_order_acquire));
+#else
+    return profiler::CLOCK_SOURCE_DEFAULT;
+#endif
+}
+
+void ProfileManager::setCompressionEnabled(bool _isEnable)
+{
+    m_isCompressionEnabled.store(_isEnable, std::memory_order_release);
+}
+
+bool ProfileManager::isCompressionEnabled() const
+{
+    return m_isCompressionEnabled.load(std::memory_order_acquire);
+}
+
+uint64_t ProfileManager::residentMemorySize()
+{
+    guard_lock_t lock(m_spin);
+
+    uint64_t memorySize = 0;
+    for (uint32_t index = 0, threadsNumber = m_threads.size(); index < threadsNumber; ++index)
+    {
+        auto thread = m_threads.get(index);
+        if (thread != nullptr)
+            memorySize += thread->blocks.closedList.resident_size() + thread->sync.closedList.resident_size();
+    }
+
+    return memorySize;
+}
+
+void ProfileManager::recordLoop()
+{
+    EASY_THREAD_SCOPE("EasyProfiler.Record");
+
+    while (!m_stopFlush.load(std::memory_order_acquire))
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+        if (m_profilerStatus.load(std::memory_order_acquire) != EASY_PROF_ENABLED)
+            continue;
+
+        const auto threadMemoryBudget = m_memoryBudget.load(std::memory_order_acquire);
+
+        guard_lock_t lock(m_spin);
+        for (uint32_t index = 0, threadsNumber = m_threads.size(); index < threadsNumber; ++index)
+        {
+            auto thread = m_threads.get(index);
+            if (thread != nullptr)
+            {
+                // Drop the oldest blocks: only the most recent blocks fit into the budget
+                thread->blocks.closedList.trim(threadMemoryBudget);
+                thread->sync.closedList.trim(threadMemoryBudget);
+            }
+        }
+    }
+}
+
+static std::string trigger_timestamp()
+{
+    const auto now = std::chrono::system_clock::now();
+    const auto time = std::chrono::system_clock::to_time_t(now);
+    const auto ms = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count() % 1000);
+
+    std::tm local;
+#ifdef _WIN32
+    localtime_s(&local, &time);
+#else
+    localtime_r(&time, &local);
+#endif
+
+    char buffer[32];
+    const auto length = std::strftime(buffer, sizeof(buffer), "%Y%m%d-%H%M%S", &local);
+    snprintf(buffer + length, sizeof(buffer) - length, "-%03d", ms);
+
+    return buffer;
+}
+
+void ProfileManager::triggerLoop()
+{
+    EASY_THREAD_SCOPE("EasyProfiler.Trigger");
+
+    while (!m_stopTriggers.load(std::memory_order_acquire))
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+        // Take the request before dumping: slow frame which happens during dump would be written into the next file
+        const auto beginTime = m_triggerTime.exchange(0, std::memory_order_acq_rel);
+        if (beginTime == 0)
+            continue;
+
+        std::string filename;
+        {
+            guard_lock_t lock(m_triggerSpin);
+            filename = m_triggerFilenamePrefix;
+        }
+        filename += "." + trigger_timestamp() + ".prof";
+
+        const auto margin = nanoseconds_to_ticks(static_cast<profiler::timestamp_t>(m_triggerMargin.load(std::memory_order_acquire)) * 1000000ULL);
+        const auto windowBegin = beginTime > margin ? beginTime - margin : 0;
+        const auto now = getCurrentTime();
+
+        // Non-consuming snapshot (the same as dumpRecentToFile()): capturing and event tracing keep working
+        // with threads storages while the file is being written
+        EASY_LOGMSG("Capture trigger fired, writing \"" << filename << "\"...\n");
+        dumpWindowToFile(filename.c_str(), now > windowBegin ? now - windowBegin : 1);
+    }
+}
+
+void ProfileManager::flushBlocks()
+{
+    guard_lock_t lock(m_spin);
+
+    if (!m_spillRing.isOpen())
+        return;
+
+    for (uint32_t index = 0, threadsNumber = m_threads.size(); index < threadsNumber; ++index)
+    {
+        auto thread = m_threads.get(index);
+        if (thread == nullptr)
+            continue;
+
+        auto& t = *thread;
+
+        uint64_t memorySize = 0;
+        uint32_t blocksNumber = 0;
+        profiler::timestamp_t minEnd = ~0ULL, maxEnd = 0;
+        auto& stream = m_spillRing.beginRecord();
+
+        {
+            profiler::compact::PacketWriter packets(stream, false);
+            blocksNumber = t.blocks.closedList.consume(memorySize, [&packets, &minEnd, &maxEnd](const char* _data, uint16_t _size) {
+                const auto end = record_end(_data);
+                minEnd = std::min(minEnd, end);
+                maxEnd = std::max(maxEnd, end);
+                packets.add(_data, _size);
+            });
+        }
+
+        m_spillRing.endRecord(&t, blocksNumber, memorySize, minEnd, maxEnd);
+    }
+}
+
+void ProfileManager::flushLoop()
+{
+    EASY_THREAD_SCOPE("EasyProfiler.Flush");
+
+    while (!m_stopFlush.load(std::memory_order_acquire))
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+        if (m_profilerStatus.load(std::memory_order_acquire) != EASY_PROF_ENABLED)
+            continue;
+
+        // Start flushing when half of the budget is used to leave enough space for blocks which would be stored until the next check.
+        if (residentMemorySize() * 2 < m_memoryBudget.load(std::memory_order_acquire))
+            continue;
+
+        flushBlocks();
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
 template <class T>
 inline void join(std::future<T>& futureResult)
 {
@@ -1686,6 +2742,27 @@ inline void join(std::future<T>& futureResult)
         futureResult.get();
 }
 
+static int64_t sendStream(EasySocket& _socket, const profiler::net::DataMessage& _message, const profiler::OStream& _stream)
+{
+    const auto buffersNumber = _stream.buffersNumber();
+
+    std::vector<const void*> buffers;
+    std::vector<size_t> sizes;
+    buffers.reserve(buffersNumber + 1);
+    sizes.reserve(buffersNumber + 1);
+
+    buffers.push_back(&_message);
+    sizes.push_back(sizeof(_message));
+
+    for (size_t i = 0; i < buffersNumber; ++i)
+    {
+        buffers.push_back(_stream.bufferData(i));
+        sizes.push_back(_stream.bufferSize(i));
+    }
+
+    return _socket.send(buffers.data(), sizes.data(), buffers.size());
+}
+
 void ProfileManager::listen(uint16_t _port)
 {
     EASY_THREAD_SCOPE("EasyProfiler.Listen");
@@ -1706,6 +2783,7 @@ void ProfileManager::listen(uint16_t _port)
 
     EasySocket socket;
     profiler::net::Message replyMessage(profiler::net::MESSAGE_TYPE_REPLY_START_CAPTURING);
+    bool compress = false; // Compression is requested by the client for each connection
 
     socket.bind(_port);
     int bytes = 0;
@@ -1718,11 +2796,12 @@ void ProfileManager::listen(uint16_t _port)
         socket.accept();
 
         bool hasConnect = true;
+        compress = false;
 
         // Send reply
         {
             const bool wasLowPriorityET =
-#ifdef _WIN32
+#if defined(_WIN32) || defined(__linux__)
                 EasyEventTracer::instance().isLowPriority();
 #else
                 false;
@@ -1747,41 +2826,26 @@ void ProfileManager::listen(uint16_t _port)
                     dumping = false;
                     dumpingResult.get();
 
-                    const auto size = os.stream().tellp();
-                    static const decltype(size) badSize = -1;
-                    if (size != badSize)
+                    if (compress)
                     {
-                        const profiler::net::DataMessage dm(static_cast<uint32_t>(size),
-                                                            profiler::net::MESSAGE_TYPE_REPLY_BLOCKS);
-
-                        const size_t packet_size = sizeof(dm) + dm.size;
-                        std::string sendbuf;
-                        sendbuf.reserve(packet_size + 1);
-
-                        if (sendbuf.capacity() >= packet_size) // check if there is enough memory
-                        {
-                            sendbuf.append((const char*) &dm, sizeof(dm));
-                            sendbuf += os.stream().str(); // TODO: Avoid double-coping data from stringstream!
-                            os.clear();
-
-                            bytes = socket.send(sendbuf.c_str(), packet_size);
-                            hasConnect = bytes > 0;
-                            if (!hasConnect)
-                                break;
-                        }
-                        else
-                        {
-                            EASY_ERROR("Can not send blocks. Not enough memory for allocating " << packet_size
-                                                                                                << " bytes");
-                            os.clear();
-                        }
+                        profiler::OStream compressed;
+                        profiler::compression::compress(os, compressed);
+                        os.clear();
+
+                        const profiler::net::DataMessage dm(static_cast<uint32_t>(compressed.size()), profiler::net::MESSAGE_TYPE_REPLY_BLOCKS);
+                        hasConnect = sendStream(socket, dm, compressed) > 0;
                     }
                     else
                     {
-                        EASY_ERROR("Can not send blocks. Bad std::stringstream.tellp() == -1");
+                        // Send blocks directly from the stream buffers without copying them into one contiguous buffer
+                        const profiler::net::DataMessage dm(static_cast<uint32_t>(os.size()), profiler::net::MESSAGE_TYPE_REPLY_BLOCKS);
+                        hasConnect = sendStream(socket, dm, os) > 0;
                         os.clear();
                     }
 
+                    if (!hasConnect)
+                        break;
+
                     replyMessage.type = profiler::net::MESSAGE_TYPE_REPLY_BLOCKS_END;
                     bytes = socket.send(&replyMessage, sizeof(replyMessage));
                     hasConnect = bytes > 0;
@@ -1874,6 +2938,33 @@ void ProfileManager::listen(uint16_t _port)
                     break;
                 }
 
+                case profiler::net::MESSAGE_TYPE_REQUEST_RECENT_BLOCKS:
+                {
+                    auto data = reinterpret_cast<const profiler::net::RecentBlocksMessage*>(message);
+
+                    EASY_LOGMSG("receive REQUEST_RECENT_BLOCKS window=" << data->window << "ms\n");
+
+                    if (dumping)
+                        break;
+
+                    const auto window = std::max(nanoseconds_to_ticks(static_cast<profiler::timestamp_t>(data->window) * 1000000ULL), profiler::timestamp_t(1));
+
+                    m_dumpSpin.lock();
+
+                    dumping = true;
+                    socket.setReceiveTimeout(500); // We have to check if dumping ready or not
+
+                    m_stopDumping.store(false, std::memory_order_release);
+                    dumpingResult = std::async(std::launch::async, [this, &os, window]
+                    {
+                        auto result = dumpBlocksToStream(os, false, true, window);
+                        m_dumpSpin.unlock();
+                        return result;
+                    });
+
+                    break;
+                }
+
                 case profiler::net::MESSAGE_TYPE_REQUEST_BLOCKS_DESCRIPTION:
                 {
                     EASY_LOGMSG("receive REQUEST_BLOCKS_DESCRIPTION\n");
@@ -1886,54 +2977,33 @@ void ProfileManager::listen(uint16_t _port)
                     os.write(EASY_CURRENT_VERSION);
 
                     // Write block descriptors
-                    m_storedSpin.lock();
-                    os.write(static_cast<uint32_t>(m_descriptors.size()));
-                    os.write(m_usedMemorySize);
-                    for (const auto descriptor : m_descriptors)
+                    m_descriptors.lock();
+                    const auto descriptorsNumber = m_descriptors.size();
+                    os.write(descriptorsNumber);
+                    os.write(m_usedMemorySize.load(std::memory_order_relaxed));
+                    for (uint32_t i = 0; i < descriptorsNumber; ++i)
                     {
+                        const auto descriptor = m_descriptors.get(i);
                         const auto name_size = descriptor->nameSize();
                         const auto filename_size = descriptor->filenameSize();
                         const auto size = static_cast<uint16_t>(sizeof(profiler::SerializedBlockDescriptor)
                                                                 + name_size + filename_size);
 
+                        profiler::BaseBlockDescriptor base(*descriptor);
+                        base.m_sampling = descriptor->samplingRate();
+
                         os.write(size);
-                        os.write<profiler::BaseBlockDescriptor>(*descriptor);
+                        os.write(base);
                         os.write(name_size);
                         os.write(descriptor->name(), name_size);
                         os.write(descriptor->filename(), filename_size);
                     }
-                    m_storedSpin.unlock();
+                    m_descriptors.unlock();
                     // END of Write block descriptors.
 
-                    const auto size = os.stream().tellp();
-                    static const decltype(size) badSize = -1;
-                    if (size != badSize)
-                    {
-                        const profiler::net::DataMessage dm(static_cast<uint32_t>(size),
-                                                            profiler::net::MESSAGE_TYPE_REPLY_BLOCKS_DESCRIPTION);
-
-                        const size_t packet_size = sizeof(dm) + dm.size;
-                        std::string sendbuf;
-                        sendbuf.reserve(packet_size + 1);
-
-                        if (sendbuf.capacity() >= packet_size) // check if there is enough memory
-                        {
-                            sendbuf.append((const char*)&dm, sizeof(dm));
-                            sendbuf += os.stream().str(); // TODO: Avoid double-coping data from stringstream!
-                            os.clear();
-
-                            bytes = socket.send(sendbuf.c_str(), packet_size);
-                            //hasConnect = bytes > 0;
-                        }
-                        else
-                        {
-                            EASY_ERROR("Can not send block descriptions. Not enough memory for allocating " << packet_size << " bytes");
-                        }
-                    }
-                    else
-                    {
-                        EASY_ERROR("Can not send block descriptions. Bad std::stringstream.tellp() == -1");
-                    }
+                    const profiler::net::DataMessage dm(static_cast<uint32_t>(os.size()), profiler::net::MESSAGE_TYPE_REPLY_BLOCKS_DESCRIPTION);
+                    sendStream(socket, dm, os);
+                    os.clear();
 
                     replyMessage.type = profiler::net::MESSAGE_TYPE_REPLY_BLOCKS_DESCRIPTION_END;
                     bytes = socket.send(&replyMessage, sizeof(replyMessage));
@@ -1953,6 +3023,17 @@ void ProfileManager::listen(uint16_t _port)
                     break;
                 }
 
+                case profiler::net::MESSAGE_TYPE_EDIT_BLOCK_SAMPLING:
+                {
+                    auto data = reinterpret_cast<const profiler::net::BlockSamplingMessage*>(message);
+
+                    EASY_LOGMSG("receive EDIT_BLOCK_SAMPLING id=" << data->id << " sampling=" << data->sampling << std::endl);
+
+                    setBlockSampling(data->id, data->sampling);
+
+                    break;
+                }
+
                 case profiler::net::MESSAGE_TYPE_EVENT_TRACING_STATUS:
                 {
                     auto data = reinterpret_cast<const profiler::net::BoolMessage*>(message);
@@ -1963,15 +3044,25 @@ void ProfileManager::listen(uint16_t _port)
                     break;
                 }
 
+                case profiler::net::MESSAGE_TYPE_COMPRESSION_STATUS:
+                {
+                    auto data = reinterpret_cast<const profiler::net::BoolMessage*>(message);
+
+                    EASY_LOGMSG("receive COMPRESSION_STATUS on=" << data->flag << std::endl);
+
+                    compress = data->flag;
+                    break;
+                }
+
                 case profiler::net::MESSAGE_TYPE_EVENT_TRACING_PRIORITY:
                 {
-#if defined(_WIN32) || EASY_OPTION_LOG_ENABLED != 0
+#if defined(_WIN32) || defined(__linux__) || EASY_OPTION_LOG_ENABLED != 0
                     auto data = reinterpret_cast<const profiler::net::BoolMessage*>(message);
 #endif
 
                     EASY_LOGMSG("receive EVENT_TRACING_PRIORITY low=" << data->flag << std::endl);
 
-#if defined(_WIN32)
+#if defined(_WIN32) || defined(__linux__)
                     EasyEventTracer::instance().setLowPriority(data->flag);
 #endif
                     break;
@@ -48,10 +48,12 @@ The Apache License, Version 2.0 (the "License");
 
 #include "spin_lock.h"
 #include "outstream.h"
-#include "hashed_cstr.h"
-#include "thread_storage.h"
+#include "descriptors_registry.h"
+#include "threads_registry.h"
+#include "spill_ring.h"
+#include "clock_calibration.h"
+#include "context_switch_log.h"
 
-#include <map>
 #include <vector>
 #include <unordered_map>
 #include <thread>
@@ -75,47 +77,82 @@ class ProfileManager
     ProfileManager& operator=(const ProfileManager&) = delete;
 
     typedef profiler::guard_lock<profiler::spin_lock> guard_lock_t;
-    typedef std::map<profiler::thread_id_t, ThreadStorage> map_of_threads_stacks;
-    typedef std::vector<BlockDescriptor*> block_descriptors_t;
-
-#ifdef EASY_PROFILER_HASHED_CSTR_DEFINED
-    typedef std::unordered_map<profiler::hashed_cstr, profiler::block_id_t> descriptors_map_t;
-#else
-    typedef std::unordered_map<profiler::hashed_stdstring, profiler::block_id_t> descriptors_map_t;
-#endif
+    typedef DescriptorsRegistry<BlockDescriptor> block_descriptors_t;
 
     const processid_t                     m_processId;
 
-    map_of_threads_stacks                   m_threads;
+    ThreadsRegistry                         m_threads;
     block_descriptors_t                 m_descriptors;
-    descriptors_map_t                m_descriptorsMap;
-    uint64_t                         m_usedMemorySize;
+    BlockDescriptor*             m_overflowDescriptor; ///< Disabled descriptor shared by all blocks which were registered after m_descriptors had become full
+    std::atomic<uint64_t>            m_usedMemorySize;
     profiler::timestamp_t                 m_beginTime;
     profiler::timestamp_t                   m_endTime;
     std::atomic<profiler::timestamp_t>     m_frameMax;
     std::atomic<profiler::timestamp_t>     m_frameAvg;
     std::atomic<profiler::timestamp_t>     m_frameCur;
-    profiler::spin_lock                        m_spin;
-    profiler::spin_lock                  m_storedSpin;
+    profiler::spin_lock                        m_spin; ///< Guards foreign thread storages readers (dumping and flushing threads)
     profiler::spin_lock                    m_dumpSpin;
     std::atomic<profiler::thread_id_t> m_mainThreadId;
-    std::atomic<char>                m_profilerStatus;
+    std::atomic<char>&               m_profilerStatus; ///< Reference to exported profiler::profilerStatus (checked by inlined fast path of blocks)
     std::atomic_bool          m_isEventTracingEnabled;
+    std::atomic_bool          m_isEventTracerLaunched; ///< True if built-in event tracer has been launched by the last enableEventTracer() call
+    std::atomic<profiler::timestamp_t> m_minBlockDuration; ///< Global minimum duration of stored blocks (in ticks)
+    std::atomic_bool                 m_isSamplingUsed; ///< True if at least one descriptor has sampling rate > 1
+    std::atomic_bool                m_isFilteringUsed; ///< True if minimum duration has been set at least once (globally or for any descriptor)
+    std::atomic_bool               m_isStatisticsOnly; ///< True if blocks are only accumulated into per-thread statistics instead of being stored
+    std::atomic_bool             m_isPerfCountersUsed; ///< True if at least one descriptor has performance counters enabled
+    std::atomic<uint32_t>          m_perfCountersMask; ///< Performance counters read for blocks (bit (1 << profiler::PerfCounter) for each one)
+    std::atomic<uint32_t>    m_perfCountersGeneration; ///< Incremented on each m_perfCountersMask change to make threads reopen their counters
     std::atomic_bool             m_isAlreadyListening;
     std::atomic_bool                  m_frameMaxReset;
     std::atomic_bool                  m_frameAvgReset;
     std::atomic_bool                    m_stopDumping;
+    std::atomic_bool           m_isDescriptorsOverflow; ///< True if m_overflowDescriptor has been returned at least once
 
     std::string m_csInfoFilename = "/tmp/cs_profiling_info.log";
 
-    uint32_t dumpBlocksToStream(profiler::OStream& _outputStream, bool _lockSpin, bool _async);
+    uint32_t dumpBlocksToStream(profiler::OStream& _outputStream, bool _lockSpin, bool _async, profiler::timestamp_t _recentWindow = 0);
     void setBlockStatus(profiler::block_id_t _id, profiler::EasyBlockStatus _status);
+    void setBlockSampling(profiler::block_id_t _id, uint16_t _sampling);
+    bool filterBlock(const profiler::Block& _block);
+    void accumulateBlock(const profiler::Block& _block);
 
     std::thread m_listenThread;
     void listen(uint16_t _port);
 
     std::atomic_bool m_stopListen;
 
+    SpillRing                 m_spillRing; ///< On-disk storage for flushed blocks (guarded by m_spin)
+    std::unordered_map<profiler::block_id_t, MergedStatistics> m_retiredStatistics; ///< Statistics of removed threads (guarded by m_spin)
+    std::thread             m_flushThread;
+    std::atomic<uint64_t>  m_memoryBudget; ///< Total budget for streaming or per-thread budget for flight recording
+    std::atomic_bool          m_stopFlush;
+    std::atomic_bool        m_isStreaming;
+    std::atomic_bool  m_isFlightRecording;
+    std::atomic_bool m_isCompressionEnabled;
+
+#ifndef _WIN32
+    ClockCalibration m_clock;
+#endif
+
+    std::thread                      m_triggerThread;
+    std::string              m_triggerFilenamePrefix = "easy_trigger"; ///< Prefix of files written by capture triggers (guarded by m_triggerSpin)
+    profiler::spin_lock                m_triggerSpin;
+    std::atomic<profiler::timestamp_t> m_frameTrigger; ///< Main thread frame duration (in ticks) which fires capture trigger. 0 means disabled.
+    std::atomic<uint32_t>            m_triggerMargin; ///< Duration (in milliseconds) captured before the slow frame (or block)
+    std::atomic<profiler::timestamp_t> m_triggerTime; ///< Begin time of the slow frame (or block) waiting to be dumped. 0 means nothing to dump.
+    std::atomic_bool                 m_isTriggersUsed; ///< True if capture triggers thread has been started
+    std::atomic_bool                   m_stopTriggers;
+
+    void flushLoop();
+    void recordLoop();
+    void triggerLoop();
+    void startTriggers();
+    void fireTrigger(profiler::timestamp_t _beginTime);
+    uint32_t dumpWindowToFile(const char* _filename, profiler::timestamp_t _window);
+    void flushBlocks();
+    uint64_t residentMemorySize();
+
 public:
 
     static ProfileManager& instance();
@@ -128,13 +165,15 @@ public:
                                                             int _line,
                                                             profiler::block_type_t _block_type,
                                                             profiler::color_t _color,
-                                                            bool _copyName = false);
+                                                            bool _copyName = false,
+                                                            uint16_t _sampling = 1);
 
     bool storeBlock(const profiler::BaseBlockDescriptor* _desc, const char* _runtimeName);
     bool storeBlock(const profiler::BaseBlockDescriptor* _desc, const char* _runtimeName, profiler::timestamp_t _beginTime, profiler::timestamp_t _endTime);
     void beginBlock(profiler::Block& _block);
     void beginNonScopedBlock(const profiler::BaseBlockDescriptor* _desc, const char* _runtimeName);
     void endBlock();
+    profiler::ThreadFastState* registerThreadFastState(profiler::ThreadFastState** _cache);
     profiler::timestamp_t maxFrameDuration();
     profiler::timestamp_t avgFrameDuration();
     profiler::timestamp_t curFrameDuration() const;
@@ -156,11 +195,40 @@ public:
         return m_csInfoFilename.c_str();
     }
 
-    void beginContextSwitch(profiler::thread_id_t _thread_id, profiler::timestamp_t _time, profiler::thread_id_t _target_thread_id, const char* _target_process, bool _lockSpin = true);
-    void endContextSwitch(profiler::thread_id_t _thread_id, processid_t _process_id, profiler::timestamp_t _endtime, bool _lockSpin = true);
+    void beginContextSwitch(profiler::thread_id_t _thread_id, profiler::timestamp_t _time, profiler::thread_id_t _target_thread_id, const char* _target_process);
+    void endContextSwitch(profiler::thread_id_t _thread_id, processid_t _process_id, profiler::timestamp_t _endtime);
     void startListen(uint16_t _port);
     void stopListen();
     bool isListening() const;
+    bool startStreaming(const char* _filenamePrefix, uint64_t _memoryBudget, uint32_t _segmentsNumber, uint64_t _segmentSize);
+    void stopStreaming();
+    bool isStreaming() const;
+    void startFlightRecording(uint64_t _threadMemoryBudget);
+    void stopFlightRecording();
+    bool isFlightRecording() const;
+    uint32_t dumpRecentToFile(const char* _filename, uint32_t _windowMs);
+    void setFrameTrigger(profiler::timestamp_t _nanoseconds);
+    void setBlockTrigger(profiler::block_id_t _id, profiler::timestamp_t _nanoseconds);
+    void setTriggerOutput(const char* _filenamePrefix, uint32_t _marginMs);
+    bool setClockSource(profiler::ClockSource _source);
+    profiler::ClockSource clockSource() const;
+    void setCompressionEnabled(bool _isEnable);
+    bool isCompressionEnabled() const;
+    void setMinBlockDuration(profiler::timestamp_t _nanoseconds);
+    void setBlockMinDuration(profiler::block_id_t _id, profiler::timestamp_t _nanoseconds);
+    void setStatisticsOnly(bool _isEnable);
+    bool isStatisticsOnly() const;
+    uint32_t setPerfCounters(uint32_t _mask);
+    void setBlockPerfCounters(profiler::block_id_t _id, bool _isEnable);
+
+#ifndef _WIN32
+    int64_t cpuFrequency()
+    {
+        return m_clock.frequency();
+    }
+#endif
+    double ticksPerNanosecond();
+    uint32_t dumpStatisticsToFile(const char* _filename);
 
 private:
 
@@ -172,27 +240,20 @@ private:
     void enableEventTracer();
     void disableEventTracer();
 
+    /** Find storage of the thread which gets CPU (creates it if implicit thread registration is enabled and thread is owned by current process).
+    */
+    ThreadsRegistry::Reference contextSwitchTarget(profiler::thread_id_t _thread_id, processid_t _process_id);
+
+    /** Store context switch events of one thread read from the log-file (see context_switch_log.h).
+    */
+    void storeContextSwitches(profiler::thread_id_t _thread_id, const std::vector<profiler::cswitch_log::ThreadEvent>& _events);
+
     static char checkThreadExpired(ThreadStorage& _registeredThread);
 
     void storeBlockForce(const profiler::BaseBlockDescriptor* _desc, const char* _runtimeName, ::profiler::timestamp_t& _timestamp);
     void storeBlockForce2(const profiler::BaseBlockDescriptor* _desc, const char* _runtimeName, ::profiler::timestamp_t _timestamp);
     void storeBlockForce2(ThreadStorage& _registeredThread, const profiler::BaseBlockDescriptor* _desc, const char* _runtimeName, ::profiler::timestamp_t _timestamp);
 
-    ThreadStorage& _threadStorage(profiler::thread_id_t _thread_id);
-    ThreadStorage* _findThreadStorage(profiler::thread_id_t _thread_id);
-
-    inline ThreadStorage& threadStorage(profiler::thread_id_t _thread_id)
-    {
-        guard_lock_t lock(m_spin);
-        return _threadStorage(_thread_id);
-    }
-
-    inline ThreadStorage* findThreadStorage(profiler::thread_id_t _thread_id)
-    {
-        guard_lock_t lock(m_spin);
-        return _findThreadStorage(_thread_id);
-    }
-
 }; // END of class ProfileManager.
 
 //////////////////////////////////////////////////////////////////////////
@@ -69,6 +69,9 @@
 #include <easy/reader.h>
 
 #include "hashed_cstr.h"
+#include "compact_format.h"
+#include "compression.h"
+#include "parallel_for.h"
 
 #include <fstream>
 #include <sstream>
@@ -77,6 +80,18 @@
 #include <unordered_map>
 #include <thread>
 
+#ifdef _WIN32
+# ifndef WIN32_LEAN_AND_MEAN
+#  define WIN32_LEAN_AND_MEAN
+# endif
+# include <windows.h>
+#else
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+#endif
+
 //////////////////////////////////////////////////////////////////////////
 
 typedef uint64_t processid_t;
@@ -88,6 +103,7 @@ extern const uint32_t EASY_CURRENT_VERSION;
 const uint32_t MIN_COMPATIBLE_VERSION = EASY_VERSION_INT(0, 1, 0); ///< minimal compatible version (.prof file format was not changed seriously since this version)
 const uint32_t EASY_V_100 = EASY_VERSION_INT(1, 0, 0); ///< in v1.0.0 some additional data were added into .prof file
 const uint32_t EASY_V_130 = EASY_VERSION_INT(1, 3, 0); ///< in v1.3.0 changed sizeof(thread_id_t) uint32_t -> uint64_t
+const uint32_t EASY_V_140 = EASY_VERSION_INT(1, 4, 0); ///< in v1.4.0 blocks and context switches are stored in compact format (see compact_format.h), descriptors store sampling rate, header stores clock drift, thread sections store interned runtime names
 # undef EASY_VERSION_INT
 
 const uint64_t TIME_FACTOR = 1000000000ULL;
@@ -142,9 +158,77 @@ namespace profiler {
 
     void SerializedData::set(char* _data, uint64_t _size)
     {
-        delete [] m_data;
+        if (!m_mapped)
+            delete [] m_data;
+#ifdef _WIN32
+        else
+            UnmapViewOfFile(m_data);
+#else
+        else
+            munmap(m_data, m_size);
+#endif
+
         m_data = _data;
         m_size = _size;
+        m_mapped = false;
+    }
+
+    bool SerializedData::map(const char* _filename)
+    {
+        clear();
+
+#ifdef _WIN32
+        HANDLE file = CreateFileA(_filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+        {
+            CloseHandle(file);
+            return false;
+        }
+
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        if (mapping == nullptr)
+            return false;
+
+        void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping); // the view keeps the mapping alive
+        if (data == nullptr)
+            return false;
+
+        const auto size = static_cast<uint64_t>(fileSize.QuadPart);
+#else
+        const int file = open(_filename, O_RDONLY);
+        if (file < 0)
+            return false;
+
+        struct stat info;
+        if (fstat(file, &info) != 0 || info.st_size <= 0)
+        {
+            close(file);
+            return false;
+        }
+
+        const auto size = static_cast<uint64_t>(info.st_size);
+        void* data = mmap(nullptr, static_cast<size_t>(size), PROT_READ, MAP_PRIVATE, file, 0);
+        close(file); // the mapping keeps the file alive
+        if (data == MAP_FAILED)
+            return false;
+
+# ifdef MADV_SEQUENTIAL
+        // Blocks are parsed from the beginning to the end of the file
+        madvise(data, static_cast<size_t>(size), MADV_SEQUENTIAL);
+# endif
+#endif
+
+        m_data = static_cast<char*>(data);
+        m_size = static_cast<size_t>(size);
+        m_mapped = true;
+
+        return true;
     }
 
     void SerializedData::set(uint64_t _size)
@@ -160,13 +244,11 @@ namespace profiler {
         auto olddata = m_data;
         auto oldsize = m_size;
 
-        m_size = oldsize + _size;
-        m_data = new char[m_size];
+        auto newdata = new char[oldsize + _size];
+        if (olddata != nullptr)
+            memcpy(newdata, olddata, oldsize);
 
-        if (olddata != nullptr) {
-            memcpy(m_data, olddata, oldsize);
-            delete [] olddata;
-        }
+        set(newdata, oldsize + _size);
     }
 
     extern "C" PROFILER_API void release_stats(BlockStatistics*& _stats)
@@ -174,12 +256,55 @@ namespace profiler {
         if (_stats == nullptr)
             return;
 
-        if (--_stats->calls_number == 0)
+        // Each block refers to it's statistics
+        if (_stats->references <= 1)
             delete _stats;
+        else
+            --_stats->references;
 
         _stats = nullptr;
     }
 
+    extern "C" PROFILER_API uint32_t readPerfCounters(const SerializedBlock* _block, uint64_t* _values)
+    {
+        for (uint32_t counter = 0; counter < PERF_COUNTERS_NUMBER; ++counter)
+            _values[counter] = 0;
+
+        // Counters are stored after extra data flags which follow the name (see compact_format.h)
+        const char* extra = _block->name() + strlen(_block->name()) + 1;
+        if ((*extra & compact::EXTRA_PERF_COUNTERS) == 0)
+            return 0;
+
+        const auto mask = static_cast<uint8_t>(extra[1]);
+        const char* counters = extra + 2;
+        for (uint32_t counter = 0; counter < PERF_COUNTERS_NUMBER; ++counter)
+        {
+            if (mask & (1U << counter))
+            {
+                memcpy(_values + counter, counters, sizeof(uint64_t));
+                counters += sizeof(uint64_t);
+            }
+        }
+
+        return mask;
+    }
+
+    extern "C" PROFILER_API uint16_t readSampling(const SerializedBlock* _block)
+    {
+        // Sampling rate is stored after performance counters (if any) which follow extra data flags (see compact_format.h)
+        const char* extra = _block->name() + strlen(_block->name()) + 1;
+        if ((*extra & compact::EXTRA_SAMPLING) == 0)
+            return 1;
+
+        const char* sampling = extra + 1;
+        if (*extra & compact::EXTRA_PERF_COUNTERS)
+            sampling += sizeof(uint8_t) + compact::counters_number(static_cast<uint8_t>(*sampling)) * sizeof(uint64_t);
+
+        uint16_t rate = 1;
+        memcpy(&rate, sampling, sizeof(uint16_t));
+        return rate;
+    }
+
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -205,6 +330,20 @@ typedef ::std::unordered_map<::profiler::hashed_stdstring, ::profiler::BlockStat
 
 //////////////////////////////////////////////////////////////////////////
 
+/** Add performance counters of the block (if any) into it's statistics. */
+static void update_perf_counters(::profiler::BlockStatistics& _stats, const ::profiler::SerializedBlock* _block, uint16_t _sampling)
+{
+    uint64_t values[::profiler::PERF_COUNTERS_NUMBER];
+    const auto mask = ::profiler::readPerfCounters(_block, values);
+    if (mask == 0)
+        return;
+
+    _stats.perf_counters_mask |= static_cast<uint8_t>(mask);
+    _stats.perf_counters_calls += _sampling;
+    for (uint32_t counter = 0; counter < ::profiler::PERF_COUNTERS_NUMBER; ++counter)
+        _stats.total_perf_counters[counter] += values[counter] * _sampling;
+}
+
 /** \brief Updates statistics for a profiler block.
 
 \param _stats_map Storage of statistics for blocks.
@@ -220,6 +359,10 @@ automatically receive statistics update.
 static ::profiler::BlockStatistics* update_statistics(StatsMap& _stats_map, const ::profiler::BlocksTree& _current, ::profiler::block_index_t _current_index, ::profiler::block_index_t _parent_index, const ::profiler::blocks_t& _blocks, bool _calculate_children = true)
 {
     auto duration = _current.node->duration();
+    const auto sampling = ::profiler::readSampling(_current.node);
+
+    ::profiler::BlockStatistics* stats = nullptr;
+
     //StatsMap::key_type key(_current.node->name());
     //auto it = _stats_map.find(key);
     auto it = _stats_map.find(_current.node->id());
@@ -227,16 +370,11 @@ static ::profiler::BlockStatistics* update_statistics(StatsMap& _stats_map, cons
     {
         // Update already existing statistics
 
-        auto stats = it->second; // write pointer to statistics into output (this is BlocksTree:: per_thread_stats or per_parent_stats or per_frame_stats)
-
-        ++stats->calls_number; // update calls number of this block
-        stats->total_duration += duration; // update summary duration of all block calls
+        stats = it->second; // write pointer to statistics into output (this is BlocksTree:: per_thread_stats or per_parent_stats or per_frame_stats)
 
-        if (_calculate_children)
-        {
-            for (auto i : _current.children)
-                stats->total_children_duration += _blocks[i].node->duration();
-        }
+        ++stats->references;
+        stats->calls_number += sampling; // update calls number of this block
+        stats->total_duration += duration * sampling; // update summary duration of all block calls
 
         if (duration > _blocks[stats->max_duration_block].node->duration())
         {
@@ -253,20 +391,29 @@ static ::profiler::BlockStatistics* update_statistics(StatsMap& _stats_map, cons
         }
 
         // average duration is calculated inside average_duration() method by dividing total_duration to the calls_number
-
-        return stats;
+    }
+    else
+    {
+        // This is first time the block appear in the file.
+        // Create new statistics.
+        stats = new ::profiler::BlockStatistics(duration, _current_index, _parent_index, sampling);
+        //_stats_map.emplace(key, stats);
+        _stats_map.emplace(_current.node->id(), stats);
     }
 
-    // This is first time the block appear in the file.
-    // Create new statistics.
-    auto stats = new ::profiler::BlockStatistics(duration, _current_index, _parent_index);
-    //_stats_map.emplace(key, stats);
-    _stats_map.emplace(_current.node->id(), stats);
+    update_perf_counters(*stats, _current.node, sampling);
 
     if (_calculate_children)
     {
+        // Each stored block stands for sampling calls and each stored child stands for it's own sampling calls
+        ::profiler::timestamp_t children_duration = 0;
         for (auto i : _current.children)
-            stats->total_children_duration += _blocks[i].node->duration();
+        {
+            const auto child = _blocks[i].node;
+            children_duration += child->duration() * ::profiler::readSampling(child);
+        }
+
+        stats->total_children_duration += children_duration * sampling;
     }
 
     return stats;
@@ -283,6 +430,7 @@ static ::profiler::BlockStatistics* update_statistics(CsStatsMap& _stats_map, co
 
         auto stats = it->second; // write pointer to statistics into output (this is BlocksTree:: per_thread_stats or per_parent_stats or per_frame_stats)
 
+        ++stats->references;
         ++stats->calls_number; // update calls number of this block
         stats->total_duration += duration; // update summary duration of all block calls
 
@@ -330,9 +478,11 @@ static ::profiler::BlockStatistics* update_statistics(CsStatsMap& _stats_map, co
 static void update_statistics_recursive(StatsMap& _stats_map, ::profiler::BlocksTree& _current, ::profiler::block_index_t _current_index, ::profiler::block_index_t _parent_index, ::profiler::blocks_t& _blocks)
 {
     _current.per_frame_stats = update_statistics(_stats_map, _current, _current_index, _parent_index, _blocks, false);
+    const auto sampling = ::profiler::readSampling(_current.node);
     for (auto i : _current.children)
     {
-        _current.per_frame_stats->total_children_duration += _blocks[i].node->duration();
+        const auto child = _blocks[i].node;
+        _current.per_frame_stats->total_children_duration += child->duration() * ::profiler::readSampling(child) * sampling;
         update_statistics_recursive(_stats_map, _blocks[i], i, _parent_index, _blocks);
     }
 }
@@ -386,550 +536,1591 @@ static bool update_progress(::std::atomic<int>& progress, int new_value, ::std::
     return true;
 }
 
-//////////////////////////////////////////////////////////////////////////
+/** Input stream over a contiguous memory buffer.
 
-extern "C" {
+Used to index file data without copying: pointer() returns address of the data in the buffer.
+Mimics std::istream eof() behavior: eof flag is set when trying to read past the end of the buffer.
+*/
+class MemoryStream EASY_FINAL
+{
+    const char* m_data;
+    uint64_t    m_size;
+    uint64_t  m_offset;
+    bool         m_eof;
 
-    PROFILER_API ::profiler::block_index_t fillTreesFromFile(::std::atomic<int>& progress, const char* filename,
-                                                             ::profiler::SerializedData& serialized_blocks,
-                                                             ::profiler::SerializedData& serialized_descriptors,
-                                                             ::profiler::descriptors_list_t& descriptors,
-                                                             ::profiler::blocks_t& blocks,
-                                                             ::profiler::thread_blocks_tree_t& threaded_trees,
-                                                             uint32_t& total_descriptors_number,
-                                                             uint32_t& version,
-                                                             bool gather_statistics,
-                                                             ::std::stringstream& _log)
+public:
+
+    MemoryStream(const char* _data, uint64_t _size) : m_data(_data), m_size(_size), m_offset(0), m_eof(false)
     {
-        if (!update_progress(progress, 0, _log))
-        {
-            return 0;
-        }
+    }
 
-        ::std::ifstream inFile(filename, ::std::fstream::binary);
-        if (!inFile.is_open())
+    void read(char* _buffer, uint64_t _size)
+    {
+        if (_size > m_size - m_offset)
         {
-            _log << "Can not open file " << filename;
-            return 0;
+            _size = m_size - m_offset;
+            m_eof = true;
         }
 
-        ::std::stringstream str;
-
-        // Replace str buffer to inFile buffer to avoid redundant copying
-        typedef ::std::basic_iostream<::std::stringstream::char_type, ::std::stringstream::traits_type> stringstream_parent;
-        stringstream_parent& s = str;
-        auto oldbuf = s.rdbuf(inFile.rdbuf());
-        
-        // Read data from file
-        auto result = fillTreesFromStream(progress, str, serialized_blocks, serialized_descriptors, descriptors, blocks,
-                                          threaded_trees, total_descriptors_number, version, gather_statistics, _log);
-
-        // Restore old str buffer to avoid possible second memory free on stringstream destructor
-        s.rdbuf(oldbuf);
-
-        return result;
+        memcpy(_buffer, m_data + m_offset, static_cast<size_t>(_size));
+        m_offset += _size;
     }
 
-    //////////////////////////////////////////////////////////////////////////
-
-    PROFILER_API ::profiler::block_index_t fillTreesFromStream(::std::atomic<int>& progress, ::std::stringstream& inFile,
-                                                               ::profiler::SerializedData& serialized_blocks,
-                                                               ::profiler::SerializedData& serialized_descriptors,
-                                                               ::profiler::descriptors_list_t& descriptors,
-                                                               ::profiler::blocks_t& blocks,
-                                                               ::profiler::thread_blocks_tree_t& threaded_trees,
-                                                               uint32_t& total_descriptors_number,
-                                                               uint32_t& version,
-                                                               bool gather_statistics,
-                                                               ::std::stringstream& _log)
+    const char* current() const
     {
-        EASY_FUNCTION(::profiler::colors::Cyan);
+        return m_data + m_offset;
+    }
 
-        if (!update_progress(progress, 0, _log))
+    const char* pointer(uint64_t _size)
+    {
+        if (_size > m_size - m_offset)
         {
-            return 0;
+            m_offset = m_size;
+            m_eof = true;
+            return nullptr;
         }
 
-        uint32_t signature = 0;
-        inFile.read((char*)&signature, sizeof(uint32_t));
-        if (signature != PROFILER_SIGNATURE)
-        {
-            _log << "Wrong signature " << signature << "\nThis is not EasyProfiler file/stream.";
-            return 0;
-        }
+        const char* data = m_data + m_offset;
+        m_offset += _size;
+        return data;
+    }
 
-        version = 0;
-        inFile.read((char*)&version, sizeof(uint32_t));
-        if (!isCompatibleVersion(version))
-        {
-            _log << "Incompatible version: v" << (version >> 24) << "." << ((version & 0x00ff0000) >> 16) << "." << (version & 0x0000ffff);
-            return 0;
-        }
+    bool eof() const
+    {
+        return m_eof;
+    }
 
-        processid_t pid = 0;
-        if (version > EASY_V_100)
-        {
-            if (version < EASY_V_130)
-            {
-                uint32_t old_pid = 0;
-                inFile.read((char*)&old_pid, sizeof(uint32_t));
-                pid = old_pid;
-            }
-            else
-            {
-                inFile.read((char*)&pid, sizeof(processid_t));
-            }
-        }
+}; // END of class MemoryStream.
 
-        int64_t file_cpu_frequency = 0LL;
-        inFile.read((char*)&file_cpu_frequency, sizeof(int64_t));
-        uint64_t cpu_frequency = file_cpu_frequency;
-        const double conversion_factor = static_cast<double>(TIME_FACTOR) / static_cast<double>(cpu_frequency);
+//////////////////////////////////////////////////////////////////////////
 
-        ::profiler::timestamp_t begin_time = 0ULL;
-        ::profiler::timestamp_t end_time = 0ULL;
-        inFile.read((char*)&begin_time, sizeof(::profiler::timestamp_t));
-        inFile.read((char*)&end_time, sizeof(::profiler::timestamp_t));
-        if (cpu_frequency != 0)
-        {
-            EASY_CONVERT_TO_NANO(begin_time, cpu_frequency, conversion_factor);
-            EASY_CONVERT_TO_NANO(end_time, cpu_frequency, conversion_factor);
-        }
+/** Part of the file containing context switches and blocks of one thread.
+*/
+struct ThreadSection
+{
+    ::std::string             thread_name;
+    ::std::vector<::profiler::compact::RuntimeName> names; ///< Interned runtime names of blocks (compact format only)
+    ::profiler::compact::NamesTable names_tables[::profiler::compact::NAMES_TABLES_NUMBER]; ///< Generations of interned runtime names
+    char*                        cs_begin = nullptr; ///< First context switch record (record is uint16_t size + data) in decoded buffer
+    char*                    blocks_begin = nullptr; ///< First block record in decoded buffer
+    const char*                 cs_source = nullptr; ///< First packet (compact format) or record (older formats) of context switches in the file
+    const char*             blocks_source = nullptr; ///< First packet (compact format) or record (older formats) of blocks in the file
+    const char*                 summaries = nullptr; ///< First summary record of blocks filtered out by minimum duration (compact format only)
+    uint64_t                      cs_size = 0; ///< Decoded size of context switches
+    uint64_t                  blocks_size = 0; ///< Decoded size of blocks
+    ::profiler::thread_id_t     thread_id = 0;
+    uint32_t                    cs_number = 0;
+    uint32_t                blocks_number = 0;
+    uint32_t             summaries_number = 0;
+};
+
+/** Size of summary record: block id, calls number and total duration.
+*/
+const uint64_t SUMMARY_RECORD_SIZE = sizeof(::profiler::block_id_t) + sizeof(::profiler::calls_number_t) + sizeof(::profiler::timestamp_t);
 
-        uint32_t total_blocks_number = 0;
-        inFile.read((char*)&total_blocks_number, sizeof(uint32_t));
-        if (total_blocks_number == 0)
-        {
-            _log << "Profiled blocks number == 0";
-            return 0;
-        }
+/** Block with runtime name: ids for such blocks are generated sequentially after parsing all threads.
+*/
+struct NamedBlock
+{
+    ::profiler::SerializedBlock* block; ///< Decoded block (nullptr if blocks are decoded on demand, see ThreadTask::named_ids)
+    uint64_t                      name; ///< Offset of the name in ThreadTask::names (if blocks are decoded on demand)
+    uint32_t                name_index; ///< Index of the interned name (or NO_NAME_ID)
+    ::profiler::block_id_t          id; ///< Descriptor id of the block
+};
 
-        uint64_t memory_size = 0;
-        inFile.read((char*)&memory_size, sizeof(decltype(memory_size)));
-        if (memory_size == 0)
+/** All sections of one thread: they are parsed by one worker.
+*/
+struct ThreadTask
+{
+    ::std::vector<const ThreadSection*>        sections;
+    ::std::vector<NamedBlock>                named_blocks; ///< Blocks with runtime names in order of appearance
+    ::std::vector<char>                             names; ///< Runtime names of named_blocks (if blocks are decoded on demand)
+    ::std::vector<::profiler::block_id_t>       named_ids; ///< Generated ids of named_blocks (if blocks are decoded on demand)
+    ::profiler::summaries_t                        summaries; ///< Summaries of all sections (one per block id)
+    ::std::string                                  error;
+    ::std::string                            thread_name;
+    ::profiler::BlocksTreeRoot*                     root = nullptr;
+    ::profiler::thread_id_t                    thread_id = 0;
+    ::profiler::block_index_t               blocks_begin = 0; ///< Index of the first block of this thread in blocks list
+    ::profiler::block_index_t              blocks_number = 0; ///< Number of blocks (and context switches) inside capture bounds
+    ::profiler::block_index_t                sync_number = 0; ///< Number of context switches inside capture bounds
+    uint32_t                                names_number = 0; ///< Number of interned runtime names of all sections
+};
+
+/** Skip _number records (uint16_t size + data).
+
+If there is not enough data then _number is decreased to the number of complete records.
+
+\param _size Total size of skipped records would be added to this value.
+
+\retval false if there is a record with zero size.
+*/
+static bool index_records(MemoryStream& _stream, uint32_t& _number, uint64_t& _size)
+{
+    for (uint32_t k = 0; k < _number; ++k)
+    {
+        uint16_t sz = 0;
+        _stream.read((char*)&sz, sizeof(sz));
+        if (_stream.eof())
         {
-            _log << "Wrong memory size == 0 for " << total_blocks_number << " blocks";
-            return 0;
+            _number = k;
+            break;
         }
 
-        total_descriptors_number = 0;
-        inFile.read((char*)&total_descriptors_number, sizeof(uint32_t));
-        if (total_descriptors_number == 0)
-        {
-            _log << "Blocks description number == 0";
-            return 0;
-        }
+        if (sz == 0)
+            return false;
 
-        uint64_t descriptors_memory_size = 0;
-        inFile.read((char*)&descriptors_memory_size, sizeof(decltype(descriptors_memory_size)));
-        if (descriptors_memory_size == 0)
+        if (_stream.pointer(sz) == nullptr)
         {
-            _log << "Wrong memory size == 0 for " << total_descriptors_number << " blocks descriptions";
-            return 0;
+            _number = k;
+            break;
         }
 
-        descriptors.reserve(total_descriptors_number);
-        //const char* olddata = append_regime ? serialized_descriptors.data() : nullptr;
-        serialized_descriptors.set(descriptors_memory_size);
-        //validate_pointers(progress, olddata, serialized_descriptors, descriptors, descriptors.size());
-
-        uint64_t i = 0;
-        while (!inFile.eof() && descriptors.size() < total_descriptors_number)
-        {
-            uint16_t sz = 0;
-            inFile.read((char*)&sz, sizeof(sz));
-            if (sz == 0)
-            {
-                descriptors.push_back(nullptr);
-                continue;
-            }
+        _size += sizeof(sz) + sz;
+    }
 
-            //if (i + sz > descriptors_memory_size) {
-            //    printf("FILE CORRUPTED\n");
-            //    return 0;
-            //}
+    return true;
+}
 
-            char* data = serialized_descriptors[i];
-            inFile.read(data, sz);
-            auto descriptor = reinterpret_cast<::profiler::SerializedBlockDescriptor*>(data);
-            descriptors.push_back(descriptor);
+/** Skip packets (compact format) containing _number records.
 
-            i += sz;
-            if (!update_progress(progress, static_cast<int>(15 * i / descriptors_memory_size), _log))
-            {
-                return 0;
-            }
-        }
+If there is not enough data then _number is decreased to the number of records in complete packets.
 
-        typedef ::std::unordered_map<::profiler::thread_id_t, StatsMap, ::profiler::passthrough_hash<::profiler::thread_id_t> > PerThreadStats;
-        PerThreadStats parent_statistics, frame_statistics;
-        IdMap identification_table;
+\param _decodedSize Total decoded size of skipped packets would be added to this value.
 
-        blocks.reserve(total_blocks_number);
-        //olddata = append_regime ? serialized_blocks.data() : nullptr;
-        serialized_blocks.set(memory_size);
-        //validate_pointers(progress, olddata, serialized_blocks, blocks, blocks.size());
+\retval false if there is an empty packet or packet with too many records.
+*/
+static bool index_packets(MemoryStream& _stream, uint32_t& _number, uint64_t& _decodedSize)
+{
+    uint32_t records = 0;
+    while (records < _number)
+    {
+        uint32_t header[3] = {0, 0, 0}; // records number, payload size, decoded size
+        _stream.read((char*)header, sizeof(header));
+        if (_stream.eof() || _stream.pointer(header[1]) == nullptr)
+            break;
 
-        i = 0;
-        uint32_t read_number = 0;
-        ::profiler::block_index_t blocks_counter = 0;
-        ::std::vector<char> name;
+        if (header[0] == 0 || header[0] > _number - records)
+            return false;
 
-        const size_t thread_id_t_size = version < EASY_V_130 ? sizeof(uint32_t) : sizeof(::profiler::thread_id_t);
+        records += header[0];
+        _decodedSize += header[2];
+    }
 
-        while (!inFile.eof())
-        {
-            EASY_BLOCK("Read thread data", ::profiler::colors::DarkGreen);
+    _number = records;
+    return true;
+}
 
-            ::profiler::thread_id_t thread_id = 0;
-            inFile.read((char*)&thread_id, thread_id_t_size);
-            if (inFile.eof())
-                break;
+/** Copy _number records of older formats from _records into _output.
 
-            auto& root = threaded_trees[thread_id];
+Empty extra data flags (see compact_format.h) are added to each block record.
 
-            uint16_t name_size = 0;
-            inFile.read((char*)&name_size, sizeof(uint16_t));
-            if (name_size != 0)
-            {
-                name.resize(name_size);
-                inFile.read(name.data(), name_size);
-                root.thread_name = name.data();
-            }
+\retval false if a record is corrupted.
+*/
+static bool copy_records(bool _cswitch, const char* _records, uint32_t _number, char* _output)
+{
+    const size_t headerSize = _cswitch ? sizeof(::profiler::CSwitchEvent) : sizeof(::profiler::BaseBlockData);
+    const uint16_t extraSize = _cswitch ? 0 : 1;
 
-            CsStatsMap per_thread_statistics_cs;
+    for (uint32_t k = 0; k < _number; ++k)
+    {
+        uint16_t sz = 0;
+        memcpy(&sz, _records, sizeof(sz));
+        _records += sizeof(sz);
 
-            uint32_t blocks_number_in_thread = 0;
-            inFile.read((char*)&blocks_number_in_thread, sizeof(decltype(blocks_number_in_thread)));
-            auto threshold = read_number + blocks_number_in_thread;
-            while (!inFile.eof() && read_number < threshold)
-            {
-                EASY_BLOCK("Read context switch", ::profiler::colors::Green);
+        // Record ends with '\0'-terminated name
+        if (sz <= headerSize || _records[sz - 1] != 0 || sz > 0xffff - extraSize)
+            return false;
 
-                ++read_number;
+        const auto decodedSize = static_cast<uint16_t>(sz + extraSize);
+        memcpy(_output, &decodedSize, sizeof(decodedSize));
+        _output += sizeof(decodedSize);
 
-                uint16_t sz = 0;
-                inFile.read((char*)&sz, sizeof(sz));
-                if (sz == 0)
-                {
-                    _log << "Bad CSwitch block size == 0";
-                    return 0;
-                }
+        memcpy(_output, _records, sz);
+        if (extraSize != 0)
+            _output[sz] = 0;
 
-                char* data = serialized_blocks[i];
-                inFile.read(data, sz);
-                i += sz;
-                auto baseData = reinterpret_cast<::profiler::SerializedCSwitch*>(data);
-                auto t_begin = reinterpret_cast<::profiler::timestamp_t*>(data);
-                auto t_end = t_begin + 1;
+        _records += sz;
+        _output += decodedSize;
+    }
 
-                if (cpu_frequency != 0)
-                {
-                    EASY_CONVERT_TO_NANO(*t_begin, cpu_frequency, conversion_factor);
-                    EASY_CONVERT_TO_NANO(*t_end, cpu_frequency, conversion_factor);
-                }
+    return true;
+}
 
-                if (*t_end > begin_time)
-                {
-                    if (*t_begin < begin_time)
-                        *t_begin = begin_time;
+/** Decode _number records from packets starting at _packets into _output.
 
-                    blocks.emplace_back();
-                    ::profiler::BlocksTree& tree = blocks.back();
-                    tree.cs = baseData;
-                    const auto block_index = blocks_counter++;
+\retval false if packets are corrupted.
+*/
+static bool decode_packets(bool _cswitch, const char* _packets, uint32_t _number, char* _output,
+                           const ::std::vector<::profiler::compact::RuntimeName>* _names = nullptr,
+                           ::std::vector<uint32_t>* _nameIds = nullptr,
+                           const ::profiler::compact::NamesTable* _namesTables = nullptr)
+{
+    uint32_t records = 0;
+    while (records < _number)
+    {
+        uint32_t header[3];
+        memcpy(header, _packets, sizeof(header));
+        _packets += sizeof(header);
 
-                    root.wait_time += baseData->duration();
-                    root.sync.emplace_back(block_index);
+        if (!::profiler::compact::decode(_cswitch, _packets, header[1], header[0], _output, header[2], _names, _nameIds, _namesTables))
+            return false;
 
-                    if (gather_statistics)
-                    {
-                        EASY_BLOCK("Gather per thread statistics", ::profiler::colors::Coral);
-                        tree.per_thread_stats = update_statistics(per_thread_statistics_cs, tree, block_index, ~0U, blocks);//, thread_id, blocks);
-                    }
-                }
+        _packets += header[1];
+        _output += header[2];
+        records += header[0];
+    }
 
-                if (!update_progress(progress, 20 + static_cast<int>(70 * i / memory_size), _log))
-                {
-                    return 0; // Loading interrupted
-                }
-            }
+    return true;
+}
 
-            if (inFile.eof())
-                break;
+/** Decode (or copy if they are stored in format of previous versions) blocks of the section into _output.
 
-            StatsMap per_thread_statistics;
+\param _output Buffer of the section decoded blocks size.
 
-            blocks_number_in_thread = 0;
-            inFile.read((char*)&blocks_number_in_thread, sizeof(decltype(blocks_number_in_thread)));
-            threshold = read_number + blocks_number_in_thread;
-            while (!inFile.eof() && read_number < threshold)
-            {
-                EASY_BLOCK("Read block", ::profiler::colors::Green);
+\retval false if blocks are corrupted.
+*/
+static bool decode_blocks(const ThreadSection& _section, bool _compact, char* _output, ::std::vector<uint32_t>* _nameIds = nullptr)
+{
+    if (_compact)
+        return decode_packets(false, _section.blocks_source, _section.blocks_number, _output, &_section.names, _nameIds, _section.names_tables);
+    return copy_records(false, _section.blocks_source, _section.blocks_number, _output);
+}
+
+static inline uint16_t next_record(char*& _data)
+{
+    uint16_t sz = 0;
+    memcpy(&sz, _data, sizeof(sz));
+    _data += sizeof(sz);
+    return sz;
+}
+
+/** Reads block descriptor of size _size into _data converting it from format of previous versions.
+
+Before v1.4.0 descriptors had no sampling rate: it is inserted right after BaseBlockDescriptor fields.
+
+\retval Size of the descriptor stored into _data.
+*/
+template <class TStream>
+static uint16_t read_descriptor(TStream& _stream, char* _data, uint16_t _size, uint32_t _version)
+{
+    if (_version >= EASY_V_140)
+    {
+        _stream.read(_data, _size);
+        return _size;
+    }
+
+    const uint16_t samplingOffset = static_cast<uint16_t>(sizeof(::profiler::BaseBlockDescriptor) - sizeof(uint16_t));
+    if (_size < samplingOffset)
+    {
+        _stream.read(_data, _size);
+        return _size; // corrupted descriptor
+    }
+
+    const uint16_t sampling = 1;
+    _stream.read(_data, samplingOffset);
+    memcpy(_data + samplingOffset, &sampling, sizeof(uint16_t));
+    _stream.read(_data + samplingOffset + sizeof(uint16_t), _size - samplingOffset);
+
+    return static_cast<uint16_t>(_size + sizeof(uint16_t));
+}
+
+/** Same as update_progress() but could be called from several threads: progress never decreases
+and interruption flag (negative value) is never overwritten.
+*/
+static bool update_progress_concurrent(::std::atomic<int>& progress, int new_value)
+{
+    auto oldprogress = progress.load(::std::memory_order_acquire);
+    while (oldprogress >= 0 && oldprogress < new_value && !progress.compare_exchange_weak(oldprogress, new_value, ::std::memory_order_release, ::std::memory_order_acquire));
+    return oldprogress >= 0;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+/** Reads header and descriptors, indexes thread sections, converts timestamps and generates ids for runtime names.
+
+This is common part for loading blocks into trees or into columns.
+
+Blocks are decoded (or copied if they are stored in format of previous versions) into new buffer which replaces serialized_blocks:
+file data is never modified, so it could be mapped read-only.
+
+\param file_data If not null then decoded blocks are dropped after counting and generating ids for runtime names:
+file data is moved here and blocks are decoded from it again by the caller thread by thread (see decode_blocks()
+and ThreadTask::named_ids), so only context switches and runtime names are kept in serialized_blocks.
+\param cpu_frequency Receives the frequency for converting timestamps of the file into nanoseconds (0 if they are in nanoseconds).
+\param runtime_names If not null then receives runtime names for generated ids (in order of generation).
+
+\retval Total number of blocks and context switches inside capture bounds or 0 in case of error.
+*/
+static ::profiler::block_index_t prepareThreadTasks(::std::atomic<int>& progress, MemoryStream& inFile,
+                                                    ::profiler::SerializedData& serialized_blocks,
+                                                    ::profiler::SerializedData& serialized_descriptors,
+                                                    ::profiler::descriptors_list_t& descriptors,
+                                                    uint32_t& total_descriptors_number,
+                                                    uint32_t& version,
+                                                    ::std::vector<ThreadSection>& sections,
+                                                    ::std::vector<ThreadTask>& tasks,
+                                                    ::profiler::timestamp_t& begin_time,
+                                                    ::profiler::SerializedData* file_data,
+                                                    uint64_t& cpu_frequency,
+                                                    ::std::vector<const char*>* runtime_names,
+                                                    ::std::stringstream& _log)
+{
+    const bool keep_blocks = file_data == nullptr;
+
+    if (!update_progress(progress, 0, _log))
+    {
+        return 0;
+    }
+
+    uint32_t signature = 0;
+    inFile.read((char*)&signature, sizeof(uint32_t));
+    if (signature != PROFILER_SIGNATURE)
+    {
+        _log << "Wrong signature " << signature << "\nThis is not EasyProfiler file/stream.";
+        return 0;
+    }
+
+    version = 0;
+    inFile.read((char*)&version, sizeof(uint32_t));
+    if (!isCompatibleVersion(version))
+    {
+        _log << "Incompatible version: v" << (version >> 24) << "." << ((version & 0x00ff0000) >> 16) << "." << (version & 0x0000ffff);
+        return 0;
+    }
+
+    processid_t pid = 0;
+    if (version > EASY_V_100)
+    {
+        if (version < EASY_V_130)
+        {
+            uint32_t old_pid = 0;
+            inFile.read((char*)&old_pid, sizeof(uint32_t));
+            pid = old_pid;
+        }
+        else
+        {
+            inFile.read((char*)&pid, sizeof(processid_t));
+        }
+    }
+
+    int64_t file_cpu_frequency = 0LL;
+    inFile.read((char*)&file_cpu_frequency, sizeof(int64_t));
+    cpu_frequency = file_cpu_frequency;
+
+    if (version >= EASY_V_140)
+    {
+        // Correct cached frequency by it's drift measured during the capture (in parts per billion)
+        int64_t drift = 0LL;
+        inFile.read((char*)&drift, sizeof(int64_t));
+        if (drift != 0 && cpu_frequency != 0)
+            cpu_frequency = static_cast<uint64_t>(static_cast<double>(cpu_frequency) * (1.0 + static_cast<double>(drift) * 1e-9) + 0.5);
+    }
+    const double conversion_factor = static_cast<double>(TIME_FACTOR) / static_cast<double>(cpu_frequency);
+
+    begin_time = 0ULL;
+    ::profiler::timestamp_t end_time = 0ULL;
+    inFile.read((char*)&begin_time, sizeof(::profiler::timestamp_t));
+    inFile.read((char*)&end_time, sizeof(::profiler::timestamp_t));
+    if (cpu_frequency != 0)
+    {
+        EASY_CONVERT_TO_NANO(begin_time, cpu_frequency, conversion_factor);
+        EASY_CONVERT_TO_NANO(end_time, cpu_frequency, conversion_factor);
+    }
+
+    uint32_t total_blocks_number = 0;
+    inFile.read((char*)&total_blocks_number, sizeof(uint32_t));
+    if (total_blocks_number == 0)
+    {
+        _log << "Profiled blocks number == 0";
+        return 0;
+    }
+
+    uint64_t memory_size = 0;
+    inFile.read((char*)&memory_size, sizeof(decltype(memory_size)));
+    if (memory_size == 0)
+    {
+        _log << "Wrong memory size == 0 for " << total_blocks_number << " blocks";
+        return 0;
+    }
+
+    total_descriptors_number = 0;
+    inFile.read((char*)&total_descriptors_number, sizeof(uint32_t));
+    if (total_descriptors_number == 0)
+    {
+        _log << "Blocks description number == 0";
+        return 0;
+    }
+
+    uint64_t descriptors_memory_size = 0;
+    inFile.read((char*)&descriptors_memory_size, sizeof(decltype(descriptors_memory_size)));
+    if (descriptors_memory_size == 0)
+    {
+        _log << "Wrong memory size == 0 for " << total_descriptors_number << " blocks descriptions";
+        return 0;
+    }
+
+    descriptors.reserve(total_descriptors_number);
+    //const char* olddata = append_regime ? serialized_descriptors.data() : nullptr;
+    if (version < EASY_V_140)
+        descriptors_memory_size += total_descriptors_number * sizeof(uint16_t); // sampling rate would be added to each descriptor
+    serialized_descriptors.set(descriptors_memory_size);
+    //validate_pointers(progress, olddata, serialized_descriptors, descriptors, descriptors.size());
+
+    uint64_t i = 0;
+    while (!inFile.eof() && descriptors.size() < total_descriptors_number)
+    {
+        uint16_t sz = 0;
+        inFile.read((char*)&sz, sizeof(sz));
+        if (sz == 0)
+        {
+            descriptors.push_back(nullptr);
+            continue;
+        }
+
+        //if (i + sz > descriptors_memory_size) {
+        //    printf("FILE CORRUPTED\n");
+        //    return 0;
+        //}
+
+        char* data = serialized_descriptors[i];
+        sz = read_descriptor(inFile, data, sz, version);
+        auto descriptor = reinterpret_cast<::profiler::SerializedBlockDescriptor*>(data);
+        descriptors.push_back(descriptor);
+
+        i += sz;
+        if (!update_progress(progress, static_cast<int>(15 * i / descriptors_memory_size), _log))
+        {
+            return 0;
+        }
+    }
+
+    // Index thread sections.
+    // Each thread section is self-contained, so all threads could be parsed in parallel.
+
+    const size_t thread_id_t_size = version < EASY_V_130 ? sizeof(uint32_t) : sizeof(::profiler::thread_id_t);
+    const bool compact = version >= EASY_V_140;
+
+    {
+        EASY_BLOCK("Index thread sections", ::profiler::colors::DarkGreen);
+
+        while (!inFile.eof())
+        {
+            ThreadSection section;
+
+            inFile.read((char*)&section.thread_id, thread_id_t_size);
+            if (inFile.eof())
+                break;
+
+            uint16_t name_size = 0;
+            inFile.read((char*)&name_size, sizeof(uint16_t));
+            if (name_size != 0)
+            {
+                const char* name = inFile.pointer(name_size);
+                if (name != nullptr)
+                    section.thread_name.assign(name, strnlen(name, name_size));
+            }
+
+            inFile.read((char*)&section.cs_number, sizeof(uint32_t));
+            section.cs_source = inFile.current();
+            if (compact)
+            {
+                if (!index_packets(inFile, section.cs_number, section.cs_size))
+                {
+                    _log << "Bad CSwitch packet";
+                    return 0;
+                }
+            }
+            else
+            {
+                if (!index_records(inFile, section.cs_number, section.cs_size))
+                {
+                    _log << "Bad CSwitch block size == 0";
+                    return 0;
+                }
+            }
+
+            if (inFile.eof())
+            {
+                sections.push_back(::std::move(section));
+                break;
+            }
+
+            inFile.read((char*)&section.blocks_number, sizeof(uint32_t));
+            section.blocks_source = inFile.current();
+            if (compact)
+            {
+                if (!index_packets(inFile, section.blocks_number, section.blocks_size))
+                {
+                    _log << "Bad block packet";
+                    return 0;
+                }
+
+                // Summaries and interned names are always written after blocks of the thread,
+                // so the end of file here means that the file is truncated
+                inFile.read((char*)&section.summaries_number, sizeof(uint32_t));
+                section.summaries = inFile.pointer(static_cast<uint64_t>(section.summaries_number) * SUMMARY_RECORD_SIZE);
+                if (inFile.eof() || section.summaries == nullptr)
+                {
+                    _log << "Unexpected end of file while reading summaries of thread " << section.thread_id;
+                    return 0;
+                }
+
+                for (auto& table : section.names_tables)
+                {
+                    inFile.read((char*)&table.generation, sizeof(uint32_t));
+                    inFile.read((char*)&table.size, sizeof(uint32_t));
+                    table.begin = static_cast<uint32_t>(section.names.size());
+                    for (uint32_t k = 0; k < table.size && !inFile.eof(); ++k)
+                    {
+                        uint16_t length = 0;
+                        inFile.read((char*)&length, sizeof(uint16_t));
+                        const char* name = inFile.pointer(length);
+                        if (name == nullptr)
+                            break;
+                        section.names.push_back({name, length});
+                    }
+                }
+
+                if (inFile.eof())
+                {
+                    _log << "Unexpected end of file while reading runtime names of thread " << section.thread_id;
+                    return 0;
+                }
+            }
+            else
+            {
+                if (!index_records(inFile, section.blocks_number, section.blocks_size))
+                {
+                    _log << "Bad block size == 0";
+                    return 0;
+                }
+
+                section.blocks_size += section.blocks_number; // extra data flags of each decoded block record
+            }
+
+            sections.push_back(::std::move(section));
+        }
+    }
+
+    // Allocate memory for decoded blocks of all threads: they would be decoded in parallel.
+    // The file is mapped read-only, so blocks of older formats are copied too: their timestamps are converted and
+    // ids of blocks with runtime names are replaced.
+
+    ::profiler::SerializedData decoded;
+    {
+        uint64_t decoded_size = 0;
+        for (const auto& section : sections)
+            decoded_size += section.cs_size + (keep_blocks ? section.blocks_size : 0);
+
+        decoded.set(decoded_size);
+
+        uint64_t offset = 0;
+        for (auto& section : sections)
+        {
+            section.cs_begin = decoded[offset];
+            offset += section.cs_size;
+            if (keep_blocks)
+            {
+                section.blocks_begin = decoded[offset];
+                offset += section.blocks_size;
+            }
+        }
+    }
+
+    if (!update_progress(progress, 20, _log))
+    {
+        return 0;
+    }
+
+    // Group sections by thread id (in order of appearance in the file)
+
+    {
+        ::std::unordered_map<::profiler::thread_id_t, size_t, ::profiler::passthrough_hash<::profiler::thread_id_t> > task_indices;
+        for (const auto& section : sections)
+        {
+            auto it = task_indices.find(section.thread_id);
+            if (it == task_indices.end())
+            {
+                it = task_indices.emplace(section.thread_id, tasks.size()).first;
+                tasks.emplace_back();
+
+                tasks.back().thread_id = section.thread_id;
+            }
+
+            auto& task = tasks[it->second];
+            task.sections.push_back(&section);
+            if (!section.thread_name.empty())
+                task.thread_name = section.thread_name;
+        }
+    }
+
+    // Convert timestamps, validate blocks and count blocks which are inside capture bounds
+
+    const size_t tasks_number = tasks.size();
+    ::std::atomic<size_t> tasks_done(ATOMIC_VAR_INIT(0));
+
+    ::profiler::parallel_for(tasks_number, [&](size_t _index)
+    {
+        auto& task = tasks[_index];
+        ::std::vector<uint32_t> name_ids;
+        ::std::vector<char> section_blocks; // Decoded blocks of one section if they are not kept
+        ::std::vector<bool> copied_names; // Interned names which have been copied into task.names
+
+        for (auto section : task.sections)
+        {
+            name_ids.clear();
+
+            char* blocks = section->blocks_begin;
+            if (!keep_blocks)
+            {
+                section_blocks.resize(static_cast<size_t>(section->blocks_size));
+                blocks = section_blocks.data();
+                copied_names.resize(task.names_number + section->names.size(), false);
+            }
+
+            if (compact)
+            {
+                if (!decode_packets(true, section->cs_source, section->cs_number, section->cs_begin) ||
+                    !decode_blocks(*section, compact, blocks, &name_ids))
+                {
+                    task.error = "Bad packet for thread " + ::std::to_string(section->thread_id);
+                    return;
+                }
+            }
+            else
+            {
+                if (!copy_records(true, section->cs_source, section->cs_number, section->cs_begin) ||
+                    !decode_blocks(*section, compact, blocks))
+                {
+                    task.error = "Bad record for thread " + ::std::to_string(section->thread_id);
+                    return;
+                }
+            }
+
+            char* data = section->cs_begin;
+            for (uint32_t k = 0; k < section->cs_number; ++k)
+            {
+                const auto sz = next_record(data);
+                auto t_begin = reinterpret_cast<::profiler::timestamp_t*>(data);
+                auto t_end = t_begin + 1;
+                data += sz;
+
+                if (cpu_frequency != 0)
+                {
+                    EASY_CONVERT_TO_NANO(*t_begin, cpu_frequency, conversion_factor);
+                    EASY_CONVERT_TO_NANO(*t_end, cpu_frequency, conversion_factor);
+                }
+
+                if (*t_end > begin_time)
+                {
+                    if (*t_begin < begin_time)
+                        *t_begin = begin_time;
+                    ++task.blocks_number;
+                    ++task.sync_number;
+                }
+            }
+
+            data = blocks;
+            size_t named_index = 0;
+            for (uint32_t k = 0; k < section->blocks_number; ++k)
+            {
+                const auto sz = next_record(data);
+                auto baseData = reinterpret_cast<::profiler::SerializedBlock*>(data);
+                auto t_begin = reinterpret_cast<::profiler::timestamp_t*>(data);
+                auto t_end = t_begin + 1;
+                data += sz;
+
+                if (baseData->id() >= total_descriptors_number)
+                {
+                    task.error = "Bad block id == " + ::std::to_string(baseData->id());
+                    return;
+                }
+
+                if (descriptors[baseData->id()] == nullptr)
+                {
+                    task.error = "Bad block id == " + ::std::to_string(baseData->id()) + ". Description is null.";
+                    return;
+                }
+
+                if (cpu_frequency != 0)
+                {
+                    EASY_CONVERT_TO_NANO(*t_begin, cpu_frequency, conversion_factor);
+                    EASY_CONVERT_TO_NANO(*t_end, cpu_frequency, conversion_factor);
+                }
+
+                if (*t_end >= begin_time)
+                {
+                    if (*t_begin < begin_time)
+                        *t_begin = begin_time;
+
+                    ++task.blocks_number;
+                }
+
+                if (*baseData->name() != 0)
+                {
+                    // Interned name ids of the section are converted into indices of interned names of the task
+                    uint32_t name_index = ::profiler::compact::NO_NAME_ID;
+                    if (named_index < name_ids.size() && name_ids[named_index] != ::profiler::compact::NO_NAME_ID)
+                        name_index = task.names_number + name_ids[named_index];
+                    ++named_index;
+
+                    if (*t_end >= begin_time)
+                    {
+                        NamedBlock named = {baseData, 0, name_index, baseData->id()};
+                        if (!keep_blocks)
+                        {
+                            // Decoded block would be dropped: copy it's name (only once for interned names,
+                            // the other blocks with the same interned name get the same id without it)
+                            named.block = nullptr;
+                            if (name_index == ::profiler::compact::NO_NAME_ID || !copied_names[name_index])
+                            {
+                                const char* name = baseData->name();
+                                named.name = task.names.size();
+                                task.names.insert(task.names.end(), name, name + strlen(name) + 1);
+                                if (name_index != ::profiler::compact::NO_NAME_ID)
+                                    copied_names[name_index] = true;
+                            }
+                        }
+
+                        task.named_blocks.push_back(named);
+                    }
+                }
+            }
+
+            task.names_number += static_cast<uint32_t>(section->names.size());
+
+            const char* summary = section->summaries;
+            for (uint32_t k = 0; k < section->summaries_number; ++k, summary += SUMMARY_RECORD_SIZE)
+            {
+                ::profiler::block_id_t id = 0;
+                ::profiler::calls_number_t calls_number = 0;
+                ::profiler::timestamp_t duration = 0;
+                memcpy(&id, summary, sizeof(id));
+                memcpy(&calls_number, summary + sizeof(id), sizeof(calls_number));
+                memcpy(&duration, summary + sizeof(id) + sizeof(calls_number), sizeof(duration));
+
+                if (id >= total_descriptors_number || descriptors[id] == nullptr)
+                {
+                    task.error = "Bad summary block id == " + ::std::to_string(id);
+                    return;
+                }
+
+                if (cpu_frequency != 0)
+                {
+                    EASY_CONVERT_TO_NANO(duration, cpu_frequency, conversion_factor);
+                }
+
+                auto it = ::std::find_if(task.summaries.begin(), task.summaries.end(), [id](const ::profiler::BlockSummary& s) { return s.id == id; });
+                if (it == task.summaries.end())
+                {
+                    task.summaries.emplace_back(id, calls_number, duration);
+                }
+                else
+                {
+                    it->calls_number += calls_number;
+                    it->total_duration += duration;
+                }
+            }
+        }
+
+        update_progress_concurrent(progress, 20 + static_cast<int>(30 * ++tasks_done / tasks_number));
+    });
+
+    for (const auto& task : tasks)
+    {
+        if (!task.error.empty())
+        {
+            _log << task.error;
+            return 0;
+        }
+    }
+
+    if (progress.load(::std::memory_order_acquire) < 0)
+    {
+        _log << "Reading was interrupted";
+        return 0; // Loading interrupted
+    }
+
+    // File data is not needed anymore (unless blocks are decoded on demand): use decoded blocks instead
+    serialized_blocks.swap(decoded);
+    if (!keep_blocks)
+        file_data->swap(decoded);
+
+    // Assign blocks index range for each thread and generate ids for blocks with runtime names.
+    // This is done sequentially to keep generated ids independent from threads scheduling.
+
+    ::profiler::block_index_t blocks_counter = 0;
+    {
+        EASY_BLOCK("Generate ids for runtime names", ::profiler::colors::Blue);
+
+        IdMap identification_table;
+        ::std::vector<::profiler::block_id_t> interned_ids; // Generated id for each interned name of current task
+        for (auto& task : tasks)
+        {
+            task.blocks_begin = blocks_counter;
+            blocks_counter += task.blocks_number;
+
+            interned_ids.assign(task.names_number, ::profiler::compact::NO_NAME_ID);
+
+            if (!keep_blocks)
+                task.named_ids.reserve(task.named_blocks.size());
+
+            for (const auto& named_block : task.named_blocks)
+            {
+                // Blocks with the same interned name are resolved by name index without hashing their names again
+                ::profiler::block_id_t* interned_id = nullptr;
+                ::profiler::block_id_t id = ::profiler::compact::NO_NAME_ID;
+                if (named_block.name_index != ::profiler::compact::NO_NAME_ID)
+                {
+                    interned_id = &interned_ids[named_block.name_index];
+                    id = *interned_id;
+                }
+
+                if (id == ::profiler::compact::NO_NAME_ID)
+                {
+                    // If block has runtime name then generate new id for such block.
+                    // Blocks with the same name will have same id.
+
+                    const char* name = named_block.block != nullptr ? named_block.block->name() : task.names.data() + named_block.name;
+                    IdMap::key_type key(name);
+                    auto it = identification_table.find(key);
+                    if (it != identification_table.end())
+                    {
+                        // There is already block with such name, use it's id
+                        id = it->second;
+                    }
+                    else
+                    {
+                        // There were no blocks with such name, generate new id and save it in the table for further usage.
+                        id = static_cast<::profiler::block_id_t>(descriptors.size());
+                        identification_table.emplace(key, id);
+                        if (descriptors.capacity() == descriptors.size())
+                            descriptors.reserve((descriptors.size() * 3) >> 1);
+                        descriptors.push_back(descriptors[named_block.id]);
+                        if (runtime_names != nullptr)
+                            runtime_names->push_back(name);
+                    }
+
+                    if (interned_id != nullptr)
+                        *interned_id = id;
+                }
+
+                if (named_block.block != nullptr)
+                    named_block.block->setId(id);
+                else
+                    task.named_ids.push_back(id);
+            }
+
+            task.named_blocks.clear();
+            task.named_blocks.shrink_to_fit();
+        }
+    }
+
+    if (!keep_blocks && runtime_names != nullptr && !runtime_names->empty())
+    {
+        // Runtime names are kept after context switches: names of tasks are freed
+        uint64_t names_size = 0;
+        for (auto name : *runtime_names)
+            names_size += strlen(name) + 1;
+
+        const uint64_t cs_size = serialized_blocks.size();
+        ::profiler::SerializedData data;
+        data.set(cs_size + names_size);
+        if (cs_size != 0)
+        {
+            memcpy(data.data(), serialized_blocks.data(), static_cast<size_t>(cs_size));
+            for (auto& section : sections)
+                section.cs_begin = data[static_cast<uint64_t>(section.cs_begin - serialized_blocks.data())];
+        }
+
+        char* output = data[cs_size];
+        for (auto& name : *runtime_names)
+        {
+            const auto size = strlen(name) + 1;
+            memcpy(output, name, size);
+            name = output;
+            output += size;
+        }
+
+        serialized_blocks.swap(data);
+    }
+
+    for (auto& task : tasks)
+        ::std::vector<char>().swap(task.names);
+
+    return blocks_counter;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static ::profiler::block_index_t fillTreesFromMemory(::std::atomic<int>& progress, MemoryStream& inFile,
+                                                     ::profiler::SerializedData& serialized_blocks,
+                                                     ::profiler::SerializedData& serialized_descriptors,
+                                                     ::profiler::descriptors_list_t& descriptors,
+                                                     ::profiler::blocks_t& blocks,
+                                                     ::profiler::thread_blocks_tree_t& threaded_trees,
+                                                     uint32_t& total_descriptors_number,
+                                                     uint32_t& version,
+                                                     bool gather_statistics,
+                                                     ::std::stringstream& _log)
+{
+    EASY_FUNCTION(::profiler::colors::Cyan);
+
+    ::std::vector<ThreadSection> sections;
+    ::std::vector<ThreadTask> tasks;
+    ::profiler::timestamp_t begin_time = 0ULL;
+
+    uint64_t cpu_frequency = 0;
+    const auto blocks_counter = prepareThreadTasks(progress, inFile, serialized_blocks, serialized_descriptors, descriptors, total_descriptors_number,
+                                                   version, sections, tasks, begin_time, nullptr, cpu_frequency, nullptr, _log);
+    if (blocks_counter == 0)
+        return 0;
+
+    for (auto& task : tasks)
+    {
+        task.root = &threaded_trees[task.thread_id];
+        if (!task.thread_name.empty())
+            task.root->thread_name = task.thread_name;
+    }
+
+    blocks.resize(blocks_counter);
+
+    const size_t tasks_number = tasks.size();
+    ::std::atomic<size_t> tasks_done(ATOMIC_VAR_INIT(0));
+
+    // Build blocks hierarchy for each thread
+
+    ::profiler::parallel_for(tasks_number, [&](size_t _index)
+    {
+        auto& task = tasks[_index];
+        auto& root = *task.root;
+        auto block_index = task.blocks_begin;
+
+        root.summaries = ::std::move(task.summaries);
+
+        CsStatsMap per_thread_statistics_cs;
+        StatsMap per_thread_statistics, per_parent_statistics;
+
+        for (auto section : task.sections)
+        {
+            if (progress.load(::std::memory_order_acquire) < 0)
+                return; // Loading interrupted
+
+            char* data = section->cs_begin;
+            for (uint32_t k = 0; k < section->cs_number; ++k)
+            {
+                const auto sz = next_record(data);
+                auto baseData = reinterpret_cast<::profiler::SerializedCSwitch*>(data);
+                data += sz;
+
+                if (baseData->end() <= begin_time)
+                    continue;
+
+                ::profiler::BlocksTree& tree = blocks[block_index];
+                tree.cs = baseData;
+
+                root.wait_time += baseData->duration();
+                root.sync.emplace_back(block_index);
+
+                if (gather_statistics)
+                    tree.per_thread_stats = update_statistics(per_thread_statistics_cs, tree, block_index, ~0U, blocks);
+
+                ++block_index;
+            }
+
+            data = section->blocks_begin;
+            for (uint32_t k = 0; k < section->blocks_number; ++k)
+            {
+                const auto sz = next_record(data);
+                auto baseData = reinterpret_cast<::profiler::SerializedBlock*>(data);
+                data += sz;
+
+                if (baseData->end() < begin_time)
+                    continue;
+
+                ::profiler::BlocksTree& tree = blocks[block_index];
+                tree.node = baseData;
+
+                const auto desc = descriptors[baseData->id()];
+
+                if (!root.children.empty())
+                {
+                    auto& back = blocks[root.children.back()];
+                    auto t1 = back.node->end();
+                    auto mt0 = tree.node->begin();
+                    if (mt0 < t1)//parent - starts earlier than last ends
+                    {
+                        auto rlower1 = ++root.children.rbegin();
+                        for (; rlower1 != root.children.rend() && !(mt0 > blocks[*rlower1].node->begin()); ++rlower1);
+                        auto lower = rlower1.base();
+                        ::std::move(lower, root.children.end(), ::std::back_inserter(tree.children));
 
-                ++read_number;
+                        root.children.erase(lower, root.children.end());
 
-                uint16_t sz = 0;
-                inFile.read((char*)&sz, sizeof(sz));
-                if (sz == 0)
-                {
-                    _log << "Bad block size == 0";
-                    return 0;
-                }
+                        if (gather_statistics)
+                        {
+                            per_parent_statistics.clear();
 
-                char* data = serialized_blocks[i];
-                inFile.read(data, sz);
-                i += sz;
-                auto baseData = reinterpret_cast<::profiler::SerializedBlock*>(data);
-                if (baseData->id() >= total_descriptors_number)
-                {
-                    _log << "Bad block id == " << baseData->id();
-                    return 0;
+                            for (auto child_block_index : tree.children)
+                            {
+                                auto& child = blocks[child_block_index];
+                                child.per_parent_stats = update_statistics(per_parent_statistics, child, child_block_index, block_index, blocks);
+                                if (tree.depth < child.depth)
+                                    tree.depth = child.depth;
+                            }
+                        }
+                        else
+                        {
+                            for (auto child_block_index : tree.children)
+                            {
+                                const auto& child = blocks[child_block_index];
+                                if (tree.depth < child.depth)
+                                    tree.depth = child.depth;
+                            }
+                        }
+
+                        if (tree.depth == 254)
+                        {
+                            // 254 because we need 1 additional level for root (thread).
+                            // In other words: real stack depth = 1 root block + 254 children
+
+                            ::std::ostringstream error;
+                            if (*tree.node->name() != 0)
+                                error << "Stack depth exceeded value of 254\nfor block \"" << desc->name() << "\"";
+                            else
+                                error << "Stack depth exceeded value of 254\nfor block \"" << desc->name() << "\"\nfrom file \"" << desc->file() << "\":" << desc->line();
+                            task.error = error.str();
+
+                            return;
+                        }
+
+                        ++tree.depth;
+                    }
                 }
 
-                auto desc = descriptors[baseData->id()];
-                if (desc == nullptr)
+                ++root.blocks_number;
+                root.children.emplace_back(block_index);
+                if (desc->type() == ::profiler::BLOCK_TYPE_EVENT)
+                    root.events.emplace_back(block_index);
+
+                if (gather_statistics)
+                    tree.per_thread_stats = update_statistics(per_thread_statistics, tree, block_index, ~0U, blocks);
+
+                ++block_index;
+            }
+        }
+
+        update_progress_concurrent(progress, 50 + static_cast<int>(40 * ++tasks_done / tasks_number));
+    });
+
+    for (const auto& task : tasks)
+    {
+        if (!task.error.empty())
+        {
+            _log << task.error;
+            return 0;
+        }
+    }
+
+    if (progress.load(::std::memory_order_acquire) < 0)
+    {
+        _log << "Reading was interrupted";
+        return 0; // Loading interrupted
+    }
+
+    EASY_BLOCK("Gather statistics for roots", ::profiler::colors::Purple);
+    tasks_done.store(0, ::std::memory_order_release);
+
+    ::profiler::parallel_for(tasks_number, [&](size_t _index)
+    {
+        auto& root = *tasks[_index].root;
+        root.thread_id = tasks[_index].thread_id;
+
+        if (gather_statistics)
+        {
+            StatsMap per_parent_statistics, per_frame_statistics;
+
+            ::profiler::block_index_t cs_index = 0;
+            for (auto i : root.children)
+            {
+                auto& frame = blocks[i];
+
+                if (descriptors[frame.node->id()]->type() == ::profiler::BLOCK_TYPE_BLOCK)
+                    ++root.frames_number;
+
+                frame.per_parent_stats = update_statistics(per_parent_statistics, frame, i, ~0U, blocks);
+
+                per_frame_statistics.clear();
+                update_statistics_recursive(per_frame_statistics, frame, i, i, blocks);
+
+                if (cs_index < root.sync.size())
                 {
-                    _log << "Bad block id == " << baseData->id() << ". Description is null.";
-                    return 0;
+                    CsStatsMap frame_stats_cs;
+                    do {
+
+                        auto j = root.sync[cs_index];
+                        auto& cs = blocks[j];
+                        if (cs.node->end() < frame.node->begin())
+                            continue;
+                        if (cs.node->begin() > frame.node->end())
+                            break;
+                        cs.per_frame_stats = update_statistics(frame_stats_cs, cs, cs_index, i, blocks);
+
+                    } while (++cs_index < root.sync.size());
                 }
 
+                if (root.depth < frame.depth)
+                    root.depth = frame.depth;
+
+                root.profiled_time += frame.node->duration();
+            }
+        }
+        else
+        {
+            for (auto child_block_index : root.children)
+            {
+                auto& frame = blocks[child_block_index];
+
+                if (descriptors[frame.node->id()]->type() == ::profiler::BLOCK_TYPE_BLOCK)
+                    ++root.frames_number;
+
+                if (root.depth < frame.depth)
+                    root.depth = frame.depth;
+
+                root.profiled_time += frame.node->duration();
+            }
+        }
+
+        ++root.depth;
+
+        update_progress_concurrent(progress, 90 + static_cast<int>(10 * ++tasks_done / tasks_number));
+    });
+
+    // No need to delete BlockStatistics instances - they will be deleted inside BlocksTree destructors
+
+    return blocks_counter;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static ::profiler::block_index_t fillColumnsFromMemory(::std::atomic<int>& progress, MemoryStream& inFile,
+                                                       ::profiler::SerializedData& serialized_blocks,
+                                                       ::profiler::SerializedData& serialized_descriptors,
+                                                       ::profiler::descriptors_list_t& descriptors,
+                                                       ::profiler::BlocksColumns& columns,
+                                                       uint32_t& total_descriptors_number,
+                                                       uint32_t& version,
+                                                       bool gather_statistics,
+                                                       ::std::stringstream& _log)
+{
+    EASY_FUNCTION(::profiler::colors::Cyan);
+
+    using ::profiler::NO_BLOCK_INDEX;
+
+    ::std::vector<ThreadSection> sections;
+    ::std::vector<ThreadTask> tasks;
+    ::profiler::timestamp_t begin_time = 0ULL;
+
+    columns.clear();
+
+    // Blocks are decoded from the file data on demand thread by thread: only columns are kept for them
+    ::profiler::SerializedData file_data;
+    uint64_t cpu_frequency = 0;
+    const auto records_counter = prepareThreadTasks(progress, inFile, serialized_blocks, serialized_descriptors, descriptors, total_descriptors_number,
+                                                    version, sections, tasks, begin_time, &file_data, cpu_frequency, &columns.runtime_names, _log);
+    if (records_counter == 0)
+        return 0;
+
+    // Context switches are stored separately (per thread), so columns contain only blocks
+    ::profiler::block_index_t blocks_counter = 0;
+    for (auto& task : tasks)
+    {
+        task.blocks_begin = blocks_counter;
+        blocks_counter += task.blocks_number - task.sync_number;
+    }
+
+    columns.first_runtime_id = total_descriptors_number;
+    columns.resize(blocks_counter);
+    columns.threads.resize(tasks.size());
+
+    const bool compact = version >= EASY_V_140;
+    const double conversion_factor = static_cast<double>(TIME_FACTOR) / static_cast<double>(cpu_frequency);
+
+    const size_t tasks_number = tasks.size();
+    ::std::atomic<size_t> tasks_done(ATOMIC_VAR_INIT(0));
+
+    ::profiler::parallel_for(tasks_number, [&](size_t _index)
+    {
+        auto& task = tasks[_index];
+        auto& thread = columns.threads[_index];
+        auto block_index = task.blocks_begin;
+
+        thread.thread_id = task.thread_id;
+        thread.thread_name = ::std::move(task.thread_name);
+        thread.summaries = ::std::move(task.summaries);
+        thread.sync.reserve(task.sync_number);
+
+        // Current top-level blocks: they become children of the next block which starts earlier than they end
+        ::std::vector<::profiler::block_index_t> top;
+
+        ::std::vector<char> section_blocks; // Decoded blocks of the current section
+        size_t named_index = 0;
+
+        for (auto section : task.sections)
+        {
+            if (progress.load(::std::memory_order_acquire) < 0)
+                return; // Loading interrupted
+
+            section_blocks.resize(static_cast<size_t>(section->blocks_size));
+            if (!decode_blocks(*section, compact, section_blocks.data()))
+            {
+                task.error = "Bad block for thread " + ::std::to_string(section->thread_id);
+                return;
+            }
+
+            char* data = section->cs_begin;
+            for (uint32_t k = 0; k < section->cs_number; ++k)
+            {
+                const auto sz = next_record(data);
+                auto baseData = reinterpret_cast<::profiler::SerializedCSwitch*>(data);
+                data += sz;
+
+                if (baseData->end() <= begin_time)
+                    continue;
+
+                thread.wait_time += baseData->duration();
+                thread.sync.push_back(baseData);
+            }
+
+            data = section_blocks.data();
+            for (uint32_t k = 0; k < section->blocks_number; ++k)
+            {
+                const auto sz = next_record(data);
+                auto baseData = reinterpret_cast<::profiler::SerializedBlock*>(data);
                 auto t_begin = reinterpret_cast<::profiler::timestamp_t*>(data);
                 auto t_end = t_begin + 1;
+                data += sz;
 
+                // Blocks have been validated by prepareThreadTasks() which generated ids for their runtime names
                 if (cpu_frequency != 0)
                 {
                     EASY_CONVERT_TO_NANO(*t_begin, cpu_frequency, conversion_factor);
                     EASY_CONVERT_TO_NANO(*t_end, cpu_frequency, conversion_factor);
                 }
 
-                if (*t_end >= begin_time)
-                {
-                    if (*t_begin < begin_time)
-                        *t_begin = begin_time;
+                if (*t_end < begin_time)
+                    continue;
 
-                    blocks.emplace_back();
-                    ::profiler::BlocksTree& tree = blocks.back();
-                    tree.node = baseData;
-                    const auto block_index = blocks_counter++;
+                if (*t_begin < begin_time)
+                    *t_begin = begin_time;
 
-                    if (*tree.node->name() != 0)
-                    {
-                        // If block has runtime name then generate new id for such block.
-                        // Blocks with the same name will have same id.
+                if (*baseData->name() != 0)
+                    baseData->setId(task.named_ids[named_index++]);
 
-                        IdMap::key_type key(tree.node->name());
-                        auto it = identification_table.find(key);
-                        if (it != identification_table.end())
-                        {
-                            // There is already block with such name, use it's id
-                            baseData->setId(it->second);
-                        }
-                        else
-                        {
-                            // There were no blocks with such name, generate new id and save it in the table for further usage.
-                            auto id = static_cast<::profiler::block_id_t>(descriptors.size());
-                            identification_table.emplace(key, id);
-                            if (descriptors.capacity() == descriptors.size())
-                                descriptors.reserve((descriptors.size() * 3) >> 1);
-                            descriptors.push_back(descriptors[baseData->id()]);
-                            baseData->setId(id);
-                        }
-                    }
+                const auto t0 = baseData->begin();
+                const auto t1 = baseData->end();
+                columns.begin[block_index] = t0;
+                columns.end[block_index] = t1;
+                columns.id[block_index] = baseData->id();
+                columns.sampling[block_index] = ::profiler::readSampling(baseData);
 
-                    if (!root.children.empty())
+                ::profiler::timestamp_t children_duration = 0;
+                if (!top.empty() && t0 < columns.end[top.back()])
+                {
+                    // parent - starts earlier than last ends
+                    auto rlower1 = ++top.rbegin();
+                    for (; rlower1 != top.rend() && !(t0 > columns.begin[*rlower1]); ++rlower1);
+                    auto lower = rlower1.base();
+
+                    uint8_t depth = 0;
+                    columns.first_child[block_index] = *lower;
+                    for (auto it = lower; it != top.end(); ++it)
                     {
-                        auto& back = blocks[root.children.back()];
-                        auto t1 = back.node->end();
-                        auto mt0 = tree.node->begin();
-                        if (mt0 < t1)//parent - starts earlier than last ends
-                        {
-                            //auto lower = ::std::lower_bound(root.children.begin(), root.children.end(), tree);
-                            /**/
-                            EASY_BLOCK("Find children", ::profiler::colors::Blue);
-                            auto rlower1 = ++root.children.rbegin();
-                            for (; rlower1 != root.children.rend() && !(mt0 > blocks[*rlower1].node->begin()); ++rlower1);
-                            auto lower = rlower1.base();
-                            ::std::move(lower, root.children.end(), ::std::back_inserter(tree.children));
-
-                            root.children.erase(lower, root.children.end());
-                            EASY_END_BLOCK;
-
-                            if (gather_statistics)
-                            {
-                                EASY_BLOCK("Gather statistic within parent", ::profiler::colors::Magenta);
-                                auto& per_parent_statistics = parent_statistics[thread_id];
-                                per_parent_statistics.clear();
-
-                                //per_parent_statistics.reserve(tree.children.size());     // this gives slow-down on Windows
-                                //per_parent_statistics.reserve(tree.children.size() * 2); // this gives no speed-up on Windows
-                                // TODO: check this behavior on Linux
-
-                                for (auto child_block_index : tree.children)
-                                {
-                                    auto& child = blocks[child_block_index];
-                                    child.per_parent_stats = update_statistics(per_parent_statistics, child, child_block_index, block_index, blocks);
-                                    if (tree.depth < child.depth)
-                                        tree.depth = child.depth;
-                                }
-                            }
-                            else
-                            {
-                                for (auto child_block_index : tree.children)
-                                {
-                                    const auto& child = blocks[child_block_index];
-                                    if (tree.depth < child.depth)
-                                        tree.depth = child.depth;
-                                }
-                            }
+                        const auto child = *it;
+                        columns.parent[child] = block_index;
+                        if (it + 1 != top.end())
+                            columns.next_sibling[child] = *(it + 1);
+                        if (depth < columns.depth[child])
+                            depth = columns.depth[child];
+                        children_duration += columns.duration(child) * columns.sampling[child];
+                    }
 
-                            if (tree.depth == 254)
-                            {
-                                // 254 because we need 1 additional level for root (thread).
-                                // In other words: real stack depth = 1 root block + 254 children
+                    top.erase(lower, top.end());
 
-                                if (*tree.node->name() != 0)
-                                    _log << "Stack depth exceeded value of 254\nfor block \"" << desc->name() << "\"";
-                                else
-                                    _log << "Stack depth exceeded value of 254\nfor block \"" << desc->name() << "\"\nfrom file \"" << desc->file() << "\":" << desc->line();
+                    if (depth == 254)
+                    {
+                        // 254 because we need 1 additional level for root (thread).
+                        // In other words: real stack depth = 1 root block + 254 children
 
-                                return 0;
-                            }
+                        const auto desc = descriptors[baseData->id()];
+                        ::std::ostringstream error;
+                        if (*baseData->name() != 0)
+                            error << "Stack depth exceeded value of 254\nfor block \"" << desc->name() << "\"";
+                        else
+                            error << "Stack depth exceeded value of 254\nfor block \"" << desc->name() << "\"\nfrom file \"" << desc->file() << "\":" << desc->line();
+                        task.error = error.str();
 
-                            ++tree.depth;
-                        }
+                        return;
                     }
 
-                    ++root.blocks_number;
-                    root.children.emplace_back(block_index);// ::std::move(tree));
-                    if (desc->type() == ::profiler::BLOCK_TYPE_EVENT)
-                        root.events.emplace_back(block_index);
+                    columns.depth[block_index] = depth + 1;
+                }
 
+                ++thread.blocks_number;
+                top.push_back(block_index);
 
-                    if (gather_statistics)
+                if (gather_statistics)
+                {
+                    const auto duration = t1 - t0;
+                    const auto sampling = columns.sampling[block_index];
+                    auto it = thread.statistics.find(baseData->id());
+                    if (it == thread.statistics.end())
+                    {
+                        auto& stats = thread.statistics.emplace(baseData->id(), ::profiler::BlockStatistics(duration, block_index, ~0U, sampling)).first->second;
+                        stats.total_children_duration = children_duration * sampling;
+                        update_perf_counters(stats, baseData, sampling);
+                    }
+                    else
                     {
-                        EASY_BLOCK("Gather per thread statistics", ::profiler::colors::Coral);
-                        tree.per_thread_stats = update_statistics(per_thread_statistics, tree, block_index, ~0U, blocks);//, thread_id, blocks);
+                        auto& stats = it->second;
+                        stats.calls_number += sampling;
+                        stats.total_duration += duration * sampling;
+                        stats.total_children_duration += children_duration * sampling;
+                        if (duration > columns.duration(stats.max_duration_block))
+                            stats.max_duration_block = block_index;
+                        if (duration < columns.duration(stats.min_duration_block))
+                            stats.min_duration_block = block_index;
+                        update_perf_counters(stats, baseData, sampling);
                     }
                 }
 
-                if (!update_progress(progress, 20 + static_cast<int>(70 * i / memory_size), _log))
-                {
-                    return 0; // Loading interrupted
-                }
+                ++block_index;
             }
         }
 
-        if (progress.load(::std::memory_order_acquire) < 0)
+        // Link top-level blocks into frames list
+
+        if (!top.empty())
+            thread.first_frame = top.front();
+
+        for (size_t i = 0, size = top.size(); i < size; ++i)
         {
-            _log << "Reading was interrupted";
-            return 0; // Loading interrupted
+            const auto frame = top[i];
+            if (i + 1 < size)
+                columns.next_sibling[frame] = top[i + 1];
+
+            const auto type = descriptors[columns.id[frame]]->type();
+            if (type == ::profiler::BLOCK_TYPE_BLOCK)
+                ++thread.frames_number;
+            else if (type == ::profiler::BLOCK_TYPE_EVENT)
+                thread.events.push_back(frame);
+
+            if (thread.depth < columns.depth[frame])
+                thread.depth = columns.depth[frame];
+
+            thread.profiled_time += columns.duration(frame);
         }
 
-        EASY_BLOCK("Gather statistics for roots", ::profiler::colors::Purple);
-        if (gather_statistics)
+        ++thread.depth;
+
+        update_progress_concurrent(progress, 50 + static_cast<int>(50 * ++tasks_done / tasks_number));
+    });
+
+    for (const auto& task : tasks)
+    {
+        if (!task.error.empty())
         {
-            ::std::vector<::std::thread> statistics_threads;
-            statistics_threads.reserve(threaded_trees.size());
+            _log << task.error;
+            columns.clear();
+            return 0;
+        }
+    }
 
-            for (auto& it : threaded_trees)
-            {
-                auto& root = it.second;
-                root.thread_id = it.first;
-                //root.tree.shrink_to_fit();
+    if (progress.load(::std::memory_order_acquire) < 0)
+    {
+        _log << "Reading was interrupted";
+        columns.clear();
+        return 0; // Loading interrupted
+    }
 
-                auto& per_frame_statistics = frame_statistics[root.thread_id];
-                auto& per_parent_statistics = parent_statistics[it.first];
-                per_parent_statistics.clear();
+    return blocks_counter;
+}
 
-                statistics_threads.emplace_back(::std::thread([&per_parent_statistics, &per_frame_statistics, &blocks, &descriptors](::profiler::BlocksTreeRoot& root)
-                {
-                    //::std::sort(root.sync.begin(), root.sync.end(), [&blocks](::profiler::block_index_t left, ::profiler::block_index_t right)
-                    //{
-                    //    return blocks[left].node->begin() < blocks[right].node->begin();
-                    //});
+//////////////////////////////////////////////////////////////////////////
 
-                    ::profiler::block_index_t cs_index = 0;
-                    for (auto i : root.children)
-                    {
-                        auto& frame = blocks[i];
+/** Replace compressed data (see compression.h) with decompressed one. Does nothing if data is not compressed. */
+static bool decompressIfNeeded(::profiler::SerializedData& serialized_blocks, ::std::stringstream& _log)
+{
+    if (!::profiler::compression::isCompressed(serialized_blocks.data(), serialized_blocks.size()))
+        return true;
 
-                        if (descriptors[frame.node->id()]->type() == ::profiler::BLOCK_TYPE_BLOCK)
-                            ++root.frames_number;
+    ::profiler::SerializedData decompressed;
+    if (!::profiler::compression::decompress(serialized_blocks.data(), serialized_blocks.size(), decompressed))
+    {
+        _log << "Compressed data is corrupted";
+        return false;
+    }
 
-                        frame.per_parent_stats = update_statistics(per_parent_statistics, frame, i, ~0U, blocks);//, root.thread_id, blocks);
+    serialized_blocks.swap(decompressed);
+    return true;
+}
 
-                        per_frame_statistics.clear();
-                        update_statistics_recursive(per_frame_statistics, frame, i, i, blocks);
+/** Makes whole file contents available in serialized_blocks: maps it into memory or reads it if mapping is not possible.
 
-                        if (cs_index < root.sync.size())
-                        {
-                            CsStatsMap frame_stats_cs;
-                            do {
-
-                                auto j = root.sync[cs_index];
-                                auto& cs = blocks[j];
-                                if (cs.node->end() < frame.node->begin())
-                                    continue;
-                                if (cs.node->begin() > frame.node->end())
-                                    break;
-                                cs.per_frame_stats = update_statistics(frame_stats_cs, cs, cs_index, i, blocks);
-
-                            } while (++cs_index < root.sync.size());
-                        }
+Compressed file is decompressed.
+*/
+static bool loadFile(const char* filename, ::profiler::SerializedData& serialized_blocks, ::std::stringstream& _log)
+{
+    // Map the file into memory: blocks would be decoded directly from the mapped data without reading them
+    if (serialized_blocks.map(filename))
+        return decompressIfNeeded(serialized_blocks, _log);
 
-                        if (root.depth < frame.depth)
-                            root.depth = frame.depth;
+    ::std::ifstream inFile(filename, ::std::fstream::binary);
+    if (!inFile.is_open())
+    {
+        _log << "Can not open file " << filename;
+        return false;
+    }
 
-                        root.profiled_time += frame.node->duration();
-                    }
+    // Memory mapping is not available: read the whole file into memory
+    inFile.seekg(0, ::std::ios_base::end);
+    const auto size = static_cast<uint64_t>(inFile.tellg());
+    inFile.seekg(0, ::std::ios_base::beg);
 
-                    ++root.depth;
-                }, ::std::ref(root)));
-            }
+    serialized_blocks.set(size);
+    inFile.read(serialized_blocks.data(), static_cast<::std::streamsize>(size));
 
-            int j = 0, n = static_cast<int>(statistics_threads.size());
-            for (auto& t : statistics_threads)
-            {
-                t.join();
-                progress.store(90 + (10 * ++j) / n, ::std::memory_order_release);
-            }
+    return decompressIfNeeded(serialized_blocks, _log);
+}
+
+/** Reads the rest of the stream into serialized_blocks at once: blocks are decoded from it.
+
+Compressed data is decompressed.
+*/
+static bool loadStream(::std::stringstream& inFile, ::profiler::SerializedData& serialized_blocks, ::std::stringstream& _log)
+{
+    const auto position = inFile.tellg();
+    inFile.seekg(0, ::std::ios_base::end);
+    const auto size = static_cast<uint64_t>(inFile.tellg() - position);
+    inFile.seekg(position);
+
+    serialized_blocks.set(size);
+    inFile.read(serialized_blocks.data(), static_cast<::std::streamsize>(size));
+
+    return decompressIfNeeded(serialized_blocks, _log);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+extern "C" {
+
+    PROFILER_API ::profiler::block_index_t fillTreesFromFile(::std::atomic<int>& progress, const char* filename,
+                                                             ::profiler::SerializedData& serialized_blocks,
+                                                             ::profiler::SerializedData& serialized_descriptors,
+                                                             ::profiler::descriptors_list_t& descriptors,
+                                                             ::profiler::blocks_t& blocks,
+                                                             ::profiler::thread_blocks_tree_t& threaded_trees,
+                                                             uint32_t& total_descriptors_number,
+                                                             uint32_t& version,
+                                                             bool gather_statistics,
+                                                             ::std::stringstream& _log)
+    {
+        if (!update_progress(progress, 0, _log))
+        {
+            return 0;
         }
-        else
+
+        if (!loadFile(filename, serialized_blocks, _log))
         {
-            int j = 0, n = static_cast<int>(threaded_trees.size());
-            for (auto& it : threaded_trees)
-            {
-                auto& root = it.second;
-                root.thread_id = it.first;
+            return 0;
+        }
 
-                //::std::sort(root.sync.begin(), root.sync.end(), [&blocks](::profiler::block_index_t left, ::profiler::block_index_t right)
-                //{
-                //    return blocks[left].node->begin() < blocks[right].node->begin();
-                //});
+        MemoryStream memoryStream(serialized_blocks.data(), serialized_blocks.size());
+        return fillTreesFromMemory(progress, memoryStream, serialized_blocks, serialized_descriptors, descriptors, blocks,
+                                   threaded_trees, total_descriptors_number, version, gather_statistics, _log);
+    }
 
-                //root.tree.shrink_to_fit();
-                for (auto child_block_index : root.children)
-                {
-                    auto& frame = blocks[child_block_index];
+    //////////////////////////////////////////////////////////////////////////
 
-                    if (descriptors[frame.node->id()]->type() == ::profiler::BLOCK_TYPE_BLOCK)
-                        ++root.frames_number;
+    PROFILER_API ::profiler::block_index_t fillTreesFromStream(::std::atomic<int>& progress, ::std::stringstream& inFile,
+                                                               ::profiler::SerializedData& serialized_blocks,
+                                                               ::profiler::SerializedData& serialized_descriptors,
+                                                               ::profiler::descriptors_list_t& descriptors,
+                                                               ::profiler::blocks_t& blocks,
+                                                               ::profiler::thread_blocks_tree_t& threaded_trees,
+                                                               uint32_t& total_descriptors_number,
+                                                               uint32_t& version,
+                                                               bool gather_statistics,
+                                                               ::std::stringstream& _log)
+    {
+        if (!update_progress(progress, 0, _log))
+        {
+            return 0;
+        }
 
-                    if (root.depth < frame.depth)
-                        root.depth = frame.depth;
+        if (!loadStream(inFile, serialized_blocks, _log))
+        {
+            return 0;
+        }
 
-                    root.profiled_time += frame.node->duration();
-                }
+        MemoryStream memoryStream(serialized_blocks.data(), serialized_blocks.size());
+        return fillTreesFromMemory(progress, memoryStream, serialized_blocks, serialized_descriptors, descriptors, blocks,
+                                   threaded_trees, total_descriptors_number, version, gather_statistics, _log);
+    }
 
-                ++root.depth;
+    //////////////////////////////////////////////////////////////////////////
 
-                progress.store(90 + (10 * ++j) / n, ::std::memory_order_release);
-            }
+    PROFILER_API ::profiler::block_index_t fillColumnsFromFile(::std::atomic<int>& progress, const char* filename,
+                                                               ::profiler::SerializedData& serialized_blocks,
+                                                               ::profiler::SerializedData& serialized_descriptors,
+                                                               ::profiler::descriptors_list_t& descriptors,
+                                                               ::profiler::BlocksColumns& columns,
+                                                               uint32_t& total_descriptors_number,
+                                                               uint32_t& version,
+                                                               bool gather_statistics,
+                                                               ::std::stringstream& _log)
+    {
+        if (!update_progress(progress, 0, _log))
+        {
+            return 0;
+        }
+
+        if (!loadFile(filename, serialized_blocks, _log))
+        {
+            return 0;
+        }
+
+        MemoryStream memoryStream(serialized_blocks.data(), serialized_blocks.size());
+        return fillColumnsFromMemory(progress, memoryStream, serialized_blocks, serialized_descriptors, descriptors, columns,
+                                     total_descriptors_number, version, gather_statistics, _log);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+
+    PROFILER_API ::profiler::block_index_t fillColumnsFromStream(::std::atomic<int>& progress, ::std::stringstream& inFile,
+                                                                 ::profiler::SerializedData& serialized_blocks,
+                                                                 ::profiler::SerializedData& serialized_descriptors,
+                                                                 ::profiler::descriptors_list_t& descriptors,
+                                                                 ::profiler::BlocksColumns& columns,
+                                                                 uint32_t& total_descriptors_number,
+                                                                 uint32_t& version,
+                                                                 bool gather_statistics,
+                                                                 ::std::stringstream& _log)
+    {
+        if (!update_progress(progress, 0, _log))
+        {
+            return 0;
+        }
+
+        if (!loadStream(inFile, serialized_blocks, _log))
+        {
+            return 0;
         }
-        // No need to delete BlockStatistics instances - they will be deleted inside BlocksTree destructors
 
-        return blocks_counter;
+        MemoryStream memoryStream(serialized_blocks.data(), serialized_blocks.size());
+        return fillColumnsFromMemory(progress, memoryStream, serialized_blocks, serialized_descriptors, descriptors, columns,
+                                     total_descriptors_number, version, gather_statistics, _log);
     }
 
     //////////////////////////////////////////////////////////////////////////
@@ -977,7 +2168,9 @@ extern "C" {
 
         descriptors.reserve(total_descriptors_number);
         //const char* olddata = append_regime ? serialized_descriptors.data() : nullptr;
-        serialized_descriptors.set(descriptors_memory_size);
+        if (version < EASY_V_140)
+        descriptors_memory_size += total_descriptors_number * sizeof(uint16_t); // sampling rate would be added to each descriptor
+    serialized_descriptors.set(descriptors_memory_size);
         //validate_pointers(progress, olddata, serialized_descriptors, descriptors, descriptors.size());
 
         uint64_t i = 0;
@@ -997,7 +2190,7 @@ extern "C" {
             //}
 
             char* data = serialized_descriptors[i];
-            inFile.read(data, sz);
+            sz = read_descriptor(inFile, data, sz, version);
             auto descriptor = reinterpret_cast<::profiler::SerializedBlockDescriptor*>(data);
             descriptors.push_back(descriptor);
 
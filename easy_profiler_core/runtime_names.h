@@ -0,0 +1,266 @@
+/**
+Lightweight profiler library for c++
+Copyright(C) 2016-2017  Sergey Yagovtsev, Victor Zarubkin
+
+Licensed under either of
+    * MIT license (LICENSE.MIT or http://opensource.org/licenses/MIT)
+    * Apache License, Version 2.0, (LICENSE.APACHE or http://www.apache.org/licenses/LICENSE-2.0)
+at your option.
+
+The MIT License
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights 
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies 
+    of the Software, and to permit persons to whom the Software is furnished 
+    to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all 
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+    PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE 
+    LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE 
+    USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+The Apache License, Version 2.0 (the "License");
+    You may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+
+**/
+
+#ifndef EASY_PROFILER_RUNTIME_NAMES_H
+#define EASY_PROFILER_RUNTIME_NAMES_H
+
+#include <easy/profiler.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <atomic>
+#include <string.h>
+#include "outstream.h"
+#include "spin_lock.h"
+#include "compact_format.h"
+
+//////////////////////////////////////////////////////////////////////////
+
+/** Per-thread table of interned runtime block names.
+
+Owner thread interns runtime names while storing blocks, so each distinct name is stored only once
+and block records store small name id instead of the name itself (see compact_format.h).
+The table is written into thread section of .prof file by dumping thread.
+
+The table is started anew after each full dump (see requestReset()), so it does not grow for the whole thread life.
+Name id contains the table generation. The previous table is kept until the next reset and written too:
+blocks stored while the thread was being dumped use it and would be written by the next dump.
+If there are too many distinct names then new names are not interned and stored inside block records as before.
+*/
+class RuntimeNames EASY_FINAL
+{
+    enum : uint32_t { POINTER_CACHE_SIZE = 64 };
+
+    struct CachedPointer
+    {
+        const char* name = nullptr; ///< Pointer passed to intern() last time
+        uint32_t      id = 0;
+    };
+
+    std::vector<uint64_t>        m_slots; ///< Open addressing hash table of (name hash << 32 | name index + 1), 0 for empty slot. Used by owner thread only.
+    std::vector<std::string>     m_names; ///< Interned names indexed by name index. Appended by owner thread, read by dumping thread (guarded by m_spin).
+    std::vector<std::string>  m_previous; ///< Names of the previous generation (guarded by m_spin)
+    CachedPointer m_pointers[POINTER_CACHE_SIZE]; ///< Direct-mapped cache of recently interned name pointers. Used by owner thread only.
+    uint32_t                m_generation = 1; ///< Incremented on each reset (guarded by m_spin for dumping thread)
+    std::atomic_bool    m_resetRequested;
+    mutable profiler::spin_lock   m_spin;
+
+public:
+
+    static const uint32_t NO_ID = 0xffffffff; ///< Name was not interned
+    static const uint32_t MAX_NAMES = profiler::compact::NAME_INDEX_MASK + 1; ///< Maximum number of interned names per thread (between resets)
+
+    RuntimeNames()
+    {
+        m_resetRequested = ATOMIC_VAR_INIT(false);
+    }
+
+    /** Get id of runtime name adding it into the table if needed.
+
+    \param _length Length of _name (without '\0') would be stored here.
+
+    \retval NO_ID if the table is full and _name has not been interned before.
+    */
+    uint32_t intern(const char* _name, uint16_t& _length)
+    {
+        if (m_resetRequested.load(std::memory_order_relaxed))
+            reset();
+
+        // Runtime names are often passed by the same pointer (string literals, cached strings):
+        // check cached pointer first to avoid calculating string length and hash.
+        // Contents is compared because the same buffer could be reused for another name.
+        auto& cached = m_pointers[(reinterpret_cast<uintptr_t>(_name) >> 3) % POINTER_CACHE_SIZE];
+        if (cached.name == _name)
+        {
+            const auto& name = m_names[cached.id & profiler::compact::NAME_INDEX_MASK];
+            if (strncmp(name.c_str(), _name, name.size() + 1) == 0)
+            {
+                _length = static_cast<uint16_t>(name.size());
+                return cached.id;
+            }
+        }
+
+        const auto length = strlen(_name);
+        const auto hash = calculateHash(_name, length);
+        _length = static_cast<uint16_t>(length);
+
+        if (!m_slots.empty())
+        {
+            const size_t mask = m_slots.size() - 1;
+            for (size_t i = hash & mask; m_slots[i] != 0; i = (i + 1) & mask)
+            {
+                if (static_cast<uint32_t>(m_slots[i] >> 32) != hash)
+                    continue;
+
+                const auto index = static_cast<uint32_t>(m_slots[i]) - 1;
+                const auto& name = m_names[index];
+                if (name.size() == _length && memcmp(name.data(), _name, _length) == 0)
+                    return cache(cached, _name, index);
+            }
+        }
+
+        if (m_names.size() >= MAX_NAMES)
+            return NO_ID;
+
+        const auto index = static_cast<uint32_t>(m_names.size());
+
+        {
+            profiler::guard_lock<profiler::spin_lock> lock(m_spin);
+            m_names.emplace_back(_name, _length);
+        }
+
+        if ((m_names.size() << 1) > m_slots.size())
+        {
+            // Keep load factor below 0.5
+            std::vector<uint64_t> slots(std::max(m_slots.size() << 1, size_t(64)), 0);
+            m_slots.swap(slots);
+            for (auto slot : slots)
+            {
+                if (slot != 0)
+                    insert(slot);
+            }
+        }
+
+        insert((static_cast<uint64_t>(hash) << 32) | (index + 1));
+
+        return cache(cached, _name, index);
+    }
+
+    /** Ask owner thread to start new table generation before interning the next name.
+
+    \note Called by dumping thread after all blocks of the thread have been written.
+    */
+    void requestReset()
+    {
+        m_resetRequested.store(true, std::memory_order_relaxed);
+    }
+
+    /** Write previous and current tables into _stream (see compact_format.h).
+
+    \note Called by dumping thread.
+    */
+    void serialize(profiler::OStream& _stream) const
+    {
+        profiler::guard_lock<profiler::spin_lock> lock(m_spin);
+
+        serialize(_stream, (m_generation - 1) & profiler::compact::NAME_GENERATION_MASK, m_previous);
+        serialize(_stream, m_generation, m_names);
+    }
+
+private:
+
+    static void serialize(profiler::OStream& _stream, uint32_t _generation, const std::vector<std::string>& _names)
+    {
+        _stream.write(_generation);
+        _stream.write(static_cast<uint32_t>(_names.size()));
+        for (const auto& name : _names)
+        {
+            _stream.write(static_cast<uint16_t>(name.size()));
+            _stream.write(name.data(), name.size());
+        }
+    }
+
+    uint32_t cache(CachedPointer& _cached, const char* _name, uint32_t _index)
+    {
+        _cached.name = _name;
+        _cached.id = (m_generation << profiler::compact::NAME_GENERATION_SHIFT) | _index;
+        return _cached.id;
+    }
+
+    void reset()
+    {
+        std::vector<std::string> names;
+        std::vector<uint64_t> slots;
+
+        {
+            profiler::guard_lock<profiler::spin_lock> lock(m_spin);
+            m_previous.swap(names);
+            m_previous.swap(m_names);
+            m_generation = (m_generation + 1) & profiler::compact::NAME_GENERATION_MASK;
+            m_resetRequested.store(false, std::memory_order_relaxed);
+        }
+
+        m_slots.swap(slots);
+        for (auto& cached : m_pointers)
+            cached.name = nullptr;
+
+        // Memory of the oldest table is freed here (out of the lock)
+    }
+
+    /** Hash string by 8-byte words (much faster than per-character hashing for long names).
+    */
+    static uint32_t calculateHash(const char* _str, size_t _length)
+    {
+        const uint64_t factor = 0x9e3779b97f4a7c15ULL;
+        uint64_t hash = _length * factor;
+
+        for (; _length >= sizeof(uint64_t); _length -= sizeof(uint64_t), _str += sizeof(uint64_t))
+        {
+            uint64_t word;
+            memcpy(&word, _str, sizeof(uint64_t));
+            hash = ((hash ^ word) * factor) ^ (hash >> 29);
+        }
+
+        uint64_t tail = 0;
+        memcpy(&tail, _str, _length);
+        hash = (hash ^ tail) * factor;
+
+        return static_cast<uint32_t>(hash >> 32);
+    }
+
+    void insert(uint64_t _slot)
+    {
+        const size_t mask = m_slots.size() - 1;
+        size_t i = static_cast<size_t>(_slot >> 32) & mask;
+        while (m_slots[i] != 0)
+            i = (i + 1) & mask;
+        m_slots[i] = _slot;
+    }
+
+    RuntimeNames(const RuntimeNames&) = delete;
+    RuntimeNames(RuntimeNames&&) = delete;
+
+}; // END of class RuntimeNames.
+
+//////////////////////////////////////////////////////////////////////////
+
+#endif // EASY_PROFILER_RUNTIME_NAMES_H
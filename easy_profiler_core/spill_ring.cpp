@@ -0,0 +1,394 @@
+/**
+Lightweight profiler library for c++
+Copyright(C) 2016-2017  Sergey Yagovtsev, Victor Zarubkin
+
+Licensed under either of
+    * MIT license (LICENSE.MIT or http://opensource.org/licenses/MIT)
+    * Apache License, Version 2.0, (LICENSE.APACHE or http://www.apache.org/licenses/LICENSE-2.0)
+at your option.
+
+The MIT License
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights 
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies 
+    of the Software, and to permit persons to whom the Software is furnished 
+    to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all 
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+    PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE 
+    LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE 
+    USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+The Apache License, Version 2.0 (the "License");
+    You may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+
+**/
+
+#include <cstdio>
+#include <algorithm>
+#include "spill_ring.h"
+#include "compact_format.h"
+
+//////////////////////////////////////////////////////////////////////////
+
+SpillRing::SpillRing()
+    : m_stream(m_file)
+    , m_segmentSize(0)
+    , m_recordOffset(0)
+    , m_lostBlocks(0)
+    , m_current(0)
+{
+}
+
+SpillRing::~SpillRing()
+{
+    close();
+}
+
+bool SpillRing::open(const char* _filenamePrefix, uint32_t _segmentsNumber, uint64_t _segmentSize)
+{
+    close();
+
+    // At least 2 segments are required, otherwise the current segment would be overwritten
+    // immediately after it reaches the size limit.
+    if (_segmentsNumber < 2)
+        _segmentsNumber = 2;
+
+    m_segments.resize(_segmentsNumber);
+    for (uint32_t i = 0; i < _segmentsNumber; ++i)
+        m_segments[i].filename = std::string(_filenamePrefix) + "." + std::to_string(i) + ".spill";
+
+    m_filenamePrefix = _filenamePrefix;
+    m_segmentSize = _segmentSize;
+    m_lostBlocks = 0;
+    m_current = 0;
+
+    if (!openSegment(0))
+    {
+        m_segments.clear();
+        return false;
+    }
+
+    return true;
+}
+
+void SpillRing::close()
+{
+    m_stream.clear();
+
+    if (m_file.is_open())
+        m_file.close();
+
+    for (const auto& segment : m_segments)
+        std::remove(segment.filename.c_str());
+
+    m_segments.clear();
+}
+
+bool SpillRing::isOpen() const
+{
+    return !m_segments.empty();
+}
+
+bool SpillRing::empty() const
+{
+    for (const auto& segment : m_segments)
+    {
+        if (!segment.records.empty())
+            return false;
+    }
+
+    return true;
+}
+
+bool SpillRing::isOpenedWith(const char* _filenamePrefix, uint32_t _segmentsNumber, uint64_t _segmentSize) const
+{
+    return isOpen() && m_filenamePrefix == _filenamePrefix && m_segments.size() == std::max(_segmentsNumber, 2U)
+        && m_segmentSize == _segmentSize;
+}
+
+uint32_t SpillRing::blocksNumber() const
+{
+    uint32_t blocksNumber = 0;
+    for (const auto& segment : m_segments)
+    {
+        for (const auto& record : segment.records)
+            blocksNumber += record.blocksNumber;
+    }
+
+    return blocksNumber;
+}
+
+profiler::OStream& SpillRing::beginRecord()
+{
+    // Reset error state which could be set by previous write errors
+    m_stream.clear();
+    m_file.clear();
+
+    m_recordOffset = static_cast<uint64_t>(m_file.tellp());
+    return m_stream;
+}
+
+void SpillRing::endRecord(const ThreadStorage* _thread, uint32_t _blocksNumber, uint64_t _memorySize, profiler::timestamp_t _minEnd, profiler::timestamp_t _maxEnd)
+{
+    auto& segment = m_segments[m_current];
+
+    m_stream.flush();
+
+    const auto position = m_file.tellp();
+    if (position < 0 || m_file.fail())
+    {
+        // Write error: flushed blocks are lost
+        m_lostBlocks += _blocksNumber;
+        return;
+    }
+
+    const auto offset = static_cast<uint64_t>(position);
+    const auto size = offset - m_recordOffset;
+    segment.size = offset;
+
+    if (_blocksNumber != 0)
+    {
+        Record record = {_thread, m_recordOffset, size, _memorySize, _minEnd, _maxEnd, _blocksNumber};
+        segment.records.push_back(record);
+    }
+
+    if (segment.size < m_segmentSize)
+        return;
+
+    // Switch to the next segment overwriting the oldest data
+    const auto next = static_cast<uint32_t>((m_current + 1) % m_segments.size());
+    for (const auto& record : m_segments[next].records)
+        m_lostBlocks += record.blocksNumber;
+
+    m_current = next;
+    openSegment(next);
+}
+
+void SpillRing::threadInfo(const ThreadStorage* _thread, uint32_t& _blocksNumber, uint64_t& _memorySize, profiler::timestamp_t _beginTime) const
+{
+    _blocksNumber = 0;
+    _memorySize = 0;
+
+    for (const auto& segment : m_segments)
+    {
+        for (const auto& record : segment.records)
+        {
+            if (record.thread != _thread || record.maxEnd < _beginTime)
+                continue;
+
+            if (record.minEnd >= _beginTime)
+            {
+                _blocksNumber += record.blocksNumber;
+                _memorySize += record.memorySize;
+                continue;
+            }
+
+            uint32_t blocksNumber = 0;
+            filterRecord(segment, record, _beginTime, nullptr, blocksNumber);
+            _blocksNumber += blocksNumber;
+            _memorySize += record.memorySize * blocksNumber / record.blocksNumber;
+        }
+    }
+}
+
+uint32_t SpillRing::validate()
+{
+    if (m_segments.empty())
+        return 0;
+
+    m_file.flush();
+
+    uint32_t droppedBlocks = 0;
+    for (auto& segment : m_segments)
+    {
+        if (segment.records.empty())
+            continue;
+
+        uint64_t fileSize = 0;
+        std::ifstream segmentFile(segment.filename.c_str(), std::fstream::binary | std::fstream::ate);
+        if (segmentFile.is_open())
+        {
+            const auto position = segmentFile.tellg();
+            if (position > 0)
+                fileSize = static_cast<uint64_t>(position);
+        }
+
+        auto& records = segment.records;
+        const auto end = std::remove_if(records.begin(), records.end(), [fileSize, &droppedBlocks](const Record& _record)
+        {
+            if (_record.offset + _record.size <= fileSize)
+                return false;
+            droppedBlocks += _record.blocksNumber;
+            return true;
+        });
+
+        records.erase(end, records.end());
+    }
+
+    return droppedBlocks;
+}
+
+bool SpillRing::writeThread(const ThreadStorage* _thread, profiler::OStream& _outputStream, profiler::timestamp_t _beginTime)
+{
+    if (m_segments.empty())
+        return true;
+
+    m_file.flush();
+
+    const auto segmentsNumber = static_cast<uint32_t>(m_segments.size());
+    char buffer[64 * 1024];
+
+    // Start from the oldest segment
+    for (uint32_t i = 1; i <= segmentsNumber; ++i)
+    {
+        const auto& segment = m_segments[(m_current + i) % segmentsNumber];
+
+        std::ifstream segmentFile;
+        for (const auto& record : segment.records)
+        {
+            if (record.thread != _thread || record.maxEnd < _beginTime)
+                continue;
+
+            if (record.minEnd < _beginTime)
+            {
+                // Only a part of record blocks is in the requested window
+                uint32_t blocksNumber = 0;
+                if (!filterRecord(segment, record, _beginTime, &_outputStream, blocksNumber))
+                    return false;
+                continue;
+            }
+
+            if (!segmentFile.is_open())
+            {
+                segmentFile.open(segment.filename.c_str(), std::fstream::binary);
+                if (!segmentFile.is_open())
+                    return false;
+            }
+
+            if (!segmentFile.seekg(static_cast<std::streamoff>(record.offset)))
+                return false;
+
+            auto size = record.size;
+            while (size != 0)
+            {
+                const auto n = size < sizeof(buffer) ? size : static_cast<uint64_t>(sizeof(buffer));
+                segmentFile.read(buffer, static_cast<std::streamsize>(n));
+
+                // Write only bytes which have been really read
+                const auto count = static_cast<uint64_t>(segmentFile.gcount());
+                _outputStream.write(buffer, count);
+                if (count != n)
+                    return false;
+
+                size -= n;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool SpillRing::filterRecord(const Segment& _segment, const Record& _record, profiler::timestamp_t _beginTime,
+                             profiler::OStream* _output, uint32_t& _blocksNumber) const
+{
+    _blocksNumber = 0;
+
+    std::ifstream segmentFile(_segment.filename.c_str(), std::fstream::binary);
+    if (!segmentFile.is_open() || !segmentFile.seekg(static_cast<std::streamoff>(_record.offset)))
+        return false;
+
+    std::vector<char> data(static_cast<size_t>(_record.size));
+    segmentFile.read(data.data(), static_cast<std::streamsize>(data.size()));
+    if (static_cast<uint64_t>(segmentFile.gcount()) != _record.size)
+        return false;
+
+    std::vector<char> payload;
+    const char* packet = data.data();
+    const char* end = packet + data.size();
+    while (packet != end)
+    {
+        uint32_t header[3]; // records number, payload size, decoded size
+        if (static_cast<size_t>(end - packet) < profiler::compact::PACKET_HEADER_SIZE)
+            return false;
+
+        memcpy(header, packet, profiler::compact::PACKET_HEADER_SIZE);
+        packet += profiler::compact::PACKET_HEADER_SIZE;
+        if (header[1] > static_cast<size_t>(end - packet))
+            return false;
+
+        uint32_t recordsNumber = 0, decodedSize = 0;
+        payload.clear();
+        if (!profiler::compact::filter(false, packet, header[1], header[0], _beginTime, payload, recordsNumber, decodedSize))
+            return false;
+
+        packet += header[1];
+        _blocksNumber += recordsNumber;
+
+        if (_output != nullptr && recordsNumber != 0)
+        {
+            _output->write(recordsNumber);
+            _output->write(static_cast<uint32_t>(payload.size()));
+            _output->write(decodedSize);
+            _output->write(payload.data(), payload.size());
+        }
+    }
+
+    return true;
+}
+
+uint32_t SpillRing::clear()
+{
+    const auto lostBlocks = m_lostBlocks;
+    m_lostBlocks = 0;
+
+    if (m_segments.empty())
+        return lostBlocks;
+
+    m_stream.clear();
+
+    for (auto& segment : m_segments)
+    {
+        segment.records.clear();
+        segment.size = 0;
+    }
+
+    m_current = 0;
+    openSegment(0);
+
+    for (uint32_t i = 1, n = static_cast<uint32_t>(m_segments.size()); i < n; ++i)
+        std::remove(m_segments[i].filename.c_str());
+
+    return lostBlocks;
+}
+
+bool SpillRing::openSegment(uint32_t _index)
+{
+    auto& segment = m_segments[_index];
+    segment.records.clear();
+    segment.size = 0;
+
+    if (m_file.is_open())
+        m_file.close();
+
+    m_file.open(segment.filename.c_str(), std::fstream::binary | std::fstream::trunc);
+    return m_file.is_open();
+}
+
+//////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,186 @@
+/**
+Lightweight profiler library for c++
+Copyright(C) 2016-2017  Sergey Yagovtsev, Victor Zarubkin
+
+Licensed under either of
+    * MIT license (LICENSE.MIT or http://opensource.org/licenses/MIT)
+    * Apache License, Version 2.0, (LICENSE.APACHE or http://www.apache.org/licenses/LICENSE-2.0)
+at your option.
+
+The MIT License
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights 
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies 
+    of the Software, and to permit persons to whom the Software is furnished 
+    to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all 
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+    PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE 
+    LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE 
+    USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+The Apache License, Version 2.0 (the "License");
+    You may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+
+**/
+
+#ifndef EASY_PROFILER_SPILL_RING_H
+#define EASY_PROFILER_SPILL_RING_H
+
+#include <easy/profiler.h>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "outstream.h"
+
+struct ThreadStorage;
+
+//////////////////////////////////////////////////////////////////////////
+
+/** Ring of on-disk segments used to store flushed blocks in streaming mode.
+
+Each segment is a plain file containing packets of blocks (in the compact format of .prof file,
+see compact_format.h) appended by the flushing thread. In-memory index of records is used to find
+blocks of each thread when writing them into the output stream during dump.
+Records are indexed by thread storage instead of thread id: expired thread and a new thread
+with the same (reused) id have different storages.
+
+When current segment exceeds the size limit, the ring switches to the next segment
+overwriting the oldest one (so the oldest flushed blocks are lost).
+
+\note SpillRing is not thread-safe. ProfileManager guards it with the same lock as threads storage.
+*/
+class SpillRing EASY_FINAL
+{
+    struct Record
+    {
+        const ThreadStorage*    thread; ///< Storage of the thread which blocks are stored in this record
+        uint64_t                offset; ///< Offset of the record data in the segment file
+        uint64_t                  size; ///< Size of the record data in the segment file
+        uint64_t            memorySize; ///< Total size of blocks payload
+        profiler::timestamp_t   minEnd; ///< Minimum end time of blocks stored in this record
+        profiler::timestamp_t   maxEnd; ///< Maximum end time of blocks stored in this record
+        uint32_t          blocksNumber; ///< Number of blocks stored in this record
+    };
+
+    struct Segment
+    {
+        std::string         filename;
+        std::vector<Record>  records;
+        uint64_t                size = 0;
+    };
+
+    std::vector<Segment> m_segments; ///< Ring of segments
+    std::string    m_filenamePrefix; ///< Prefix of segment files names
+    std::ofstream            m_file; ///< Current segment file
+    profiler::OStream      m_stream; ///< Output stream which writes to m_file
+    uint64_t          m_segmentSize; ///< Segment size limit
+    uint64_t         m_recordOffset; ///< Offset of the record which is being written now
+    uint32_t           m_lostBlocks; ///< Number of blocks lost due to overwriting the oldest segments
+    uint32_t              m_current; ///< Index of the current segment
+
+public:
+
+    SpillRing();
+    ~SpillRing();
+
+    /** Create segment files "<prefix>.<index>.spill".
+
+    \retval true if the current segment file has been opened successfully.
+    */
+    bool open(const char* _filenamePrefix, uint32_t _segmentsNumber, uint64_t _segmentSize);
+
+    /** Close and remove all segment files.
+    */
+    void close();
+
+    bool isOpen() const;
+    bool empty() const;
+
+    /** Check if the ring has been opened with the same parameters (see open()).
+    */
+    bool isOpenedWith(const char* _filenamePrefix, uint32_t _segmentsNumber, uint64_t _segmentSize) const;
+
+    /** Total number of blocks stored for all threads.
+    */
+    uint32_t blocksNumber() const;
+
+    /** Start new record and return stream to write record data to.
+    */
+    profiler::OStream& beginRecord();
+
+    /** Finish the record started by beginRecord().
+
+    Switches to the next segment if the current one exceeds the size limit.
+
+    \param _minEnd Minimum end time of blocks written into the record.
+    \param _maxEnd Maximum end time of blocks written into the record.
+    */
+    void endRecord(const ThreadStorage* _thread, uint32_t _blocksNumber, uint64_t _memorySize, profiler::timestamp_t _minEnd, profiler::timestamp_t _maxEnd);
+
+    /** Get total number and total memory size of blocks stored for specified thread.
+
+    \param _beginTime Blocks which end before this time are not counted (see writeThread()).
+    Memory size of records which are counted partially is estimated.
+    */
+    void threadInfo(const ThreadStorage* _thread, uint32_t& _blocksNumber, uint64_t& _memorySize, profiler::timestamp_t _beginTime = 0) const;
+
+    /** Drop records which can not be read back from segment files (e.g. after a failed or partial flush of segment file).
+
+    Must be called before threadInfo() and writeThread() during dump, so blocks number written into
+    thread header matches the blocks written by writeThread().
+
+    \retval Number of dropped blocks.
+    */
+    uint32_t validate();
+
+    /** Copy all blocks stored for specified thread into output stream (from the oldest to the newest).
+
+    \param _beginTime Blocks which end before this time are skipped (the same way as reader drops them).
+    Records which contain such blocks only partially are read and filtered, others are copied as is.
+
+    \retval false if segment file could not be read (the rest of the thread blocks are not written).
+    */
+    bool writeThread(const ThreadStorage* _thread, profiler::OStream& _outputStream, profiler::timestamp_t _beginTime = 0);
+
+    /** Drop all stored records and truncate segment files.
+
+    \retval Number of blocks lost due to overwriting since the previous call of clear().
+    */
+    uint32_t clear();
+
+private:
+
+    /** Write packets of record blocks which end not before _beginTime into _output (could be nullptr).
+
+    \retval false if segment file could not be read or the record is corrupted.
+    */
+    bool filterRecord(const Segment& _segment, const Record& _record, profiler::timestamp_t _beginTime,
+                      profiler::OStream* _output, uint32_t& _blocksNumber) const;
+
+    bool openSegment(uint32_t _index);
+
+    SpillRing(const SpillRing&) = delete;
+    SpillRing(SpillRing&&) = delete;
+
+}; // END of class SpillRing.
+
+//////////////////////////////////////////////////////////////////////////
+
+#endif // EASY_PROFILER_SPILL_RING_H
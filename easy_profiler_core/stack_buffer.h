@@ -44,9 +44,10 @@ The Apache License, Version 2.0 (the "License");
 #define EASY_PROFILER_STACK_BUFFER_H
 
 #include "nonscoped_block.h"
-#include <list>
+#include <vector>
 #include <algorithm>
 #include <cstdlib>
+#include <cstddef>
 
 #ifdef max
 #undef max
@@ -63,72 +64,140 @@ inline void destroy_elem(NonscopedBlock* _elem)
     _elem->destroy();
 }
 
+/** Per-thread stack of elements built on top of bump arena.
+
+Each element is allocated in the arena together with any additional memory requested
+by allocate() while this element is on top of the stack (e.g. copy of nonscoped block name).
+All this memory is released at once when the element is popped.
+
+Arena memory is never returned to the heap while thread is alive: when stack gone empty
+used chunks are merged into one chunk large enough to hold the maximum used stack,
+so there are no heap allocations in steady state.
+*/
 template <class T>
 class StackBuffer
 {
-    struct chunk { int8_t data[sizeof(T)]; };
+    struct Chunk
+    {
+        char*    data;
+        uint32_t capacity;
+    };
 
-    std::list<chunk> m_overflow; ///< List of additional stack elements if current capacity of buffer is not enough
-    T*                 m_buffer; ///< Contiguous buffer used for stack
+    struct Header
+    {
+        Header*    prev; ///< Header of previous element in the stack
+        uint32_t  chunk; ///< Arena position before this element was pushed (chunk index)
+        uint32_t offset; ///< Arena position before this element was pushed (offset in chunk)
+    };
+
+    static const uint32_t Alignment = static_cast<uint32_t>(alignof(std::max_align_t));
+    static const uint32_t ElementSize = static_cast<uint32_t>((sizeof(Header) + sizeof(T) + Alignment - 1) & ~(Alignment - 1));
+
+    std::vector<Chunk> m_chunks; ///< Arena chunks (the first one is the main buffer, others are allocated on overflow)
+    Header*               m_top; ///< Header of current top element
+    uint32_t            m_chunk; ///< Index of current chunk
+    uint32_t           m_offset; ///< Offset of first free byte in current chunk
     uint32_t             m_size; ///< Current size of stack
-    uint32_t         m_capacity; ///< Current capacity of m_buffer
-    uint32_t      m_maxcapacity; ///< Maximum used capacity including m_buffer and m_overflow
+    uint32_t         m_maxbytes; ///< Maximum used arena size in bytes since last compaction
 
 public:
 
-    StackBuffer(uint32_t N) : m_buffer(static_cast<T*>(malloc(N * sizeof(T)))), m_size(0), m_capacity(N), m_maxcapacity(N)
+    StackBuffer(uint32_t N) : m_top(nullptr), m_chunk(0), m_offset(0), m_size(0), m_maxbytes(0)
     {
+        addChunk(N * ElementSize);
     }
 
     ~StackBuffer()
     {
-        for (uint32_t i = 0; i < m_size; ++i)
-            destroy_elem(m_buffer + i);
-
-        free(m_buffer);
+        while (m_top != nullptr)
+        {
+            destroy_elem(element(m_top));
+            m_top = m_top->prev;
+        }
 
-        for (auto& elem : m_overflow)
-            destroy_elem(reinterpret_cast<T*>(elem.data + 0));
+        for (auto& chunk : m_chunks)
+            free(chunk.data);
     }
 
     template <class ... TArgs>
     T& push(TArgs ... _args)
     {
-        if (m_size < m_capacity)
-            return *(::new (m_buffer + m_size++) T(_args...));
+        const uint32_t chunk = m_chunk, offset = m_offset;
 
-        m_overflow.emplace_back();
-        const uint32_t cap = m_capacity + static_cast<uint32_t>(m_overflow.size());
-        if (m_maxcapacity < cap)
-            m_maxcapacity = cap;
+        auto header = static_cast<Header*>(allocate(ElementSize));
+        header->prev = m_top;
+        header->chunk = chunk;
+        header->offset = offset;
 
-        return *(::new (m_overflow.back().data + 0) T(_args...));
+        m_top = header;
+        ++m_size;
+
+        return *(::new (element(header)) T(_args...));
     }
 
     void pop()
     {
-        if (m_overflow.empty())
+        // m_top should not be equal to nullptr here because ProfileManager behavior does not allow such situation
+        destroy_elem(element(m_top));
+
+        m_chunk = m_top->chunk;
+        m_offset = m_top->offset;
+        m_top = m_top->prev;
+
+        if (--m_size == 0 && m_chunks.size() > 1)
         {
-            // m_size should not be equal to 0 here because ProfileManager behavior does not allow such situation
-            destroy_elem(m_buffer + --m_size);
-
-            if (m_size == 0 && m_maxcapacity > m_capacity)
-            {
-                // When stack gone empty we can resize buffer to use enough space in the future
-                free(m_buffer);
-                m_maxcapacity = m_capacity = std::max(m_maxcapacity, m_capacity << 1);
-                m_buffer = static_cast<T*>(malloc(m_capacity * sizeof(T)));
-            }
-
-            return;
+            // When stack gone empty we can merge all chunks to use one contiguous buffer in the future
+            for (auto& chunk : m_chunks)
+                free(chunk.data);
+            m_chunks.clear();
+            addChunk(m_maxbytes);
+            m_maxbytes = 0;
         }
+    }
+
+    /** Allocate memory which will be released together with current top element.
 
-        destroy_elem(reinterpret_cast<T*>(m_overflow.back().data + 0));
-        m_overflow.pop_back();
+    Returned memory is aligned by alignof(std::max_align_t).
+    */
+    void* allocate(uint32_t _size)
+    {
+        _size = (_size + Alignment - 1) & ~(Alignment - 1);
+
+        if (m_offset + _size > m_chunks[m_chunk].capacity)
+        {
+            // Current chunk is out of space: take next unused chunk or allocate new one
+            m_offset = 0;
+            if (++m_chunk == m_chunks.size() || m_chunks[m_chunk].capacity < _size)
+                addChunk(std::max(_size, m_chunks.back().capacity << 1), m_chunk);
+        }
+
+        void* data = m_chunks[m_chunk].data + m_offset;
+        m_offset += _size;
+
+        uint32_t usedBytes = m_offset;
+        for (uint32_t i = 0; i < m_chunk; ++i)
+            usedBytes += m_chunks[i].capacity;
+        if (m_maxbytes < usedBytes)
+            m_maxbytes = usedBytes;
+
+        return data;
     }
 
 private:
 
+    static T* element(Header* _header)
+    {
+        return reinterpret_cast<T*>(reinterpret_cast<char*>(_header) + sizeof(Header));
+    }
+
+    void addChunk(uint32_t _capacity, uint32_t _index = 0)
+    {
+        Chunk chunk;
+        chunk.data = static_cast<char*>(malloc(_capacity));
+        chunk.capacity = _capacity;
+        m_chunks.insert(m_chunks.begin() + std::min(_index, static_cast<uint32_t>(m_chunks.size())), chunk);
+    }
+
     StackBuffer(const StackBuffer&) = delete;
     StackBuffer(StackBuffer&&) = delete;
 
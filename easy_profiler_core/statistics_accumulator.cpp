@@ -0,0 +1,131 @@
+/**
+Lightweight profiler library for c++
+Copyright(C) 2016-2017  Sergey Yagovtsev, Victor Zarubkin
+
+Licensed under either of
+    * MIT license (LICENSE.MIT or http://opensource.org/licenses/MIT)
+    * Apache License, Version 2.0, (LICENSE.APACHE or http://www.apache.org/licenses/LICENSE-2.0)
+at your option.
+
+The MIT License
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights 
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies 
+    of the Software, and to permit persons to whom the Software is furnished 
+    to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all 
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+    PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE 
+    LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE 
+    USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+The Apache License, Version 2.0 (the "License");
+    You may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+
+**/
+
+#include "statistics_accumulator.h"
+
+//////////////////////////////////////////////////////////////////////////
+
+BlockAccumulator::BlockAccumulator()
+{
+    count = ATOMIC_VAR_INIT(0ULL);
+    total = ATOMIC_VAR_INIT(0ULL);
+    min = ATOMIC_VAR_INIT(~0ULL);
+    max = ATOMIC_VAR_INIT(0ULL);
+    for (auto& bucket : buckets)
+        bucket = ATOMIC_VAR_INIT(0ULL);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void MergedStatistics::merge(const BlockAccumulator& _accumulator)
+{
+    count += _accumulator.count.load(std::memory_order_relaxed);
+    total += _accumulator.total.load(std::memory_order_relaxed);
+
+    const auto accumulatorMin = _accumulator.min.load(std::memory_order_relaxed);
+    if (accumulatorMin < min)
+        min = accumulatorMin;
+
+    const auto accumulatorMax = _accumulator.max.load(std::memory_order_relaxed);
+    if (accumulatorMax > max)
+        max = accumulatorMax;
+
+    for (uint16_t i = 0; i < HISTOGRAM_BUCKETS; ++i)
+        buckets[i] += _accumulator.buckets[i].load(std::memory_order_relaxed);
+}
+
+void MergedStatistics::merge(const MergedStatistics& _statistics)
+{
+    count += _statistics.count;
+    total += _statistics.total;
+
+    if (_statistics.min < min)
+        min = _statistics.min;
+
+    if (_statistics.max > max)
+        max = _statistics.max;
+
+    for (uint16_t i = 0; i < HISTOGRAM_BUCKETS; ++i)
+        buckets[i] += _statistics.buckets[i];
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+AccumulatorsTable::AccumulatorsTable()
+{
+    for (auto& chunk : m_chunks)
+        chunk = ATOMIC_VAR_INIT(nullptr);
+}
+
+AccumulatorsTable::~AccumulatorsTable()
+{
+    for (auto& chunk : m_chunks)
+    {
+        slot_t* slots = chunk.load(std::memory_order_acquire);
+        if (slots == nullptr)
+            continue;
+
+        for (uint32_t j = 0; j < CHUNK_SIZE; ++j)
+            delete slots[j].load(std::memory_order_acquire);
+
+        delete [] slots;
+    }
+}
+
+BlockAccumulator* AccumulatorsTable::create(profiler::block_id_t _id)
+{
+    auto& chunk = m_chunks[_id / CHUNK_SIZE];
+
+    slot_t* slots = chunk.load(std::memory_order_relaxed);
+    if (slots == nullptr)
+    {
+        slots = new slot_t[CHUNK_SIZE];
+        for (uint32_t j = 0; j < CHUNK_SIZE; ++j)
+            slots[j] = ATOMIC_VAR_INIT(nullptr);
+        chunk.store(slots, std::memory_order_release);
+    }
+
+    auto accumulator = new BlockAccumulator();
+    slots[_id % CHUNK_SIZE].store(accumulator, std::memory_order_release);
+
+    return accumulator;
+}
@@ -0,0 +1,229 @@
+/**
+Lightweight profiler library for c++
+Copyright(C) 2016-2017  Sergey Yagovtsev, Victor Zarubkin
+
+Licensed under either of
+    * MIT license (LICENSE.MIT or http://opensource.org/licenses/MIT)
+    * Apache License, Version 2.0, (LICENSE.APACHE or http://www.apache.org/licenses/LICENSE-2.0)
+at your option.
+
+The MIT License
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights 
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies 
+    of the Software, and to permit persons to whom the Software is furnished 
+    to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all 
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+    PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE 
+    LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE 
+    USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+The Apache License, Version 2.0 (the "License");
+    You may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+
+**/
+
+#ifndef EASY_PROFILER_STATISTICS_ACCUMULATOR_H
+#define EASY_PROFILER_STATISTICS_ACCUMULATOR_H
+
+#include <easy/profiler.h>
+#include <atomic>
+
+#ifdef _MSC_VER
+# include <intrin.h>
+#endif
+
+//////////////////////////////////////////////////////////////////////////
+
+/** Log-linear histogram layout.
+
+Values less than 4 have their own buckets. Every next power of two range [2^e, 2^(e+1)) is split
+into 4 equal sub-buckets, so relative error of a bucket bound is at most 25%.
+Values greater than or equal to 2^48 ticks (more than a day for 3 GHz clock) are counted in the last bucket.
+*/
+const uint16_t HISTOGRAM_SUB_BUCKETS = 4;
+const uint16_t HISTOGRAM_MAX_EXPONENT = 47;
+const uint16_t HISTOGRAM_BUCKETS = HISTOGRAM_SUB_BUCKETS * HISTOGRAM_MAX_EXPONENT;
+
+inline uint16_t histogram_bucket(profiler::timestamp_t _value)
+{
+    if (_value < HISTOGRAM_SUB_BUCKETS)
+        return static_cast<uint16_t>(_value);
+
+#ifdef _MSC_VER
+    unsigned long exponent = 0;
+    _BitScanReverse64(&exponent, _value);
+#else
+    const auto exponent = static_cast<uint16_t>(63 - __builtin_clzll(_value));
+#endif
+
+    if (exponent > HISTOGRAM_MAX_EXPONENT)
+        return HISTOGRAM_BUCKETS - 1;
+
+    return static_cast<uint16_t>(HISTOGRAM_SUB_BUCKETS * (exponent - 1) + ((_value >> (exponent - 2)) & (HISTOGRAM_SUB_BUCKETS - 1)));
+}
+
+/** Lowest value which is counted in the bucket.
+*/
+inline profiler::timestamp_t histogram_bucket_lower_bound(uint16_t _bucket)
+{
+    if (_bucket < HISTOGRAM_SUB_BUCKETS)
+        return _bucket;
+
+    const auto exponent = _bucket / HISTOGRAM_SUB_BUCKETS + 1;
+    const auto sub = _bucket % HISTOGRAM_SUB_BUCKETS;
+    return static_cast<profiler::timestamp_t>(HISTOGRAM_SUB_BUCKETS + sub) << (exponent - 2);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+/** Statistics of one block descriptor collected by one thread.
+
+Only the owner thread writes (without read-modify-write operations), other threads may read concurrently.
+Values read concurrently may be slightly inconsistent with each other (for example, count may be already
+updated while total is not), which is acceptable for statistics.
+*/
+struct BlockAccumulator EASY_FINAL
+{
+    std::atomic<uint64_t>                     count;
+    std::atomic<profiler::timestamp_t>        total;
+    std::atomic<profiler::timestamp_t>          min;
+    std::atomic<profiler::timestamp_t>          max;
+    std::atomic<uint64_t> buckets[HISTOGRAM_BUCKETS];
+
+    BlockAccumulator();
+
+    /** Add _weight calls of _duration ticks each (weight is a sampling rate of the descriptor).
+
+    \note Must be called only by the owner thread.
+    */
+    inline void add(profiler::timestamp_t _duration, uint16_t _weight)
+    {
+        count.store(count.load(std::memory_order_relaxed) + _weight, std::memory_order_relaxed);
+        total.store(total.load(std::memory_order_relaxed) + _duration * _weight, std::memory_order_relaxed);
+
+        if (_duration < min.load(std::memory_order_relaxed))
+            min.store(_duration, std::memory_order_relaxed);
+
+        if (_duration > max.load(std::memory_order_relaxed))
+            max.store(_duration, std::memory_order_relaxed);
+
+        auto& bucket = buckets[histogram_bucket(_duration)];
+        bucket.store(bucket.load(std::memory_order_relaxed) + _weight, std::memory_order_relaxed);
+    }
+
+private:
+
+    BlockAccumulator(const BlockAccumulator&) = delete;
+    BlockAccumulator& operator = (const BlockAccumulator&) = delete;
+
+}; // END of struct BlockAccumulator.
+
+/** Plain (not atomic) statistics of one block descriptor merged from several accumulators.
+*/
+struct MergedStatistics EASY_FINAL
+{
+    uint64_t                          count = 0;
+    profiler::timestamp_t             total = 0;
+    profiler::timestamp_t            min = ~0ULL;
+    profiler::timestamp_t               max = 0;
+    uint64_t buckets[HISTOGRAM_BUCKETS] = {};
+
+    void merge(const BlockAccumulator& _accumulator);
+    void merge(const MergedStatistics& _statistics);
+
+}; // END of struct MergedStatistics.
+
+//////////////////////////////////////////////////////////////////////////
+
+/** Per-thread accumulators indexed by block descriptor id.
+
+Accumulators are created lazily by the owner thread on the first block of a descriptor and are never removed,
+so the memory used by the table is bounded by the number of descriptors and does not grow with time.
+Two-level array of pointers is used to let other threads read accumulators without locks while the owner adds new ones.
+*/
+class AccumulatorsTable EASY_FINAL
+{
+    enum : uint32_t
+    {
+        CHUNK_SIZE = 8192,
+        MAX_CHUNKS = 512 ///< Up to 4M descriptors (the same as descriptors registry limit)
+    };
+
+    typedef std::atomic<BlockAccumulator*> slot_t;
+
+    std::atomic<slot_t*> m_chunks[MAX_CHUNKS];
+
+public:
+
+    AccumulatorsTable();
+    ~AccumulatorsTable();
+
+    /** Add block duration to the accumulator of descriptor _id, creating it if necessary.
+
+    \note Must be called only by the owner thread.
+    */
+    inline void add(profiler::block_id_t _id, profiler::timestamp_t _duration, uint16_t _weight)
+    {
+        if (_id >= static_cast<uint32_t>(CHUNK_SIZE) * MAX_CHUNKS)
+            return;
+
+        const slot_t* chunk = m_chunks[_id / CHUNK_SIZE].load(std::memory_order_relaxed);
+        BlockAccumulator* accumulator = chunk != nullptr ? chunk[_id % CHUNK_SIZE].load(std::memory_order_relaxed) : nullptr;
+        if (accumulator == nullptr)
+            accumulator = create(_id);
+
+        accumulator->add(_duration, _weight);
+    }
+
+    /** Call _func(block_id_t id, const BlockAccumulator& accumulator) for every existing accumulator.
+
+    \note Can be called concurrently with add().
+    */
+    template <class TFunc>
+    void forEach(TFunc&& _func) const
+    {
+        for (uint32_t i = 0; i < MAX_CHUNKS; ++i)
+        {
+            const slot_t* chunk = m_chunks[i].load(std::memory_order_acquire);
+            if (chunk == nullptr)
+                continue;
+
+            for (uint32_t j = 0; j < CHUNK_SIZE; ++j)
+            {
+                const BlockAccumulator* accumulator = chunk[j].load(std::memory_order_acquire);
+                if (accumulator != nullptr)
+                    _func(static_cast<profiler::block_id_t>(i * CHUNK_SIZE + j), *accumulator);
+            }
+        }
+    }
+
+private:
+
+    BlockAccumulator* create(profiler::block_id_t _id);
+
+    AccumulatorsTable(const AccumulatorsTable&) = delete;
+    AccumulatorsTable& operator = (const AccumulatorsTable&) = delete;
+
+}; // END of class AccumulatorsTable.
+
+//////////////////////////////////////////////////////////////////////////
+
+#endif // EASY_PROFILER_STATISTICS_ACCUMULATOR_H
@@ -42,25 +42,26 @@ The Apache License, Version 2.0 (the "License");
 
 #include <easy/serialized_block.h>
 #include "thread_storage.h"
-#include "current_thread.h"
 #include "current_time.h"
+#include "compact_format.h"
 
-ThreadStorage::ThreadStorage()
+ThreadStorage::ThreadStorage(profiler::thread_id_t _id)
     : nonscopedBlocks(16)
     , frameStartTime(0)
-    , id(getCurrentThreadId())
+    , id(_id)
+    , perfGeneration(0)
     , stackSize(0)
     , allowChildren(true)
     , named(false)
     , guarded(false)
-    , frameOpened(false)
     , halt(false)
 {
     expired = ATOMIC_VAR_INIT(0);
-    profiledFrameOpened = ATOMIC_VAR_INIT(false);
+    fastState.silentBlocks = 0;
+    fastState.frameOpened = false;
 }
 
-void ThreadStorage::storeBlock(const profiler::Block& block)
+void ThreadStorage::storeBlock(const profiler::Block& block, uint16_t sampling, uint32_t countersMask, const uint64_t* counters)
 {
 #if EASY_OPTION_MEASURE_STORAGE_EXPAND != 0
     EASY_LOCAL_STATIC_PTR(const BaseBlockDescriptor*, desc, \
@@ -71,8 +72,13 @@ void ThreadStorage::storeBlock(const profiler::Block& block)
     EASY_THREAD_LOCAL static profiler::timestamp_t endTime = 0ULL;
 #endif
 
-    uint16_t name_length = static_cast<uint16_t>(strlen(block.name()));
-    uint16_t size = static_cast<uint16_t>(sizeof(profiler::BaseBlockData) + name_length + 1);
+    // Runtime name is stored only once in runtimeNames table, block record stores it's id instead
+    uint16_t name_length = 0;
+    const uint32_t name_id = *block.name() != 0 ? runtimeNames.intern(block.name(), name_length) : RuntimeNames::NO_ID;
+    const uint16_t name_size = name_id != RuntimeNames::NO_ID ? profiler::compact::INTERNED_NAME_SIZE : static_cast<uint16_t>(name_length + 1);
+    const uint16_t sampling_size = sampling > 1 ? static_cast<uint16_t>(sizeof(uint16_t)) : 0;
+    const uint16_t counters_size = countersMask != 0 ? profiler::compact::counters_size(countersMask) : 0;
+    uint16_t size = static_cast<uint16_t>(sizeof(profiler::BaseBlockData) + name_size + sampling_size + counters_size);
 
 #if EASY_OPTION_MEASURE_STORAGE_EXPAND != 0
     const bool expanded = (desc->m_status & profiler::ON) && blocks.closedList.need_expand(size);
@@ -85,8 +91,38 @@ void ThreadStorage::storeBlock(const profiler::Block& block)
     if (expanded) endTime = getCurrentTime();
 #endif
 
-    ::new (data) profiler::SerializedBlock(block, name_length);
-    blocks.usedMemorySize += size;
+    if (name_id != RuntimeNames::NO_ID)
+    {
+        // Empty name followed by name id and name length (see compact_format.h)
+        ::new (data) profiler::SerializedBlock(block, 0);
+        char* name = static_cast<char*>(data) + sizeof(profiler::BaseBlockData);
+        memcpy(name + 1, &name_id, sizeof(uint32_t));
+        memcpy(name + 1 + sizeof(uint32_t), &name_length, sizeof(uint16_t));
+    }
+    else
+    {
+        ::new (data) profiler::SerializedBlock(block, name_length);
+    }
+
+    if (sampling_size != 0)
+    {
+        // Sampling rate is stored right after the name (see compact_format.h)
+        auto serialized = static_cast<profiler::SerializedBlock*>(data);
+        serialized->setId(serialized->id() | profiler::compact::SAMPLING_FLAG);
+        memcpy(static_cast<char*>(data) + sizeof(profiler::BaseBlockData) + name_size, &sampling, sizeof(uint16_t));
+    }
+
+    if (countersMask != 0)
+    {
+        // Counters values followed by their mask (see compact_format.h)
+        auto serialized = static_cast<profiler::SerializedBlock*>(data);
+        serialized->setId(serialized->id() | profiler::compact::PERF_COUNTERS_FLAG);
+        char* output = static_cast<char*>(data) + sizeof(profiler::BaseBlockData) + name_size + sampling_size;
+        memcpy(output, counters, counters_size - sizeof(uint8_t));
+        output[counters_size - 1] = static_cast<char>(countersMask);
+    }
+
+    blocks.closedList.publish();
 
 #if EASY_OPTION_MEASURE_STORAGE_EXPAND != 0
     if (expanded)
@@ -97,7 +133,7 @@ void ThreadStorage::storeBlock(const profiler::Block& block)
         size = static_cast<uint16_t>(sizeof(profiler::BaseBlockData) + 1);
         data = blocks.closedList.allocate(size);
         ::new (data) profiler::SerializedBlock(b, 0);
-        blocks.usedMemorySize += size;
+        blocks.closedList.publish();
     }
 #endif
 }
@@ -108,13 +144,7 @@ void ThreadStorage::storeCSwitch(const CSwitchBlock& block)
     uint16_t size = static_cast<uint16_t>(sizeof(profiler::CSwitchEvent) + name_length + 1);
     void* data = sync.closedList.allocate(size);
     ::new (data) profiler::SerializedCSwitch(block, name_length);
-    sync.usedMemorySize += size;
-}
-
-void ThreadStorage::clearClosed()
-{
-    blocks.clearClosed();
-    sync.clearClosed();
+    sync.closedList.publish();
 }
 
 void ThreadStorage::popSilent()
@@ -125,21 +155,125 @@ void ThreadStorage::popSilent()
         top.m_end = top.m_begin;
         if (!top.m_isScoped)
             nonscopedBlocks.pop();
+        if (!perfSamples.empty() && perfSamples.back().depth + 1 == blocks.openedList.size())
+            perfSamples.pop_back();
         blocks.openedList.pop_back();
     }
 }
 
+void ThreadStorage::beginPerfSample(uint32_t _mask, uint32_t _generation)
+{
+    // Reopening counters would invalidate values read for opened blocks, so wait until they are closed
+    if (perfGeneration != _generation && perfSamples.empty())
+    {
+        perfGeneration = _generation;
+        perfCounters.open(_mask);
+    }
+
+    if (perfCounters.mask() == 0)
+        return;
+
+    perfSamples.emplace_back();
+    auto& sample = perfSamples.back();
+    sample.depth = static_cast<uint32_t>(blocks.openedList.size() - 1);
+    sample.mask = perfCounters.mask();
+    if (!perfCounters.read(sample.values))
+        perfSamples.pop_back();
+}
+
+uint32_t ThreadStorage::endPerfSample(uint64_t* _deltas)
+{
+    if (perfSamples.empty() || perfSamples.back().depth + 1 != blocks.openedList.size())
+        return 0;
+
+    const auto& sample = perfSamples.back();
+    const auto mask = sample.mask;
+    if (mask != perfCounters.mask() || !perfCounters.read(_deltas))
+    {
+        perfSamples.pop_back();
+        return 0;
+    }
+
+    for (uint32_t i = 0, number = perfCounters.number(); i < number; ++i)
+        _deltas[i] -= sample.values[i];
+
+    perfSamples.pop_back();
+    return mask;
+}
+
+bool ThreadStorage::sample(profiler::block_id_t _id, uint16_t _sampling)
+{
+    if (_id >= samplingCounters.size())
+        samplingCounters.resize(_id + 1, 0);
+
+    auto& counter = samplingCounters[_id];
+    if (counter == 0)
+    {
+        counter = static_cast<uint16_t>(_sampling - 1);
+        return true;
+    }
+
+    --counter;
+    return false;
+}
+
+void ThreadStorage::storeSummary(profiler::block_id_t _id, profiler::timestamp_t _duration, uint16_t _calls)
+{
+    profiler::guard_lock<profiler::spin_lock> lock(summariesSpin);
+
+    if (_id >= summaries.size())
+        summaries.resize(_id + 1);
+
+    auto& summary = summaries[_id];
+    summary.duration += _duration * _calls;
+    summary.count += _calls;
+}
+
+void ThreadStorage::takeSummaries(std::vector<std::pair<profiler::block_id_t, BlockSummary> >& _output)
+{
+    profiler::guard_lock<profiler::spin_lock> lock(summariesSpin);
+
+    for (size_t id = 0, size = summaries.size(); id < size; ++id)
+    {
+        auto& summary = summaries[id];
+        if (summary.count != 0)
+        {
+            _output.emplace_back(static_cast<profiler::block_id_t>(id), summary);
+            summary = BlockSummary();
+        }
+    }
+}
+
+void ThreadStorage::copySummaries(std::vector<std::pair<profiler::block_id_t, BlockSummary> >& _output)
+{
+    profiler::guard_lock<profiler::spin_lock> lock(summariesSpin);
+
+    for (size_t id = 0, size = summaries.size(); id < size; ++id)
+    {
+        const auto& summary = summaries[id];
+        if (summary.count != 0)
+            _output.emplace_back(static_cast<profiler::block_id_t>(id), summary);
+    }
+}
+
 void ThreadStorage::beginFrame()
 {
-    if (!frameOpened)
+    if (!fastState.frameOpened)
     {
         frameStartTime = getCurrentTime();
-        frameOpened = true;
+        fastState.frameOpened = true;
     }
 }
 
 profiler::timestamp_t ThreadStorage::endFrame()
 {
-    frameOpened = false;
+    fastState.frameOpened = false;
     return getCurrentTime() - frameStartTime;
 }
+
+void ThreadStorage::resetFastStateCaches()
+{
+    for (auto cache : fastStateCaches)
+        *cache = nullptr;
+    fastStateCaches.clear();
+}
@@ -50,6 +50,10 @@ The Apache License, Version 2.0 (the "License");
 #include <functional>
 #include "stack_buffer.h"
 #include "chunk_allocator.h"
+#include "spin_lock.h"
+#include "statistics_accumulator.h"
+#include "runtime_names.h"
+#include "perf_counters.h"
 
 //////////////////////////////////////////////////////////////////////////
 
@@ -59,13 +63,7 @@ struct BlocksList
     BlocksList() = default;
 
     std::vector<T>            openedList;
-    chunk_allocator<N>        closedList;
-    uint64_t          usedMemorySize = 0;
-
-    void clearClosed() {
-        //closedList.clear();
-        usedMemorySize = 0;
-    }
+    chunk_allocator<N>        closedList; ///< Filled by the owner thread, consumed by dumping (or flushing) thread without locks
 
 private:
 
@@ -88,6 +86,29 @@ public:
 
 //////////////////////////////////////////////////////////////////////////
 
+/** Aggregated blocks of one descriptor which have been filtered out by minimum duration.
+*/
+struct BlockSummary
+{
+    profiler::timestamp_t duration = 0; ///< Total duration of filtered blocks (in ticks)
+    uint32_t                 count = 0; ///< Number of filtered blocks
+
+}; // END of struct BlockSummary.
+
+//////////////////////////////////////////////////////////////////////////
+
+/** Values of performance counters read at the beginning of opened block.
+*/
+struct PerfSample
+{
+    uint64_t values[profiler::PERF_COUNTERS_NUMBER]; ///< Counter values in order of set bits of mask
+    uint32_t                                  depth; ///< Index of the block in blocks.openedList
+    uint32_t                                   mask; ///< Counters which have been read
+
+}; // END of struct PerfSample.
+
+//////////////////////////////////////////////////////////////////////////
+
 const uint16_t SIZEOF_BLOCK = sizeof(profiler::BaseBlockData) + 1 + sizeof(uint16_t); // SerializedBlock stores BaseBlockData + at least 1 character for name ('\0') + 2 bytes for size of serialized data
 const uint16_t SIZEOF_CSWITCH = sizeof(profiler::CSwitchEvent) + 1 + sizeof(uint16_t); // SerializedCSwitch also stores additional 4 bytes to be able to save 64-bit thread_id
 
@@ -95,29 +116,85 @@ struct ThreadStorage
 {
     StackBuffer<NonscopedBlock>                                                 nonscopedBlocks;
     BlocksList<std::reference_wrapper<profiler::Block>, SIZEOF_BLOCK * (uint16_t)128U>   blocks;
-    BlocksList<CSwitchBlock, SIZEOF_CSWITCH * (uint16_t)128U>                              sync;
-
+    BlocksList<CSwitchBlock, SIZEOF_CSWITCH * (uint16_t)128U>                              sync; ///< Filled by event tracer or dumping thread, not by the owner thread (guarded by syncSpin)
+
+    std::vector<uint16_t> samplingCounters; ///< Number of blocks to skip for each sampled descriptor (indexed by descriptor id)
+    std::vector<BlockSummary>    summaries; ///< Filtered blocks aggregated per descriptor (indexed by descriptor id, guarded by summariesSpin)
+    profiler::spin_lock       summariesSpin; ///< Owner thread updates summaries, dumping thread takes them away
+    profiler::spin_lock            syncSpin; ///< Guards sync.openedList and producer side of sync.closedList (context switches are stored by several threads)
+    AccumulatorsTable           statistics; ///< Blocks statistics collected in statistics-only mode (indexed by descriptor id)
+    RuntimeNames              runtimeNames; ///< Interned runtime names of stored blocks
+    PerfCounters              perfCounters; ///< Performance counters opened for this thread
+    std::vector<PerfSample>    perfSamples; ///< Counters read at the beginning of opened blocks which have counters enabled
     std::string                     name; ///< Thread name
+    std::vector<profiler::ThreadFastState**> fastStateCaches; ///< Thread-local variables of modules which cache pointer to fastState
+    profiler::ThreadFastState      fastState; ///< State checked by inlined fast path of blocks (also tells if new frame is opened)
     profiler::timestamp_t frameStartTime; ///< Current frame start time. Used to calculate FPS.
     const profiler::thread_id_t       id; ///< Thread ID
+    uint32_t              perfGeneration; ///< Counters set generation which perfCounters have been opened for
     std::atomic<char>            expired; ///< Is thread expired
-    std::atomic_bool profiledFrameOpened; ///< Is new profiled frame opened (this is true when profiling is enabled and there is an opened frame) \sa frameOpened
     int32_t                    stackSize; ///< Current thread stack depth. Used when switching profiler state to begin collecting blocks only when new frame would be opened.
     bool                   allowChildren; ///< False if one of previously opened blocks has OFF_RECURSIVE or ON_WITHOUT_CHILDREN status
     bool                           named; ///< True if thread name was set
     bool                         guarded; ///< True if thread has been registered using ThreadGuard
-    bool                     frameOpened; ///< Is new frame opened (this does not depend on profiling status) \sa profiledFrameOpened
     bool                            halt; ///< This is set to true when new frame started while dumping blocks. Used to restrict collecting blocks during dumping process.
 
-    void storeBlock(const profiler::Block& _block);
+    /** Store closed block.
+
+    \param _sampling Sampling rate the block has been stored with (number of calls represented by the block).
+    \param _countersMask Performance counters stored with the block (0 if there are no counters).
+    \param _counters Counters deltas in order of set bits of _countersMask.
+    */
+    void storeBlock(const profiler::Block& _block, uint16_t _sampling = 1, uint32_t _countersMask = 0, const uint64_t* _counters = nullptr);
+    /** Store closed context switch event.
+
+    \note syncSpin must be locked by the caller.
+    */
     void storeCSwitch(const CSwitchBlock& _block);
-    void clearClosed();
     void popSilent();
 
+    /** Read performance counters for the block which has just been pushed into blocks.openedList.
+
+    Counters are (re)opened with _mask when _generation changes (ProfileManager increments it on each counters set change).
+    */
+    void beginPerfSample(uint32_t _mask, uint32_t _generation);
+
+    /** Calculate performance counters deltas for the top opened block if they have been read by beginPerfSample().
+
+    \retval Mask of counters written into _deltas (0 if there are no counters for the top block).
+    */
+    uint32_t endPerfSample(uint64_t* _deltas);
+
+    /** Check if the next block of sampled descriptor should be stored.
+
+    The first block is stored, then next (_sampling - 1) blocks are skipped and so on.
+    */
+    bool sample(profiler::block_id_t _id, uint16_t _sampling);
+
+    /** Aggregate block which is shorter than minimum duration instead of storing it.
+
+    \param _calls Number of calls represented by the block (sampling rate of it's descriptor).
+    */
+    void storeSummary(profiler::block_id_t _id, profiler::timestamp_t _duration, uint16_t _calls);
+
+    /** Move all non-empty summaries into _output as (descriptor id, summary) pairs.
+
+    \note Called by dumping thread.
+    */
+    void takeSummaries(std::vector<std::pair<profiler::block_id_t, BlockSummary> >& _output);
+
+    /** Copy all non-empty summaries into _output as (descriptor id, summary) pairs leaving them in the storage.
+    */
+    void copySummaries(std::vector<std::pair<profiler::block_id_t, BlockSummary> >& _output);
+
     void beginFrame();
     profiler::timestamp_t endFrame();
 
-    ThreadStorage();
+    /** Reset all cached pointers to fastState (called when thread is unregistered).
+    */
+    void resetFastStateCaches();
+
+    explicit ThreadStorage(profiler::thread_id_t _id);
 
 private:
 
@@ -0,0 +1,206 @@
+/**
+Lightweight profiler library for c++
+Copyright(C) 2016-2017  Sergey Yagovtsev, Victor Zarubkin
+
+Licensed under either of
+    * MIT license (LICENSE.MIT or http://opensource.org/licenses/MIT)
+    * Apache License, Version 2.0, (LICENSE.APACHE or http://www.apache.org/licenses/LICENSE-2.0)
+at your option.
+
+The MIT License
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights 
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies 
+    of the Software, and to permit persons to whom the Software is furnished 
+    to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all 
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+    PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE 
+    LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE 
+    USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+The Apache License, Version 2.0 (the "License");
+    You may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+
+**/
+
+#include <thread>
+#include "threads_registry.h"
+
+ThreadsRegistry::ThreadsRegistry()
+{
+    for (auto& chunk : m_chunks)
+        chunk = ATOMIC_VAR_INIT(nullptr);
+    m_size = ATOMIC_VAR_INIT(0U);
+
+    // Pre-allocate the first chunk: most applications would never need more
+    auto chunk = new Slot[CHUNK_SIZE];
+    for (uint32_t i = 0; i < CHUNK_SIZE; ++i)
+    {
+        chunk[i].storage = ATOMIC_VAR_INIT(nullptr);
+        chunk[i].refs = ATOMIC_VAR_INIT(0U);
+        chunk[i].state = ATOMIC_VAR_INIT(SLOT_FREE);
+    }
+
+    m_chunks[0].store(chunk, std::memory_order_release);
+}
+
+ThreadsRegistry::~ThreadsRegistry()
+{
+    for (auto& chunkRef : m_chunks)
+    {
+        auto chunk = chunkRef.load(std::memory_order_acquire);
+        if (chunk == nullptr)
+            break;
+
+        for (uint32_t i = 0; i < CHUNK_SIZE; ++i)
+            delete chunk[i].storage.load(std::memory_order_acquire);
+
+        delete [] chunk;
+    }
+}
+
+uint32_t ThreadsRegistry::size() const
+{
+    return m_size.load(std::memory_order_acquire);
+}
+
+ThreadsRegistry::Slot* ThreadsRegistry::slot(uint32_t _index) const
+{
+    return m_chunks[_index / CHUNK_SIZE].load(std::memory_order_acquire) + _index % CHUNK_SIZE;
+}
+
+ThreadStorage* ThreadsRegistry::get(uint32_t _index) const
+{
+    auto s = slot(_index);
+    if (s->state.load(std::memory_order_acquire) != SLOT_READY)
+        return nullptr;
+    return s->storage.load(std::memory_order_acquire);
+}
+
+ThreadsRegistry::Reference ThreadsRegistry::find(profiler::thread_id_t _id) const
+{
+    Slot* s = nullptr;
+
+    {
+        profiler::guard_lock<profiler::spin_lock> lock(m_indexSpin);
+        auto it = m_index.find(_id);
+        if (it == m_index.end())
+            return Reference();
+
+        // Sequentially consistent operations here and in remove(): either remove() sees this reference
+        // or this reader sees the slot is not ready anymore.
+        s = slot(it->second);
+        s->refs.fetch_add(1, std::memory_order_seq_cst);
+    }
+
+    if (s->state.load(std::memory_order_seq_cst) == SLOT_READY)
+    {
+        auto storage = s->storage.load(std::memory_order_acquire);
+        if (storage->id == _id && storage->expired.load(std::memory_order_acquire) == 0)
+            return Reference(s, storage);
+    }
+
+    s->refs.fetch_sub(1, std::memory_order_release);
+
+    return Reference();
+}
+
+ThreadsRegistry::Reference ThreadsRegistry::findOrAdd(profiler::thread_id_t _id)
+{
+    auto storage = find(_id);
+    if (storage != nullptr)
+        return storage;
+
+    profiler::guard_lock<profiler::spin_lock> lock(m_insertSpin);
+
+    // Check again: the storage could be created by another thread (implicit registration)
+    storage = find(_id);
+    if (storage != nullptr)
+        return storage;
+
+    // Try to reuse a free slot first
+    const auto n = size();
+    uint32_t index = 0;
+    for (; index < n; ++index)
+    {
+        char expected = SLOT_FREE;
+        if (slot(index)->state.compare_exchange_strong(expected, SLOT_BUSY, std::memory_order_acq_rel))
+            break;
+    }
+
+    if (index == n)
+    {
+        if (n == static_cast<uint32_t>(CHUNK_SIZE) * MAX_CHUNKS)
+            return Reference();
+
+        if (n % CHUNK_SIZE == 0 && m_chunks[n / CHUNK_SIZE].load(std::memory_order_acquire) == nullptr)
+        {
+            auto chunk = new Slot[CHUNK_SIZE];
+            for (uint32_t i = 0; i < CHUNK_SIZE; ++i)
+            {
+                chunk[i].storage = ATOMIC_VAR_INIT(nullptr);
+                chunk[i].refs = ATOMIC_VAR_INIT(0U);
+                chunk[i].state = ATOMIC_VAR_INIT(SLOT_FREE);
+            }
+
+            m_chunks[n / CHUNK_SIZE].store(chunk, std::memory_order_release);
+        }
+
+        slot(n)->state.store(SLOT_BUSY, std::memory_order_release);
+        m_size.store(n + 1, std::memory_order_release);
+    }
+
+    auto s = slot(index);
+    auto newStorage = new ThreadStorage(_id);
+    s->refs.fetch_add(1, std::memory_order_relaxed); // Reference for the caller
+    s->storage.store(newStorage, std::memory_order_release);
+    s->state.store(SLOT_READY, std::memory_order_release);
+
+    {
+        // Index points to the latest storage of the thread (previous one is expired)
+        profiler::guard_lock<profiler::spin_lock> indexLock(m_indexSpin);
+        m_index[_id] = index;
+    }
+
+    return Reference(s, newStorage);
+}
+
+void ThreadsRegistry::remove(uint32_t _index)
+{
+    auto s = slot(_index);
+
+    char expected = SLOT_READY;
+    if (!s->state.compare_exchange_strong(expected, SLOT_BUSY, std::memory_order_seq_cst))
+        return;
+
+    {
+        profiler::guard_lock<profiler::spin_lock> lock(m_indexSpin);
+        auto it = m_index.find(s->storage.load(std::memory_order_acquire)->id);
+        if (it != m_index.end() && it->second == _index)
+            m_index.erase(it);
+    }
+
+    // Wait for references which have been taken before the slot has been marked busy
+    while (s->refs.load(std::memory_order_seq_cst) != 0)
+        std::this_thread::yield();
+
+    delete s->storage.exchange(nullptr, std::memory_order_acq_rel);
+    s->state.store(SLOT_FREE, std::memory_order_release);
+}
@@ -0,0 +1,193 @@
+/**
+Lightweight profiler library for c++
+Copyright(C) 2016-2017  Sergey Yagovtsev, Victor Zarubkin
+
+Licensed under either of
+    * MIT license (LICENSE.MIT or http://opensource.org/licenses/MIT)
+    * Apache License, Version 2.0, (LICENSE.APACHE or http://www.apache.org/licenses/LICENSE-2.0)
+at your option.
+
+The MIT License
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights 
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies 
+    of the Software, and to permit persons to whom the Software is furnished 
+    to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all 
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+    PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE 
+    LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE 
+    USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+The Apache License, Version 2.0 (the "License");
+    You may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+
+**/
+
+#ifndef EASY_PROFILER_THREADS_REGISTRY_H
+#define EASY_PROFILER_THREADS_REGISTRY_H
+
+#include <easy/profiler.h>
+#include <atomic>
+#include <unordered_map>
+#include "spin_lock.h"
+#include "thread_storage.h"
+
+//////////////////////////////////////////////////////////////////////////
+
+/** Registry of thread storages.
+
+Storages live in slots of pre-allocated chunks which are never moved or freed until registry destruction,
+so iterating over all storages does not require any locks. Storage of a thread is found by thread id
+with a hash index (guarded by a short spin lock).
+
+Slots of removed threads are reused by newly registered threads. Only insertion of a new storage
+takes a short spin lock (to prevent from registering the same thread twice) which is never held
+during dumping, so threads can be registered while dumping is in progress.
+
+\note find() and findOrAdd() return a Reference which keeps the storage alive: remove() waits until
+all references to the storage are released. get() is not protected: ProfileManager calls get() and remove()
+only while holding the lock which guards foreign storages readers (dumping and flushing threads).
+*/
+class ThreadsRegistry EASY_FINAL
+{
+    enum : uint32_t
+    {
+        CHUNK_SIZE = 256,
+        MAX_CHUNKS = 256 ///< Up to 64K simultaneously registered threads
+    };
+
+    enum SlotState : char
+    {
+        SLOT_FREE = 0,
+        SLOT_BUSY,  ///< Slot is claimed, storage is being created or destroyed
+        SLOT_READY
+    };
+
+    struct Slot
+    {
+        std::atomic<ThreadStorage*> storage;
+        std::atomic<uint32_t>          refs; ///< Number of alive references to the storage (remove() waits for them)
+        std::atomic<char>             state;
+    };
+
+public:
+
+    /** Reference to a thread storage which is not destroyed until the reference is released.
+    */
+    class Reference EASY_FINAL
+    {
+        friend ThreadsRegistry;
+
+        Slot*             m_slot;
+        ThreadStorage* m_storage;
+
+        Reference(Slot* _slot, ThreadStorage* _storage) : m_slot(_slot), m_storage(_storage) {}
+
+    public:
+
+        Reference() : m_slot(nullptr), m_storage(nullptr) {}
+
+        Reference(Reference&& _other) : m_slot(_other.m_slot), m_storage(_other.m_storage)
+        {
+            _other.m_slot = nullptr;
+            _other.m_storage = nullptr;
+        }
+
+        Reference& operator = (Reference&& _other)
+        {
+            if (this != &_other)
+            {
+                release();
+                m_slot = _other.m_slot;
+                m_storage = _other.m_storage;
+                _other.m_slot = nullptr;
+                _other.m_storage = nullptr;
+            }
+            return *this;
+        }
+
+        Reference(const Reference&) = delete;
+        Reference& operator = (const Reference&) = delete;
+
+        ~Reference() { release(); }
+
+        ThreadStorage* get() const { return m_storage; }
+        ThreadStorage* operator -> () const { return m_storage; }
+        bool operator == (std::nullptr_t) const { return m_storage == nullptr; }
+        bool operator != (std::nullptr_t) const { return m_storage != nullptr; }
+
+        void release()
+        {
+            if (m_slot != nullptr)
+                m_slot->refs.fetch_sub(1, std::memory_order_release);
+            m_slot = nullptr;
+            m_storage = nullptr;
+        }
+
+    }; // END of class Reference.
+
+private:
+
+    std::atomic<Slot*> m_chunks[MAX_CHUNKS];
+    std::atomic<uint32_t>            m_size; ///< Number of slots ever used (upper bound for iteration)
+    std::unordered_map<profiler::thread_id_t, uint32_t> m_index; ///< Thread id -> index of the slot with the latest storage of this thread
+    mutable profiler::spin_lock     m_indexSpin; ///< Guards m_index
+    profiler::spin_lock            m_insertSpin; ///< Guards only insertion of new storages
+
+public:
+
+    ThreadsRegistry();
+    ~ThreadsRegistry();
+
+    /** Upper bound of slot indices to iterate over with get().
+    */
+    uint32_t size() const;
+
+    /** Get storage in slot with specified index.
+
+    \retval nullptr if the slot is free.
+    */
+    ThreadStorage* get(uint32_t _index) const;
+
+    /** Find not expired storage of the thread.
+    */
+    Reference find(profiler::thread_id_t _id) const;
+
+    /** Find not expired storage of the thread or create a new one.
+
+    \retval Empty reference if there are no free slots.
+    */
+    Reference findOrAdd(profiler::thread_id_t _id);
+
+    /** Destroy storage in slot with specified index and make the slot free for reuse.
+
+    Waits until all references to the storage are released.
+    */
+    void remove(uint32_t _index);
+
+private:
+
+    Slot* slot(uint32_t _index) const;
+
+}; // END of class ThreadsRegistry.
+
+//////////////////////////////////////////////////////////////////////////
+
+#endif // EASY_PROFILER_THREADS_REGISTRY_H
@@ -68,6 +68,7 @@
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QTimer>
+#include <QInputDialog>
 #include <thread>
 #include "descriptors_tree_widget.h"
 #include "globals.h"
@@ -312,6 +313,13 @@ void EasyDescTreeWidget::contextMenuEvent(QContextMenuEvent* _event)
         submenu->setEnabled(EASY_GLOBALS.connected);
         if (!EASY_GLOBALS.connected)
             submenu->setTitle(QString("%1 (connection needed)").arg(submenu->title()));
+
+        action = menu.addAction(QString("Change sampling rate (%1)...").arg(desc.sampling()));
+        action->setToolTip("Store only 1 of N blocks of this type.\nIt is applied when capturing is stopped.");
+        action->setEnabled(EASY_GLOBALS.connected);
+        if (!EASY_GLOBALS.connected)
+            action->setText(QString("%1 (connection needed)").arg(action->text()));
+        connect(action, &QAction::triggered, this, &This::onBlockSamplingChangeClicked);
     }
 
     menu.exec(QCursor::pos());
@@ -537,6 +545,27 @@ void EasyDescTreeWidget::onBlockStatusChangeClicked(bool _checked)
     }
 }
 
+void EasyDescTreeWidget::onBlockSamplingChangeClicked(bool)
+{
+    if (!EASY_GLOBALS.connected)
+        return;
+
+    auto item = currentItem();
+    if (item == nullptr || item->parent() == nullptr)
+        return;
+
+    auto& desc = easyDescriptor(static_cast<EasyDescWidgetItem*>(item)->desc());
+
+    bool ok = false;
+    const int sampling = QInputDialog::getInt(this, "Sampling rate", QString("Store 1 of N blocks \"%1\":").arg(desc.name()),
+                                              desc.sampling(), 1, 65535, 1, &ok);
+    if (!ok || sampling == desc.sampling())
+        return;
+
+    desc.setSampling(static_cast<uint16_t>(sampling));
+    emit EASY_GLOBALS.events.blockSamplingChanged(desc.id(), desc.sampling());
+}
+
 void EasyDescTreeWidget::onBlockStatusChange(::profiler::block_id_t _id, ::profiler::EasyBlockStatus /* _status */)
 {
     if (m_bLocked)
@@ -76,6 +76,7 @@ namespace profiler_gui {
         void selectedBlockIdChanged(::profiler::block_id_t _id);
         void itemsExpandStateChanged();
         void blockStatusChanged(::profiler::block_id_t _id, ::profiler::EasyBlockStatus _status);
+        void blockSamplingChanged(::profiler::block_id_t _id, uint16_t _sampling);
         void connectionChanged(bool _connected);
         void blocksRefreshRequired(bool);
         void expectedFrameTimeChanged();
@@ -654,6 +654,7 @@ EasyMainWindow::EasyMainWindow() : Parent(), m_lastAddress("localhost"), m_lastP
     }
 
     connect(&EASY_GLOBALS.events, &::profiler_gui::EasyGlobalSignals::blockStatusChanged, this, &This::onBlockStatusChange);
+    connect(&EASY_GLOBALS.events, &::profiler_gui::EasyGlobalSignals::blockSamplingChanged, this, &This::onBlockSamplingChange);
     connect(&EASY_GLOBALS.events, &::profiler_gui::EasyGlobalSignals::blocksRefreshRequired, this, &This::onGetBlockDescriptionsClicked);
 }
 
@@ -2185,6 +2186,12 @@ void EasyMainWindow::onBlockStatusChange(::profiler::block_id_t _id, ::profiler:
         m_listener.send(profiler::net::BlockStatusMessage(_id, static_cast<uint8_t>(_status)));
 }
 
+void EasyMainWindow::onBlockSamplingChange(::profiler::block_id_t _id, uint16_t _sampling)
+{
+    if (EASY_GLOBALS.connected)
+        m_listener.send(profiler::net::BlockSamplingMessage(_id, _sampling));
+}
+
 //////////////////////////////////////////////////////////////////////////
 
 EasySocketListener::EasySocketListener() : m_receivedSize(0), m_port(0), m_regime(LISTENER_IDLE)
@@ -2342,8 +2349,16 @@ bool EasySocketListener::connect(const char* _ipaddress, uint16_t _port, profile
 
         auto message = reinterpret_cast<const ::profiler::net::EasyProfilerStatus*>(buffer);
         if (message->isEasyNetMessage() && message->type == profiler::net::MESSAGE_TYPE_ACCEPTED_CONNECTION)
+        {
             _reply = *message;
 
+            // Request compressed blocks: they are decompressed by fillTreesFromStream().
+            // Older applications do not know this message and just ignore it sending uncompressed blocks
+            // which are read as usual, so EasyProfilerStatus is left unchanged for compatibility.
+            profiler::net::BoolMessage request(profiler::net::MESSAGE_TYPE_COMPRESSION_STATUS, true);
+            m_easySocket.send(&request, sizeof(request));
+        }
+
         m_address = _ipaddress;
         m_port = _port;
     }
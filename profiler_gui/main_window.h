@@ -295,6 +295,7 @@ protected slots:
     void onFrameTimeChanged();
 
     void onBlockStatusChange(::profiler::block_id_t _id, ::profiler::EasyBlockStatus _status);
+    void onBlockSamplingChange(::profiler::block_id_t _id, uint16_t _sampling);
 
     void checkFrameTimeReady();
 
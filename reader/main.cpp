@@ -4,6 +4,7 @@
 #include <list>
 #include <iostream>
 #include <map>
+#include <unordered_map>
 #include <stack>
 #include <vector>
 #include <iterator>
@@ -69,6 +70,90 @@ void printTree(TreePrinter& printer, const ::profiler::BlocksTree& tree, int lev
     //}
 }
 
+/** Print per-thread block statistics gathered by columnar loader.
+
+Columnar storage is used here because it takes less memory than blocks tree and statistics do not need the tree itself.
+*/
+int printStatistics(const char* filename)
+{
+    ::profiler::SerializedData serialized_blocks, serialized_descriptors;
+    ::profiler::descriptors_list_t descriptors;
+    ::profiler::BlocksColumns columns;
+    ::std::stringstream errorMessage;
+    uint32_t descriptorsNumberInFile = 0;
+    uint32_t version = 0;
+
+    auto start = std::chrono::system_clock::now();
+    auto blocks_counter = fillColumnsFromFile(filename, serialized_blocks, serialized_descriptors, descriptors, columns,
+                                              descriptorsNumberInFile, version, true, errorMessage);
+    if (blocks_counter == 0)
+    {
+        std::cout << "Can not read blocks from file " << filename << "\nReason: " << errorMessage.str();
+        return 1;
+    }
+
+    auto end = std::chrono::system_clock::now();
+    std::cout << "Blocks count: " << blocks_counter << std::endl;
+    std::cout << "dT =  " << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << " usec" << std::endl;
+
+    for (const auto& thread : columns.threads)
+    {
+        std::cout << std::string(20, '=') << " thread " << thread.thread_id << " " << thread.name() << " " << std::string(20, '=') << std::endl;
+        std::cout << "blocks: " << thread.blocks_number << ", frames: " << thread.frames_number
+                  << ", profiled: " << thread.profiled_time / 1000 << " us, wait: " << thread.wait_time / 1000 << " us" << std::endl;
+
+        // Sort by total duration: the most expensive blocks go first
+        std::vector<std::pair<::profiler::block_id_t, const ::profiler::BlockStatistics*> > sorted;
+        sorted.reserve(thread.statistics.size());
+        for (const auto& stats : thread.statistics)
+            sorted.emplace_back(stats.first, &stats.second);
+        std::sort(sorted.begin(), sorted.end(), [](const std::pair<::profiler::block_id_t, const ::profiler::BlockStatistics*>& a,
+                                                   const std::pair<::profiler::block_id_t, const ::profiler::BlockStatistics*>& b) {
+            return a.second->total_duration > b.second->total_duration;
+        });
+
+        // Blocks filtered out by minimum duration are not stored, but their calls and duration are summarized
+        std::unordered_map<::profiler::block_id_t, const ::profiler::BlockSummary*> summaries;
+        for (const auto& summary : thread.summaries)
+            summaries.emplace(summary.id, &summary);
+
+        for (const auto& entry : sorted)
+        {
+            const auto& stats = *entry.second;
+            const char* name = entry.first < columns.first_runtime_id ? descriptors[entry.first]->name()
+                                                                       : columns.runtime_names[entry.first - columns.first_runtime_id];
+            std::cout << "  " << name << ": calls " << stats.calls_number
+                      << ", total " << stats.total_duration / 1000 << " us"
+                      << ", self " << (stats.total_duration - std::min(stats.total_duration, stats.total_children_duration)) / 1000 << " us"
+                      << ", avg " << stats.average_duration() << " ns"
+                      << ", min " << columns.duration(stats.min_duration_block) << " ns"
+                      << ", max " << columns.duration(stats.max_duration_block) << " ns";
+
+            auto it = summaries.find(entry.first);
+            if (it != summaries.end())
+            {
+                std::cout << ", filtered calls " << it->second->calls_number << ", filtered total " << it->second->total_duration / 1000 << " us";
+                summaries.erase(it);
+            }
+
+            std::cout << std::endl;
+        }
+
+        // Blocks which all have been filtered out
+        for (const auto& summary : thread.summaries)
+        {
+            if (summaries.find(summary.id) == summaries.end())
+                continue;
+
+            std::cout << "  " << descriptors[summary.id]->name() << ": filtered calls " << summary.calls_number
+                      << ", filtered total " << summary.total_duration / 1000 << " us"
+                      << ", avg " << summary.total_duration / std::max(summary.calls_number, static_cast<::profiler::calls_number_t>(1)) << " ns" << std::endl;
+        }
+    }
+
+    return 0;
+}
+
 int main(int argc, char* argv[])
 {
 
@@ -86,6 +171,9 @@ int main(int argc, char* argv[])
         //return 255;
     }
 
+    if (argc > 2 && argv[2] && ::std::string(argv[2]) == "--stats")
+        return printStatistics(filename.c_str());
+
     ::std::string dump_filename;
     if (argc > 2 && argv[2])
     {
@@ -0,0 +1,138 @@
+// Producer thread stores elements of different sizes into chunk_allocator (see easy_profiler_core/chunk_allocator.h)
+// while consumer thread reads and consumes published elements concurrently.
+// Checks that consumer gets every element exactly once, in order and fully constructed.
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#include "chunk_allocator.h"
+
+namespace {
+
+    const uint16_t CHUNK_SIZE = 1024; ///< Small chunks: many of them are linked and freed while consuming
+    const uint64_t ELEMENTS_NUMBER = 300000;
+
+    uint16_t elementSize(uint64_t _index)
+    {
+        return static_cast<uint16_t>(sizeof(uint64_t) + (_index * 7919) % 200);
+    }
+
+    char fillByte(uint64_t _index)
+    {
+        return static_cast<char>(_index * 31 + 7);
+    }
+
+    typedef chunk_allocator<CHUNK_SIZE> Queue;
+
+    // Consumer side: checks elements passed by read() or consume()
+    class Checker
+    {
+        uint64_t    m_next = 0;
+        uint64_t    m_size = 0;
+        bool      m_failed = false;
+
+    public:
+
+        explicit Checker(uint64_t _next = 0) : m_next(_next) {}
+
+        void operator () (const char* _data, uint16_t _size)
+        {
+            if (m_failed)
+                return;
+
+            uint64_t index = 0;
+            memcpy(&index, _data, sizeof(uint64_t));
+
+            bool ok = index == m_next && _size == elementSize(index);
+            for (uint16_t i = sizeof(uint64_t); ok && i < _size; ++i)
+                ok = _data[i] == fillByte(index);
+
+            if (!ok)
+            {
+                std::cerr << "Element " << index << " of size " << _size << " is passed instead of element " << m_next << "\n";
+                m_failed = true;
+                return;
+            }
+
+            ++m_next;
+            m_size += _size;
+        }
+
+        uint64_t next() const { return m_next; }
+        uint64_t size() const { return m_size; }
+        bool failed() const { return m_failed; }
+    };
+
+} // END of namespace.
+
+int main()
+{
+    Queue queue;
+    std::atomic<bool> producing(ATOMIC_VAR_INIT(true));
+
+    std::thread producer([&] {
+        for (uint64_t index = 0; index < ELEMENTS_NUMBER; ++index)
+        {
+            const auto size = elementSize(index);
+            auto data = static_cast<char*>(queue.allocate(size));
+            memcpy(data, &index, sizeof(uint64_t));
+            memset(data + sizeof(uint64_t), fillByte(index), size - sizeof(uint64_t));
+
+            // Publish some elements in batches
+            if (index % 3 != 0)
+                queue.publish();
+        }
+
+        queue.publish();
+        producing.store(false);
+    });
+
+    Checker consumed;
+    uint64_t counted = 0, countedSize = 0;
+    bool ok = true;
+
+    for (bool last = false; ok && !last;)
+    {
+        last = !producing.load();
+
+        // Elements counted by published() are read without consuming and then consumed: both passes see the same elements
+        Queue::position end;
+        uint64_t memorySize = 0;
+        const auto elementsNumber = queue.published(end, memorySize);
+
+        Checker read(consumed.next());
+        queue.read(end, read);
+
+        const auto before = consumed.next();
+        queue.consume(end, consumed);
+
+        if (read.failed() || consumed.failed() || read.next() != consumed.next()
+            || consumed.next() - before != elementsNumber || read.size() != memorySize)
+        {
+            std::cerr << "Elements passed by read() and consume() differ from published()\n";
+            ok = false;
+        }
+
+        counted += elementsNumber;
+        countedSize += memorySize;
+
+        if (queue.resident_size() != 0 && last)
+        {
+            std::cerr << "Published elements have not been consumed\n";
+            ok = false;
+        }
+    }
+
+    producer.join();
+
+    if (ok && (counted != ELEMENTS_NUMBER || consumed.next() != ELEMENTS_NUMBER || countedSize != consumed.size()))
+    {
+        std::cerr << consumed.next() << " elements consumed instead of " << ELEMENTS_NUMBER << "\n";
+        ok = false;
+    }
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,431 @@
+// Checks compact format of blocks and context switches (see easy_profiler_core/compact_format.h):
+// zigzag and varint encoding, PacketWriter + decode() round trip, rejecting of corrupted packets
+// and filtering of records by capture begin time.
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <easy/profiler.h>
+#include "compact_format.h"
+
+namespace {
+
+    struct Record
+    {
+        profiler::timestamp_t begin;
+        profiler::timestamp_t   end;
+        uint64_t              value; ///< Block id or target thread id
+        std::string            name;
+    };
+
+    bool operator == (const Record& _a, const Record& _b)
+    {
+        return _a.begin == _b.begin && _a.end == _b.end && _a.value == _b.value && _a.name == _b.name;
+    }
+
+    size_t headerSize(bool _cswitch)
+    {
+        return _cswitch ? sizeof(profiler::CSwitchEvent) : sizeof(profiler::BaseBlockData);
+    }
+
+    // Plain record payload as it is stored by ThreadStorage
+    std::vector<char> plainRecord(bool _cswitch, const Record& _record)
+    {
+        std::vector<char> data(headerSize(_cswitch) + _record.name.size() + 1, 0);
+        memcpy(data.data(), &_record.begin, sizeof(profiler::timestamp_t));
+        memcpy(data.data() + sizeof(profiler::timestamp_t), &_record.end, sizeof(profiler::timestamp_t));
+
+        if (_cswitch)
+        {
+            const profiler::thread_id_t tid = _record.value;
+            memcpy(data.data() + sizeof(profiler::Event), &tid, sizeof(profiler::thread_id_t));
+        }
+        else
+        {
+            const auto id = static_cast<profiler::block_id_t>(_record.value);
+            memcpy(data.data() + sizeof(profiler::Event), &id, sizeof(profiler::block_id_t));
+        }
+
+        memcpy(data.data() + headerSize(_cswitch), _record.name.c_str(), _record.name.size());
+        return data;
+    }
+
+    std::string encode(bool _cswitch, const std::vector<Record>& _records)
+    {
+        std::ostringstream output;
+        profiler::OStream stream(output);
+
+        {
+            profiler::compact::PacketWriter writer(stream, _cswitch);
+            for (const auto& record : _records)
+            {
+                const auto data = plainRecord(_cswitch, record);
+                writer.add(data.data(), static_cast<uint16_t>(data.size()));
+            }
+        }
+
+        stream.flush();
+        return output.str();
+    }
+
+    // Decode all packets and parse decoded records (uint16_t size + payload)
+    bool decode(bool _cswitch, const std::string& _packets, std::vector<Record>& _records, size_t& _packetsNumber)
+    {
+        _records.clear();
+        _packetsNumber = 0;
+
+        size_t pos = 0;
+        while (pos < _packets.size())
+        {
+            if (_packets.size() - pos < profiler::compact::PACKET_HEADER_SIZE)
+            {
+                std::cerr << "Truncated packet header\n";
+                return false;
+            }
+
+            uint32_t header[3];
+            memcpy(header, _packets.data() + pos, sizeof(header));
+            pos += profiler::compact::PACKET_HEADER_SIZE;
+
+            const uint32_t recordsNumber = header[0], payloadSize = header[1], decodedSize = header[2];
+            if (_packets.size() - pos < payloadSize)
+            {
+                std::cerr << "Truncated packet payload\n";
+                return false;
+            }
+
+            std::vector<char> decoded(decodedSize);
+            if (!profiler::compact::decode(_cswitch, _packets.data() + pos, payloadSize, recordsNumber, decoded.data(), decodedSize))
+            {
+                std::cerr << "Packet " << _packetsNumber << " can not be decoded\n";
+                return false;
+            }
+
+            pos += payloadSize;
+            ++_packetsNumber;
+
+            const char* data = decoded.data();
+            for (uint32_t i = 0; i < recordsNumber; ++i)
+            {
+                uint16_t size = 0;
+                memcpy(&size, data, sizeof(uint16_t));
+                data += sizeof(uint16_t);
+
+                Record record;
+                memcpy(&record.begin, data, sizeof(profiler::timestamp_t));
+                memcpy(&record.end, data + sizeof(profiler::timestamp_t), sizeof(profiler::timestamp_t));
+
+                if (_cswitch)
+                {
+                    profiler::thread_id_t tid = 0;
+                    memcpy(&tid, data + sizeof(profiler::Event), sizeof(profiler::thread_id_t));
+                    record.value = tid;
+                }
+                else
+                {
+                    profiler::block_id_t id = 0;
+                    memcpy(&id, data + sizeof(profiler::Event), sizeof(profiler::block_id_t));
+                    record.value = id;
+                }
+
+                record.name = data + headerSize(_cswitch);
+                if (headerSize(_cswitch) + record.name.size() + 1 > size)
+                {
+                    std::cerr << "Decoded record " << i << " is too small for it's name\n";
+                    return false;
+                }
+
+                _records.push_back(record);
+                data += size;
+            }
+
+            if (data != decoded.data() + decoded.size())
+            {
+                std::cerr << "Decoded size of packet " << _packetsNumber - 1 << " is wrong\n";
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool checkZigzag()
+    {
+        const int64_t values[] = {0, 1, -1, 2, -2, 63, -64, 123456789, -987654321,
+                                  std::numeric_limits<int64_t>::max(), std::numeric_limits<int64_t>::min()};
+
+        for (auto value : values)
+        {
+            if (profiler::compact::unzigzag(profiler::compact::zigzag(value)) != value)
+            {
+                std::cerr << "zigzag round trip failed for " << value << "\n";
+                return false;
+            }
+        }
+
+        // Small values of both signs must become small unsigned values
+        if (profiler::compact::zigzag(0) != 0 || profiler::compact::zigzag(-1) != 1 || profiler::compact::zigzag(1) != 2)
+        {
+            std::cerr << "zigzag does not interleave signs\n";
+            return false;
+        }
+
+        return true;
+    }
+
+    bool checkVarint()
+    {
+        const uint64_t values[] = {0, 1, 127, 128, 300, 16383, 16384, 0xffffffffULL, 0x100000000ULL,
+                                   std::numeric_limits<uint64_t>::max()};
+        const size_t sizes[] = {1, 1, 1, 2, 2, 2, 3, 5, 5, 10};
+
+        std::vector<char> buffer;
+        for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i)
+        {
+            const auto before = buffer.size();
+            profiler::compact::write_varint(buffer, values[i]);
+            if (buffer.size() - before != sizes[i])
+            {
+                std::cerr << "varint of " << values[i] << " takes " << buffer.size() - before << " bytes instead of " << sizes[i] << "\n";
+                return false;
+            }
+        }
+
+        const char* data = buffer.data();
+        const char* end = data + buffer.size();
+        for (auto expected : values)
+        {
+            uint64_t value = 0;
+            if (!profiler::compact::read_varint(data, end, value) || value != expected)
+            {
+                std::cerr << "varint round trip failed for " << expected << "\n";
+                return false;
+            }
+        }
+
+        if (data != end)
+        {
+            std::cerr << "varint reading has not consumed all data\n";
+            return false;
+        }
+
+        // Truncated value must not be read
+        buffer.clear();
+        profiler::compact::write_varint(buffer, 300);
+        buffer.pop_back();
+        data = buffer.data();
+        uint64_t value = 0;
+        if (profiler::compact::read_varint(data, buffer.data() + buffer.size(), value))
+        {
+            std::cerr << "Truncated varint has been read\n";
+            return false;
+        }
+
+        return true;
+    }
+
+    bool checkRoundTrip(bool _cswitch, const std::vector<Record>& _records, size_t _minPackets, const char* _title)
+    {
+        const auto packets = encode(_cswitch, _records);
+
+        std::vector<Record> decoded;
+        size_t packetsNumber = 0;
+        if (!decode(_cswitch, packets, decoded, packetsNumber))
+        {
+            std::cerr << _title << ": decoding failed\n";
+            return false;
+        }
+
+        if (decoded.size() != _records.size())
+        {
+            std::cerr << _title << ": " << decoded.size() << " records decoded instead of " << _records.size() << "\n";
+            return false;
+        }
+
+        for (size_t i = 0; i < decoded.size(); ++i)
+        {
+            if (!(decoded[i] == _records[i]))
+            {
+                std::cerr << _title << ": record " << i << " differs after round trip\n";
+                return false;
+            }
+        }
+
+        if (packetsNumber < _minPackets)
+        {
+            std::cerr << _title << ": " << packetsNumber << " packets written instead of at least " << _minPackets << "\n";
+            return false;
+        }
+
+        return true;
+    }
+
+    // Blocks are stored in order of their completion: children before parents, so begin deltas are also negative
+    std::vector<Record> nestedBlocks(size_t _frames)
+    {
+        std::vector<Record> records;
+        uint64_t seed = 12345;
+        profiler::timestamp_t time = 1ULL << 60;
+
+        for (size_t frame = 0; frame < _frames; ++frame)
+        {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            const profiler::timestamp_t frameBegin = time;
+            profiler::timestamp_t childBegin = frameBegin + (seed >> 60);
+
+            for (uint32_t child = 0; child < 3; ++child)
+            {
+                seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+                const profiler::timestamp_t duration = child == 1 ? 0 : (seed >> 40);
+                const std::string name = child == 2 ? std::string() : "child " + std::to_string(frame % 100);
+                records.push_back(Record {childBegin, childBegin + duration, 1 + child, name});
+                childBegin += duration + (seed >> 58);
+            }
+
+            records.push_back(Record {frameBegin, childBegin, 0x3ffffff0U, frame % 7 == 0 ? std::string(300, 'n') : std::string()});
+            time = childBegin + (seed >> 50);
+        }
+
+        return records;
+    }
+
+    std::vector<Record> contextSwitches()
+    {
+        std::vector<Record> records;
+        profiler::timestamp_t time = 1000;
+        for (uint64_t i = 0; i < 1000; ++i)
+        {
+            records.push_back(Record {time, time + i * 17, (i * 0x10001ULL) << 20, i % 3 == 0 ? std::string() : "process " + std::to_string(i)});
+            time += i * 31 + 1;
+        }
+
+        return records;
+    }
+
+    bool checkCorruption()
+    {
+        const auto packets = encode(false, nestedBlocks(100));
+
+        uint32_t header[3];
+        memcpy(header, packets.data(), sizeof(header));
+        const char* payload = packets.data() + profiler::compact::PACKET_HEADER_SIZE;
+
+        std::vector<char> decoded(header[2] + 64);
+        if (profiler::compact::decode(false, payload, header[1] - 1, header[0], decoded.data(), header[2]))
+        {
+            std::cerr << "Truncated payload has been decoded\n";
+            return false;
+        }
+
+        if (profiler::compact::decode(false, payload, header[1], header[0], decoded.data(), header[2] - 1))
+        {
+            std::cerr << "Payload has been decoded into too small buffer\n";
+            return false;
+        }
+
+        if (profiler::compact::decode(false, payload, header[1], header[0] + 1, decoded.data(), header[2] + 64))
+        {
+            std::cerr << "Payload has been decoded with wrong number of records\n";
+            return false;
+        }
+
+        return true;
+    }
+
+    // Filtered packets must contain exactly the records which reader keeps for the begin time
+    bool checkFilter(bool _cswitch, const std::vector<Record>& _records, profiler::timestamp_t _beginTime, const char* _title)
+    {
+        const auto packets = encode(_cswitch, _records);
+
+        std::string filtered;
+        size_t pos = 0;
+        while (pos < packets.size())
+        {
+            uint32_t header[3];
+            memcpy(header, packets.data() + pos, sizeof(header));
+            pos += profiler::compact::PACKET_HEADER_SIZE;
+
+            std::vector<char> payload;
+            uint32_t keptRecordsNumber = 0, keptDecodedSize = 0;
+            if (!profiler::compact::filter(_cswitch, packets.data() + pos, header[1], header[0], _beginTime, payload,
+                                           keptRecordsNumber, keptDecodedSize))
+            {
+                std::cerr << _title << ": packet can not be filtered\n";
+                return false;
+            }
+
+            pos += header[1];
+            if (keptRecordsNumber == 0)
+                continue;
+
+            const uint32_t keptHeader[3] = {keptRecordsNumber, static_cast<uint32_t>(payload.size()), keptDecodedSize};
+            filtered.append(reinterpret_cast<const char*>(keptHeader), sizeof(keptHeader));
+            filtered.append(payload.data(), payload.size());
+        }
+
+        std::vector<Record> expected;
+        for (const auto& record : _records)
+        {
+            if (_cswitch ? record.end > _beginTime : record.end >= _beginTime)
+                expected.push_back(record);
+        }
+
+        std::vector<Record> decoded;
+        size_t packetsNumber = 0;
+        if (!decode(_cswitch, filtered, decoded, packetsNumber))
+        {
+            std::cerr << _title << ": filtered packets can not be decoded\n";
+            return false;
+        }
+
+        if (decoded.size() != expected.size())
+        {
+            std::cerr << _title << ": " << decoded.size() << " records kept instead of " << expected.size() << "\n";
+            return false;
+        }
+
+        for (size_t i = 0; i < decoded.size(); ++i)
+        {
+            if (!(decoded[i] == expected[i]))
+            {
+                std::cerr << _title << ": kept record " << i << " differs from the original one\n";
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool checkFilters()
+    {
+        const auto blocks = nestedBlocks(1000);
+        const auto cswitches = contextSwitches();
+
+        // Begin time of a child block is between begin and end of it's parent (parent is stored after children)
+        return checkFilter(false, blocks, 0, "All blocks")
+            && checkFilter(false, blocks, blocks[blocks.size() / 2].begin, "Half of blocks")
+            && checkFilter(false, blocks, blocks[blocks.size() / 2].end, "Blocks ending at begin time")
+            && checkFilter(false, blocks, blocks.back().end + 1, "No blocks")
+            && checkFilter(true, cswitches, cswitches[cswitches.size() / 3].end, "Context switches ending at begin time");
+    }
+
+} // END of namespace.
+
+int main()
+{
+    // Large number of records with long names must be split into several packets
+    const bool ok = checkZigzag()
+                 && checkVarint()
+                 && checkRoundTrip(false, nestedBlocks(1000), 1, "Blocks")
+                 && checkRoundTrip(true, contextSwitches(), 1, "Context switches")
+                 && checkRoundTrip(false, nestedBlocks(40000), 2, "Many blocks")
+                 && checkCorruption()
+                 && checkFilters();
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,213 @@
+// Checks LZ4-style compression of profiler data (see easy_profiler_core/compression.h):
+// round trip of single chunks and of chunked containers, rejecting of corrupted data.
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <easy/reader.h>
+#include "compression.h"
+#include "outstream.h"
+
+namespace {
+
+    std::vector<char> randomData(size_t _size, uint64_t _seed)
+    {
+        std::vector<char> data(_size);
+        for (auto& byte : data)
+        {
+            _seed = _seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            byte = static_cast<char>(_seed >> 56);
+        }
+
+        return data;
+    }
+
+    // Looks like serialized blocks: small records with slowly growing timestamps and repeated names
+    std::vector<char> recordsData(size_t _size)
+    {
+        std::vector<char> data;
+        uint64_t time = 1ULL << 40;
+        for (uint32_t i = 0; data.size() < _size; ++i)
+        {
+            time += 1000 + (i % 13) * 7;
+            const uint32_t id = i % 5;
+            const std::string name = i % 3 == 0 ? "Frame" : "";
+            data.insert(data.end(), reinterpret_cast<const char*>(&time), reinterpret_cast<const char*>(&time) + sizeof(time));
+            data.insert(data.end(), reinterpret_cast<const char*>(&id), reinterpret_cast<const char*>(&id) + sizeof(id));
+            data.insert(data.end(), name.c_str(), name.c_str() + name.size() + 1);
+        }
+
+        data.resize(_size);
+        return data;
+    }
+
+    bool checkBlock(const std::vector<char>& _data, const char* _title, bool _compressible)
+    {
+        // Worst case: literals only (token, length bytes and literals)
+        std::vector<char> compressed(_data.size() + _data.size() / 255 + 16);
+        const auto size = profiler::compression::compressBlock(_data.data(), _data.size(), compressed.data(), compressed.size());
+        if (size == 0)
+        {
+            std::cerr << _title << ": compressed data does not fit into the worst case size\n";
+            return false;
+        }
+
+        if (_compressible && size >= _data.size())
+        {
+            std::cerr << _title << ": " << _data.size() << " bytes compressed only into " << size << " bytes\n";
+            return false;
+        }
+
+        std::vector<char> decompressed(_data.size() + 1, 0);
+        if (!profiler::compression::decompressBlock(compressed.data(), size, decompressed.data(), _data.size())
+            || memcmp(decompressed.data(), _data.data(), _data.size()) != 0)
+        {
+            std::cerr << _title << ": round trip failed\n";
+            return false;
+        }
+
+        // Decompressed size must be exact
+        if (!_data.empty() && profiler::compression::decompressBlock(compressed.data(), size, decompressed.data(), _data.size() + 1))
+        {
+            std::cerr << _title << ": data has been decompressed into bigger size\n";
+            return false;
+        }
+
+        if (!_data.empty() && profiler::compression::decompressBlock(compressed.data(), size, decompressed.data(), _data.size() - 1))
+        {
+            std::cerr << _title << ": data has been decompressed into smaller size\n";
+            return false;
+        }
+
+        // Data which does not fit into destination must not be compressed
+        if (size > 1 && profiler::compression::compressBlock(_data.data(), _data.size(), compressed.data(), size - 1) != 0)
+        {
+            std::cerr << _title << ": data has been compressed into too small buffer\n";
+            return false;
+        }
+
+        return true;
+    }
+
+    bool checkBlocks()
+    {
+        std::string overlapped;
+        for (int i = 0; i < 1000; ++i)
+            overlapped += "ab";
+
+        bool ok = checkBlock(std::vector<char>(), "Empty", false)
+               && checkBlock(std::vector<char>(1, 'x'), "One byte", false)
+               && checkBlock(std::vector<char>(12, 'x'), "Shorter than match limit", false)
+               && checkBlock(std::vector<char>(13, 'x'), "Match limit", false)
+               && checkBlock(std::vector<char>(100000, 0), "Zeros", true)
+               && checkBlock(std::vector<char>(overlapped.begin(), overlapped.end()), "Overlapped matches", true)
+               && checkBlock(recordsData(300000), "Records", true)
+               && checkBlock(randomData(100000, 1), "Random", false);
+
+        // Matches with maximum offset and beyond it
+        auto data = randomData(200000, 2);
+        memcpy(data.data() + 65535 + 1000, data.data() + 1000, 500);
+        memcpy(data.data() + 65536 + 3000, data.data() + 3000, 500);
+        ok = ok && checkBlock(data, "Far matches", false);
+
+        return ok;
+    }
+
+    bool checkCorruptedBlock()
+    {
+        const auto data = recordsData(10000);
+        std::vector<char> compressed(data.size() * 2), decompressed(data.size());
+        const auto size = profiler::compression::compressBlock(data.data(), data.size(), compressed.data(), compressed.size());
+
+        for (size_t truncated = 1; truncated < size; truncated += 97)
+        {
+            if (profiler::compression::decompressBlock(compressed.data(), truncated, decompressed.data(), decompressed.size()))
+            {
+                std::cerr << "Block truncated to " << truncated << " bytes has been decompressed\n";
+                return false;
+            }
+        }
+
+        // Match offset pointing before the beginning of the output
+        const char bad[] = {0x10, 'a', 0x02, 0x00, 0x00};
+        if (profiler::compression::decompressBlock(bad, sizeof(bad), decompressed.data(), 5))
+        {
+            std::cerr << "Block with bad match offset has been decompressed\n";
+            return false;
+        }
+
+        return true;
+    }
+
+    bool checkContainer()
+    {
+        // Several buffers (chunks) of the stream: compressible, incompressible and the last one partially filled
+        const auto records = recordsData(profiler::OStream::BUFFER_SIZE + 1000);
+        const auto random = randomData(profiler::OStream::BUFFER_SIZE, 3);
+
+        profiler::OStream input;
+        input.write(records.data(), records.size());
+        input.write(random.data(), random.size());
+        input.write(records.data(), 12345);
+
+        std::vector<char> original(records);
+        original.insert(original.end(), random.begin(), random.end());
+        original.insert(original.end(), records.begin(), records.begin() + 12345);
+
+        profiler::OStream output;
+        profiler::compression::compress(input, output);
+
+        std::vector<char> container;
+        for (size_t i = 0; i < output.buffersNumber(); ++i)
+            container.insert(container.end(), output.bufferData(i), output.bufferData(i) + output.bufferSize(i));
+
+        if (container.size() != output.size() || !profiler::compression::isCompressed(container.data(), container.size()))
+        {
+            std::cerr << "Compressed container has no signature\n";
+            return false;
+        }
+
+        if (container.size() >= original.size() || input.buffersNumber() < 3)
+        {
+            std::cerr << "Container of " << input.buffersNumber() << " chunks takes " << container.size() << " bytes for "
+                      << original.size() << " bytes of data\n";
+            return false;
+        }
+
+        profiler::SerializedData decompressed;
+        if (!profiler::compression::decompress(container.data(), container.size(), decompressed)
+            || decompressed.size() != original.size() || memcmp(decompressed.data(), original.data(), original.size()) != 0)
+        {
+            std::cerr << "Container round trip failed\n";
+            return false;
+        }
+
+        if (profiler::compression::isCompressed(original.data(), original.size()))
+        {
+            std::cerr << "Not compressed data has been detected as compressed\n";
+            return false;
+        }
+
+        profiler::SerializedData truncated;
+        if (profiler::compression::decompress(container.data(), container.size() / 2, truncated))
+        {
+            std::cerr << "Truncated container has been decompressed\n";
+            return false;
+        }
+
+        return true;
+    }
+
+} // END of namespace.
+
+int main()
+{
+    const bool ok = checkBlocks()
+                 && checkCorruptedBlock()
+                 && checkContainer();
+
+    return ok ? 0 : 1;
+}
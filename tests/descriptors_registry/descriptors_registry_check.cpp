@@ -0,0 +1,157 @@
+// Registers the same set of descriptors from several threads at once (see easy_profiler_core/descriptors_registry.h)
+// while other threads read descriptors by id and take snapshots with lock()/unlock().
+// Checks that each key gets exactly one descriptor with unique id and that published descriptors are always readable.
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <easy/profiler.h>
+#include "descriptors_registry.h"
+
+namespace {
+
+    const size_t THREADS_NUMBER = 8;
+    const size_t KEYS_NUMBER = 5000; ///< Several registry chunks
+
+    struct Descriptor
+    {
+        profiler::block_id_t id;
+        std::string         key;
+    };
+
+    typedef DescriptorsRegistry<Descriptor> Registry;
+
+    std::string makeKey(size_t _index)
+    {
+        return "file.cpp:" + std::to_string(_index) + ":block";
+    }
+
+} // END of namespace.
+
+int main()
+{
+    Registry registry;
+    std::atomic<uint32_t> created(ATOMIC_VAR_INIT(0U));
+    std::atomic<bool> registering(ATOMIC_VAR_INIT(true));
+    std::atomic<bool> failed(ATOMIC_VAR_INIT(false));
+
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < KEYS_NUMBER; ++i)
+        keys.push_back(makeKey(i));
+
+    // Descriptor and stored key found by each thread for each key
+    std::vector<std::vector<Registry::Entry> > found(THREADS_NUMBER, std::vector<Registry::Entry>(KEYS_NUMBER));
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < THREADS_NUMBER; ++t)
+    {
+        threads.emplace_back([&, t] {
+            // Each thread registers keys in it's own order (and every key twice):
+            // multipliers are coprime with KEYS_NUMBER, so each order is a permutation
+            const size_t multipliers[THREADS_NUMBER] = {1, 3, 7, 9, 11, 13, 17, 19};
+            std::vector<size_t> order(KEYS_NUMBER);
+            for (size_t i = 0; i < KEYS_NUMBER; ++i)
+                order[i] = (i * multipliers[t] + t * 977) % KEYS_NUMBER;
+
+            for (int pass = 0; pass < 2; ++pass)
+            {
+                for (auto index : order)
+                {
+                    const char* key = keys[index].c_str();
+                    auto entry = registry.findOrAdd(key, Registry::hash(key), [&](profiler::block_id_t _id) {
+                        created.fetch_add(1, std::memory_order_relaxed);
+                        return new Descriptor {_id, keys[index]};
+                    });
+
+                    if (entry.descriptor == nullptr || (pass != 0 && entry.descriptor != found[t][index].descriptor))
+                        failed.store(true);
+
+                    found[t][index] = entry;
+                }
+            }
+        });
+    }
+
+    // Reader: published descriptors must be readable by their ids without locking
+    std::thread reader([&] {
+        while (registering.load())
+        {
+            const auto size = registry.size();
+            for (profiler::block_id_t id = 0; id < size; ++id)
+            {
+                auto descriptor = registry.get(id);
+                if (descriptor != nullptr && descriptor->id != id)
+                    failed.store(true);
+            }
+        }
+    });
+
+    // Snapshot: after lock() all descriptors with id less than size() must be published
+    std::thread snapshot([&] {
+        while (registering.load())
+        {
+            registry.lock();
+            const auto size = registry.size();
+            for (profiler::block_id_t id = 0; id < size; ++id)
+            {
+                if (registry.get(id) == nullptr)
+                    failed.store(true);
+            }
+            registry.unlock();
+            std::this_thread::yield();
+        }
+    });
+
+    for (auto& thread : threads)
+        thread.join();
+
+    registering.store(false);
+    reader.join();
+    snapshot.join();
+
+    bool ok = !failed.load();
+    if (!ok)
+        std::cerr << "Descriptor has been changed or has not been published while registering\n";
+
+    if (ok && (registry.size() != KEYS_NUMBER || created.load() != KEYS_NUMBER))
+    {
+        std::cerr << created.load() << " descriptors created and " << registry.size() << " registered for " << KEYS_NUMBER << " keys\n";
+        ok = false;
+    }
+
+    std::vector<bool> used(KEYS_NUMBER, false);
+    for (size_t i = 0; ok && i < KEYS_NUMBER; ++i)
+    {
+        const auto& entry = found[0][i];
+        for (size_t t = 1; t < THREADS_NUMBER; ++t)
+        {
+            if (found[t][i].descriptor != entry.descriptor || found[t][i].key != entry.key)
+            {
+                std::cerr << "Key \"" << keys[i] << "\" has got different descriptors in different threads\n";
+                ok = false;
+            }
+        }
+
+        const auto id = entry.descriptor->id;
+        if (entry.descriptor->key != keys[i] || strcmp(entry.key, keys[i].c_str()) != 0 || id >= KEYS_NUMBER || used[id]
+            || registry.get(id) != entry.descriptor)
+        {
+            std::cerr << "Key \"" << keys[i] << "\" has got wrong descriptor or id " << id << "\n";
+            ok = false;
+        }
+        else
+        {
+            used[id] = true;
+        }
+    }
+
+    for (profiler::block_id_t id = 0; id < registry.size(); ++id)
+        delete registry.get(id);
+
+    return ok ? 0 : 1;
+}
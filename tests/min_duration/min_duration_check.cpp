@@ -0,0 +1,144 @@
+// Captures blocks with global and per descriptor minimum duration (see profiler::setMinBlockDuration) and checks that
+// only long enough blocks are stored, events are never filtered and filtered blocks are counted in thread summaries.
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+
+#include <easy/profiler.h>
+#include <easy/reader.h>
+
+namespace {
+
+    const uint32_t KEPT_NUMBER = 10;
+    const uint32_t SHORT_NUMBER = 50; ///< Number of short blocks inside each kept block
+
+    void spin(uint32_t _microseconds)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        while (std::chrono::steady_clock::now() - start < std::chrono::microseconds(_microseconds));
+    }
+
+    // Blocks of the tree are walked: flat list of blocks contains context switches too
+    void collect(const profiler::blocks_t& _blocks, const profiler::descriptors_list_t& _descriptors,
+                 const profiler::BlocksTree::children_t& _children, std::map<std::string, uint32_t>& _stored)
+    {
+        for (auto i : _children)
+        {
+            const auto& block = _blocks[i];
+            ++_stored[_descriptors[block.node->id()]->name()];
+            collect(_blocks, _descriptors, block.children, _stored);
+        }
+    }
+
+    bool checkStored(const std::map<std::string, uint32_t>& _stored, const std::string& _name, uint32_t _expected)
+    {
+        const auto it = _stored.find(_name);
+        const uint32_t stored = it != _stored.end() ? it->second : 0;
+        if (stored != _expected)
+        {
+            std::cerr << "Block \"" << _name << "\" has been stored " << stored << " times instead of " << _expected << "\n";
+            return false;
+        }
+
+        return true;
+    }
+
+    bool checkSummary(const profiler::BlocksTreeRoot& _root, const profiler::descriptors_list_t& _descriptors,
+                      const std::string& _name, uint32_t _expected)
+    {
+        uint32_t calls = 0;
+        bool hasDuration = true;
+        for (const auto& summary : _root.summaries)
+        {
+            if (_descriptors[summary.id]->name() != _name)
+                continue;
+
+            calls += summary.calls_number;
+            hasDuration = hasDuration && summary.total_duration != 0;
+        }
+
+        if (calls != _expected || !hasDuration)
+        {
+            std::cerr << "Summary of block \"" << _name << "\" has " << calls << " calls instead of " << _expected << "\n";
+            return false;
+        }
+
+        return true;
+    }
+
+} // END of namespace.
+
+int main()
+{
+    EASY_MAIN_THREAD;
+    EASY_PROFILER_ENABLE;
+
+    // Everything shorter than 1 second is filtered except of "Kept" block
+    profiler::setMinBlockDuration(1000000000ULL);
+
+    const auto kept = profiler::registerDescription(profiler::ON, "min_duration_check_kept", "Kept", __FILE__, __LINE__,
+                                                    profiler::BLOCK_TYPE_BLOCK, profiler::colors::Default);
+    profiler::setBlockMinDuration(kept->id(), 1000);
+
+    for (uint32_t i = 0; i < KEPT_NUMBER; ++i)
+    {
+        profiler::beginNonScopedBlock(kept);
+        spin(100);
+
+        for (uint32_t j = 0; j < SHORT_NUMBER; ++j)
+        {
+            EASY_BLOCK("Short");
+        }
+
+        profiler::endBlock();
+        EASY_EVENT("Event");
+    }
+
+    const char* output = "min_duration.prof";
+    profiler::dumpBlocksToFile(output);
+
+    profiler::SerializedData serializedBlocks, serializedDescriptors;
+    profiler::descriptors_list_t descriptors;
+    profiler::blocks_t blocks;
+    profiler::thread_blocks_tree_t trees;
+    uint32_t descriptorsNumber = 0, version = 0;
+    std::stringstream log;
+
+    if (fillTreesFromFile(output, serializedBlocks, serializedDescriptors, descriptors, blocks, trees,
+                          descriptorsNumber, version, true, log) == 0)
+    {
+        std::cerr << "Can not read \"" << output << "\": " << log.str() << "\n";
+        return 1;
+    }
+
+    // Profiler's own threads are captured too
+    const profiler::BlocksTreeRoot* root = nullptr;
+    for (const auto& thread : trees)
+    {
+        if (thread.second.thread_name == "Main")
+            root = &thread.second;
+    }
+
+    if (root == nullptr)
+    {
+        std::cerr << "Main thread has not been stored\n";
+        return 1;
+    }
+
+    std::map<std::string, uint32_t> stored;
+    collect(blocks, descriptors, root->children, stored);
+
+    bool ok = checkSummary(*root, descriptors, "Short", KEPT_NUMBER * SHORT_NUMBER)
+           && checkSummary(*root, descriptors, "Kept", 0)
+           && checkSummary(*root, descriptors, "Event", 0);
+
+    ok = ok && checkStored(stored, "Kept", KEPT_NUMBER)
+            && checkStored(stored, "Event", KEPT_NUMBER)
+            && checkStored(stored, "Short", 0);
+
+    return ok ? 0 : 1;
+}
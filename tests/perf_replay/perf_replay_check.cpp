@@ -0,0 +1,207 @@
+// Replays context switch events recorded by built-in linux event tracer (see EASY_PROFILER_PERF_REPLAY)
+// and checks that they are stored for profiled threads.
+//
+// Fixtures have been recorded by process 4242 (it's main thread) with worker thread 4243,
+// other thread 4194000 belongs to another process. Their ids are replaced by ids of this process threads
+// before replaying. Each fixture contains 5 context switches of the main thread and 3 of the worker thread.
+
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <easy/profiler.h>
+#include <easy/reader.h>
+
+namespace {
+
+    const uint32_t RECORDED_PROCESS = 4242;
+    const uint32_t RECORDED_WORKER = 4243;
+    const uint32_t OTHER_THREAD = 4194000;
+
+    const size_t MAIN_SWITCHES = 5;
+    const size_t WORKER_SWITCHES = 3;
+
+    // Replay-file header: "EASYPERF", mode, prev_pid offset, next_pid offset, next_comm offset
+    const size_t HEADER_SIZE = 8 + 4 * sizeof(uint32_t);
+
+    uint32_t thisThreadId()
+    {
+        return static_cast<uint32_t>(syscall(SYS_gettid));
+    }
+
+    void patchId(char* _data, uint32_t _worker)
+    {
+        uint32_t value;
+        memcpy(&value, _data, sizeof(uint32_t));
+
+        if (value == RECORDED_PROCESS)
+            value = static_cast<uint32_t>(getpid());
+        else if (value == RECORDED_WORKER)
+            value = _worker;
+
+        memcpy(_data, &value, sizeof(uint32_t));
+    }
+
+    bool patchFixture(std::vector<char>& _data, uint32_t _worker)
+    {
+        if (_data.size() < HEADER_SIZE || memcmp(_data.data(), "EASYPERF", 8) != 0)
+            return false;
+
+        uint32_t offsets[3];
+        memcpy(offsets, _data.data() + 8 + sizeof(uint32_t), sizeof(offsets));
+
+        size_t pos = HEADER_SIZE;
+        while (pos + sizeof(perf_event_header) <= _data.size())
+        {
+            perf_event_header header;
+            memcpy(&header, _data.data() + pos, sizeof(perf_event_header));
+            if (header.size < sizeof(perf_event_header) || pos + header.size > _data.size())
+                return false;
+
+            char* data = _data.data() + pos + sizeof(perf_event_header);
+            if (header.type == PERF_RECORD_SAMPLE)
+            {
+                // u32 pid, tid; u64 time; u32 cpu, res; u32 size; char raw[size];
+                patchId(data, _worker);
+                patchId(data + 4, _worker);
+                patchId(data + 28 + offsets[0], _worker);
+                patchId(data + 28 + offsets[1], _worker);
+            }
+            else if (header.type == PERF_RECORD_SWITCH_CPU_WIDE)
+            {
+                // u32 next_prev_pid, next_prev_tid; sample_id { u32 pid, tid; u64 time; u32 cpu, res; }
+                for (int i = 0; i < 4; ++i)
+                    patchId(data + i * 4, _worker);
+            }
+
+            pos += header.size;
+        }
+
+        return pos == _data.size();
+    }
+
+    bool checkThread(const profiler::thread_blocks_tree_t& _trees, const profiler::blocks_t& _blocks,
+                     uint32_t _thread, size_t _expected)
+    {
+        const auto it = _trees.find(_thread);
+        if (it == _trees.end())
+        {
+            std::cerr << "Thread " << _thread << " has not been written\n";
+            return false;
+        }
+
+        const auto& sync = it->second.sync;
+        if (sync.size() != _expected)
+        {
+            std::cerr << "Thread " << _thread << " has " << sync.size() << " context switches instead of " << _expected << "\n";
+            return false;
+        }
+
+        for (auto index : sync)
+        {
+            const auto& cs = _blocks[index].cs;
+            if (cs->tid() != OTHER_THREAD || cs->end() <= cs->begin())
+            {
+                std::cerr << "Thread " << _thread << " has bad context switch (target " << cs->tid() << ")\n";
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+} // END of namespace.
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " FIXTURE\n";
+        return 2;
+    }
+
+    std::ifstream fixture(argv[1], std::ios::binary);
+    std::vector<char> data((std::istreambuf_iterator<char>(fixture)), std::istreambuf_iterator<char>());
+
+    // Worker thread must be registered before the events are replayed
+    std::mutex mutex;
+    std::condition_variable cv;
+    uint32_t worker = 0;
+    bool finish = false;
+
+    std::thread thread([&] {
+        EASY_THREAD("Worker");
+        std::unique_lock<std::mutex> lock(mutex);
+        worker = thisThreadId();
+        cv.notify_all();
+        cv.wait(lock, [&] { return finish; });
+    });
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&] { return worker != 0; });
+    }
+
+    EASY_MAIN_THREAD;
+
+    if (!patchFixture(data, worker))
+    {
+        std::cerr << "\"" << argv[1] << "\" is not a replay-file\n";
+        return 1;
+    }
+
+    const std::string replay = std::string(argv[1]).substr(std::string(argv[1]).find_last_of('/') + 1) + ".patched";
+    std::ofstream(replay.c_str(), std::ios::binary).write(data.data(), static_cast<std::streamsize>(data.size()));
+    setenv("EASY_PROFILER_PERF_REPLAY", replay.c_str(), 1);
+
+    EASY_SET_EVENT_TRACING_ENABLED(true);
+    EASY_PROFILER_ENABLE;
+
+    {
+        // Replayed events are shifted to the moment of enabling the profiler and last for 10ms
+        EASY_BLOCK("Wait for replay");
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+
+    const std::string output = replay + ".prof";
+    profiler::dumpBlocksToFile(output.c_str());
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        finish = true;
+        cv.notify_all();
+    }
+
+    thread.join();
+
+    profiler::SerializedData serializedBlocks, serializedDescriptors;
+    profiler::descriptors_list_t descriptors;
+    profiler::blocks_t blocks;
+    profiler::thread_blocks_tree_t trees;
+    uint32_t descriptorsNumber = 0, version = 0;
+    std::stringstream log;
+
+    if (fillTreesFromFile(output.c_str(), serializedBlocks, serializedDescriptors, descriptors, blocks, trees,
+                          descriptorsNumber, version, true, log) == 0)
+    {
+        std::cerr << "Can not read \"" << output << "\": " << log.str() << "\n";
+        return 1;
+    }
+
+    const bool ok = checkThread(trees, blocks, static_cast<uint32_t>(getpid()), MAIN_SWITCHES)
+                 && checkThread(trees, blocks, worker, WORKER_SWITCHES);
+
+    return ok ? 0 : 1;
+}
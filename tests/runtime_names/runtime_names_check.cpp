@@ -0,0 +1,236 @@
+// Checks interning of runtime block names (see easy_profiler_core/runtime_names.h): ids of equal and reused names,
+// the table limit, generations of tables and resolving of interned names by decoder (see easy_profiler_core/compact_format.h).
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <easy/profiler.h>
+#include "runtime_names.h"
+
+namespace {
+
+    // Serialized tables of one thread section parsed as reader does it
+    struct Tables
+    {
+        std::string                                     data;
+        std::vector<profiler::compact::RuntimeName>    names;
+        profiler::compact::NamesTable tables[profiler::compact::NAMES_TABLES_NUMBER];
+    };
+
+    bool parse(const RuntimeNames& _runtimeNames, Tables& _tables)
+    {
+        std::ostringstream output;
+        profiler::OStream stream(output);
+        _runtimeNames.serialize(stream);
+        stream.flush();
+
+        _tables.data = output.str();
+        _tables.names.clear();
+
+        size_t pos = 0;
+        for (auto& table : _tables.tables)
+        {
+            uint32_t header[2];
+            if (_tables.data.size() - pos < sizeof(header))
+                return false;
+
+            memcpy(header, _tables.data.data() + pos, sizeof(header));
+            pos += sizeof(header);
+
+            table.generation = header[0];
+            table.begin = static_cast<uint32_t>(_tables.names.size());
+            table.size = header[1];
+
+            for (uint32_t i = 0; i < table.size; ++i)
+            {
+                uint16_t length = 0;
+                if (_tables.data.size() - pos < sizeof(uint16_t))
+                    return false;
+
+                memcpy(&length, _tables.data.data() + pos, sizeof(uint16_t));
+                pos += sizeof(uint16_t);
+                if (_tables.data.size() - pos < length)
+                    return false;
+
+                _tables.names.push_back(profiler::compact::RuntimeName {_tables.data.data() + pos, length});
+                pos += length;
+            }
+        }
+
+        return pos == _tables.data.size();
+    }
+
+    // Encode block with interned name as ThreadStorage stores it and decode it back with the tables
+    bool resolve(const Tables& _tables, uint32_t _id, uint16_t _length, std::string& _name, uint32_t& _nameIndex)
+    {
+        std::vector<char> record(sizeof(profiler::BaseBlockData) + profiler::compact::INTERNED_NAME_SIZE, 0);
+        const profiler::timestamp_t begin = 100, end = 200;
+        const profiler::block_id_t blockId = 7;
+        memcpy(record.data(), &begin, sizeof(profiler::timestamp_t));
+        memcpy(record.data() + sizeof(profiler::timestamp_t), &end, sizeof(profiler::timestamp_t));
+        memcpy(record.data() + sizeof(profiler::Event), &blockId, sizeof(profiler::block_id_t));
+        memcpy(record.data() + sizeof(profiler::BaseBlockData) + 1, &_id, sizeof(uint32_t));
+        memcpy(record.data() + sizeof(profiler::BaseBlockData) + 1 + sizeof(uint32_t), &_length, sizeof(uint16_t));
+
+        std::ostringstream output;
+        {
+            profiler::OStream stream(output);
+            {
+                profiler::compact::PacketWriter writer(stream, false);
+                writer.add(record.data(), static_cast<uint16_t>(record.size()));
+            }
+            stream.flush();
+        }
+
+        const auto packet = output.str();
+        uint32_t header[3];
+        memcpy(header, packet.data(), sizeof(header));
+
+        std::vector<char> decoded(header[2]);
+        std::vector<uint32_t> nameIds;
+        if (!profiler::compact::decode(false, packet.data() + profiler::compact::PACKET_HEADER_SIZE, header[1], header[0],
+                                       decoded.data(), header[2], &_tables.names, &nameIds, _tables.tables) || nameIds.size() != 1)
+        {
+            return false;
+        }
+
+        _name = decoded.data() + sizeof(uint16_t) + sizeof(profiler::BaseBlockData);
+        _nameIndex = nameIds.front();
+        return true;
+    }
+
+    bool checkInterning()
+    {
+        RuntimeNames names;
+        uint16_t length = 0, otherLength = 0;
+
+        const auto id = names.intern("Load texture", length);
+        if (id == RuntimeNames::NO_ID || length != 12)
+        {
+            std::cerr << "Name has not been interned\n";
+            return false;
+        }
+
+        // The same name passed by another pointer
+        const std::string copy = "Load texture";
+        if (names.intern(copy.c_str(), otherLength) != id || otherLength != length)
+        {
+            std::cerr << "Equal names have got different ids\n";
+            return false;
+        }
+
+        // The same buffer reused for another name (pointer cache must compare contents)
+        char buffer[32] = "Frame 1";
+        const auto first = names.intern(buffer, length);
+        strcpy(buffer, "Frame 22");
+        const auto second = names.intern(buffer, otherLength);
+        if (first == second || otherLength != 8 || names.intern("Frame 1", length) != first)
+        {
+            std::cerr << "Reused buffer has got id of the previous name\n";
+            return false;
+        }
+
+        // Table is full: new names are not interned, interned ones are still found
+        std::vector<std::string> many;
+        for (uint32_t i = 0; i < RuntimeNames::MAX_NAMES; ++i)
+            many.push_back("Name " + std::to_string(i));
+
+        uint32_t interned = 0;
+        for (const auto& name : many)
+        {
+            if (names.intern(name.c_str(), length) != RuntimeNames::NO_ID)
+                ++interned;
+        }
+
+        if (interned != RuntimeNames::MAX_NAMES - 3 || names.intern("Load texture", length) != id
+            || names.intern("Not interned", length) != RuntimeNames::NO_ID)
+        {
+            std::cerr << interned << " names interned into the table of " << RuntimeNames::MAX_NAMES << " names\n";
+            return false;
+        }
+
+        return true;
+    }
+
+    bool checkGenerations()
+    {
+        RuntimeNames names;
+        uint16_t length = 0;
+
+        const auto oldId = names.intern("Old name", length);
+        const auto sharedId = names.intern("Shared name", length);
+
+        // Reset is done by owner thread on the next interning after dump
+        names.requestReset();
+        const auto newId = names.intern("New name", length);
+        const auto sharedNewId = names.intern("Shared name", length);
+
+        if (newId == oldId || sharedNewId == sharedId
+            || (newId >> profiler::compact::NAME_GENERATION_SHIFT) != (oldId >> profiler::compact::NAME_GENERATION_SHIFT) + 1)
+        {
+            std::cerr << "New table generation has not been started\n";
+            return false;
+        }
+
+        // Both generations are written and resolved
+        Tables tables;
+        std::string name;
+        uint32_t nameIndex = 0;
+        if (!parse(names, tables))
+        {
+            std::cerr << "Names tables can not be parsed\n";
+            return false;
+        }
+
+        if (!resolve(tables, oldId, 8, name, nameIndex) || name != "Old name" || nameIndex == profiler::compact::NO_NAME_ID
+            || !resolve(tables, newId, 8, name, nameIndex) || name != "New name"
+            || !resolve(tables, sharedId, 11, name, nameIndex) || name != "Shared name")
+        {
+            std::cerr << "Names of previous and current generations have not been resolved\n";
+            return false;
+        }
+
+        // Names of older generations are unknown (but blocks keep the length of their names)
+        names.requestReset();
+        names.intern("Newest name", length);
+        if (!parse(names, tables) || !resolve(tables, oldId, 8, name, nameIndex) || name != "????????"
+            || nameIndex != profiler::compact::NO_NAME_ID)
+        {
+            std::cerr << "Name of too old generation has been resolved\n";
+            return false;
+        }
+
+        // Generation wraps around but name id never becomes NO_NAME_ID
+        for (uint32_t i = 0; i <= profiler::compact::NAME_GENERATION_MASK + 1; ++i)
+        {
+            names.requestReset();
+            const auto id = names.intern("Wrapped name", length);
+            if (id == RuntimeNames::NO_ID || id == profiler::compact::NO_NAME_ID)
+            {
+                std::cerr << "Name id of generation " << i << " is not valid\n";
+                return false;
+            }
+        }
+
+        if (!parse(names, tables) || !resolve(tables, names.intern("Wrapped name", length), 12, name, nameIndex) || name != "Wrapped name")
+        {
+            std::cerr << "Name has not been resolved after generation wrap around\n";
+            return false;
+        }
+
+        return true;
+    }
+
+} // END of namespace.
+
+int main()
+{
+    const bool ok = checkInterning()
+                 && checkGenerations();
+
+    return ok ? 0 : 1;
+}
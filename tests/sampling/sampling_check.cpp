@@ -0,0 +1,119 @@
+// Captures blocks with sampling rate (see profiler::Sampling) and checks that only 1 of each rate blocks is stored,
+// stored blocks keep their rate and statistics scale calls number of stored blocks back by the rate.
+
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+
+#include <easy/profiler.h>
+#include <easy/reader.h>
+
+namespace {
+
+    const uint32_t CALLS_NUMBER = 1000;
+    const uint16_t RATE = 3;
+
+    struct Stored
+    {
+        uint32_t                          blocks = 0;
+        bool                         wrongRate = false;
+        const profiler::BlockStatistics* stats = nullptr;
+    };
+
+    // Blocks of the tree are walked: flat list of blocks contains context switches too
+    void collect(const profiler::blocks_t& _blocks, const profiler::descriptors_list_t& _descriptors,
+                 const profiler::BlocksTree::children_t& _children, std::map<std::string, Stored>& _stored)
+    {
+        for (auto i : _children)
+        {
+            const auto& block = _blocks[i];
+            const auto descriptor = _descriptors[block.node->id()];
+            auto& entry = _stored[descriptor->name()];
+            ++entry.blocks;
+            entry.stats = block.per_thread_stats;
+
+            if (profiler::readSampling(block.node) != descriptor->sampling())
+                entry.wrongRate = true;
+
+            collect(_blocks, _descriptors, block.children, _stored);
+        }
+    }
+
+    bool checkBlock(const std::map<std::string, Stored>& _stored, const std::string& _name, uint16_t _rate)
+    {
+        const auto it = _stored.find(_name);
+        if (it == _stored.end() || it->second.stats == nullptr)
+        {
+            std::cerr << "Block \"" << _name << "\" has not been stored\n";
+            return false;
+        }
+
+        // The first call is stored and then each _rate-th call
+        const auto& stored = it->second;
+        const uint32_t expected = (CALLS_NUMBER + _rate - 1) / _rate;
+        if (stored.blocks != expected || stored.stats->references != expected || stored.wrongRate)
+        {
+            std::cerr << "Block \"" << _name << "\" has been stored " << stored.blocks << " times instead of " << expected << "\n";
+            return false;
+        }
+
+        if (stored.stats->calls_number != expected * _rate)
+        {
+            std::cerr << "Block \"" << _name << "\" has " << stored.stats->calls_number << " calls in statistics instead of "
+                      << expected * _rate << "\n";
+            return false;
+        }
+
+        return true;
+    }
+
+} // END of namespace.
+
+int main()
+{
+    EASY_MAIN_THREAD;
+    EASY_PROFILER_ENABLE;
+
+    {
+        EASY_BLOCK("Root");
+        for (uint32_t i = 0; i < CALLS_NUMBER; ++i)
+        {
+            {
+                EASY_BLOCK("Sampled", profiler::Sampling(RATE));
+                EASY_BLOCK("Child of sampled");
+            }
+
+            EASY_BLOCK("Plain");
+        }
+    }
+
+    const char* output = "sampling.prof";
+    profiler::dumpBlocksToFile(output);
+
+    profiler::SerializedData serializedBlocks, serializedDescriptors;
+    profiler::descriptors_list_t descriptors;
+    profiler::blocks_t blocks;
+    profiler::thread_blocks_tree_t trees;
+    uint32_t descriptorsNumber = 0, version = 0;
+    std::stringstream log;
+
+    if (fillTreesFromFile(output, serializedBlocks, serializedDescriptors, descriptors, blocks, trees,
+                          descriptorsNumber, version, true, log) == 0)
+    {
+        std::cerr << "Can not read \"" << output << "\": " << log.str() << "\n";
+        return 1;
+    }
+
+    std::map<std::string, Stored> stored;
+    for (const auto& thread : trees)
+        collect(blocks, descriptors, thread.second.children, stored);
+
+    // Children of skipped blocks are stored anyway
+    const bool ok = checkBlock(stored, "Sampled", RATE)
+                 && checkBlock(stored, "Child of sampled", 1)
+                 && checkBlock(stored, "Plain", 1);
+
+    return ok ? 0 : 1;
+}
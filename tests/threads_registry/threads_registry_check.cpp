@@ -0,0 +1,177 @@
+// Registers and expires many short-living threads from several workers at once (see easy_profiler_core/threads_registry.h)
+// while the remover thread (like dumping thread of ProfileManager) removes expired storages
+// and the finder thread takes references to storages of random threads.
+// Checks that references keep storages alive and that slots of removed storages are reused.
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <easy/profiler.h>
+#include "threads_registry.h"
+
+namespace {
+
+    const uint32_t WORKERS_NUMBER = 6;
+    const uint32_t ROUNDS_NUMBER = 2000;
+
+    profiler::thread_id_t makeId(uint32_t _worker, uint32_t _round)
+    {
+        return (static_cast<profiler::thread_id_t>(_worker + 1) << 32) | _round;
+    }
+
+    bool validId(profiler::thread_id_t _id)
+    {
+        const auto worker = static_cast<uint32_t>(_id >> 32);
+        return worker >= 1 && worker <= WORKERS_NUMBER && static_cast<uint32_t>(_id) < ROUNDS_NUMBER;
+    }
+
+} // END of namespace.
+
+int main()
+{
+    ThreadsRegistry registry;
+    std::atomic<bool> running(ATOMIC_VAR_INIT(true));
+    std::atomic<bool> failed(ATOMIC_VAR_INIT(false));
+    std::atomic<uint32_t> maxSize(ATOMIC_VAR_INIT(0U));
+
+    // Number of removed storages of each worker: worker does not register next thread
+    // until storage of the thread before previous one is removed, so at most 2 storages per worker exist
+    std::vector<std::atomic<uint32_t> > removed(WORKERS_NUMBER);
+    for (auto& counter : removed)
+        counter.store(0);
+
+    std::vector<std::thread> workers;
+    for (uint32_t w = 0; w < WORKERS_NUMBER; ++w)
+    {
+        workers.emplace_back([&, w] {
+            for (uint32_t round = 0; round < ROUNDS_NUMBER && !failed.load(); ++round)
+            {
+                while (removed[w].load() + 1 < round && !failed.load())
+                    std::this_thread::yield();
+
+                const auto id = makeId(w, round);
+                auto storage = registry.findOrAdd(id);
+                if (storage == nullptr || storage->id != id || registry.find(id).get() != storage.get())
+                {
+                    std::cerr << "Storage of thread " << id << " has not been registered\n";
+                    failed.store(true);
+                    return;
+                }
+
+                const std::string name = "Thread " + std::to_string(id);
+                storage->name = name;
+
+                // Storage must not be destroyed until the reference is released (even if it's expired)
+                storage->expired.store(1, std::memory_order_release);
+                for (int i = 0; i < 3; ++i)
+                    std::this_thread::yield();
+
+                if (storage->id != id || storage->name != name)
+                {
+                    std::cerr << "Storage of thread " << id << " has been destroyed while being referenced\n";
+                    failed.store(true);
+                    return;
+                }
+
+                if (registry.find(id) != nullptr)
+                {
+                    std::cerr << "Expired storage of thread " << id << " has been found\n";
+                    failed.store(true);
+                    return;
+                }
+            }
+        });
+    }
+
+    // Remover: get() and remove() are called by one thread only
+    std::thread remover([&] {
+        while (running.load())
+        {
+            const auto size = registry.size();
+            if (size > maxSize.load())
+                maxSize.store(size);
+
+            for (uint32_t i = 0; i < size; ++i)
+            {
+                auto storage = registry.get(i);
+                if (storage == nullptr || storage->expired.load(std::memory_order_acquire) == 0)
+                    continue;
+
+                const auto id = storage->id;
+                if (!validId(id))
+                {
+                    std::cerr << "Slot " << i << " contains storage of unknown thread " << id << "\n";
+                    failed.store(true);
+                }
+
+                registry.remove(i);
+
+                if (registry.get(i) != nullptr && registry.get(i)->id == id)
+                {
+                    std::cerr << "Storage of thread " << id << " has not been removed\n";
+                    failed.store(true);
+                }
+
+                removed[static_cast<uint32_t>(id >> 32) - 1].fetch_add(1);
+            }
+
+            std::this_thread::yield();
+        }
+    });
+
+    // Finder: references to storages of other threads are either empty or point to the requested thread
+    std::thread finder([&] {
+        uint64_t seed = 1;
+        while (running.load())
+        {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            const auto id = makeId(static_cast<uint32_t>(seed >> 33) % WORKERS_NUMBER, static_cast<uint32_t>(seed >> 40) % ROUNDS_NUMBER);
+            auto storage = registry.find(id);
+            if (storage != nullptr && storage->id != id)
+            {
+                std::cerr << "Storage of thread " << storage->id << " has been found instead of " << id << "\n";
+                failed.store(true);
+            }
+
+            std::this_thread::yield();
+        }
+    });
+
+    for (auto& worker : workers)
+        worker.join();
+
+    running.store(false);
+    remover.join();
+    finder.join();
+
+    bool ok = !failed.load();
+
+    // Slots are reused: there were never more than 2 storages per worker at once
+    if (ok && (maxSize.load() > 2 * WORKERS_NUMBER || registry.size() > 2 * WORKERS_NUMBER))
+    {
+        std::cerr << registry.size() << " slots used for " << WORKERS_NUMBER * ROUNDS_NUMBER << " threads\n";
+        ok = false;
+    }
+
+    // Remove the rest and check that all slots are reused by new threads
+    const auto size = registry.size();
+    for (uint32_t i = 0; i < size; ++i)
+        registry.remove(i);
+
+    std::vector<ThreadsRegistry::Reference> storages;
+    for (uint32_t i = 0; ok && i < size; ++i)
+    {
+        storages.push_back(registry.findOrAdd(makeId(0, i)));
+        if (storages.back() == nullptr || registry.size() != size)
+        {
+            std::cerr << "Free slot has not been reused\n";
+            ok = false;
+        }
+    }
+
+    return ok ? 0 : 1;
+}